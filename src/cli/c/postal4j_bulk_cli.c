@@ -0,0 +1,228 @@
+/*
+ * postal4j_bulk_cli.c
+ * Standalone bulk parse/expand of newline delimited address files, no JVM involved
+ *
+ * usage: postal4jBulk [options] INPUT OUTPUT
+ */
+
+#include "postal4j_bulk.h"
+#include "postal4j_cache.h"
+#include "postal4j_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Minimum seconds between progress lines
+#define PROGRESS_INTERVAL 1.0
+
+typedef struct {
+    double lastReport;
+    bool quiet;
+} cliProgress_t;
+
+/*
+ * Print the usage message
+ * @param program the program name
+ */
+static void usage(const char *program) {
+    fprintf(stderr,
+        "usage: %s [options] INPUT OUTPUT\n"
+        "\n"
+        "Parses or expands every line of INPUT, writing one record per line to OUTPUT in input order.\n"
+        "\n"
+        "  --parse          parse addresses (default)\n"
+        "  --expand         expand addresses\n"
+        "  --expand-root    expand addresses to their root forms\n"
+        "  --tsv            tab separated output (default)\n"
+        "  --binary         compact binary output\n"
+        "  --data-dir DIR   libpostal data directory\n"
+        "  --workers N      native worker threads (default: one less than the number of cores)\n"
+        "  --cache N        result cache entries (default: 0, disabled)\n"
+        "  --chunk N        lines per chunk (default: %d)\n"
+        "  --quiet          no progress output\n",
+        program, DEFAULT_BULK_CHUNK_LINES);
+}
+
+/*
+ * Parse a non-negative integer option value
+ * @param value the option value
+ * @param max the largest allowed value
+ * @param parsed set to the parsed value
+ * @return true if the value is valid
+ */
+static bool parseCount(const char *value, long max, long *parsed) {
+    char *end = NULL;
+    long count = (value != NULL ? strtol(value, &end, 10) : -1);
+
+    if (value == NULL || *end != '\0' || count < 0 || count > max) {
+        return false;
+    }
+
+    *parsed = count;
+    return true;
+}
+
+/*
+ * Progress callback, prints a progress line at most once per interval
+ * @param progress the current counters
+ * @param context the CLI progress state
+ * @return true to keep going
+ */
+static bool printProgress(const bulkProgress_t *progress, void *context) {
+    cliProgress_t *state = (cliProgress_t*)context;
+
+    if (state->quiet || progress->elapsedSeconds - state->lastReport < PROGRESS_INTERVAL) {
+        return true;
+    }
+
+    state->lastReport = progress->elapsedSeconds;
+
+    double percent = (progress->totalBytes > 0 ? 100.0 * (double)progress->bytesRead / (double)progress->totalBytes : 100.0);
+
+    fprintf(stderr, "\r%llu lines (%.1f%%), %.0f lines/s, %.1f MB/s",
+        (unsigned long long)progress->lines, percent, (double)progress->lines / progress->elapsedSeconds,
+        (double)progress->bytesRead / progress->elapsedSeconds / 1e6);
+    fflush(stderr);
+
+    return true;
+}
+
+/*
+ * Load the libpostal modules a mode needs
+ * @param mode the bulk mode
+ * @param dataDir the data directory, or NULL for the default one
+ * @return true on success
+ */
+static bool setupLibpostal(bulkMode_t mode, char *dataDir) {
+    if (!(dataDir != NULL ? libpostal_setup_datadir(dataDir) : libpostal_setup())) {
+        fprintf(stderr, "Error initializing libpostal\n");
+        return false;
+    }
+
+    if (mode == BULK_PARSE) {
+        if (!(dataDir != NULL ? libpostal_setup_parser_datadir(dataDir) : libpostal_setup_parser())) {
+            fprintf(stderr, "Error initializing libpostal parser\n");
+            libpostal_teardown();
+            return false;
+        }
+    } else if (!(dataDir != NULL ? libpostal_setup_language_classifier_datadir(dataDir) : libpostal_setup_language_classifier())) {
+        fprintf(stderr, "Error initializing libpostal language classifier\n");
+        libpostal_teardown();
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Tear down the libpostal modules loaded by setupLibpostal
+ * @param mode the bulk mode
+ */
+static void teardownLibpostal(bulkMode_t mode) {
+    if (mode == BULK_PARSE) {
+        libpostal_teardown_parser();
+    } else {
+        libpostal_teardown_language_classifier();
+    }
+
+    libpostal_teardown();
+}
+
+int main(int argc, char **argv) {
+    bulkOptions_t options;
+    bulkDefaultOptions(&options);
+
+    char *dataDir = NULL;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long workers = (cores > 1 ? (cores - 1 < MAX_POOL_WORKERS ? cores - 1 : MAX_POOL_WORKERS) : 0);
+    long cacheEntries = 0;
+    long chunkLines = DEFAULT_BULK_CHUNK_LINES;
+    cliProgress_t state = { 0.0, false };
+    const char *paths[2];
+    int numPaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--parse") == 0) {
+            options.mode = BULK_PARSE;
+        } else if (strcmp(arg, "--expand") == 0) {
+            options.mode = BULK_EXPAND;
+        } else if (strcmp(arg, "--expand-root") == 0) {
+            options.mode = BULK_EXPAND_ROOT;
+        } else if (strcmp(arg, "--tsv") == 0) {
+            options.format = BULK_FORMAT_TSV;
+        } else if (strcmp(arg, "--binary") == 0) {
+            options.format = BULK_FORMAT_BINARY;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            state.quiet = true;
+        } else if (strcmp(arg, "--data-dir") == 0 && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (strcmp(arg, "--workers") == 0) {
+            if (!parseCount(i + 1 < argc ? argv[++i] : NULL, MAX_POOL_WORKERS, &workers)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--cache") == 0) {
+            if (!parseCount(i + 1 < argc ? argv[++i] : NULL, MAX_CACHE_ENTRIES, &cacheEntries)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--chunk") == 0) {
+            if (!parseCount(i + 1 < argc ? argv[++i] : NULL, MAX_BULK_CHUNK_LINES, &chunkLines) || chunkLines == 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg[0] == '-' || numPaths == 2) {
+            usage(argv[0]);
+            return 2;
+        } else {
+            paths[numPaths++] = arg;
+        }
+    }
+
+    if (numPaths != 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    options.chunkLines = (size_t)chunkLines;
+    options.progress = printProgress;
+    options.progressContext = &state;
+
+    if (!setupLibpostal(options.mode, dataDir)) {
+        return 1;
+    }
+
+    if (!poolStart((int)workers) || !cacheStart((size_t)cacheEntries)) {
+        fprintf(stderr, "Error starting worker threads or result cache\n");
+        poolStop();
+        teardownLibpostal(options.mode);
+        return 1;
+    }
+
+    bulkProgress_t result;
+    const char *error = bulkProcessFile(paths[0], paths[1], &options, &result);
+
+    poolStop();
+    cacheStop();
+    teardownLibpostal(options.mode);
+
+    if (!state.quiet) {
+        fprintf(stderr, "\n");
+    }
+
+    if (error != NULL) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    if (!state.quiet) {
+        fprintf(stderr, "%llu lines in %.1f s (%.0f lines/s), %llu bytes written\n", (unsigned long long)result.lines,
+            result.elapsedSeconds, result.elapsedSeconds > 0 ? (double)result.lines / result.elapsedSeconds : 0.0,
+            (unsigned long long)result.bytesWritten);
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+package com.dnebinger.postal4j;
+
+import org.openjdk.jmh.annotations.*;
+
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * JNI vs FFM backend cost of the single-address parse/expand calls over the multilingual corpus.
+ * Each benchmark forks with the backend forced through {@code postal4j.backend}; the FFM ones need a JDK 22+ fork,
+ * run them with {@code ./gradlew jmh -PjmhJava=22 -PjmhIncludes=BackendBenchmark}.
+ */
+@BenchmarkMode({Mode.Throughput, Mode.SampleTime})
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@State(Scope.Benchmark)
+@Warmup(iterations = 3, time = 5)
+@Measurement(iterations = 5, time = 5)
+public class BackendBenchmark {
+
+    private BenchmarkSupport.CorpusAddress[] corpus;
+
+    @State(Scope.Thread)
+    public static class Cursor {
+        private int next;
+
+        int next(int size) {
+            int index = next;
+            next = (index + 1 == size ? 0 : index + 1);
+            return index;
+        }
+    }
+
+    @Setup(Level.Trial)
+    public void setup() {
+        BenchmarkSupport.setup();
+        corpus = BenchmarkSupport.corpus();
+    }
+
+    @TearDown(Level.Trial)
+    public void teardown() {
+        BenchmarkSupport.teardown();
+    }
+
+    @Benchmark
+    @Fork(value = 1, jvmArgsAppend = "-Dpostal4j.backend=jni")
+    public Map<String, String> parseAddressJni(Cursor cursor) {
+        return LibPostal.parseAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    @Fork(value = 1, jvmArgsAppend = "-Dpostal4j.backend=ffm")
+    public Map<String, String> parseAddressFfm(Cursor cursor) {
+        return LibPostal.parseAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    @Fork(value = 1, jvmArgsAppend = "-Dpostal4j.backend=jni")
+    public Map<String, String> parseAddressWithHintsJni(Cursor cursor) {
+        BenchmarkSupport.CorpusAddress entry = corpus[cursor.next(corpus.length)];
+        return LibPostal.parseAddress(entry.address, entry.language, entry.country);
+    }
+
+    @Benchmark
+    @Fork(value = 1, jvmArgsAppend = "-Dpostal4j.backend=ffm")
+    public Map<String, String> parseAddressWithHintsFfm(Cursor cursor) {
+        BenchmarkSupport.CorpusAddress entry = corpus[cursor.next(corpus.length)];
+        return LibPostal.parseAddress(entry.address, entry.language, entry.country);
+    }
+
+    @Benchmark
+    @Fork(value = 1, jvmArgsAppend = "-Dpostal4j.backend=jni")
+    public String[] expandAddressJni(Cursor cursor) {
+        return LibPostal.expandAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    @Fork(value = 1, jvmArgsAppend = "-Dpostal4j.backend=ffm")
+    public String[] expandAddressFfm(Cursor cursor) {
+        return LibPostal.expandAddress(corpus[cursor.next(corpus.length)].address);
+    }
+}
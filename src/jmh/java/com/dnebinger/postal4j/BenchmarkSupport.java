@@ -0,0 +1,114 @@
+package com.dnebinger.postal4j;
+
+import java.io.BufferedReader;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InputStreamReader;
+import java.io.UncheckedIOException;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Shared setup helpers for the JMH benchmarks.
+ */
+final class BenchmarkSupport {
+
+    static final String[] SAMPLE_ADDRESSES = {
+        "123 Main Street, Springfield, IL 62701",
+        "Unter den Linden 77, 10117 Berlin, Germany",
+        "781 Franklin Ave Crown Heights Brooklyn NYC NY 11216 USA",
+        "The Book Club 100-106 Leonard St Shoreditch London EC2A 4RH, United Kingdom",
+        "30 W 26th St Fl 7, New York, NY 10010",
+        "Rue de Rivoli 99, 75001 Paris, France",
+        "Calle de Alcalá 45, 28014 Madrid, España",
+        "1600 Pennsylvania Avenue NW, Washington, DC 20500"
+    };
+
+    // Multilingual corpus with language/country hints, see src/jmh/resources/addresses.tsv
+    static final String CORPUS_RESOURCE = "/addresses.tsv";
+
+    /**
+     * One corpus line: the address and its language/country hints.
+     */
+    static final class CorpusAddress {
+        final String address;
+        final String language;
+        final String country;
+
+        CorpusAddress(String address, String language, String country) {
+            this.address = address;
+            this.language = language;
+            this.country = country;
+        }
+    }
+
+    private BenchmarkSupport() {
+        // Utility class
+    }
+
+    /**
+     * Initializes libpostal using the data directory from the {@code postal4j.dataDir} system property,
+     * falling back to the default data directory when it is not set.
+     */
+    static void setup() {
+        String dataDir = System.getProperty("postal4j.dataDir");
+
+        if (dataDir == null || dataDir.isEmpty()) {
+            LibPostal.setup();
+        } else {
+            LibPostal.setup(dataDir);
+        }
+    }
+
+    static void teardown() {
+        LibPostal.teardown();
+    }
+
+    /**
+     * Builds an array of the given size by cycling through the sample addresses.
+     *
+     * @param size the number of addresses
+     * @return the addresses
+     */
+    static String[] addresses(int size) {
+        String[] addresses = new String[size];
+
+        for (int i = 0; i < size; i++) {
+            addresses[i] = SAMPLE_ADDRESSES[i % SAMPLE_ADDRESSES.length];
+        }
+
+        return addresses;
+    }
+
+    /**
+     * Loads the multilingual benchmark corpus, skipping blank and {@code #} comment lines.
+     *
+     * @return the corpus addresses in file order
+     */
+    static CorpusAddress[] corpus() {
+        List<CorpusAddress> corpus = new ArrayList<>();
+
+        try (InputStream in = BenchmarkSupport.class.getResourceAsStream(CORPUS_RESOURCE)) {
+            if (in == null) {
+                throw new IllegalStateException("Missing benchmark corpus " + CORPUS_RESOURCE);
+            }
+
+            BufferedReader reader = new BufferedReader(new InputStreamReader(in, StandardCharsets.UTF_8));
+            String line;
+
+            while ((line = reader.readLine()) != null) {
+                if (line.isBlank() || line.startsWith("#")) {
+                    continue;
+                }
+
+                String[] columns = line.split("\t");
+                corpus.add(new CorpusAddress(columns[0], columns.length > 1 ? columns[1] : null, columns.length > 2 ? columns[2] : null));
+            }
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
+        }
+
+        return corpus.toArray(new CorpusAddress[0]);
+    }
+}
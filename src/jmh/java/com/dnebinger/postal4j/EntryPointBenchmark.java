@@ -0,0 +1,111 @@
+package com.dnebinger.postal4j;
+
+import org.openjdk.jmh.annotations.*;
+
+import java.nio.charset.StandardCharsets;
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Single-threaded cost of every single-address entry point over the multilingual corpus.
+ * Each invocation takes the next corpus address, so scores average over all languages.
+ * Throughput gives ops/s, SampleTime gives the latency percentiles (p99 etc.), and running
+ * with the gc profiler (the Gradle default) adds {@code gc.alloc.rate.norm}, the bytes allocated per op.
+ */
+@BenchmarkMode({Mode.Throughput, Mode.SampleTime})
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@State(Scope.Benchmark)
+@Fork(1)
+@Warmup(iterations = 3, time = 5)
+@Measurement(iterations = 5, time = 5)
+public class EntryPointBenchmark {
+
+    private BenchmarkSupport.CorpusAddress[] corpus;
+    private byte[][] utf8;
+    private NormalizeOptions normalizeOptions;
+
+    @State(Scope.Thread)
+    public static class Cursor {
+        private int next;
+
+        int next(int size) {
+            int index = next;
+            next = (index + 1 == size ? 0 : index + 1);
+            return index;
+        }
+    }
+
+    @Setup(Level.Trial)
+    public void setup() {
+        BenchmarkSupport.setup();
+        corpus = BenchmarkSupport.corpus();
+
+        utf8 = new byte[corpus.length][];
+        for (int i = 0; i < corpus.length; i++) {
+            utf8[i] = corpus[i].address.getBytes(StandardCharsets.UTF_8);
+        }
+
+        // the same options as the option-rich overloads below
+        normalizeOptions = NormalizeOptions.builder()
+            .flags(NormalizeOptions.LATIN_ASCII | NormalizeOptions.TRANSLITERATE | NormalizeOptions.STRIP_ACCENTS |
+                NormalizeOptions.DECOMPOSE | NormalizeOptions.LOWERCASE | NormalizeOptions.TRIM_STRING | NormalizeOptions.EXPAND_NUMEX)
+            .addressComponents(NormalizeOptions.ADDRESS_ALL)
+            .build();
+    }
+
+    @TearDown(Level.Trial)
+    public void teardown() {
+        normalizeOptions.close();
+        BenchmarkSupport.teardown();
+    }
+
+    @Benchmark
+    public Map<String, String> parseAddress(Cursor cursor) {
+        return LibPostal.parseAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    public Map<String, String> parseAddressWithHints(Cursor cursor) {
+        BenchmarkSupport.CorpusAddress entry = corpus[cursor.next(corpus.length)];
+        return LibPostal.parseAddress(entry.address, entry.language, entry.country);
+    }
+
+    @Benchmark
+    public ParsedAddress parseAddressCompact(Cursor cursor) {
+        return LibPostal.parseAddressCompact(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    public Map<String, String> parseAddressUtf8(Cursor cursor) {
+        return LibPostal.parseAddress(utf8[cursor.next(corpus.length)]);
+    }
+
+    @Benchmark
+    public String[] expandAddress(Cursor cursor) {
+        return LibPostal.expandAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    public String[] expandAddressWithOptions(Cursor cursor) {
+        BenchmarkSupport.CorpusAddress entry = corpus[cursor.next(corpus.length)];
+        return LibPostal.expandAddress(entry.address, new String[]{entry.language}, true, true, true, true, true, true,
+            false, false, false, false, false, false, false, false, false, false, true, false, 0xFFFF);
+    }
+
+    @Benchmark
+    public String[] expandAddressWithNormalizeOptions(Cursor cursor) {
+        return LibPostal.expandAddress(corpus[cursor.next(corpus.length)].address, normalizeOptions);
+    }
+
+    @Benchmark
+    public String[] expandRootAddress(Cursor cursor) {
+        return LibPostal.expandRootAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    public String[] expandRootAddressWithOptions(Cursor cursor) {
+        BenchmarkSupport.CorpusAddress entry = corpus[cursor.next(corpus.length)];
+        return LibPostal.expandRootAddress(entry.address, new String[]{entry.language}, true, true, true, true, true, true,
+            false, false, false, false, false, false, false, false, false, false, true, false, 0xFFFF);
+    }
+}
@@ -0,0 +1,58 @@
+package com.dnebinger.postal4j;
+
+import org.openjdk.jmh.annotations.*;
+
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Measures how batch parsing and expansion scale with the number of native worker threads.
+ * Scores are addresses per second; the batch mixes short and long addresses so the
+ * work-stealing split has uneven work to balance.
+ */
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@State(Scope.Benchmark)
+@Fork(1)
+@Warmup(iterations = 2, time = 10)
+@Measurement(iterations = 5, time = 10)
+public class ParallelBatchBenchmark {
+
+    private static final int BATCH_SIZE = 10_000;
+
+    @Param({"0", "1", "2", "4", "8", "16", "32", "64"})
+    int workerThreads;
+
+    private String[] addresses;
+
+    @Setup(Level.Trial)
+    public void setup() {
+        String dataDir = System.getProperty("postal4j.dataDir");
+
+        LibPostal.setup(dataDir == null || dataDir.isEmpty() ? null : dataDir, workerThreads);
+        addresses = BenchmarkSupport.addresses(BATCH_SIZE);
+    }
+
+    @TearDown(Level.Trial)
+    public void teardown() {
+        BenchmarkSupport.teardown();
+    }
+
+    @Benchmark
+    @OperationsPerInvocation(BATCH_SIZE)
+    public Map<String, String>[] parseAddresses() {
+        return LibPostal.parseAddresses(addresses);
+    }
+
+    @Benchmark
+    @OperationsPerInvocation(BATCH_SIZE)
+    public ParsedAddressBatch parseAddressesCompact() {
+        return LibPostal.parseAddressesCompact(addresses);
+    }
+
+    @Benchmark
+    @OperationsPerInvocation(BATCH_SIZE)
+    public String[][] expandAddresses() {
+        return LibPostal.expandAddresses(addresses);
+    }
+}
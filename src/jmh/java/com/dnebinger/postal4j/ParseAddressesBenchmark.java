@@ -0,0 +1,54 @@
+package com.dnebinger.postal4j;
+
+import org.openjdk.jmh.annotations.*;
+import org.openjdk.jmh.infra.Blackhole;
+
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Compares parsing a batch with one {@code parseAddress} call per address against a single
+ * {@code parseAddresses} or {@code parseAddressesCompact} call. Both benchmarks parse the same addresses, so the scores are the
+ * time to parse a whole batch and can be compared directly.
+ */
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@State(Scope.Benchmark)
+@Fork(1)
+@Warmup(iterations = 3, time = 5)
+@Measurement(iterations = 5, time = 5)
+public class ParseAddressesBenchmark {
+
+    @Param({"1", "10", "100", "1000", "10000"})
+    int batchSize;
+
+    private String[] addresses;
+
+    @Setup(Level.Trial)
+    public void setup() {
+        BenchmarkSupport.setup();
+        addresses = BenchmarkSupport.addresses(batchSize);
+    }
+
+    @TearDown(Level.Trial)
+    public void teardown() {
+        BenchmarkSupport.teardown();
+    }
+
+    @Benchmark
+    public void singleCalls(Blackhole blackhole) {
+        for (String address : addresses) {
+            blackhole.consume(LibPostal.parseAddress(address));
+        }
+    }
+
+    @Benchmark
+    public Map<String, String>[] batchCall() {
+        return LibPostal.parseAddresses(addresses);
+    }
+
+    @Benchmark
+    public ParsedAddressBatch batchCompactCall() {
+        return LibPostal.parseAddressesCompact(addresses);
+    }
+}
@@ -0,0 +1,74 @@
+package com.dnebinger.postal4j;
+
+import org.openjdk.jmh.annotations.*;
+
+import java.nio.charset.StandardCharsets;
+import java.util.Collections;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Cost of getting a Java String into native code as UTF-8, on ASCII, Latin-1 and CJK input.
+ * {@code tokenizeString} pays for the native UTF-16 to UTF-8 transcoding, {@code tokenizeUtf8} runs the same
+ * tokenizer on bytes that are already UTF-8, so the difference between the two is the transcoding.
+ * {@code getBytes} is the JDK's own encoder for comparison.
+ */
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@State(Scope.Benchmark)
+@Fork(1)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+public class StringInputBenchmark {
+
+    public enum Script {
+        ASCII("1600 Pennsylvania Avenue NW, Washington, DC 20500, United States of America"),
+        LATIN1("Rúa de São Pedro 45, Ñuñoa, Santiago de Compostela, Galicia, España"),
+        CJK("東京都千代田区丸の内一丁目九番一号 東京駅八重洲中央口 日本国");
+
+        final String address;
+
+        Script(String address) {
+            this.address = address;
+        }
+    }
+
+    @Param
+    public Script script;
+
+    // copies of the address per input, to see how the cost grows with length
+    @Param({"1", "32"})
+    public int repeat;
+
+    private String input;
+    private byte[] utf8;
+    private int[] tokens;
+
+    @Setup(Level.Trial)
+    public void setup() {
+        BenchmarkSupport.setup();
+
+        input = String.join(" ", Collections.nCopies(repeat, script.address));
+        utf8 = input.getBytes(StandardCharsets.UTF_8);
+        tokens = new int[LibPostal.tokenize(input).length];
+    }
+
+    @TearDown(Level.Trial)
+    public void teardown() {
+        BenchmarkSupport.teardown();
+    }
+
+    @Benchmark
+    public int[] tokenizeString() {
+        return LibPostal.tokenize(input, false);
+    }
+
+    @Benchmark
+    public int tokenizeUtf8() {
+        return LibPostal.tokenize(utf8, 0, utf8.length, false, tokens);
+    }
+
+    @Benchmark
+    public byte[] getBytes() {
+        return input.getBytes(StandardCharsets.UTF_8);
+    }
+}
@@ -0,0 +1,74 @@
+package com.dnebinger.postal4j;
+
+import org.openjdk.jmh.annotations.*;
+
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Throughput of concurrent single-address calls from 1 to N Java threads (N = available processors).
+ * The nested classes only differ in their thread count; compare the total ops/s between them to see
+ * how close to linear the JNI layer scales.
+ */
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@State(Scope.Benchmark)
+@Fork(1)
+@Warmup(iterations = 2, time = 5)
+@Measurement(iterations = 5, time = 5)
+public abstract class ThreadScalingBenchmark {
+
+    private BenchmarkSupport.CorpusAddress[] corpus;
+
+    @State(Scope.Thread)
+    public static class Cursor {
+        private int next;
+
+        int next(int size) {
+            int index = next;
+            next = (index + 1 == size ? 0 : index + 1);
+            return index;
+        }
+    }
+
+    @Setup(Level.Trial)
+    public void setup() {
+        BenchmarkSupport.setup();
+        corpus = BenchmarkSupport.corpus();
+    }
+
+    @TearDown(Level.Trial)
+    public void teardown() {
+        BenchmarkSupport.teardown();
+    }
+
+    @Benchmark
+    public Map<String, String> parseAddress(Cursor cursor) {
+        return LibPostal.parseAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Benchmark
+    public String[] expandAddress(Cursor cursor) {
+        return LibPostal.expandAddress(corpus[cursor.next(corpus.length)].address);
+    }
+
+    @Threads(1)
+    public static class Threads1 extends ThreadScalingBenchmark {
+    }
+
+    @Threads(2)
+    public static class Threads2 extends ThreadScalingBenchmark {
+    }
+
+    @Threads(4)
+    public static class Threads4 extends ThreadScalingBenchmark {
+    }
+
+    @Threads(8)
+    public static class Threads8 extends ThreadScalingBenchmark {
+    }
+
+    @Threads(Threads.MAX)
+    public static class ThreadsMax extends ThreadScalingBenchmark {
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * postal4j_buffer.c
+ * Growable native byte buffer used to build packed results
+ */
+
+#include "postal4j_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_INITIAL_CAPACITY 256
+
+/*
+ * Initialize an empty buffer, no memory is allocated until the first append
+ * @param buffer the buffer
+ */
+void bufferInit(nativeBuffer_t *buffer) {
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+/*
+ * Make sure the buffer can take additional bytes without growing
+ * @param buffer the buffer
+ * @param additional the number of bytes about to be appended
+ * @return true on success, false if memory could not be allocated
+ */
+bool bufferReserve(nativeBuffer_t *buffer, size_t additional) {
+    if (buffer->capacity - buffer->length >= additional) {
+        return true;
+    }
+
+    size_t capacity = (buffer->capacity > 0 ? buffer->capacity : BUFFER_INITIAL_CAPACITY);
+
+    // double until the new data fits
+    while (capacity - buffer->length < additional) {
+        if (capacity > SIZE_MAX / 2) {
+            return false;
+        }
+        capacity *= 2;
+    }
+
+    char *data = realloc(buffer->data, capacity);
+
+    if (data == NULL) {
+        return false;
+    }
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+
+    return true;
+}
+
+/*
+ * Append bytes to the buffer
+ * @param buffer the buffer
+ * @param data the bytes to append
+ * @param length the number of bytes
+ * @return true on success, false if memory could not be allocated
+ */
+bool bufferAppend(nativeBuffer_t *buffer, const void *data, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+
+    if (!bufferReserve(buffer, length)) {
+        return false;
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+
+    return true;
+}
+
+/*
+ * Append a single byte to the buffer
+ * @param buffer the buffer
+ * @param value the byte
+ * @return true on success, false if memory could not be allocated
+ */
+bool bufferAppendByte(nativeBuffer_t *buffer, uint8_t value) {
+    return bufferAppend(buffer, &value, sizeof(value));
+}
+
+/*
+ * Append an int in native byte order, used for arrays copied straight into Java int[]
+ * @param buffer the buffer
+ * @param value the int
+ * @return true on success, false if memory could not be allocated
+ */
+bool bufferAppendInt(nativeBuffer_t *buffer, int32_t value) {
+    return bufferAppend(buffer, &value, sizeof(value));
+}
+
+/*
+ * Empty the buffer but keep its memory for reuse
+ * @param buffer the buffer
+ */
+void bufferReset(nativeBuffer_t *buffer) {
+    buffer->length = 0;
+}
+
+/*
+ * Release the memory held by the buffer
+ * @param buffer the buffer
+ */
+void bufferFree(nativeBuffer_t *buffer) {
+    free(buffer->data);
+    bufferInit(buffer);
+}
@@ -0,0 +1,35 @@
+/*
+ * postal4j_buffer.h
+ * Growable native byte buffer used to build packed results
+ */
+
+#ifndef POSTAL4J_BUFFER_H
+#define POSTAL4J_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} nativeBuffer_t;
+
+void bufferInit(nativeBuffer_t *buffer);
+bool bufferReserve(nativeBuffer_t *buffer, size_t additional);
+bool bufferAppend(nativeBuffer_t *buffer, const void *data, size_t length);
+bool bufferAppendByte(nativeBuffer_t *buffer, uint8_t value);
+bool bufferAppendInt(nativeBuffer_t *buffer, int32_t value);
+void bufferReset(nativeBuffer_t *buffer);
+void bufferFree(nativeBuffer_t *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_BUFFER_H */
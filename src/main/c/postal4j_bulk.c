@@ -0,0 +1,553 @@
+/*
+ * postal4j_bulk.c
+ * Bulk parse/expand of newline delimited address files, shared by the JNI bindings and the CLI
+ *
+ * The input is memory-mapped and cut into chunks of lines. Each chunk is copied into one block of
+ * NUL terminated strings, parsed or expanded on the worker pool with every line formatted into its
+ * own output slot, and then handed to a writer thread. Two chunks alternate, so the pool works on
+ * one while the writer drains the other, and the writer always takes them in submission order so
+ * output records are in input order. Slot buffers keep their memory from chunk to chunk, so a long
+ * run allocates next to nothing once the first chunks have been through.
+ *
+ * TSV output has one line per input line. Parse lines have one column per AddressLabel, in enum
+ * order, with repeated labels joined by a space. Expand lines have one column per expansion.
+ * Tabs, newlines, carriage returns and backslashes in values are escaped as \t, \n, \r and \\.
+ *
+ * Binary output starts with "P4JB", a version byte, the mode byte and two zero bytes, followed by
+ * one record per input line (see postal4j_format.c). All integers are little-endian uint32. A parse record is the component
+ * count, then per component the AddressLabel ordinal byte (0xFF plus a length byte and the label for
+ * unknown labels), the value length and the UTF-8 value. An expand record is the expansion count,
+ * then per expansion its length and UTF-8 bytes.
+ */
+
+#include "postal4j_bulk.h"
+#include "postal4j_buffer.h"
+#include "postal4j_cache.h"
+#include "postal4j_format.h"
+#include "postal4j_labels.h"
+#include "postal4j_pool.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Chunks in flight: one being computed by the pool while the writer drains the other
+#define BULK_CHUNKS 2
+
+// Components of a parse whose label ordinals are looked up on the stack
+#define INLINE_COMPONENTS 32
+
+// Output buffer of the output file
+#define BULK_OUTPUT_BUFFER (1 << 20)
+
+typedef struct {
+    nativeBuffer_t lines;
+    size_t *lineOffsets;
+    nativeBuffer_t *outputs;
+    size_t count;
+    bool pending;
+} bulkChunk_t;
+
+typedef struct {
+    const bulkOptions_t *options;
+    libpostal_address_parser_options_t parserOptions;
+    libpostal_normalize_options_t normalizeOptions;
+    bulkChunk_t chunks[BULK_CHUNKS];
+    bulkChunk_t *current;
+    atomic_bool allocationFailed;
+    FILE *output;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    bool finished;
+    bool writeFailed;
+    uint64_t bytesWritten;
+} bulkRun_t;
+
+/*
+ * Fill in the default bulk options: parse to TSV, default chunk size, no progress callback
+ * @param options the options to fill in
+ */
+void bulkDefaultOptions(bulkOptions_t *options) {
+    memset(options, 0, sizeof(bulkOptions_t));
+    options->mode = BULK_PARSE;
+    options->format = BULK_FORMAT_TSV;
+    options->chunkLines = DEFAULT_BULK_CHUNK_LINES;
+}
+
+/*
+ * Seconds elapsed since a start time
+ * @param start the monotonic start time
+ * @return the elapsed seconds
+ */
+static double elapsedSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Append a string as a TSV field, escaping tabs, newlines, carriage returns and backslashes
+ * @param out the buffer
+ * @param value the string
+ * @return true on success, false if out of memory
+ */
+static bool appendTsvField(nativeBuffer_t *out, const char *value) {
+    // libpostal output rarely needs escaping, copy it in one go when it doesn't
+    if (strpbrk(value, "\t\n\r\\") == NULL) {
+        return bufferAppend(out, value, strlen(value));
+    }
+
+    for (const char *c = value; *c != '\0'; c++) {
+        const char *escape = NULL;
+
+        switch (*c) {
+            case '\t': escape = "\\t"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            case '\\': escape = "\\\\"; break;
+        }
+
+        if (escape != NULL ? !bufferAppend(out, escape, 2) : !bufferAppendByte(out, (uint8_t)*c)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Format the parse of one line
+ * @param run the bulk run
+ * @param line the line
+ * @param out the output slot
+ * @return true on success, false if out of memory
+ */
+static bool formatParse(bulkRun_t *run, char *line, nativeBuffer_t *out) {
+    libpostal_address_parser_response_t *response = (*line != '\0' ? cachedParseAddress(line, run->parserOptions) : NULL);
+    size_t count = (response != NULL ? response->num_components : 0);
+    bool formatted = true;
+
+    if (run->options->format == BULK_FORMAT_BINARY) {
+        formatted = formatParseRecord(out, RECORD_FORMAT_BINARY, response);
+    } else {
+        // look every label up once, then emit the columns in AddressLabel order
+        int inlineOrdinals[INLINE_COMPONENTS];
+        int *ordinals = (count > INLINE_COMPONENTS ? malloc(count * sizeof(int)) : inlineOrdinals);
+
+        if (ordinals == NULL) {
+            formatted = false;
+        }
+
+        for (size_t i = 0; formatted && i < count; i++) {
+            ordinals[i] = addressLabelOrdinal(response->labels[i]);
+        }
+
+        for (int label = 0; formatted && label < NUM_ADDRESS_LABELS; label++) {
+            bool first = true;
+
+            if (label > 0) {
+                formatted = bufferAppendByte(out, '\t');
+            }
+
+            for (size_t i = 0; formatted && i < count; i++) {
+                if (ordinals[i] == label) {
+                    formatted = (first || bufferAppendByte(out, ' ')) && appendTsvField(out, response->components[i]);
+                    first = false;
+                }
+            }
+        }
+
+        formatted = formatted && bufferAppendByte(out, '\n');
+
+        if (ordinals != inlineOrdinals) {
+            free(ordinals);
+        }
+    }
+
+    if (response != NULL) {
+        libpostal_address_parser_response_destroy(response);
+    }
+
+    return formatted;
+}
+
+/*
+ * Format the expansions of one line
+ * @param run the bulk run
+ * @param line the line
+ * @param out the output slot
+ * @return true on success, false if out of memory
+ */
+static bool formatExpand(bulkRun_t *run, char *line, nativeBuffer_t *out) {
+    size_t count = 0;
+    char **expansions = NULL;
+
+    if (*line != '\0') {
+        expansions = cachedExpandAddress(line, run->normalizeOptions, run->options->mode == BULK_EXPAND_ROOT, &count);
+    }
+
+    if (expansions == NULL) {
+        count = 0;
+    }
+
+    bool formatted = true;
+
+    if (run->options->format == BULK_FORMAT_BINARY) {
+        formatted = formatExpansionRecord(out, RECORD_FORMAT_BINARY, expansions, count);
+    } else {
+        for (size_t i = 0; formatted && i < count; i++) {
+            formatted = (i == 0 || bufferAppendByte(out, '\t')) && appendTsvField(out, expansions[i]);
+        }
+
+        formatted = formatted && bufferAppendByte(out, '\n');
+    }
+
+    if (expansions != NULL) {
+        libpostal_expansion_array_destroy(expansions, count);
+    }
+
+    return formatted;
+}
+
+/*
+ * Pool task that processes one line of the current chunk into its output slot
+ * @param index the line index within the chunk
+ * @param context the bulk run
+ */
+static void bulkTask(size_t index, void *context) {
+    bulkRun_t *run = (bulkRun_t*)context;
+    bulkChunk_t *chunk = run->current;
+    char *line = chunk->lines.data + chunk->lineOffsets[index];
+    nativeBuffer_t *out = &chunk->outputs[index];
+
+    bufferReset(out);
+
+    bool formatted = (run->options->mode == BULK_PARSE ? formatParse(run, line, out) : formatExpand(run, line, out));
+
+    if (!formatted) {
+        atomic_store(&run->allocationFailed, true);
+    }
+}
+
+/*
+ * Writer thread, writes the submitted chunks in order until the run is finished
+ * @param context the bulk run
+ * @return NULL
+ */
+static void *bulkWriter(void *context) {
+    bulkRun_t *run = (bulkRun_t*)context;
+    size_t next = 0;
+
+    for (;;) {
+        bulkChunk_t *chunk = &run->chunks[next];
+
+        pthread_mutex_lock(&run->lock);
+
+        while (!chunk->pending && !run->finished) {
+            pthread_cond_wait(&run->changed, &run->lock);
+        }
+
+        // chunks are submitted alternately, if the next one isn't pending neither is any other
+        if (!chunk->pending) {
+            pthread_mutex_unlock(&run->lock);
+            break;
+        }
+
+        bool failed = run->writeFailed;
+        pthread_mutex_unlock(&run->lock);
+
+        uint64_t written = 0;
+
+        for (size_t i = 0; !failed && i < chunk->count; i++) {
+            nativeBuffer_t *out = &chunk->outputs[i];
+
+            if (out->length > 0 && fwrite(out->data, 1, out->length, run->output) != out->length) {
+                failed = true;
+            }
+
+            written += out->length;
+        }
+
+        pthread_mutex_lock(&run->lock);
+        chunk->pending = false;
+        run->writeFailed = failed;
+        run->bytesWritten += written;
+        pthread_cond_broadcast(&run->changed);
+        pthread_mutex_unlock(&run->lock);
+
+        next = (next + 1) % BULK_CHUNKS;
+    }
+
+    return NULL;
+}
+
+/*
+ * Wait until the writer is done with a chunk
+ * @param run the bulk run
+ * @param chunk the chunk
+ * @return false if a write failed
+ */
+static bool waitForChunk(bulkRun_t *run, bulkChunk_t *chunk) {
+    pthread_mutex_lock(&run->lock);
+
+    while (chunk->pending && !run->writeFailed) {
+        pthread_cond_wait(&run->changed, &run->lock);
+    }
+
+    bool ok = !run->writeFailed;
+    pthread_mutex_unlock(&run->lock);
+
+    return ok;
+}
+
+/*
+ * Copy the next lines of the input into a chunk as NUL terminated strings
+ * @param chunk the chunk
+ * @param data the mapped input
+ * @param size the input size
+ * @param position the position of the next line, advanced past the copied lines
+ * @param maxLines the maximum number of lines to copy
+ * @return true on success, false if out of memory
+ */
+static bool loadChunk(bulkChunk_t *chunk, const char *data, size_t size, size_t *position, size_t maxLines) {
+    bufferReset(&chunk->lines);
+    chunk->count = 0;
+
+    while (chunk->count < maxLines && *position < size) {
+        const char *start = data + *position;
+        const char *newline = memchr(start, '\n', size - *position);
+        size_t length = (newline != NULL ? (size_t)(newline - start) : size - *position);
+
+        *position += length + (newline != NULL ? 1 : 0);
+
+        // tolerate CRLF files
+        if (length > 0 && start[length - 1] == '\r') {
+            length--;
+        }
+
+        chunk->lineOffsets[chunk->count++] = chunk->lines.length;
+
+        if (!bufferAppend(&chunk->lines, start, length) || !bufferAppendByte(&chunk->lines, 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Release the buffers of a bulk run
+ * @param run the bulk run
+ * @param chunkLines the number of output slots per chunk
+ */
+static void cleanupBulkRun(bulkRun_t *run, size_t chunkLines) {
+    for (size_t c = 0; c < BULK_CHUNKS; c++) {
+        bulkChunk_t *chunk = &run->chunks[c];
+
+        if (chunk->outputs != NULL) {
+            for (size_t i = 0; i < chunkLines; i++) {
+                bufferFree(&chunk->outputs[i]);
+            }
+            free(chunk->outputs);
+            chunk->outputs = NULL;
+        }
+
+        free(chunk->lineOffsets);
+        chunk->lineOffsets = NULL;
+        bufferFree(&chunk->lines);
+    }
+}
+
+/*
+ * Parse or expand every line of a newline delimited file on the worker pool, writing TSV or binary records in input order
+ * @param inputPath the input file
+ * @param outputPath the output file, created or truncated
+ * @param options the bulk options
+ * @param result set to the final counters on success, may be NULL
+ * @return NULL on success, otherwise the error message
+ */
+const char *bulkProcessFile(const char *inputPath, const char *outputPath, const bulkOptions_t *options, bulkProgress_t *result) {
+    if (options->mode < BULK_PARSE || options->mode > BULK_EXPAND_ROOT) {
+        return "Unknown bulk mode";
+    }
+    if (options->format < BULK_FORMAT_TSV || options->format > BULK_FORMAT_BINARY) {
+        return "Unknown bulk output format";
+    }
+    if (options->chunkLines < 1 || options->chunkLines > MAX_BULK_CHUNK_LINES) {
+        return "Bulk chunk size must be between 1 and 4194304 lines";
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // map the whole input, the kernel reads ahead as the chunks walk through it
+    int fd = open(inputPath, O_RDONLY);
+
+    if (fd < 0) {
+        return "Error opening input file";
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return "Error reading input file size";
+    }
+
+    size_t size = (size_t)info.st_size;
+    char *data = NULL;
+
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED) {
+            close(fd);
+            return "Error mapping input file";
+        }
+
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    close(fd);
+
+    FILE *output = fopen(outputPath, "wb");
+
+    if (output == NULL) {
+        if (data != NULL) {
+            munmap(data, size);
+        }
+        return "Error creating output file";
+    }
+
+    setvbuf(output, NULL, _IOFBF, BULK_OUTPUT_BUFFER);
+
+    bulkRun_t run;
+    memset(&run, 0, sizeof(bulkRun_t));
+    run.options = options;
+    run.parserOptions = libpostal_get_address_parser_default_options();
+    run.normalizeOptions = (options->normalizeOptions != NULL ? *options->normalizeOptions : libpostal_get_default_options());
+    run.output = output;
+    atomic_init(&run.allocationFailed, false);
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.changed, NULL);
+
+    const char *error = NULL;
+
+    for (size_t c = 0; c < BULK_CHUNKS; c++) {
+        bulkChunk_t *chunk = &run.chunks[c];
+        bufferInit(&chunk->lines);
+        chunk->lineOffsets = malloc(options->chunkLines * sizeof(size_t));
+        chunk->outputs = malloc(options->chunkLines * sizeof(nativeBuffer_t));
+
+        if (chunk->lineOffsets == NULL || chunk->outputs == NULL) {
+            free(chunk->outputs);
+            chunk->outputs = NULL;
+            error = "Error allocating bulk buffers";
+            continue;
+        }
+
+        for (size_t i = 0; i < options->chunkLines; i++) {
+            bufferInit(&chunk->outputs[i]);
+        }
+    }
+
+    if (error == NULL && options->format == BULK_FORMAT_BINARY) {
+        uint8_t header[8] = { 'P', '4', 'J', 'B', BULK_BINARY_VERSION, (uint8_t)options->mode, 0, 0 };
+
+        if (fwrite(header, 1, sizeof(header), output) != sizeof(header)) {
+            error = "Error writing output file";
+        }
+
+        run.bytesWritten = sizeof(header);
+    }
+
+    pthread_t writer;
+    bool writerStarted = (error == NULL && pthread_create(&writer, NULL, bulkWriter, &run) == 0);
+
+    if (error == NULL && !writerStarted) {
+        error = "Error starting bulk writer thread";
+    }
+
+    bulkProgress_t progress;
+    memset(&progress, 0, sizeof(bulkProgress_t));
+    progress.totalBytes = size;
+
+    size_t position = 0;
+
+    for (size_t next = 0; error == NULL && position < size; next = (next + 1) % BULK_CHUNKS) {
+        bulkChunk_t *chunk = &run.chunks[next];
+
+        if (!waitForChunk(&run, chunk)) {
+            error = "Error writing output file";
+            break;
+        }
+
+        if (!loadChunk(chunk, data, size, &position, options->chunkLines)) {
+            error = "Error allocating bulk buffers";
+            break;
+        }
+
+        run.current = chunk;
+        poolRun(chunk->count, bulkTask, &run);
+
+        if (atomic_load(&run.allocationFailed)) {
+            error = "Error allocating bulk output";
+            break;
+        }
+
+        pthread_mutex_lock(&run.lock);
+        chunk->pending = true;
+        progress.bytesWritten = run.bytesWritten;
+        pthread_cond_broadcast(&run.changed);
+        pthread_mutex_unlock(&run.lock);
+
+        progress.lines += chunk->count;
+        progress.bytesRead = position;
+        progress.elapsedSeconds = elapsedSince(&start);
+
+        if (options->progress != NULL && !options->progress(&progress, options->progressContext)) {
+            error = "Bulk processing cancelled";
+        }
+    }
+
+    // let the writer drain what was submitted and stop
+    if (writerStarted) {
+        pthread_mutex_lock(&run.lock);
+        run.finished = true;
+        pthread_cond_broadcast(&run.changed);
+        pthread_mutex_unlock(&run.lock);
+
+        pthread_join(writer, NULL);
+    }
+
+    if (error == NULL && run.writeFailed) {
+        error = "Error writing output file";
+    }
+    if (fclose(output) != 0 && error == NULL) {
+        error = "Error writing output file";
+    }
+
+    if (data != NULL) {
+        munmap(data, size);
+    }
+
+    cleanupBulkRun(&run, options->chunkLines);
+    pthread_cond_destroy(&run.changed);
+    pthread_mutex_destroy(&run.lock);
+
+    if (error == NULL && result != NULL) {
+        progress.bytesRead = size;
+        progress.bytesWritten = run.bytesWritten;
+        progress.elapsedSeconds = elapsedSince(&start);
+        *result = progress;
+    }
+
+    return error;
+}
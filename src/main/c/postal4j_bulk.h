@@ -0,0 +1,72 @@
+/*
+ * postal4j_bulk.h
+ * Bulk parse/expand of newline delimited address files, shared by the JNI bindings and the CLI
+ */
+
+#ifndef POSTAL4J_BULK_H
+#define POSTAL4J_BULK_H
+
+#include "postal4j_format.h"
+#include <libpostal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lines handed to the worker pool at a time
+#define DEFAULT_BULK_CHUNK_LINES 16384
+#define MAX_BULK_CHUNK_LINES (1 << 22)
+
+// First bytes of a binary output file
+#define BULK_BINARY_MAGIC "P4JB"
+#define BULK_BINARY_VERSION 1
+
+// Label byte of a binary parse component whose label is not in the AddressLabel table
+#define BULK_UNKNOWN_LABEL RECORD_UNKNOWN_LABEL
+
+typedef enum {
+    BULK_PARSE = 0,
+    BULK_EXPAND = 1,
+    BULK_EXPAND_ROOT = 2
+} bulkMode_t;
+
+typedef enum {
+    BULK_FORMAT_TSV = 0,
+    BULK_FORMAT_BINARY = 1
+} bulkFormat_t;
+
+typedef struct {
+    uint64_t lines;
+    uint64_t bytesRead;
+    uint64_t totalBytes;
+    uint64_t bytesWritten;
+    double elapsedSeconds;
+} bulkProgress_t;
+
+// Called on the calling thread after every chunk, return false to stop the run
+typedef bool (*bulkProgressCallback_t)(const bulkProgress_t *progress, void *context);
+
+typedef struct {
+    bulkMode_t mode;
+    bulkFormat_t format;
+    size_t chunkLines;
+    // expand options, NULL for the libpostal defaults
+    const libpostal_normalize_options_t *normalizeOptions;
+    bulkProgressCallback_t progress;
+    void *progressContext;
+} bulkOptions_t;
+
+void bulkDefaultOptions(bulkOptions_t *options);
+
+// Runs the whole file on the worker pool, output records are in input order.
+// Returns NULL on success (with the final counters in result), otherwise the error message.
+const char *bulkProcessFile(const char *inputPath, const char *outputPath, const bulkOptions_t *options, bulkProgress_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_BULK_H */
@@ -0,0 +1,611 @@
+/*
+ * postal4j_cache.c
+ * Sharded LRU cache of libpostal parse and expand results
+ *
+ * The key is a small header describing the call (parse, expand or root expand, plus the parser
+ * hints or normalize options) followed by the canonicalized address: leading/trailing whitespace
+ * trimmed, inner whitespace runs collapsed to a single newline when they contain a line break (the
+ * parser treats those as field separators) or a single space otherwise, and ASCII case folded
+ * whenever libpostal lowercases anyway. The canonical form is only used for the key: on a miss
+ * libpostal is called with the caller's address, so results match a setup without a cache. Entries are spread over independent
+ * shards by hash, each with its own mutex, hash table and LRU list, so concurrent callers rarely
+ * contend. A hit rebuilds the result with malloc'd strings, compatible with the libpostal destroy
+ * functions, without calling libpostal at all. While connected to a sidecar daemon, misses go to
+ * the daemon instead of the in-process libpostal. When a disk cache is open it is the second level:
+ * a memory miss is looked up on disk (and kept in memory on a hit), and a new result is stored in both.
+ */
+
+#include "postal4j_cache.h"
+#include "postal4j_buffer.h"
+#include "postal4j_diskcache.h"
+#include "postal4j_results.h"
+#include "postal4j_sidecar.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_SHARDS 64
+#define MIN_SHARD_BUCKETS 16
+
+// Call kinds, the first byte of every key
+#define KEY_PARSE 'p'
+#define KEY_EXPAND 'e'
+#define KEY_EXPAND_ROOT 'r'
+
+typedef struct cacheEntry {
+    struct cacheEntry *hashNext;
+    struct cacheEntry *lruPrev;
+    struct cacheEntry *lruNext;
+    uint64_t hash;
+    size_t keyLength;
+    size_t valueLength;
+    // the key immediately followed by the value
+    char data[];
+} cacheEntry_t;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    cacheEntry_t **buckets;
+    size_t bucketMask;
+    // most recently used first
+    cacheEntry_t *lruHead;
+    cacheEntry_t *lruTail;
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} cacheShard_t;
+
+typedef struct {
+    cacheShard_t *shards;
+    size_t numShards;
+    size_t shardCapacity;
+    size_t capacity;
+} resultCache_t;
+
+static resultCache_t *cache = NULL;
+
+/*
+ * 64-bit FNV-1a hash
+ * @param data the bytes
+ * @param length the number of bytes
+ * @return the hash
+ */
+static uint64_t hashKey(const char *data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    // fold the high bits in, they pick the shard while the low bits pick the bucket
+    return hash ^ (hash >> 29);
+}
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/*
+ * Append a NUL-terminated canonical form of an address to a key, whitespace runs with a line break
+ * becoming one newline and other runs one space
+ * @param key the key buffer
+ * @param address the address
+ * @param foldCase true to fold ASCII upper case to lower case
+ * @return true on success, false if out of memory
+ */
+static bool appendCanonicalAddress(nativeBuffer_t *key, const char *address, bool foldCase) {
+    size_t length = strlen(address);
+
+    if (!bufferReserve(key, length + 1)) {
+        return false;
+    }
+
+    char *out = key->data + key->length;
+    char pendingSpace = '\0';
+
+    for (const char *c = address; *c != '\0'; c++) {
+        if (isSpace(*c)) {
+            if (out != key->data + key->length) {
+                pendingSpace = (*c == '\n' || *c == '\r' || pendingSpace == '\n') ? '\n' : ' ';
+            }
+            continue;
+        }
+
+        if (pendingSpace != '\0') {
+            *out++ = pendingSpace;
+            pendingSpace = '\0';
+        }
+
+        *out++ = (foldCase && *c >= 'A' && *c <= 'Z') ? (char)(*c - 'A' + 'a') : *c;
+    }
+
+    *out++ = '\0';
+    key->length = (size_t)(out - key->data);
+
+    return true;
+}
+
+/*
+ * Append an optional string to a key, distinguishing NULL from empty
+ * @param key the key buffer
+ * @param value the string, may be NULL
+ * @return true on success, false if out of memory
+ */
+static bool appendKeyString(nativeBuffer_t *key, const char *value) {
+    if (value == NULL) {
+        return bufferAppendByte(key, 0);
+    }
+
+    return bufferAppendByte(key, 1) && bufferAppend(key, value, strlen(value) + 1);
+}
+
+/*
+ * Unlink an entry from the LRU list of its shard
+ */
+static void lruUnlink(cacheShard_t *shard, cacheEntry_t *entry) {
+    if (entry->lruPrev != NULL) {
+        entry->lruPrev->lruNext = entry->lruNext;
+    } else {
+        shard->lruHead = entry->lruNext;
+    }
+
+    if (entry->lruNext != NULL) {
+        entry->lruNext->lruPrev = entry->lruPrev;
+    } else {
+        shard->lruTail = entry->lruPrev;
+    }
+}
+
+/*
+ * Link an entry at the most recently used end of the LRU list of its shard
+ */
+static void lruPushFront(cacheShard_t *shard, cacheEntry_t *entry) {
+    entry->lruPrev = NULL;
+    entry->lruNext = shard->lruHead;
+
+    if (shard->lruHead != NULL) {
+        shard->lruHead->lruPrev = entry;
+    } else {
+        shard->lruTail = entry;
+    }
+
+    shard->lruHead = entry;
+}
+
+static inline cacheShard_t *shardFor(uint64_t hash) {
+    return &cache->shards[(hash >> 58) % cache->numShards];
+}
+
+/*
+ * Find an entry in a shard, the shard must be locked
+ * @return the entry, or NULL if the key is not cached
+ */
+static cacheEntry_t *shardFind(cacheShard_t *shard, uint64_t hash, const char *key, size_t keyLength) {
+    for (cacheEntry_t *entry = shard->buckets[hash & shard->bucketMask]; entry != NULL; entry = entry->hashNext) {
+        if (entry->hash == hash && entry->keyLength == keyLength && memcmp(entry->data, key, keyLength) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Remove an entry from the hash table of a shard, the shard must be locked
+ */
+static void shardRemove(cacheShard_t *shard, cacheEntry_t *entry) {
+    cacheEntry_t **link = &shard->buckets[entry->hash & shard->bucketMask];
+
+    while (*link != entry) {
+        link = &(*link)->hashNext;
+    }
+
+    *link = entry->hashNext;
+    lruUnlink(shard, entry);
+    shard->entries--;
+}
+
+/*
+ * Store a result, evicting the least recently used entry of the shard when it is full
+ * @param hash the hash of the key
+ * @param key the key
+ * @param value the serialized result
+ */
+static void cachePut(uint64_t hash, const nativeBuffer_t *key, const nativeBuffer_t *value) {
+    cacheShard_t *shard = shardFor(hash);
+
+    // allocate outside the lock, it is discarded if another thread stored the key first
+    cacheEntry_t *entry = malloc(sizeof(cacheEntry_t) + key->length + value->length);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->hash = hash;
+    entry->keyLength = key->length;
+    entry->valueLength = value->length;
+    memcpy(entry->data, key->data, key->length);
+    memcpy(entry->data + key->length, value->data, value->length);
+
+    cacheEntry_t *evicted = NULL;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    if (shardFind(shard, hash, key->data, key->length) != NULL) {
+        pthread_mutex_unlock(&shard->mutex);
+        free(entry);
+        return;
+    }
+
+    if (shard->entries >= cache->shardCapacity) {
+        evicted = shard->lruTail;
+        shardRemove(shard, evicted);
+        shard->evictions++;
+    }
+
+    cacheEntry_t **bucket = &shard->buckets[hash & shard->bucketMask];
+    entry->hashNext = *bucket;
+    *bucket = entry;
+    lruPushFront(shard, entry);
+    shard->entries++;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    free(evicted);
+}
+
+/*
+ * Look up a result and copy it out while the shard is locked
+ * @param hash the hash of the key
+ * @param key the key
+ * @param value receives the serialized result on a hit
+ * @return true on a hit
+ */
+static bool cacheGet(uint64_t hash, const nativeBuffer_t *key, nativeBuffer_t *value) {
+    cacheShard_t *shard = shardFor(hash);
+    bool hit = false;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    cacheEntry_t *entry = shardFind(shard, hash, key->data, key->length);
+
+    if (entry != NULL && bufferAppend(value, entry->data + entry->keyLength, entry->valueLength)) {
+        lruUnlink(shard, entry);
+        lruPushFront(shard, entry);
+        shard->hits++;
+        hit = true;
+    } else {
+        shard->misses++;
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    return hit;
+}
+
+/*
+ * Look up a result in memory, then on disk
+ * @param key the key
+ * @param value receives the serialized result on a hit
+ * @param pairs true for a parse result
+ * @return true on a hit
+ */
+static bool tieredGet(const nativeBuffer_t *key, nativeBuffer_t *value, bool pairs) {
+    uint64_t hash = hashKey(key->data, key->length);
+
+    if (cache != NULL && cacheGet(hash, key, value)) {
+        return true;
+    }
+
+    if (diskCacheActive() && diskCacheGet(hash, key->data, key->length, value)) {
+        // the file is shared with other processes, so its bytes are checked like the sidecar's
+        if (validResults(value->data, value->length, pairs)) {
+            if (cache != NULL) {
+                cachePut(hash, key, value);
+            }
+
+            return true;
+        }
+
+        bufferReset(value);
+    }
+
+    return false;
+}
+
+/*
+ * Store a result in memory and on disk
+ * @param key the key
+ * @param value the serialized result
+ */
+static void tieredPut(const nativeBuffer_t *key, const nativeBuffer_t *value) {
+    uint64_t hash = hashKey(key->data, key->length);
+
+    if (cache != NULL) {
+        cachePut(hash, key, value);
+    }
+
+    if (diskCacheActive()) {
+        diskCachePut(hash, key->data, key->length, value->data, value->length);
+    }
+}
+
+/*
+ * Start the cache
+ * @param capacity the maximum number of cached results, 0 disables the cache
+ * @return true on success, false if the cache is already started, the capacity is invalid or out of memory
+ */
+bool cacheStart(size_t capacity) {
+    if (cache != NULL || capacity > MAX_CACHE_ENTRIES) {
+        return false;
+    }
+
+    if (capacity == 0) {
+        return true;
+    }
+
+    resultCache_t *created = calloc(1, sizeof(resultCache_t));
+
+    if (created == NULL) {
+        return false;
+    }
+
+    // small caches keep a single shard so the LRU order stays global
+    created->numShards = (capacity >= CACHE_SHARDS * 16 ? CACHE_SHARDS : 1);
+    created->shardCapacity = (capacity + created->numShards - 1) / created->numShards;
+    created->capacity = capacity;
+    created->shards = calloc(created->numShards, sizeof(cacheShard_t));
+
+    if (created->shards == NULL) {
+        free(created);
+        return false;
+    }
+
+    size_t numBuckets = MIN_SHARD_BUCKETS;
+
+    while (numBuckets < created->shardCapacity) {
+        numBuckets <<= 1;
+    }
+
+    for (size_t i = 0; i < created->numShards; i++) {
+        cacheShard_t *shard = &created->shards[i];
+
+        shard->buckets = calloc(numBuckets, sizeof(cacheEntry_t*));
+        shard->bucketMask = numBuckets - 1;
+
+        if (shard->buckets == NULL) {
+            for (size_t j = 0; j < i; j++) {
+                pthread_mutex_destroy(&created->shards[j].mutex);
+                free(created->shards[j].buckets);
+            }
+
+            free(created->shards);
+            free(created);
+            return false;
+        }
+
+        pthread_mutex_init(&shard->mutex, NULL);
+    }
+
+    cache = created;
+
+    return true;
+}
+
+/*
+ * Free every entry of a shard, the shard must be locked or otherwise unused
+ */
+static void shardClear(cacheShard_t *shard) {
+    cacheEntry_t *entry = shard->lruHead;
+
+    while (entry != NULL) {
+        cacheEntry_t *next = entry->lruNext;
+        free(entry);
+        entry = next;
+    }
+
+    memset(shard->buckets, 0, (shard->bucketMask + 1) * sizeof(cacheEntry_t*));
+    shard->lruHead = NULL;
+    shard->lruTail = NULL;
+    shard->entries = 0;
+}
+
+/*
+ * Stop the cache and free every entry, no lookups may be in flight
+ */
+void cacheStop(void) {
+    if (cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->numShards; i++) {
+        shardClear(&cache->shards[i]);
+        pthread_mutex_destroy(&cache->shards[i].mutex);
+        free(cache->shards[i].buckets);
+    }
+
+    free(cache->shards);
+    free(cache);
+    cache = NULL;
+}
+
+/*
+ * Drop every cached result, the counters are kept
+ */
+void cacheClear(void) {
+    if (cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->numShards; i++) {
+        pthread_mutex_lock(&cache->shards[i].mutex);
+        shardClear(&cache->shards[i]);
+        pthread_mutex_unlock(&cache->shards[i].mutex);
+    }
+}
+
+/*
+ * Sum the counters of every shard
+ * @param stats receives the counters, all zero when the cache is disabled
+ */
+void cacheGetStats(cacheStats_t *stats) {
+    memset(stats, 0, sizeof(cacheStats_t));
+
+    if (cache == NULL) {
+        return;
+    }
+
+    stats->capacity = cache->capacity;
+
+    for (size_t i = 0; i < cache->numShards; i++) {
+        cacheShard_t *shard = &cache->shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->entries;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+/*
+ * Parse an address with libpostal, or on the sidecar daemon when connected to one
+ * @param address the address
+ * @param options the parser options
+ * @return the response, to be freed with libpostal_address_parser_response_destroy
+ */
+static libpostal_address_parser_response_t *uncachedParseAddress(char *address, libpostal_address_parser_options_t options) {
+    return sidecarActive() ? sidecarParseAddress(address, options) : libpostal_parse_address(address, options);
+}
+
+/*
+ * Expand an address with libpostal, or on the sidecar daemon when connected to one
+ * @param address the address
+ * @param options the normalize options
+ * @param root true for libpostal_expand_address_root
+ * @param n set to the number of expansions
+ * @return the expansions, to be freed with libpostal_expansion_array_destroy
+ */
+static char **uncachedExpandAddress(char *address, libpostal_normalize_options_t options, bool root, size_t *n) {
+    if (sidecarActive()) {
+        return sidecarExpandAddress(address, options, root, n);
+    }
+
+    return root ? libpostal_expand_address_root(address, options, n) : libpostal_expand_address(address, options, n);
+}
+
+/*
+ * Parse an address, serving it from the cache when possible
+ * @param address the address
+ * @param options the parser options
+ * @return the response, to be freed with libpostal_address_parser_response_destroy
+ */
+libpostal_address_parser_response_t *cachedParseAddress(char *address, libpostal_address_parser_options_t options) {
+    if (cache == NULL && !diskCacheActive()) {
+        return uncachedParseAddress(address, options);
+    }
+
+    nativeBuffer_t key;
+    nativeBuffer_t value;
+    bufferInit(&key);
+    bufferInit(&value);
+
+    libpostal_address_parser_response_t *response = NULL;
+
+    // the parser lowercases its input, so case can be folded
+    if (bufferAppendByte(&key, KEY_PARSE) && appendKeyString(&key, options.language) && appendKeyString(&key, options.country)) {
+        if (appendCanonicalAddress(&key, address, true)) {
+            if (tieredGet(&key, &value, true)) {
+                response = decodeParseResponse(&value);
+                bufferReset(&value);
+            }
+
+            if (response == NULL) {
+                response = uncachedParseAddress(address, options);
+
+                if (response != NULL && encodeParseResponse(&value, response)) {
+                    tieredPut(&key, &value);
+                }
+            }
+
+            bufferFree(&key);
+            bufferFree(&value);
+
+            return response;
+        }
+    }
+
+    // out of memory building the key, bypass the cache
+    bufferFree(&key);
+    bufferFree(&value);
+
+    return uncachedParseAddress(address, options);
+}
+
+/*
+ * Expand an address, serving it from the cache when possible
+ * @param address the address
+ * @param options the normalize options
+ * @param root true for libpostal_expand_address_root
+ * @param n set to the number of expansions
+ * @return the expansions, to be freed with libpostal_expansion_array_destroy
+ */
+char **cachedExpandAddress(char *address, libpostal_normalize_options_t options, bool root, size_t *n) {
+    if (cache == NULL && !diskCacheActive()) {
+        return uncachedExpandAddress(address, options, root, n);
+    }
+
+    nativeBuffer_t key;
+    nativeBuffer_t value;
+    bufferInit(&key);
+    bufferInit(&value);
+
+    bool keyed = bufferAppendByte(&key, root ? KEY_EXPAND_ROOT : KEY_EXPAND)
+        && bufferAppendByte(&key, options.latin_ascii) && bufferAppendByte(&key, options.transliterate)
+        && bufferAppendByte(&key, options.strip_accents) && bufferAppendByte(&key, options.decompose)
+        && bufferAppendByte(&key, options.lowercase) && bufferAppendByte(&key, options.trim_string)
+        && bufferAppendByte(&key, options.drop_parentheticals) && bufferAppendByte(&key, options.replace_numeric_hyphens)
+        && bufferAppendByte(&key, options.delete_numeric_hyphens) && bufferAppendByte(&key, options.split_alpha_from_numeric)
+        && bufferAppendByte(&key, options.replace_word_hyphens) && bufferAppendByte(&key, options.delete_word_hyphens)
+        && bufferAppendByte(&key, options.delete_final_periods) && bufferAppendByte(&key, options.delete_acronym_periods)
+        && bufferAppendByte(&key, options.drop_english_possessives) && bufferAppendByte(&key, options.delete_apostrophes)
+        && bufferAppendByte(&key, options.expand_numex) && bufferAppendByte(&key, options.roman_numerals)
+        && bufferAppend(&key, &options.address_components, sizeof(options.address_components))
+        && bufferAppend(&key, &options.num_languages, sizeof(options.num_languages));
+
+    for (size_t i = 0; keyed && i < options.num_languages; i++) {
+        keyed = appendKeyString(&key, options.languages[i]);
+    }
+
+    // without the lowercase option the expansions keep the input case, so it must stay in the key
+    if (keyed && appendCanonicalAddress(&key, address, options.lowercase)) {
+        char **expansions = NULL;
+
+        if (tieredGet(&key, &value, false)) {
+            expansions = decodeExpansions(&value, n);
+            bufferReset(&value);
+        }
+
+        if (expansions == NULL) {
+            expansions = uncachedExpandAddress(address, options, root, n);
+
+            if (expansions != NULL && encodeExpansions(&value, expansions, *n)) {
+                tieredPut(&key, &value);
+            }
+        }
+
+        bufferFree(&key);
+        bufferFree(&value);
+
+        return expansions;
+    }
+
+    // out of memory building the key, bypass the cache
+    bufferFree(&key);
+    bufferFree(&value);
+
+    return uncachedExpandAddress(address, options, root, n);
+}
@@ -0,0 +1,43 @@
+/*
+ * postal4j_cache.h
+ * Sharded LRU cache of libpostal parse and expand results
+ */
+
+#ifndef POSTAL4J_CACHE_H
+#define POSTAL4J_CACHE_H
+
+#include <libpostal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Upper bound on the number of cached results
+#define MAX_CACHE_ENTRIES (1 << 26)
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+    uint64_t capacity;
+} cacheStats_t;
+
+bool cacheStart(size_t capacity);
+void cacheStop(void);
+void cacheClear(void);
+void cacheGetStats(cacheStats_t *stats);
+
+// Drop-in replacements for libpostal_parse_address/libpostal_expand_address(_root), results are freed
+// with the matching libpostal destroy function whether they came from the cache or from libpostal
+libpostal_address_parser_response_t *cachedParseAddress(char *address, libpostal_address_parser_options_t options);
+char **cachedExpandAddress(char *address, libpostal_normalize_options_t options, bool root, size_t *n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_CACHE_H */
@@ -0,0 +1,419 @@
+/*
+ * postal4j_diskcache.c
+ * Persistent memory-mapped cache of libpostal parse and expand results, shared by the processes of a host
+ *
+ * The file is a header page followed by fixed size slots, grouped in buckets of DISK_CACHE_WAYS slots, used in
+ * place through one shared mapping of every process that opened it:
+ *
+ *   header    magic, slot size and slot count, written once when the file is created
+ *   slots     { sequence, key hash, data tag, checksum, key length, value length, key bytes, value bytes }
+ *
+ * A key goes to the bucket picked by its hash and may sit in any slot of it, a store replaces the slot holding
+ * the same key, else a free or stale one, else a pseudo-random one. Each slot is guarded by a sequence lock:
+ * a writer moves the sequence to an odd value with a compare and swap (skipping the store if another writer
+ * got there first), writes the entry and moves it to the next even value; a reader copies the entry out and
+ * only trusts the copy if the sequence was even and unchanged around it. So any number of processes read and
+ * write concurrently without locks or system calls, and a writer dying half way only loses its slot.
+ *
+ * Every entry carries the data tag of the process that stored it, a fingerprint of its libpostal data files.
+ * An entry with another tag is a miss and the first slot to be overwritten, so updating the libpostal data
+ * drops the stale results without any reset, and processes running different data can share a file.
+ * The checksum covers the key and value, so an entry torn by a crash of the host is a miss as well.
+ */
+
+#include "postal4j_diskcache.h"
+#include "postal4j_file.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Modification time of a struct stat, Apple kept the BSD field name
+#ifdef __APPLE__
+#define MODIFIED_TIME(st) ((st).st_mtimespec)
+#else
+#define MODIFIED_TIME(st) ((st).st_mtim)
+#endif
+
+#define HEADER_BYTES 4096
+
+// Slots per bucket
+#define DISK_CACHE_WAYS 4
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotBytes;
+    uint64_t numSlots;
+} diskCacheHeader_t;
+
+typedef struct {
+    _Atomic uint64_t sequence;
+    uint64_t hash;
+    uint64_t tag;
+    uint64_t checksum;
+    uint32_t keyLength;
+    uint32_t valueLength;
+    // the key immediately followed by the value
+    char data[];
+} diskSlot_t;
+
+// Bytes of a slot available to the key and the value
+#define SLOT_DATA_BYTES (DISK_CACHE_SLOT_BYTES - sizeof(diskSlot_t))
+
+typedef struct {
+    int fd;
+    char *map;
+    size_t mappedBytes;
+    size_t numBuckets;
+    uint64_t tag;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t stores;
+    _Atomic uint64_t skipped;
+} diskCache_t;
+
+static diskCache_t *diskCache = NULL;
+
+// Data files whose size and modification time go into the data tag
+static const char *dataFiles[] = {
+    "address_expansions/address_dictionary.dat",
+    "address_parser/address_parser.dat",
+    "address_parser/address_parser_crf.dat",
+    "address_parser/address_parser_phrases.dat",
+    "address_parser/address_parser_postal_codes.dat",
+    "address_parser/address_parser_vocab.trie",
+    "language_classifier/language_classifier.dat",
+    "numex/numex.dat",
+    "transliteration/transliteration.dat"
+};
+
+// Version files written by libpostal_data, whose contents go into the data tag
+static const char *versionFiles[] = {
+    "data_version",
+    "base_data_file_version",
+    "parser_model_file_version",
+    "language_classifier_model_file_version"
+};
+
+/*
+ * Continue a 64-bit FNV-1a hash
+ * @param hash the hash so far
+ * @param data the bytes
+ * @param length the number of bytes
+ * @return the hash
+ */
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static inline diskSlot_t *slotAt(size_t index) {
+    return (diskSlot_t*)(diskCache->map + HEADER_BYTES + index * DISK_CACHE_SLOT_BYTES);
+}
+
+static inline uint64_t entryChecksum(const char *data, size_t length) {
+    return hashBytes(14695981039346656037ULL, data, length);
+}
+
+/*
+ * Map the file and check or write its header, the file must be locked
+ * @param cache the cache being opened
+ * @param bytes the size of a new file
+ * @return NULL on success, otherwise the error message
+ */
+static const char *mapDiskCache(diskCache_t *cache, size_t bytes) {
+    struct stat st;
+
+    if (fstat(cache->fd, &st) != 0) {
+        return "Error reading disk cache file";
+    }
+
+    bool created = (st.st_size == 0);
+
+    if (created) {
+        size_t numSlots = (bytes - HEADER_BYTES) / DISK_CACHE_SLOT_BYTES / DISK_CACHE_WAYS * DISK_CACHE_WAYS;
+
+        bytes = HEADER_BYTES + numSlots * DISK_CACHE_SLOT_BYTES;
+
+        if (!fileAllocate(cache->fd, bytes)) {
+            return "Error creating disk cache file";
+        }
+    } else {
+        bytes = (size_t)st.st_size;
+
+        if (bytes < HEADER_BYTES) {
+            return "Not a disk cache file";
+        }
+    }
+
+    void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+
+    if (map == MAP_FAILED) {
+        return "Error mapping disk cache file";
+    }
+
+    cache->map = map;
+    cache->mappedBytes = bytes;
+
+    diskCacheHeader_t *header = (diskCacheHeader_t*)cache->map;
+
+    if (created) {
+        memcpy(header->magic, DISK_CACHE_MAGIC, sizeof(header->magic));
+        header->version = DISK_CACHE_VERSION;
+        header->slotBytes = DISK_CACHE_SLOT_BYTES;
+        header->numSlots = (bytes - HEADER_BYTES) / DISK_CACHE_SLOT_BYTES;
+
+        // the header must be complete before the lock lets another process read it
+        if (msync(cache->map, HEADER_BYTES, MS_SYNC) != 0) {
+            return "Error creating disk cache file";
+        }
+    } else if (memcmp(header->magic, DISK_CACHE_MAGIC, sizeof(header->magic)) != 0
+            || header->version != DISK_CACHE_VERSION || header->slotBytes != DISK_CACHE_SLOT_BYTES
+            || header->numSlots == 0 || header->numSlots % DISK_CACHE_WAYS != 0
+            || header->numSlots > (bytes - HEADER_BYTES) / DISK_CACHE_SLOT_BYTES) {
+        return "Not a disk cache file";
+    }
+
+    cache->numBuckets = header->numSlots / DISK_CACHE_WAYS;
+
+    return NULL;
+}
+
+const char *diskCacheOpen(const char *path, size_t bytes, uint64_t dataTag) {
+    if (diskCache != NULL) {
+        return "Disk cache is already open";
+    }
+
+    if (bytes < MIN_DISK_CACHE_BYTES || bytes > MAX_DISK_CACHE_BYTES) {
+        return "Disk cache size must be between 1 MB and 1 TB";
+    }
+
+    if (dataTag == 0) {
+        return "Disk cache needs a libpostal data tag";
+    }
+
+    diskCache_t *cache = calloc(1, sizeof(diskCache_t));
+
+    if (cache == NULL) {
+        return "Error allocating disk cache";
+    }
+
+    cache->tag = dataTag;
+    cache->fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (cache->fd < 0) {
+        free(cache);
+        return "Error opening disk cache file";
+    }
+
+    // only held while the file is created or checked, the slots need no lock
+    const char *error = NULL;
+
+    if (flock(cache->fd, LOCK_EX) != 0) {
+        error = "Error locking disk cache file";
+    } else {
+        error = mapDiskCache(cache, bytes);
+        flock(cache->fd, LOCK_UN);
+    }
+
+    if (error != NULL) {
+        if (cache->map != NULL) {
+            munmap(cache->map, cache->mappedBytes);
+        }
+        close(cache->fd);
+        free(cache);
+        return error;
+    }
+
+    diskCache = cache;
+
+    return NULL;
+}
+
+void diskCacheClose(void) {
+    if (diskCache == NULL) {
+        return;
+    }
+
+    // the kernel writes the shared pages back, other processes keep using them meanwhile
+    munmap(diskCache->map, diskCache->mappedBytes);
+    close(diskCache->fd);
+    free(diskCache);
+    diskCache = NULL;
+}
+
+bool diskCacheActive(void) {
+    return diskCache != NULL;
+}
+
+bool diskCacheGet(uint64_t hash, const char *key, size_t keyLength, nativeBuffer_t *value) {
+    size_t first = (size_t)(hash % diskCache->numBuckets) * DISK_CACHE_WAYS;
+
+    if (keyLength < SLOT_DATA_BYTES) {
+        char copy[SLOT_DATA_BYTES];
+
+        for (size_t i = first; i < first + DISK_CACHE_WAYS; i++) {
+            diskSlot_t *slot = slotAt(i);
+            uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+            // odd while a writer is in it, zero while it was never written
+            if ((sequence & 1) != 0 || sequence == 0 || slot->hash != hash || slot->tag != diskCache->tag) {
+                continue;
+            }
+
+            size_t storedKeyLength = slot->keyLength;
+            size_t valueLength = slot->valueLength;
+            uint64_t checksum = slot->checksum;
+
+            // the lengths may be torn as well, checked before they are used
+            if (storedKeyLength != keyLength || valueLength > SLOT_DATA_BYTES - keyLength) {
+                continue;
+            }
+
+            memcpy(copy, slot->data, keyLength + valueLength);
+
+            atomic_thread_fence(memory_order_acquire);
+
+            if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != sequence) {
+                continue;
+            }
+
+            if (memcmp(copy, key, keyLength) == 0 && entryChecksum(copy, keyLength + valueLength) == checksum
+                    && bufferAppend(value, copy + keyLength, valueLength)) {
+                atomic_fetch_add_explicit(&diskCache->hits, 1, memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    atomic_fetch_add_explicit(&diskCache->misses, 1, memory_order_relaxed);
+
+    return false;
+}
+
+void diskCachePut(uint64_t hash, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+    if (keyLength + valueLength > SLOT_DATA_BYTES) {
+        atomic_fetch_add_explicit(&diskCache->skipped, 1, memory_order_relaxed);
+        return;
+    }
+
+    size_t first = (size_t)(hash % diskCache->numBuckets) * DISK_CACHE_WAYS;
+    diskSlot_t *victim = NULL;
+    int victimRank = 0;
+
+    // the slot of the same key, else a free one, else one holding another data version, else any of them
+    for (size_t i = first; i < first + DISK_CACHE_WAYS && victimRank < 3; i++) {
+        diskSlot_t *slot = slotAt(i);
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+        int rank = (sequence == 0 ? 2 : (slot->hash == hash && slot->tag == diskCache->tag) ? 3 : slot->tag != diskCache->tag ? 1 : 0);
+
+        if (victim == NULL || rank > victimRank) {
+            victim = slot;
+            victimRank = rank;
+        }
+    }
+
+    if (victimRank == 0) {
+        victim = slotAt(first + (size_t)((hash >> 32) ^ atomic_load_explicit(&diskCache->stores, memory_order_relaxed)) % DISK_CACHE_WAYS);
+    }
+
+    uint64_t sequence = atomic_load_explicit(&victim->sequence, memory_order_relaxed);
+
+    // another writer (possibly one that died) holds the slot, the result is simply not stored
+    if ((sequence & 1) != 0 || !atomic_compare_exchange_strong_explicit(&victim->sequence, &sequence, sequence + 1,
+            memory_order_acquire, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&diskCache->skipped, 1, memory_order_relaxed);
+        return;
+    }
+
+    // the odd sequence must be visible before any of the new entry
+    atomic_thread_fence(memory_order_release);
+
+    victim->hash = hash;
+    victim->tag = diskCache->tag;
+    victim->keyLength = (uint32_t)keyLength;
+    victim->valueLength = (uint32_t)valueLength;
+    memcpy(victim->data, key, keyLength);
+    memcpy(victim->data + keyLength, value, valueLength);
+    victim->checksum = entryChecksum(victim->data, keyLength + valueLength);
+
+    atomic_store_explicit(&victim->sequence, sequence + 2, memory_order_release);
+    atomic_fetch_add_explicit(&diskCache->stores, 1, memory_order_relaxed);
+}
+
+void diskCacheGetStats(diskCacheStats_t *stats) {
+    memset(stats, 0, sizeof(diskCacheStats_t));
+
+    if (diskCache == NULL) {
+        return;
+    }
+
+    stats->hits = atomic_load_explicit(&diskCache->hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&diskCache->misses, memory_order_relaxed);
+    stats->stores = atomic_load_explicit(&diskCache->stores, memory_order_relaxed);
+    stats->skipped = atomic_load_explicit(&diskCache->skipped, memory_order_relaxed);
+    stats->slots = diskCache->numBuckets * DISK_CACHE_WAYS;
+    stats->fileBytes = diskCache->mappedBytes;
+}
+
+uint64_t diskCacheDataTag(const char *dataDir) {
+    uint64_t hash = 14695981039346656037ULL;
+    size_t found = 0;
+    char path[4096];
+
+    for (size_t i = 0; i < sizeof(dataFiles) / sizeof(dataFiles[0]); i++) {
+        struct stat st;
+
+        if (snprintf(path, sizeof(path), "%s/%s", dataDir, dataFiles[i]) >= (int)sizeof(path) || stat(path, &st) != 0) {
+            continue;
+        }
+
+        // any model file that is replaced or rewritten changes the tag
+        int64_t fingerprint[3] = { (int64_t)st.st_size, (int64_t)MODIFIED_TIME(st).tv_sec, (int64_t)MODIFIED_TIME(st).tv_nsec };
+
+        hash = hashBytes(hash, dataFiles[i], strlen(dataFiles[i]) + 1);
+        hash = hashBytes(hash, fingerprint, sizeof(fingerprint));
+        found++;
+    }
+
+    if (found == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(versionFiles) / sizeof(versionFiles[0]); i++) {
+        if (snprintf(path, sizeof(path), "%s/%s", dataDir, versionFiles[i]) >= (int)sizeof(path)) {
+            continue;
+        }
+
+        FILE *file = fopen(path, "rb");
+
+        if (file == NULL) {
+            continue;
+        }
+
+        char contents[256];
+        size_t length = fread(contents, 1, sizeof(contents), file);
+        fclose(file);
+
+        hash = hashBytes(hash, versionFiles[i], strlen(versionFiles[i]) + 1);
+        hash = hashBytes(hash, contents, length);
+    }
+
+    // the serialized results change with the cache format
+    uint32_t version = DISK_CACHE_VERSION;
+    hash = hashBytes(hash, &version, sizeof(version));
+
+    return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * postal4j_diskcache.h
+ * Persistent memory-mapped cache of libpostal parse and expand results, shared by the processes of a host
+ */
+
+#ifndef POSTAL4J_DISKCACHE_H
+#define POSTAL4J_DISKCACHE_H
+
+#include "postal4j_buffer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// First bytes of a cache file
+#define DISK_CACHE_MAGIC "P4JDCAC1"
+#define DISK_CACHE_VERSION 1
+
+// Size of one entry slot, results that do not fit (key plus value) are not stored
+#define DISK_CACHE_SLOT_BYTES 2048
+
+// Bounds of the size of a new cache file
+#define MIN_DISK_CACHE_BYTES (1L << 20)
+#define MAX_DISK_CACHE_BYTES (1L << 40)
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t skipped;
+    uint64_t slots;
+    uint64_t fileBytes;
+} diskCacheStats_t;
+
+// Opens the cache file, creating it with the given size if it is empty or missing. An existing file keeps the
+// size it was created with. Entries are tagged with dataTag (see diskCacheDataTag), entries with another tag are
+// misses and get overwritten. Returns NULL on success, otherwise the error message.
+const char *diskCacheOpen(const char *path, size_t bytes, uint64_t dataTag);
+
+// Unmaps the file, no lookups may be in flight
+void diskCacheClose(void);
+
+bool diskCacheActive(void);
+
+// Looks up a key (hash being the hash of its bytes) and appends the value on a hit
+bool diskCacheGet(uint64_t hash, const char *key, size_t keyLength, nativeBuffer_t *value);
+
+// Stores a value, silently skipped when it is too large or another writer holds its slot
+void diskCachePut(uint64_t hash, const char *key, size_t keyLength, const char *value, size_t valueLength);
+
+void diskCacheGetStats(diskCacheStats_t *stats);
+
+// Fingerprint of the libpostal data in a directory (version files, model file sizes and modification times),
+// 0 if the directory holds no libpostal data
+uint64_t diskCacheDataTag(const char *dataDir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_DISKCACHE_H */
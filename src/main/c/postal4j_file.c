@@ -0,0 +1,49 @@
+/*
+ * postal4j_file.c
+ * File helpers shared by the memory-mapped index and cache files
+ *
+ * Linux and the BSDs have posix_fallocate. macOS does not, there the blocks are reserved with
+ * fcntl(F_PREALLOCATE), which does not change the file size, and the file is then extended with
+ * ftruncate over the reserved blocks.
+ */
+
+#include "postal4j_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+
+bool fileAllocate(int fd, size_t bytes) {
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    if ((off_t)bytes <= st.st_size) {
+        return true;
+    }
+
+    // all or nothing past the current end, contiguous if the file system can, then anywhere
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)bytes - st.st_size, 0 };
+
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+
+        if (fcntl(fd, F_PREALLOCATE, &store) == -1 && errno != ENOTSUP) {
+            return false;
+        }
+    }
+
+    return ftruncate(fd, (off_t)bytes) == 0;
+}
+
+#else
+
+bool fileAllocate(int fd, size_t bytes) {
+    return posix_fallocate(fd, 0, (off_t)bytes) == 0;
+}
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * postal4j_file.h
+ * File helpers shared by the memory-mapped index and cache files
+ */
+
+#ifndef POSTAL4J_FILE_H
+#define POSTAL4J_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Grows a file to at least bytes with its blocks allocated, so a full disk fails here rather than faulting a later
+// store into the mapping. A larger file is left as it is. Where the file system cannot preallocate (macOS file
+// systems without F_PREALLOCATE) the file is extended sparse instead and that guarantee does not hold.
+bool fileAllocate(int fd, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_FILE_H */
@@ -0,0 +1,314 @@
+/*
+ * postal4j_format.c
+ * JSON, CSV and length-prefixed binary records of libpostal parse and expand results
+ *
+ * JSON records are one line each: a parse is an object of label to value in libpostal order, an
+ * expansion list is an array of strings. Quotes, backslashes and control characters are escaped,
+ * everything else (UTF-8 included) is copied as is.
+ *
+ * CSV records are one line each, fields quoted (with quotes doubled) only when they contain a comma,
+ * a quote or a line break. A parse has one column per AddressLabel, in enum order, an expansion list
+ * one column per expansion.
+ *
+ * In both text formats repeated parse labels are joined by a space, as in the bulk TSV output.
+ *
+ * Binary records are the bulk binary records, all integers little-endian uint32. A parse is the
+ * component count, then per component the AddressLabel ordinal byte (0xFF plus a length byte and
+ * the label for unknown labels), the value length and the UTF-8 value. An expansion list is the
+ * count, then per expansion its length and UTF-8 bytes.
+ */
+
+#include "postal4j_format.h"
+#include "postal4j_labels.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Components of a parse whose label ordinals are looked up on the stack
+#define INLINE_COMPONENTS 32
+
+/*
+ * Append a little-endian uint32
+ * @param out the buffer
+ * @param value the value
+ * @return true on success, false if out of memory
+ */
+static bool appendUint32(nativeBuffer_t *out, uint32_t value) {
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+
+    return bufferAppend(out, bytes, sizeof(bytes));
+}
+
+/*
+ * Append a length prefixed string for binary output
+ * @param out the buffer
+ * @param value the string
+ * @return true on success, false if out of memory
+ */
+static bool appendBinaryString(nativeBuffer_t *out, const char *value) {
+    size_t length = strlen(value);
+
+    return appendUint32(out, (uint32_t)length) && bufferAppend(out, value, length);
+}
+
+/*
+ * Append the characters of a JSON string, without the quotes
+ * @param out the buffer
+ * @param value the string
+ * @return true on success, false if out of memory
+ */
+static bool appendJsonChars(nativeBuffer_t *out, const char *value) {
+    static const char hex[] = "0123456789abcdef";
+    const char *run = value;
+
+    for (const char *c = value; ; c++) {
+        uint8_t byte = (uint8_t)*c;
+
+        if (byte >= 0x20 && byte != '"' && byte != '\\') {
+            continue;
+        }
+
+        // copy the plain run in one go, libpostal output rarely needs escaping
+        if (c > run && !bufferAppend(out, run, (size_t)(c - run))) {
+            return false;
+        }
+
+        if (byte == '\0') {
+            return true;
+        }
+
+        char escape[6] = { '\\', (char)byte, 0, 0, 0, 0 };
+        size_t length = 2;
+
+        switch (byte) {
+            case '"': case '\\': break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            default:
+                memcpy(escape + 1, "u00", 3);
+                escape[4] = hex[byte >> 4];
+                escape[5] = hex[byte & 0xF];
+                length = 6;
+        }
+
+        if (!bufferAppend(out, escape, length)) {
+            return false;
+        }
+
+        run = c + 1;
+    }
+}
+
+static bool appendJsonString(nativeBuffer_t *out, const char *value) {
+    return bufferAppendByte(out, '"') && appendJsonChars(out, value) && bufferAppendByte(out, '"');
+}
+
+/*
+ * Append a CSV field, quoted when it contains a comma, a quote or a line break
+ * @param out the buffer
+ * @param value the field
+ * @return true on success, false if out of memory
+ */
+static bool appendCsvField(nativeBuffer_t *out, const char *value) {
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        return bufferAppend(out, value, strlen(value));
+    }
+
+    if (!bufferAppendByte(out, '"')) {
+        return false;
+    }
+
+    for (const char *c = value; *c != '\0'; c++) {
+        if ((*c == '"' && !bufferAppendByte(out, '"')) || !bufferAppendByte(out, (uint8_t)*c)) {
+            return false;
+        }
+    }
+
+    return bufferAppendByte(out, '"');
+}
+
+/*
+ * Append a binary parse record
+ */
+static bool binaryParseRecord(nativeBuffer_t *out, const libpostal_address_parser_response_t *response, size_t count) {
+    bool formatted = appendUint32(out, (uint32_t)count);
+
+    for (size_t i = 0; formatted && i < count; i++) {
+        int ordinal = addressLabelOrdinal(response->labels[i]);
+
+        if (ordinal >= 0) {
+            formatted = bufferAppendByte(out, (uint8_t)ordinal);
+        } else {
+            size_t length = strlen(response->labels[i]);
+            length = (length > UINT8_MAX ? UINT8_MAX : length);
+
+            formatted = bufferAppendByte(out, RECORD_UNKNOWN_LABEL) && bufferAppendByte(out, (uint8_t)length) &&
+                bufferAppend(out, response->labels[i], length);
+        }
+
+        formatted = formatted && appendBinaryString(out, response->components[i]);
+    }
+
+    return formatted;
+}
+
+/*
+ * Append a JSON parse record, the values of a repeated label joined under its first occurrence
+ */
+static bool jsonParseRecord(nativeBuffer_t *out, const libpostal_address_parser_response_t *response, size_t count) {
+    bool formatted = bufferAppendByte(out, '{');
+    bool first = true;
+
+    for (size_t i = 0; formatted && i < count; i++) {
+        bool repeated = false;
+
+        for (size_t j = 0; j < i && !repeated; j++) {
+            repeated = (strcmp(response->labels[j], response->labels[i]) == 0);
+        }
+
+        if (repeated) {
+            continue;
+        }
+
+        formatted = (first || bufferAppendByte(out, ',')) && appendJsonString(out, response->labels[i])
+            && bufferAppend(out, ":\"", 2) && appendJsonChars(out, response->components[i]);
+        first = false;
+
+        for (size_t j = i + 1; formatted && j < count; j++) {
+            if (strcmp(response->labels[j], response->labels[i]) == 0) {
+                formatted = bufferAppendByte(out, ' ') && appendJsonChars(out, response->components[j]);
+            }
+        }
+
+        formatted = formatted && bufferAppendByte(out, '"');
+    }
+
+    return formatted && bufferAppend(out, "}\n", 2);
+}
+
+/*
+ * Append a CSV parse record, one column per AddressLabel
+ */
+static bool csvParseRecord(nativeBuffer_t *out, const libpostal_address_parser_response_t *response, size_t count) {
+    // look every label up once, then emit the columns in AddressLabel order
+    int inlineOrdinals[INLINE_COMPONENTS];
+    int *ordinals = (count > INLINE_COMPONENTS ? malloc(count * sizeof(int)) : inlineOrdinals);
+
+    if (ordinals == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ordinals[i] = addressLabelOrdinal(response->labels[i]);
+    }
+
+    bool formatted = true;
+
+    for (int label = 0; formatted && label < NUM_ADDRESS_LABELS; label++) {
+        size_t first = count;
+        size_t matches = 0;
+
+        if (label > 0) {
+            formatted = bufferAppendByte(out, ',');
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (ordinals[i] == label) {
+                first = (matches++ == 0 ? i : first);
+            }
+        }
+
+        if (!formatted || matches == 0) {
+            continue;
+        }
+
+        if (matches == 1) {
+            formatted = appendCsvField(out, response->components[first]);
+            continue;
+        }
+
+        // join the values first, the quoting depends on all of them
+        nativeBuffer_t joined;
+        bufferInit(&joined);
+
+        for (size_t i = first; formatted && i < count; i++) {
+            if (ordinals[i] == label) {
+                formatted = (i == first || bufferAppendByte(&joined, ' '))
+                    && bufferAppend(&joined, response->components[i], strlen(response->components[i]));
+            }
+        }
+
+        formatted = formatted && bufferAppendByte(&joined, '\0') && appendCsvField(out, joined.data);
+        bufferFree(&joined);
+    }
+
+    if (ordinals != inlineOrdinals) {
+        free(ordinals);
+    }
+
+    return formatted && bufferAppendByte(out, '\n');
+}
+
+/*
+ * Append a parse record
+ * @param out the buffer
+ * @param format the record format
+ * @param response the parse, or NULL for an empty record
+ * @return true on success, false if out of memory
+ */
+bool formatParseRecord(nativeBuffer_t *out, recordFormat_t format, const libpostal_address_parser_response_t *response) {
+    size_t count = (response != NULL ? response->num_components : 0);
+
+    switch (format) {
+        case RECORD_FORMAT_JSON:
+            return jsonParseRecord(out, response, count);
+        case RECORD_FORMAT_CSV:
+            return csvParseRecord(out, response, count);
+        default:
+            return binaryParseRecord(out, response, count);
+    }
+}
+
+/*
+ * Append an expansion record
+ * @param out the buffer
+ * @param format the record format
+ * @param expansions the expansions, or NULL for an empty record
+ * @param count the number of expansions
+ * @return true on success, false if out of memory
+ */
+bool formatExpansionRecord(nativeBuffer_t *out, recordFormat_t format, char **expansions, size_t count) {
+    if (expansions == NULL) {
+        count = 0;
+    }
+
+    bool formatted = true;
+
+    switch (format) {
+        case RECORD_FORMAT_JSON:
+            formatted = bufferAppendByte(out, '[');
+
+            for (size_t i = 0; formatted && i < count; i++) {
+                formatted = (i == 0 || bufferAppendByte(out, ',')) && appendJsonString(out, expansions[i]);
+            }
+
+            return formatted && bufferAppend(out, "]\n", 2);
+        case RECORD_FORMAT_CSV:
+            for (size_t i = 0; formatted && i < count; i++) {
+                formatted = (i == 0 || bufferAppendByte(out, ',')) && appendCsvField(out, expansions[i]);
+            }
+
+            return formatted && bufferAppendByte(out, '\n');
+        default:
+            formatted = appendUint32(out, (uint32_t)count);
+
+            for (size_t i = 0; formatted && i < count; i++) {
+                formatted = appendBinaryString(out, expansions[i]);
+            }
+
+            return formatted;
+    }
+}
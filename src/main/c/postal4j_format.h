@@ -0,0 +1,38 @@
+/*
+ * postal4j_format.h
+ * JSON, CSV and length-prefixed binary records of libpostal parse and expand results
+ */
+
+#ifndef POSTAL4J_FORMAT_H
+#define POSTAL4J_FORMAT_H
+
+#include "postal4j_buffer.h"
+#include <libpostal.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Must match the order of com.dnebinger.postal4j.RecordFormat
+typedef enum {
+    RECORD_FORMAT_JSON = 0,
+    RECORD_FORMAT_CSV = 1,
+    RECORD_FORMAT_BINARY = 2
+} recordFormat_t;
+
+#define NUM_RECORD_FORMATS 3
+
+// Label byte of a binary parse component whose label is not in the AddressLabel table
+#define RECORD_UNKNOWN_LABEL 0xFF
+
+// Append one record, a NULL response or expansion array gives an empty record. False if out of memory.
+bool formatParseRecord(nativeBuffer_t *out, recordFormat_t format, const libpostal_address_parser_response_t *response);
+bool formatExpansionRecord(nativeBuffer_t *out, recordFormat_t format, char **expansions, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_FORMAT_H */
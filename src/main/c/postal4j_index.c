@@ -0,0 +1,565 @@
+/*
+ * postal4j_index.c
+ * Persistent memory-mapped blocking index from near-dupe hash keys to posting lists of record ids
+ *
+ * The file is a header page followed by an append-only data region, used in place through one shared mapping:
+ *
+ *   header    magic, counters, the offset of the key table and the options string the index was built with
+ *   table     open addressing (linear probing) slots of { key hash, offset of the last posting block, id count }
+ *   blocks    { offset of the previous block, used, capacity, ids[capacity] }
+ *
+ * A key's posting list is a chain of blocks walked backwards from the newest, each block twice the size of the
+ * one before it (up to a cap), so appending an id is a table probe plus a store and never moves existing data.
+ * When the table gets too full a table twice the size is written at the end of the data region and the old one
+ * is abandoned. The file grows by half at a time and is trimmed to the used length on close, so reopening is one
+ * mmap.
+ *
+ * Keys are the 64-bit FNV-1a hashes of the blocking key strings. A hash collision only adds candidates, which
+ * the caller verifies anyway. The header is marked dirty (and synced) before the first change after a flush,
+ * so a file whose writer died half way is refused instead of being read.
+ */
+
+#include "postal4j_index.h"
+#include "postal4j_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HEADER_BYTES 4096
+
+#define INITIAL_TABLE_SLOTS (1 << 16)
+#define INITIAL_BLOCK_IDS 2
+#define MAX_BLOCK_IDS 1024
+
+// The file grows at least this much at a time
+#define MIN_GROWTH_BYTES (16 << 20)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t dirty;
+    uint64_t usedBytes;
+    uint64_t tableOffset;
+    uint64_t tableSlots;
+    uint64_t numKeys;
+    uint64_t numRecords;
+    uint64_t numPostings;
+    char meta[INDEX_MAX_META];
+} indexHeader_t;
+
+typedef struct {
+    uint64_t key;
+    uint64_t tail;
+    uint64_t count;
+} indexSlot_t;
+
+typedef struct {
+    uint64_t prev;
+    uint32_t used;
+    uint32_t capacity;
+    int64_t ids[];
+} indexBlock_t;
+
+struct blockingIndex {
+    int fd;
+    char *map;
+    size_t mappedBytes;
+    pthread_rwlock_t lock;
+};
+
+_Static_assert(sizeof(indexHeader_t) <= HEADER_BYTES, "index header must fit its page");
+
+#define HEADER(index) ((indexHeader_t*)(index)->map)
+#define AT(index, offset, type) ((type*)((index)->map + (offset)))
+
+/*
+ * 64-bit FNV-1a hash of a key, never 0 (the empty slot marker)
+ * @param key the key
+ * @return the hash
+ */
+static uint64_t hashKey(const char *key) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const char *c = key; *c != '\0'; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+static int compareKeys(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+
+    return (left > right) - (left < right);
+}
+
+static int compareIds(const void *a, const void *b) {
+    int64_t left = *(const int64_t*)a;
+    int64_t right = *(const int64_t*)b;
+
+    return (left > right) - (left < right);
+}
+
+/*
+ * Map the first bytes of the file, replacing any current mapping
+ * @param index the index
+ * @param bytes the number of bytes, the file must be at least this long
+ * @return true on success
+ */
+static bool mapIndex(blockingIndex_t *index, size_t bytes) {
+    if (index->map != NULL) {
+        munmap(index->map, index->mappedBytes);
+        index->map = NULL;
+    }
+
+    void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, index->fd, 0);
+
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    index->map = map;
+    index->mappedBytes = bytes;
+
+    return true;
+}
+
+/*
+ * Make sure the file and mapping have room for more bytes after the used region. Any pointer into the mapping
+ * is invalid afterwards.
+ * @param index the index
+ * @param bytes the number of bytes needed
+ * @return true on success, false if the file could not be grown
+ */
+static bool reserveBytes(blockingIndex_t *index, size_t bytes) {
+    size_t needed = HEADER(index)->usedBytes + bytes;
+
+    if (needed <= index->mappedBytes) {
+        return true;
+    }
+
+    // grow by half, a file of billions of postings should not double at once
+    size_t target = index->mappedBytes + index->mappedBytes / 2;
+
+    if (target < needed + MIN_GROWTH_BYTES) {
+        target = needed + MIN_GROWTH_BYTES;
+    }
+
+    // allocate the blocks rather than extend a sparse file, a full disk must fail here and not fault in a store
+    if (!fileAllocate(index->fd, target)) {
+        return false;
+    }
+
+    return mapIndex(index, target);
+}
+
+/*
+ * Take bytes from the end of the used region, call reserveBytes first
+ * @param index the index
+ * @param bytes the number of bytes, a multiple of 8
+ * @return the offset of the bytes, zeroed
+ */
+static uint64_t allocateBytes(blockingIndex_t *index, size_t bytes) {
+    indexHeader_t *header = HEADER(index);
+    uint64_t offset = header->usedBytes;
+
+    memset(index->map + offset, 0, bytes);
+    header->usedBytes += bytes;
+
+    return offset;
+}
+
+/*
+ * Find the slot of a key, or the empty slot where it belongs
+ * @param index the index
+ * @param key the key hash
+ * @return the slot
+ */
+static indexSlot_t *findSlot(blockingIndex_t *index, uint64_t key) {
+    indexHeader_t *header = HEADER(index);
+    indexSlot_t *table = AT(index, header->tableOffset, indexSlot_t);
+    uint64_t mask = header->tableSlots - 1;
+
+    for (uint64_t i = key & mask; ; i = (i + 1) & mask) {
+        if (table[i].key == key || table[i].key == 0) {
+            return &table[i];
+        }
+    }
+}
+
+/*
+ * Move the keys into a table twice the size at the end of the data region
+ * @param index the index
+ * @return true on success, false if the file could not be grown
+ */
+static bool growTable(blockingIndex_t *index) {
+    uint64_t slots = HEADER(index)->tableSlots * 2;
+
+    if (!reserveBytes(index, slots * sizeof(indexSlot_t))) {
+        return false;
+    }
+
+    indexHeader_t *header = HEADER(index);
+    uint64_t oldOffset = header->tableOffset;
+    uint64_t oldSlots = header->tableSlots;
+
+    header->tableOffset = allocateBytes(index, slots * sizeof(indexSlot_t));
+    header->tableSlots = slots;
+
+    indexSlot_t *oldTable = AT(index, oldOffset, indexSlot_t);
+
+    for (uint64_t i = 0; i < oldSlots; i++) {
+        if (oldTable[i].key != 0) {
+            *findSlot(index, oldTable[i].key) = oldTable[i];
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Mark the file dirty on disk before its first change since the last flush
+ * @param index the index
+ * @return true on success
+ */
+static bool markDirty(blockingIndex_t *index) {
+    indexHeader_t *header = HEADER(index);
+
+    if (header->dirty) {
+        return true;
+    }
+
+    header->dirty = 1;
+
+    return msync(index->map, HEADER_BYTES, MS_SYNC) == 0;
+}
+
+/*
+ * Append one id to the posting list of a key
+ * @param index the index
+ * @param key the key hash
+ * @param id the record id
+ * @return true on success, false if the file could not be grown
+ */
+static bool addPosting(blockingIndex_t *index, uint64_t key, int64_t id) {
+    indexSlot_t *slot = findSlot(index, key);
+
+    if (slot->key == 0) {
+        indexHeader_t *header = HEADER(index);
+
+        // keep the table at most 70% full so probe chains stay short
+        if ((header->numKeys + 1) * 10 > header->tableSlots * 7) {
+            if (!growTable(index)) {
+                return false;
+            }
+
+            slot = findSlot(index, key);
+        }
+
+        slot->key = key;
+        HEADER(index)->numKeys++;
+    }
+
+    indexBlock_t *tail = (slot->tail != 0 ? AT(index, slot->tail, indexBlock_t) : NULL);
+
+    if (tail == NULL || tail->used == tail->capacity) {
+        uint32_t capacity = (tail == NULL ? INITIAL_BLOCK_IDS
+            : (tail->capacity * 2 <= MAX_BLOCK_IDS ? tail->capacity * 2 : MAX_BLOCK_IDS));
+        size_t bytes = sizeof(indexBlock_t) + capacity * sizeof(int64_t);
+
+        // growing the file remaps it, so the slot is found again by its offset
+        size_t slotOffset = (size_t)((char*)slot - index->map);
+
+        if (!reserveBytes(index, bytes)) {
+            return false;
+        }
+
+        slot = AT(index, slotOffset, indexSlot_t);
+
+        uint64_t offset = allocateBytes(index, bytes);
+        indexBlock_t *block = AT(index, offset, indexBlock_t);
+
+        block->prev = slot->tail;
+        block->capacity = capacity;
+        slot->tail = offset;
+        tail = block;
+    }
+
+    tail->ids[tail->used++] = id;
+    slot->count++;
+    HEADER(index)->numPostings++;
+
+    return true;
+}
+
+const char *indexOpen(const char *path, const char *meta, blockingIndex_t **index) {
+    *index = NULL;
+
+    if (strlen(meta) >= INDEX_MAX_META) {
+        return "Index options are too long";
+    }
+
+    blockingIndex_t *result = calloc(1, sizeof(blockingIndex_t));
+
+    if (result == NULL) {
+        return "Error allocating index";
+    }
+
+    result->fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (result->fd < 0) {
+        free(result);
+        return "Error opening index file";
+    }
+
+    const char *error = NULL;
+    struct stat st;
+
+    if (flock(result->fd, LOCK_EX | LOCK_NB) != 0) {
+        error = (errno == EWOULDBLOCK ? "Index file is already open" : "Error locking index file");
+    } else if (fstat(result->fd, &st) != 0) {
+        error = "Error reading index file";
+    } else if (st.st_size == 0) {
+        // a new index: the header page and an empty table
+        size_t bytes = HEADER_BYTES + INITIAL_TABLE_SLOTS * sizeof(indexSlot_t);
+
+        if (!fileAllocate(result->fd, bytes) || !mapIndex(result, bytes)) {
+            error = "Error creating index file";
+        } else {
+            indexHeader_t *header = HEADER(result);
+
+            memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+            header->version = INDEX_VERSION;
+            header->usedBytes = bytes;
+            header->tableOffset = HEADER_BYTES;
+            header->tableSlots = INITIAL_TABLE_SLOTS;
+            strcpy(header->meta, meta);
+
+            if (msync(result->map, bytes, MS_SYNC) != 0) {
+                error = "Error creating index file";
+            }
+        }
+    } else if ((size_t)st.st_size < HEADER_BYTES || !mapIndex(result, (size_t)st.st_size)) {
+        error = "Not a blocking index file";
+    } else {
+        indexHeader_t *header = HEADER(result);
+
+        if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 || header->version != INDEX_VERSION
+                || header->usedBytes > (uint64_t)st.st_size || header->tableOffset < HEADER_BYTES
+                || header->tableSlots == 0 || (header->tableSlots & (header->tableSlots - 1)) != 0
+                || header->tableOffset + header->tableSlots * sizeof(indexSlot_t) > header->usedBytes) {
+            error = "Not a blocking index file";
+        } else if (header->dirty) {
+            error = "Index file was not closed cleanly";
+        } else if (strncmp(header->meta, meta, INDEX_MAX_META) != 0) {
+            error = "Index file was built with different near dupe hash options";
+        }
+    }
+
+    if (error == NULL && pthread_rwlock_init(&result->lock, NULL) != 0) {
+        error = "Error allocating index";
+    }
+
+    if (error != NULL) {
+        if (result->map != NULL) {
+            munmap(result->map, result->mappedBytes);
+        }
+        close(result->fd);
+        free(result);
+        return error;
+    }
+
+    *index = result;
+
+    return NULL;
+}
+
+const char *indexAdd(blockingIndex_t *index, size_t numRecords, const int64_t *ids, char ***keys, const size_t *numKeys) {
+    size_t maxKeys = 0;
+
+    for (size_t i = 0; i < numRecords; i++) {
+        if (keys[i] != NULL && numKeys[i] > maxKeys) {
+            maxKeys = numKeys[i];
+        }
+    }
+
+    // hashed before taking the lock, so queries only wait for the table updates
+    uint64_t *hashes = malloc((maxKeys + 1) * sizeof(uint64_t));
+
+    if (hashes == NULL) {
+        return "Error allocating index keys";
+    }
+
+    const char *error = NULL;
+
+    pthread_rwlock_wrlock(&index->lock);
+
+    if (!markDirty(index)) {
+        error = "Error writing index file";
+    }
+
+    for (size_t i = 0; error == NULL && i < numRecords; i++) {
+        size_t count = (keys[i] != NULL ? numKeys[i] : 0);
+
+        for (size_t j = 0; j < count; j++) {
+            hashes[j] = hashKey(keys[i][j]);
+        }
+
+        // a record lists each of its keys once
+        if (count > 1) {
+            qsort(hashes, count, sizeof(uint64_t), compareKeys);
+        }
+
+        for (size_t j = 0; error == NULL && j < count; j++) {
+            if ((j == 0 || hashes[j] != hashes[j - 1]) && !addPosting(index, hashes[j], ids[i])) {
+                error = "Error growing index file";
+            }
+        }
+
+        if (error == NULL) {
+            HEADER(index)->numRecords++;
+        }
+    }
+
+    pthread_rwlock_unlock(&index->lock);
+
+    free(hashes);
+
+    return error;
+}
+
+const char *indexQuery(blockingIndex_t *index, char **keys, size_t numKeys, size_t maxPostings, int64_t **ids, size_t *numIds) {
+    *ids = NULL;
+    *numIds = 0;
+
+    size_t count = 0;
+    size_t capacity = 0;
+    int64_t *result = NULL;
+    const char *error = NULL;
+
+    pthread_rwlock_rdlock(&index->lock);
+
+    for (size_t i = 0; error == NULL && i < numKeys; i++) {
+        indexSlot_t *slot = findSlot(index, hashKey(keys[i]));
+
+        // a key shared by too many records (e.g. a whole city) does not narrow anything down
+        if (slot->key == 0 || (maxPostings > 0 && slot->count > maxPostings)) {
+            continue;
+        }
+
+        if (count + slot->count > capacity) {
+            capacity = (count + slot->count) * 2;
+
+            int64_t *grown = realloc(result, capacity * sizeof(int64_t));
+
+            if (grown == NULL) {
+                error = "Error allocating candidates";
+                break;
+            }
+
+            result = grown;
+        }
+
+        for (uint64_t offset = slot->tail; offset != 0; ) {
+            indexBlock_t *block = AT(index, offset, indexBlock_t);
+
+            memcpy(result + count, block->ids, block->used * sizeof(int64_t));
+            count += block->used;
+            offset = block->prev;
+        }
+    }
+
+    pthread_rwlock_unlock(&index->lock);
+
+    if (error != NULL) {
+        free(result);
+        return error;
+    }
+
+    if (count > 1) {
+        qsort(result, count, sizeof(int64_t), compareIds);
+    }
+
+    size_t distinct = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (distinct == 0 || result[distinct - 1] != result[i]) {
+            result[distinct++] = result[i];
+        }
+    }
+
+    *ids = result;
+    *numIds = distinct;
+
+    return NULL;
+}
+
+void indexGetStats(blockingIndex_t *index, indexStats_t *stats) {
+    pthread_rwlock_rdlock(&index->lock);
+
+    indexHeader_t *header = HEADER(index);
+
+    stats->records = header->numRecords;
+    stats->keys = header->numKeys;
+    stats->postings = header->numPostings;
+    stats->fileBytes = header->usedBytes;
+
+    pthread_rwlock_unlock(&index->lock);
+}
+
+/*
+ * Sync the used region and then the clean header, the caller holds the write lock
+ * @param index the index
+ * @return NULL on success, otherwise the error message
+ */
+static const char *flushIndex(blockingIndex_t *index) {
+    indexHeader_t *header = HEADER(index);
+
+    if (!header->dirty) {
+        return NULL;
+    }
+
+    if (msync(index->map, header->usedBytes, MS_SYNC) != 0) {
+        return "Error writing index file";
+    }
+
+    header->dirty = 0;
+
+    return msync(index->map, HEADER_BYTES, MS_SYNC) == 0 ? NULL : "Error writing index file";
+}
+
+const char *indexFlush(blockingIndex_t *index) {
+    pthread_rwlock_wrlock(&index->lock);
+
+    const char *error = flushIndex(index);
+
+    pthread_rwlock_unlock(&index->lock);
+
+    return error;
+}
+
+const char *indexClose(blockingIndex_t *index) {
+    const char *error = flushIndex(index);
+    uint64_t usedBytes = HEADER(index)->usedBytes;
+
+    munmap(index->map, index->mappedBytes);
+
+    // drop the growth headroom, the next open maps exactly the used bytes
+    if (error == NULL && ftruncate(index->fd, (off_t)usedBytes) != 0) {
+        error = "Error trimming index file";
+    }
+
+    close(index->fd);
+    pthread_rwlock_destroy(&index->lock);
+    free(index);
+
+    return error;
+}
@@ -0,0 +1,59 @@
+/*
+ * postal4j_index.h
+ * Persistent memory-mapped blocking index from near-dupe hash keys to posting lists of record ids
+ */
+
+#ifndef POSTAL4J_INDEX_H
+#define POSTAL4J_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// First bytes of an index file
+#define INDEX_MAGIC "P4JBIDX1"
+#define INDEX_VERSION 1
+
+// Upper bound on the options string stored with an index
+#define INDEX_MAX_META 1024
+
+typedef struct blockingIndex blockingIndex_t;
+
+typedef struct {
+    uint64_t records;
+    uint64_t keys;
+    uint64_t postings;
+    uint64_t fileBytes;
+} indexStats_t;
+
+// Functions return NULL on success, otherwise the error message.
+
+// Opens an index file, creating it if it is empty or missing. meta is an options string stored with a new index
+// and compared on reopen, so an index is always queried with the keys it was built with. An index can only be open
+// once at a time (across processes).
+const char *indexOpen(const char *path, const char *meta, blockingIndex_t **index);
+
+// Appends records, keys[i] holding the numKeys[i] blocking keys of ids[i] (NULL for a record without keys)
+const char *indexAdd(blockingIndex_t *index, size_t numRecords, const int64_t *ids, char ***keys, const size_t *numKeys);
+
+// Sorted, distinct ids of the records sharing at least one key, skipping keys with more than maxPostings ids
+// (0 for no limit). *ids is malloc'd, NULL when nothing matches.
+const char *indexQuery(blockingIndex_t *index, char **keys, size_t numKeys, size_t maxPostings, int64_t **ids, size_t *numIds);
+
+void indexGetStats(blockingIndex_t *index, indexStats_t *stats);
+
+// Writes everything to disk and marks the file clean, appends after a flush mark it dirty again
+const char *indexFlush(blockingIndex_t *index);
+
+// Flushes, trims and closes the file, the index must not be in use
+const char *indexClose(blockingIndex_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_INDEX_H */
@@ -0,0 +1,111 @@
+/*
+ * postal4j_input.c
+ * Access to UTF-8 address input held in Java byte arrays and direct ByteBuffers
+ */
+
+#include "postal4j_input.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Helper function to get a NUL terminated buffer large enough for the input
+ * @param input the input
+ * @param length the input length in bytes
+ * @return the buffer, or NULL if memory could not be allocated
+ */
+static char *reserveInput(utf8Input_t *input, size_t length) {
+    if (length < INLINE_INPUT_SIZE) {
+        return input->inlineData;
+    }
+
+    input->allocated = malloc(length + 1);
+
+    return input->allocated;
+}
+
+/*
+ * Get UTF-8 input from either a byte array or a direct ByteBuffer, without any transcoding.
+ * Direct buffers whose input is already followed by a NUL byte are used in place; everything
+ * else is copied once into a NUL terminated buffer since libpostal expects C strings.
+ * @param env the JNI environment
+ * @param array the byte array holding the input, or NULL when a buffer is given
+ * @param buffer the direct ByteBuffer holding the input, or NULL when an array is given
+ * @param offset the offset of the input in the array or buffer
+ * @param length the length of the input in bytes
+ * @param input the input to populate, release it with releaseUtf8Input
+ * @return NULL on success, otherwise the error message to throw
+ */
+const char *getUtf8Input(JNIEnv *env, jbyteArray array, jobject buffer, jint offset, jint length, utf8Input_t *input) {
+    input->data = NULL;
+    input->length = 0;
+    input->allocated = NULL;
+
+    if (offset < 0 || length < 0) {
+        return "Invalid input offset or length";
+    }
+
+    if (buffer != NULL) {
+        char *address = (*env)->GetDirectBufferAddress(env, buffer);
+        jlong capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+
+        if (address == NULL || capacity < 0) {
+            return "Input buffer must be a direct ByteBuffer";
+        }
+        if ((jlong)offset + length > capacity) {
+            return "Input offset and length exceed the buffer capacity";
+        }
+
+        // already NUL terminated, libpostal can read the bytes where they are
+        if ((jlong)offset + length < capacity && address[offset + length] == '\0') {
+            input->data = address + offset;
+            input->length = (size_t)length;
+            return NULL;
+        }
+
+        char *data = reserveInput(input, (size_t)length);
+
+        if (data == NULL) {
+            return "Error allocating input";
+        }
+
+        memcpy(data, address + offset, (size_t)length);
+        data[length] = '\0';
+
+        input->data = data;
+        input->length = (size_t)length;
+        return NULL;
+    }
+
+    if (array == NULL) {
+        return "Input must not be null";
+    }
+
+    if ((jlong)offset + length > (*env)->GetArrayLength(env, array)) {
+        return "Input offset and length exceed the array length";
+    }
+
+    // a plain region copy, the array is not pinned while libpostal runs
+    char *data = reserveInput(input, (size_t)length);
+
+    if (data == NULL) {
+        return "Error allocating input";
+    }
+
+    (*env)->GetByteArrayRegion(env, array, offset, length, (jbyte*)data);
+    data[length] = '\0';
+
+    input->data = data;
+    input->length = (size_t)length;
+    return NULL;
+}
+
+/*
+ * Release any memory held by an input
+ * @param input the input
+ */
+void releaseUtf8Input(utf8Input_t *input) {
+    free(input->allocated);
+    input->allocated = NULL;
+    input->data = NULL;
+    input->length = 0;
+}
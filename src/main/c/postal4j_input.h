@@ -0,0 +1,34 @@
+/*
+ * postal4j_input.h
+ * Access to UTF-8 address input held in Java byte arrays and direct ByteBuffers
+ */
+
+#ifndef POSTAL4J_INPUT_H
+#define POSTAL4J_INPUT_H
+
+#include <jni.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Inputs up to this size are copied to the stack instead of the heap
+#define INLINE_INPUT_SIZE 512
+
+typedef struct {
+    char *data;
+    size_t length;
+    char *allocated;
+    char inlineData[INLINE_INPUT_SIZE];
+} utf8Input_t;
+
+const char *getUtf8Input(JNIEnv *env, jbyteArray array, jobject buffer, jint offset, jint length, utf8Input_t *input);
+void releaseUtf8Input(utf8Input_t *input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_INPUT_H */
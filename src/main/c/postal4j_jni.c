@@ -4,12 +4,294 @@
  */
 
 #include "postal4j_jni.h"
+#include "postal4j_buffer.h"
+#include "postal4j_bulk.h"
+#include "postal4j_cache.h"
+#include "postal4j_diskcache.h"
+#include "postal4j_format.h"
+#include "postal4j_index.h"
+#include "postal4j_input.h"
+#include "postal4j_labels.h"
+#include "postal4j_lifecycle.h"
+#include "postal4j_match.h"
+#include "postal4j_metrics.h"
+#include "postal4j_pool.h"
+#include "postal4j_sidecar.h"
+#include "postal4j_utf8.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Maximum number of distinct labels cached per batch, libpostal emits around 20
+#define MAX_CACHED_LABELS 32
+
+// UTF-16 units copied out of a Java String per GetStringRegion call
+#define UTF16_CHUNK_UNITS 1024
+
+// Strings transcoding to at most this many UTF-8 bytes (NUL included) are kept on the stack
+#define UTF8_INLINE_CAPACITY 512
+
+// A Java String transcoded to standard UTF-8, short strings live in inlineChars
+typedef struct {
+    char *chars;
+    char inlineChars[UTF8_INLINE_CAPACITY];
+} utf8String_t;
+
+// Per-batch cache of label strings so each label is only created once per batch
+typedef struct {
+    size_t count;
+    char *names[MAX_CACHED_LABELS];
+    jstring strings[MAX_CACHED_LABELS];
+} labelCache_t;
+
+// Columnar parse results: label ordinals, packed UTF-8 values and offsets, built natively then copied to Java in one go
+typedef struct {
+    nativeBuffer_t records;
+    nativeBuffer_t labels;
+    nativeBuffer_t values;
+    nativeBuffer_t offsets;
+    size_t numRecords;
+    size_t numComponents;
+} columnarResult_t;
+
+// Bits of the NormalizeOptions flags, in libpostal_normalize_options_t field order
+#define NORMALIZE_LATIN_ASCII (1 << 0)
+#define NORMALIZE_TRANSLITERATE (1 << 1)
+#define NORMALIZE_STRIP_ACCENTS (1 << 2)
+#define NORMALIZE_DECOMPOSE (1 << 3)
+#define NORMALIZE_LOWERCASE (1 << 4)
+#define NORMALIZE_TRIM_STRING (1 << 5)
+#define NORMALIZE_DROP_PARENTHETICALS (1 << 6)
+#define NORMALIZE_REPLACE_NUMERIC_HYPHENS (1 << 7)
+#define NORMALIZE_DELETE_NUMERIC_HYPHENS (1 << 8)
+#define NORMALIZE_SPLIT_ALPHA_FROM_NUMERIC (1 << 9)
+#define NORMALIZE_REPLACE_WORD_HYPHENS (1 << 10)
+#define NORMALIZE_DELETE_WORD_HYPHENS (1 << 11)
+#define NORMALIZE_DELETE_FINAL_PERIODS (1 << 12)
+#define NORMALIZE_DELETE_ACRONYM_PERIODS (1 << 13)
+#define NORMALIZE_DROP_ENGLISH_POSSESSIVES (1 << 14)
+#define NORMALIZE_DELETE_APOSTROPHES (1 << 15)
+#define NORMALIZE_EXPAND_NUMEX (1 << 16)
+#define NORMALIZE_ROMAN_NUMERALS (1 << 17)
+
+// Bits of the NearDupeHashOptions flags, in libpostal_near_dupe_hash_options_t field order
+#define NEAR_DUPE_WITH_NAME (1 << 0)
+#define NEAR_DUPE_WITH_ADDRESS (1 << 1)
+#define NEAR_DUPE_WITH_UNIT (1 << 2)
+#define NEAR_DUPE_WITH_CITY_OR_EQUIVALENT (1 << 3)
+#define NEAR_DUPE_WITH_SMALL_CONTAINING_BOUNDARIES (1 << 4)
+#define NEAR_DUPE_WITH_POSTAL_CODE (1 << 5)
+#define NEAR_DUPE_WITH_LATLON (1 << 6)
+#define NEAR_DUPE_NAME_AND_ADDRESS_KEYS (1 << 7)
+#define NEAR_DUPE_NAME_ONLY_KEYS (1 << 8)
+#define NEAR_DUPE_ADDRESS_ONLY_KEYS (1 << 9)
+
+// Bits of the LibPostalModule masks, in load order
+#define MODULE_EXPANSION (1 << 0)
+#define MODULE_PARSER (1 << 1)
+#define MODULE_CLASSIFIER (1 << 2)
+#define MODULE_ALL (MODULE_EXPANSION | MODULE_PARSER | MODULE_CLASSIFIER)
+
+// A libpostal module with its setup/teardown functions, the core (expansion) module must be loaded first
+typedef struct {
+    jint bit;
+    const char *name;
+    bool (*setup)(void);
+    bool (*setupDatadir)(char *datadir);
+    void (*teardown)(void);
+    const char *setupError;
+    const char *setupDatadirError;
+} libpostalModule_t;
+
+static const libpostalModule_t libpostalModules[] = {
+    { MODULE_EXPANSION, "EXPANSION", libpostal_setup, libpostal_setup_datadir, libpostal_teardown,
+      "Error initializing libpostal", "Error initializing libpostal with data directory" },
+    { MODULE_PARSER, "PARSER", libpostal_setup_parser, libpostal_setup_parser_datadir, libpostal_teardown_parser,
+      "Error initializing libpostal parser", "Error initializing libpostal parser with data directory" },
+    { MODULE_CLASSIFIER, "CLASSIFIER", libpostal_setup_language_classifier, libpostal_setup_language_classifier_datadir,
+      libpostal_teardown_language_classifier, "Error initializing libpostal language classifier",
+      "Error initializing libpostal language classifier with data directory" }
+};
+
+#define NUM_LIBPOSTAL_MODULES (sizeof(libpostalModules) / sizeof(libpostalModules[0]))
+
+// Marks a null element of a string batch
+#define NO_STRING SIZE_MAX
+
+// Strings copied out of a Java String[] into one native block, so worker threads can read them
+typedef struct {
+    nativeBuffer_t data;
+    size_t *offsets;
+    size_t count;
+} stringBatch_t;
+
+// A batch of addresses parsed on the worker pool, each response lands in its own slot
+typedef struct {
+    stringBatch_t addresses;
+    stringBatch_t languages;
+    stringBatch_t countries;
+    libpostal_address_parser_response_t **responses;
+} parseBatch_t;
+
+// A batch of addresses expanded on the worker pool, each expansion array lands in its own slot
+typedef struct {
+    stringBatch_t addresses;
+    libpostal_normalize_options_t options;
+    bool root;
+    char ***expansions;
+    size_t *numExpansions;
+} expandBatch_t;
+
+// A batch of address pairs scored on the worker pool, each score lands in its own slot
+typedef struct {
+    stringBatch_t left;
+    stringBatch_t right;
+    libpostal_normalize_options_t options;
+    jfloat *scores;
+} matchBatch_t;
+
+// Labels and values of one record copied out of two Java String[]s, as the pointer arrays libpostal takes
+typedef struct {
+    stringBatch_t labelStrings;
+    stringBatch_t valueStrings;
+    char **labels;
+    char **values;
+    size_t count;
+} componentList_t;
+
+// libpostal_is_*_duplicate comparators, indexed by DuplicateComponent ordinal
+typedef libpostal_duplicate_status_t (*duplicateFunction_t)(char *value1, char *value2, libpostal_duplicate_options_t options);
+
+static const duplicateFunction_t duplicateFunctions[] = {
+    libpostal_is_name_duplicate,
+    libpostal_is_street_duplicate,
+    libpostal_is_house_number_duplicate,
+    libpostal_is_po_box_duplicate,
+    libpostal_is_unit_duplicate,
+    libpostal_is_floor_duplicate,
+    libpostal_is_postal_code_duplicate
+};
+
+#define NUM_DUPLICATE_COMPONENTS (sizeof(duplicateFunctions) / sizeof(duplicateFunctions[0]))
+
+// A batch of (left, right) pairs compared on the worker pool, each status lands in its own slot
+typedef struct {
+    stringBatch_t left;
+    stringBatch_t right;
+    stringBatch_t languageStrings;
+    duplicateFunction_t compare;
+    libpostal_duplicate_options_t options;
+    jbyte *statuses;
+} duplicateBatch_t;
+
+// libpostal_is_*_duplicate_fuzzy comparators
+typedef libpostal_fuzzy_duplicate_status_t (*fuzzyDuplicateFunction_t)(size_t num_tokens1, char **tokens1, double *token_scores1,
+    size_t num_tokens2, char **tokens2, double *token_scores2, libpostal_fuzzy_duplicate_options_t options);
+
+// Scored tokens copied out of packed Java arrays
+typedef struct {
+    stringBatch_t strings;
+    char **tokens;
+    double *scores;
+} tokenList_t;
+
+// One query scored against many candidates on the worker pool, each result lands in its own slot
+typedef struct {
+    tokenList_t query;
+    tokenList_t candidates;
+    jint *candidateOffsets;
+    size_t numCandidates;
+    fuzzyDuplicateFunction_t compare;
+    libpostal_fuzzy_duplicate_options_t options;
+    stringBatch_t languageStrings;
+    char **languages;
+    jbyte *statuses;
+    jdouble *similarities;
+} fuzzyBatch_t;
+
+// A batch of records hashed on the worker pool, each hash array lands in its own slot
+typedef struct {
+    size_t numRecords;
+    jint *recordOffsets;
+    char **labels;
+    char **values;
+    nativeBuffer_t valueData;
+    jdouble *latitudes;
+    jdouble *longitudes;
+    stringBatch_t languageStrings;
+    char **languages;
+    size_t numLanguages;
+    libpostal_near_dupe_hash_options_t options;
+    char ***hashes;
+    size_t *numHashes;
+} nearDupeBatch_t;
+
+// An open blocking index and the near dupe hash options its keys are built with, behind a BlockingIndex handle
+typedef struct {
+    blockingIndex_t *index;
+    libpostal_near_dupe_hash_options_t options;
+    stringBatch_t languageStrings;
+    char **languages;
+    size_t numLanguages;
+} indexHandle_t;
+
+// A batch of strings normalized on the worker pool, each normalized string lands in its own slot
+typedef struct {
+    stringBatch_t inputs;
+    stringBatch_t languageStrings;
+    char **languages;
+    size_t numLanguages;
+    uint64_t options;
+    char **results;
+} normalizeBatch_t;
+
+// Java progress listener of a bulk run, called back on the calling thread
+typedef struct {
+    JNIEnv *env;
+    jobject listener;
+    jmethodID onProgress;
+} bulkListener_t;
+
 // Forward declarations for helper functions
 void throwException(JNIEnv *env, const char *message);
-jobject parseAddressWithOptions(JNIEnv *env, char* address, libpostal_address_parser_options_t* options);
+size_t transcodeString(JNIEnv *env, jstring jstr, jsize length, char* target);
+jstring newStringFromUtf8(JNIEnv *env, const char* value);
+const char* getUtf8String(JNIEnv *env, jstring jstr, utf8String_t* str);
+void releaseUtf8String(utf8String_t* str);
+jobject parseAddressWithOptions(JNIEnv *env, char* address, libpostal_address_parser_options_t* options, labelCache_t* labelCache);
+jobject createResultMap(JNIEnv *env, libpostal_address_parser_response_t* response, labelCache_t* labelCache);
+bool loadStringBatch(JNIEnv *env, jobjectArray jstrings, bool allowNulls, stringBatch_t* batch);
+char* stringBatchGet(stringBatch_t* batch, size_t index);
+void cleanupStringBatch(stringBatch_t* batch);
+bool runParseBatch(JNIEnv *env, jobjectArray jaddresses, jobjectArray jlanguages, jobjectArray jcountries, parseBatch_t* batch);
+void parseBatchTask(size_t index, void* context);
+void cleanupParseBatch(parseBatch_t* batch);
+jobjectArray parseAddressBatch(JNIEnv *env, jobjectArray jaddresses, jobjectArray jlanguages, jobjectArray jcountries);
+bool runExpandBatch(JNIEnv *env, jobjectArray jaddresses, expandBatch_t* batch);
+void expandBatchTask(size_t index, void* context);
+void cleanupExpandBatch(expandBatch_t* batch);
+bool checkRecordOutput(JNIEnv *env, jint format, jbyteArray jarray, jobject jbuffer, jint offset, jint limit);
+bool writeRecordOutput(JNIEnv *env, jbyteArray jarray, jobject jbuffer, jint offset, const nativeBuffer_t* records);
+jint writeRecordBatch(JNIEnv *env, jbyteArray jarray, jobject jbuffer, jint offset, jintArray jends, size_t count,
+    const nativeBuffer_t* records, const size_t* ends);
+jobjectArray createExpandBatchResult(JNIEnv *env, expandBatch_t* batch);
+void matchBatchTask(size_t index, void* context);
+void cleanupMatchBatch(matchBatch_t* batch);
+bool parseAddressCompactWithOptions(JNIEnv *env, char* address, libpostal_address_parser_options_t* options, columnarResult_t* columnar);
+void initColumnarResult(columnarResult_t* columnar);
+void cleanupColumnarResult(columnarResult_t* columnar);
+bool beginColumnarRecord(JNIEnv *env, columnarResult_t* columnar);
+bool appendColumnarComponents(JNIEnv *env, columnarResult_t* columnar, libpostal_address_parser_response_t* response);
+jbyteArray createByteArray(JNIEnv *env, nativeBuffer_t* buffer);
+jintArray createIntArray(JNIEnv *env, nativeBuffer_t* buffer);
+jobject createParsedAddress(JNIEnv *env, columnarResult_t* columnar);
+jobject createParsedAddressBatch(JNIEnv *env, columnarResult_t* columnar);
+jstring cachedLabelString(JNIEnv *env, labelCache_t* labelCache, const char* label);
+void cleanupLabelCache(JNIEnv *env, labelCache_t* labelCache);
 jobjectArray expandAddressWithOptions(JNIEnv *env, char* address, libpostal_normalize_options_t* options);
 jobjectArray expandRootAddressWithOptions(JNIEnv *env, char* address, libpostal_normalize_options_t* options);
 void updateNormalizeOptions(JNIEnv *env, libpostal_normalize_options_t* options, jobjectArray languages, jboolean latinAscii, jboolean transliterate,
@@ -18,15 +300,94 @@ void updateNormalizeOptions(JNIEnv *env, libpostal_normalize_options_t* options,
     jboolean deleteFinalPeriods, jboolean deleteAcronymPeriods, jboolean dropEnglishPossessives, jboolean deleteApostrophes, jboolean expandNumex,
     jboolean romanNumerals, jint addressComponents);
 void cleanupNormalizeOptions(libpostal_normalize_options_t* options);
+jint normalizeOptionsFlags(libpostal_normalize_options_t* options);
+libpostal_normalize_options_t* normalizeOptionsHandle(JNIEnv *env, jlong handle);
 jobjectArray createResultArray(JNIEnv *env, char** expansions, size_t numExpansions);
+libpostal_near_dupe_hash_options_t nearDupeHashOptions(jint flags, jint geohashPrecision);
+jint nearDupeHashFlags(libpostal_near_dupe_hash_options_t* options);
+bool loadLanguages(JNIEnv *env, jobjectArray jlanguages, stringBatch_t* strings, char*** languages, size_t* numLanguages);
+char** nearDupeHashes(size_t numComponents, char** labels, char** values, libpostal_near_dupe_hash_options_t options,
+    double latitude, double longitude, size_t numLanguages, char** languages, size_t* numHashes);
+bool loadNearDupeBatch(JNIEnv *env, jintArray jrecordOffsets, jbyteArray jlabels, jbyteArray jvalues, jintArray jvalueOffsets,
+    jdoubleArray jlatitudes, jdoubleArray jlongitudes, nearDupeBatch_t* batch);
+void nearDupeBatchTask(size_t index, void* context);
+void cleanupNearDupeBatch(nearDupeBatch_t* batch);
+jobject createNearDupeHashBatch(JNIEnv *env, nearDupeBatch_t* batch);
+indexHandle_t* indexHandle(JNIEnv *env, jlong handle);
+jint indexModules(indexHandle_t* handle);
+char** indexRecordHashes(JNIEnv *env, indexHandle_t* handle, jobjectArray jlabels, jobjectArray jvalues, jdouble latitude,
+    jdouble longitude, size_t* numHashes, bool* ok);
+void cleanupIndexHandle(indexHandle_t* handle);
+bool loadComponents(JNIEnv *env, jobjectArray jlabels, jobjectArray jvalues, componentList_t* components);
+void cleanupComponents(componentList_t* components);
+duplicateFunction_t duplicateFunction(JNIEnv *env, jint component);
+bool loadPackedStringBatch(JNIEnv *env, jbyteArray jvalues, jintArray joffsets, stringBatch_t* batch);
+jbyteArray runDuplicateBatch(JNIEnv *env, duplicateBatch_t* batch, jobjectArray jlanguages);
+void duplicateBatchTask(size_t index, void* context);
+void cleanupDuplicateBatch(duplicateBatch_t* batch);
+bool loadTokens(JNIEnv *env, jbyteArray jtokens, jintArray joffsets, jdoubleArray jscores, tokenList_t* tokens);
+void cleanupTokens(tokenList_t* tokens);
+void fuzzyBatchTask(size_t index, void* context);
+bool setupModules(JNIEnv *env, const char* dataDir, jint modules, bool lazy);
+bool loadModules(JNIEnv *env, jint modules);
+void unloadModules(void);
+bool enterCall(JNIEnv *env);
+bool requireModules(JNIEnv *env, jint modules);
+bool requireServedModules(JNIEnv *env, jint modules);
+bool requireLoadedModules(JNIEnv *env, jint modules);
+bool connectSidecar(JNIEnv *env, const char* socketPath);
+bool startServices(JNIEnv *env, jint workerThreads, jint cacheEntries);
+bool openDiskCache(JNIEnv *env);
+void releaseServices(void);
+jint languageModules(JNIEnv *env, jobjectArray jlanguages);
+jint normalizeOptionsModules(jlong handle);
+void publishDirectModules(JNIEnv *env);
+void endBatchMetrics(bool error, size_t count);
+jobject createNormalizedTokens(JNIEnv *env, libpostal_normalized_token_t* tokens, size_t numTokens);
+void normalizeBatchTask(size_t index, void* context);
+void cleanupNormalizeBatch(normalizeBatch_t* batch);
+bool bulkProgressCallback(const bulkProgress_t* progress, void* context);
+jobject createBulkProgress(JNIEnv *env, const bulkProgress_t* progress);
 
 // Cached values for the class and method IDs
 static jclass hashMapClass;
 static jmethodID hashMapInit;
 static jmethodID hashMapPut;
+static jclass mapClass;
 static jclass stringClass;
+static jclass stringArrayClass;
+static jclass parsedAddressClass;
+static jmethodID parsedAddressInit;
+static jclass parsedAddressBatchClass;
+static jmethodID parsedAddressBatchInit;
+static jclass cacheStatsClass;
+static jmethodID cacheStatsInit;
+static jclass diskCacheStatsClass;
+static jmethodID diskCacheStatsInit;
+static jclass nearDupeHashBatchClass;
+static jmethodID nearDupeHashBatchInit;
+static jclass normalizedTokensClass;
+static jmethodID normalizedTokensInit;
+static jclass bulkProgressClass;
+static jmethodID bulkProgressInit;
+static jclass libPostalClass;
+static jfieldID directModulesField;
+static jmethodID awaitDirectCallsMethod;
 static jclass exceptionClass;
-volatile int initialized = 0;
+
+// Per-thread staging area for the UTF-16 chars of a Java String, so reading a string never allocates
+static _Thread_local jchar utf16Chunk[UTF16_CHUNK_UNITS];
+
+// Loaded modules, the modules setup allowed (loaded on first use when lazy) and the data directory to load them from
+static atomic_int loadedModules = 0;
+static jint enabledModules = 0;
+static char *moduleDataDir = NULL;
+static pthread_mutex_t moduleLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Disk cache file and size the next setup opens, see setDiskCache
+static char *diskCachePath = NULL;
+static size_t diskCacheBytes = 0;
+static pthread_mutex_t diskCacheLock = PTHREAD_MUTEX_INITIALIZER;
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
     JNIEnv *env = NULL;
@@ -49,6 +410,11 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
     hashMapInit = (*env)->GetMethodID(env, hashMapClass, "<init>", "()V");
     hashMapPut = (*env)->GetMethodID(env, hashMapClass, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
 
+    // the Map interface is the element type of batch parse results
+    jclass localMapClass = (*env)->FindClass(env, "java/util/Map");
+    mapClass = (jclass)(*env)->NewGlobalRef(env, localMapClass);
+    (*env)->DeleteLocalRef(env, localMapClass);
+
     // 4. Find the String class
     jclass localStringClass = (*env)->FindClass(env, "java/lang/String");
 
@@ -56,6 +422,53 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
     stringClass = (jclass)(*env)->NewGlobalRef(env, localStringClass);
     (*env)->DeleteLocalRef(env, localStringClass);
 
+    // String[] is the element type of batch expansion results
+    jclass localStringArrayClass = (*env)->FindClass(env, "[Ljava/lang/String;");
+    stringArrayClass = (jclass)(*env)->NewGlobalRef(env, localStringArrayClass);
+    (*env)->DeleteLocalRef(env, localStringArrayClass);
+
+    // the columnar result classes are built directly from the packed native arrays
+    jclass localParsedAddressClass = (*env)->FindClass(env, "com/dnebinger/postal4j/ParsedAddress");
+    parsedAddressClass = (jclass)(*env)->NewGlobalRef(env, localParsedAddressClass);
+    (*env)->DeleteLocalRef(env, localParsedAddressClass);
+    parsedAddressInit = (*env)->GetMethodID(env, parsedAddressClass, "<init>", "([B[B[I)V");
+
+    jclass localParsedAddressBatchClass = (*env)->FindClass(env, "com/dnebinger/postal4j/ParsedAddressBatch");
+    parsedAddressBatchClass = (jclass)(*env)->NewGlobalRef(env, localParsedAddressBatchClass);
+    (*env)->DeleteLocalRef(env, localParsedAddressBatchClass);
+    parsedAddressBatchInit = (*env)->GetMethodID(env, parsedAddressBatchClass, "<init>", "([I[B[B[I)V");
+
+    jclass localCacheStatsClass = (*env)->FindClass(env, "com/dnebinger/postal4j/CacheStats");
+    cacheStatsClass = (jclass)(*env)->NewGlobalRef(env, localCacheStatsClass);
+    (*env)->DeleteLocalRef(env, localCacheStatsClass);
+    cacheStatsInit = (*env)->GetMethodID(env, cacheStatsClass, "<init>", "(JJJJJ)V");
+
+    jclass localDiskCacheStatsClass = (*env)->FindClass(env, "com/dnebinger/postal4j/DiskCacheStats");
+    diskCacheStatsClass = (jclass)(*env)->NewGlobalRef(env, localDiskCacheStatsClass);
+    (*env)->DeleteLocalRef(env, localDiskCacheStatsClass);
+    diskCacheStatsInit = (*env)->GetMethodID(env, diskCacheStatsClass, "<init>", "(JJJJJJ)V");
+
+    jclass localNearDupeHashBatchClass = (*env)->FindClass(env, "com/dnebinger/postal4j/NearDupeHashBatch");
+    nearDupeHashBatchClass = (jclass)(*env)->NewGlobalRef(env, localNearDupeHashBatchClass);
+    (*env)->DeleteLocalRef(env, localNearDupeHashBatchClass);
+    nearDupeHashBatchInit = (*env)->GetMethodID(env, nearDupeHashBatchClass, "<init>", "([I[B[I)V");
+
+    jclass localNormalizedTokensClass = (*env)->FindClass(env, "com/dnebinger/postal4j/NormalizedTokens");
+    normalizedTokensClass = (jclass)(*env)->NewGlobalRef(env, localNormalizedTokensClass);
+    (*env)->DeleteLocalRef(env, localNormalizedTokensClass);
+    normalizedTokensInit = (*env)->GetMethodID(env, normalizedTokensClass, "<init>", "([Ljava/lang/String;[I)V");
+
+    jclass localBulkProgressClass = (*env)->FindClass(env, "com/dnebinger/postal4j/BulkProgress");
+    bulkProgressClass = (jclass)(*env)->NewGlobalRef(env, localBulkProgressClass);
+    (*env)->DeleteLocalRef(env, localBulkProgressClass);
+    bulkProgressInit = (*env)->GetMethodID(env, bulkProgressClass, "<init>", "(JJJJD)V");
+
+    jclass localLibPostalClass = (*env)->FindClass(env, "com/dnebinger/postal4j/LibPostal");
+    libPostalClass = (jclass)(*env)->NewGlobalRef(env, localLibPostalClass);
+    (*env)->DeleteLocalRef(env, localLibPostalClass);
+    directModulesField = (*env)->GetStaticFieldID(env, libPostalClass, "directModules", "I");
+    awaitDirectCallsMethod = (*env)->GetStaticMethodID(env, libPostalClass, "awaitDirectCalls", "()V");
+
     return JNI_VERSION_1_8;
 }
 
@@ -66,13 +479,9 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *reserved) {
     }
 
     // if we initialized libpostal, be sure to tear it down before unloading the library
-    if (initialized) {
-        // clear the flag to prevent multiple teardowns
-        initialized = 0;
-
-        libpostal_teardown_language_classifier();
-        libpostal_teardown_parser();
-        libpostal_teardown();
+    if (lifecycleBeginTeardown()) {
+        releaseServices();
+        lifecycleEndTeardown();
     }
 
     if (exceptionClass) {
@@ -83,14 +492,62 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *reserved) {
         (*env)->DeleteGlobalRef(env, hashMapClass);
         hashMapClass = NULL;
     }
+    if (mapClass) {
+        (*env)->DeleteGlobalRef(env, mapClass);
+        mapClass = NULL;
+    }
     if (stringClass) {
         (*env)->DeleteGlobalRef(env, stringClass);
         stringClass = NULL;
     }
+    if (stringArrayClass) {
+        (*env)->DeleteGlobalRef(env, stringArrayClass);
+        stringArrayClass = NULL;
+    }
+    if (parsedAddressClass) {
+        (*env)->DeleteGlobalRef(env, parsedAddressClass);
+        parsedAddressClass = NULL;
+    }
+    if (parsedAddressBatchClass) {
+        (*env)->DeleteGlobalRef(env, parsedAddressBatchClass);
+        parsedAddressBatchClass = NULL;
+    }
+    if (cacheStatsClass) {
+        (*env)->DeleteGlobalRef(env, cacheStatsClass);
+        cacheStatsClass = NULL;
+    }
+    if (diskCacheStatsClass) {
+        (*env)->DeleteGlobalRef(env, diskCacheStatsClass);
+        diskCacheStatsClass = NULL;
+    }
+    if (nearDupeHashBatchClass) {
+        (*env)->DeleteGlobalRef(env, nearDupeHashBatchClass);
+        nearDupeHashBatchClass = NULL;
+    }
+    if (normalizedTokensClass) {
+        (*env)->DeleteGlobalRef(env, normalizedTokensClass);
+        normalizedTokensClass = NULL;
+    }
+    if (bulkProgressClass) {
+        (*env)->DeleteGlobalRef(env, bulkProgressClass);
+        bulkProgressClass = NULL;
+    }
+    if (libPostalClass) {
+        (*env)->DeleteGlobalRef(env, libPostalClass);
+        libPostalClass = NULL;
+    }
 
     // set to nulls so we don't try to use or delete them again.
     hashMapInit = NULL;
     hashMapPut = NULL;
+    parsedAddressInit = NULL;
+    parsedAddressBatchInit = NULL;
+    cacheStatsInit = NULL;
+    nearDupeHashBatchInit = NULL;
+    normalizedTokensInit = NULL;
+    bulkProgressInit = NULL;
+    directModulesField = NULL;
+    awaitDirectCallsMethod = NULL;
 }
 
 /*
@@ -101,494 +558,4846 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *reserved) {
 JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__
   (JNIEnv *env, jclass cls) {
 
-    if (initialized) {
-        throwException(env, "LibPostal already initialized");
+    // load every module from the default data directory
+    Java_com_dnebinger_postal4j_LibPostal_setupWithModules(env, cls, NULL, 0, 0, MODULE_ALL, JNI_FALSE);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setup
+ * Signature: (Ljava/lang/String;)Z
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jstring dataDir) {
+
+    // load every module from the data directory
+    Java_com_dnebinger_postal4j_LibPostal_setupWithModules(env, cls, dataDir, 0, 0, MODULE_ALL, JNI_FALSE);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setup
+ * Signature: (Ljava/lang/String;I)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2I
+  (JNIEnv *env, jclass cls, jstring dataDir, jint workerThreads) {
+
+    Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2II(env, cls, dataDir, workerThreads, 0);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setup
+ * Signature: (Ljava/lang/String;II)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2II
+  (JNIEnv *env, jclass cls, jstring dataDir, jint workerThreads, jint cacheEntries) {
+
+    Java_com_dnebinger_postal4j_LibPostal_setupWithModules(env, cls, dataDir, workerThreads, cacheEntries, MODULE_ALL, JNI_FALSE);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setupWithModules
+ * Signature: (Ljava/lang/String;IIIZ)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setupWithModules
+  (JNIEnv *env, jclass cls, jstring dataDir, jint workerThreads, jint cacheEntries, jint modules, jboolean lazy) {
+
+    if (workerThreads < 0 || workerThreads > MAX_POOL_WORKERS) {
+        throwException(env, "Worker thread count must be between 0 and 1024");
         return;
     }
 
-    // initialize libpostal first
-    if (!libpostal_setup()) {
-        throwException(env, "Error initializing libpostal");
+    if (cacheEntries < 0 || cacheEntries > MAX_CACHE_ENTRIES) {
+        throwException(env, "Cache size must be between 0 and 67108864 entries");
         return;
     }
 
-    // next initialize the parser
-    if (!libpostal_setup_parser()) {
-        throwException(env, "Error initializing libpostal parser");
-        libpostal_teardown();
+    if ((modules & ~MODULE_ALL) != 0) {
+        throwException(env, "Unknown libpostal module");
+        return;
+    }
+
+    const char *dataDirStr = NULL;
+
+    if (dataDir != NULL && (dataDirStr = (*env)->GetStringUTFChars(env, dataDir, NULL)) == NULL) {
+        throwException(env, "Error extracting data directory");
         return;
     }
 
-    // finally initialize the language classifier
-    if (!libpostal_setup_language_classifier()) {
-        throwException(env, "Error initializing libpostal language classifier");
-        libpostal_teardown_parser();
-        libpostal_teardown();
+    // waits for a teardown that is still draining calls
+    if (!lifecycleBeginSetup()) {
+        if (dataDirStr != NULL) {
+            (*env)->ReleaseStringUTFChars(env, dataDir, dataDirStr);
+        }
+        throwException(env, "LibPostal already initialized");
         return;
     }
 
-    // set initialized successfully
-    initialized = 1;
+    // load the libpostal modules, from the default data directory when none is given
+    bool started = setupModules(env, dataDirStr, modules, lazy) && startServices(env, workerThreads, cacheEntries);
+
+    if (dataDirStr != NULL) {
+        (*env)->ReleaseStringUTFChars(env, dataDir, dataDirStr);
+    }
+
+    lifecycleEndSetup(started);
+
+    // cached setups keep every call going through the cache
+    publishDirectModules(env);
 }
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    setup
- * Signature: (Ljava/lang/String;)Z
+ * Method:    setupSidecar
+ * Signature: (Ljava/lang/String;II)V
  */
-JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2
-  (JNIEnv *env, jclass cls, jstring dataDir) {
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setupSidecar
+  (JNIEnv *env, jclass cls, jstring socketPath, jint workerThreads, jint cacheEntries) {
 
-    if (initialized) {
-        throwException(env, "LibPostal already initialized");
+    if (workerThreads < 0 || workerThreads > MAX_POOL_WORKERS) {
+        throwException(env, "Worker thread count must be between 0 and 1024");
         return;
     }
 
-    // extract the data directory from the JNI string
-    const char *dataDirStr = (*env)->GetStringUTFChars(env, dataDir, NULL);
-
-    if (dataDirStr == NULL) {
-        throwException(env, "Error extracting data directory");
+    if (cacheEntries < 0 || cacheEntries > MAX_CACHE_ENTRIES) {
+        throwException(env, "Cache size must be between 0 and 67108864 entries");
         return;
     }
 
-    // initialize libpostal with the data directory
-    if (!libpostal_setup_datadir((char*)dataDirStr)) {
-        throwException(env, "Error initializing libpostal with data directory");
-        (*env)->ReleaseStringUTFChars(env, dataDir, dataDirStr);
+    if (socketPath == NULL) {
+        throwException(env, "Sidecar socket path must not be null");
         return;
     }
 
-    // initialize the parser with the data directory
-    if (!libpostal_setup_parser_datadir((char*)dataDirStr)) {
-        throwException(env, "Error initializing libpostal parser with data directory");
-        (*env)->ReleaseStringUTFChars(env, dataDir, dataDirStr);
-        libpostal_teardown();
+    const char *socketPathStr = (*env)->GetStringUTFChars(env, socketPath, NULL);
+
+    if (socketPathStr == NULL) {
+        throwException(env, "Error extracting sidecar socket path");
         return;
     }
 
-    // initialize the language classifier with the data directory
-    if (!libpostal_setup_language_classifier_datadir((char*)dataDirStr)) {
-        throwException(env, "Error initializing libpostal language classifier with data directory");
-        (*env)->ReleaseStringUTFChars(env, dataDir, dataDirStr);
-        libpostal_teardown_parser();
-        libpostal_teardown();
+    if (!lifecycleBeginSetup()) {
+        (*env)->ReleaseStringUTFChars(env, socketPath, socketPathStr);
+        throwException(env, "LibPostal already initialized");
         return;
     }
 
-    // free the data directory string
-    (*env)->ReleaseStringUTFChars(env, dataDir, dataDirStr);
+    bool started = connectSidecar(env, socketPathStr) && startServices(env, workerThreads, cacheEntries);
 
-    // set initialized successfully
-    initialized = 1;
+    (*env)->ReleaseStringUTFChars(env, socketPath, socketPathStr);
+
+    lifecycleEndSetup(started);
+    publishDirectModules(env);
 }
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    teardown
- * Signature: ()V
+ * Method:    sidecarConnected
+ * Signature: ()Z
  */
-JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_teardown
+JNIEXPORT jboolean JNICALL Java_com_dnebinger_postal4j_LibPostal_sidecarConnected
   (JNIEnv *env, jclass cls) {
 
-    if (initialized) {
-        // clear the flag to prevent multiple teardowns
-        initialized = 0;
-
-        // reverse order teardown of the modules
-        libpostal_teardown_language_classifier();
-        libpostal_teardown_parser();
-        libpostal_teardown();
-    }
+    return lifecycleRunning() && sidecarActive() ? JNI_TRUE : JNI_FALSE;
 }
 
 /*
- * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    parseAddress
- * Signature: (Ljava/lang/String;)Ljava/util/Map;
+ * Helper function to start the batch workers and the result cache once the models are available,
+ * releasing everything setup acquired if either fails
+ * @param env the JNI environment
+ * @param workerThreads the number of batch workers
+ * @param cacheEntries the result cache capacity, 0 to disable it
+ * @return true if both started, false if an exception was thrown
  */
-JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddress__Ljava_lang_String_2
-  (JNIEnv *env, jclass cls, jstring jaddress) {
-
-    if (!initialized) {
-        throwException(env, "LibPostal not initialized - call setup() first");
-        return NULL;
+bool startServices(JNIEnv *env, jint workerThreads, jint cacheEntries) {
+    // start the batch workers
+    if (!poolStart(workerThreads)) {
+        releaseServices();
+        throwException(env, "Error starting libpostal worker threads");
+        return false;
     }
-    
-    // extract the address from the JNI string
-    const char *address = (*env)->GetStringUTFChars(env, jaddress, 0);
 
-    // check if the address is null
-    if (address == NULL) {
-        throwException(env, "Error extracting address");
-        return NULL;
+    // and the result cache
+    if (!cacheStart((size_t)cacheEntries)) {
+        releaseServices();
+        throwException(env, "Error allocating the libpostal result cache");
+        return false;
     }
 
-    // initialize the address parser options
-    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
-
-    jobject resultMap = parseAddressWithOptions(env, (char*)address, &options);
-
-    // free the address string
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
+    // with the disk cache behind it
+    if (!openDiskCache(env)) {
+        releaseServices();
+        return false;
+    }
 
-    // return the result map
-    return resultMap;
+    return true;
 }
 
 /*
- * Helper function to parse an address with options
+ * Helper function to open the disk cache configured with setDiskCache, tagged with the loaded data version
  * @param env the JNI environment
- * @param address the address string
- * @param options the address parser options
- * @return the result map
+ * @return true if it is open or none is configured, false if an exception was thrown
  */
-jobject parseAddressWithOptions(JNIEnv *env, char* address, libpostal_address_parser_options_t* options) {
-    // parse the address
-    libpostal_address_parser_response_t *response = libpostal_parse_address(address, *options);
+bool openDiskCache(JNIEnv *env) {
+    const char *error = NULL;
 
-    if (response == NULL) {
-        throwException(env, "Error parsing address");
-        return NULL;
-    }
+    pthread_mutex_lock(&diskCacheLock);
 
-    // Create HashMap<String, String> directly that we will return to the caller
-    jobject resultMap = (*env)->NewObject(env, hashMapClass, hashMapInit);
-    
-    if (resultMap == NULL) {
-        throwException(env, "Error creating result map");
-        libpostal_address_parser_response_destroy(response);
-        return NULL;
-    }
+    // a sidecar client has no data directory to tag entries with, the daemon keeps the disk cache instead
+    if (diskCachePath != NULL && !sidecarActive()) {
+        uint64_t tag = 0;
 
-    // populate the hash map with the address components
-    for (size_t i = 0; i < response->num_components; i++) {
-        // create new strings for the label and value
-        jstring jlabel = (*env)->NewStringUTF(env, response->labels[i]);
-        jstring jvalue = (*env)->NewStringUTF(env, response->components[i]);
+        if (moduleDataDir == NULL) {
+            error = "The disk cache needs setup with an explicit libpostal data directory";
+        } else if ((tag = diskCacheDataTag(moduleDataDir)) == 0) {
+            error = "No libpostal data found in the data directory";
+        } else {
+            error = diskCacheOpen(diskCachePath, diskCacheBytes, tag);
+        }
+    }
 
-        // put the label and value into the hash map
-        (*env)->CallObjectMethod(env, resultMap, hashMapPut, jlabel, jvalue);
+    pthread_mutex_unlock(&diskCacheLock);
 
-        // Clean up the local table pointers immediately
-        (*env)->DeleteLocalRef(env, jlabel);
-        (*env)->DeleteLocalRef(env, jvalue);
+    if (error != NULL) {
+        throwException(env, error);
+        return false;
     }
 
-    // done with the response
-    libpostal_address_parser_response_destroy(response);
-
-    // return the result map
-    return resultMap;
+    return true;
 }
 
 /*
- * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    parseAddress
- * Signature: (Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Ljava/util/Map;
+ * Helper function to release the workers, the cache, the sidecar connection and the loaded modules,
+ * only called while no call is running
  */
-JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddress__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2
-  (JNIEnv *env, jclass cls, jstring jaddress, jstring jlanguage, jstring jcountry) {
+void releaseServices(void) {
+    // stop the workers before the models they use go away
+    poolStop();
+    cacheStop();
+    diskCacheClose();
+    sidecarDisconnect();
 
-    if (!initialized) {
-        throwException(env, "LibPostal not initialized - call setup() first");
-        return NULL;
-    }
+    // reverse order teardown of the loaded modules
+    unloadModules();
+}
 
-    // extract the address from the JNI string
-    const char *address = (*env)->GetStringUTFChars(env, jaddress, 0);
+/*
+ * Helper function to use a sidecar daemon's models instead of loading them into this process
+ * @param env the JNI environment
+ * @param socketPath the daemon's Unix domain socket
+ * @return true if connected, false if an exception was thrown
+ */
+bool connectSidecar(JNIEnv *env, const char* socketPath) {
+    int modules = 0;
+    const char *error = sidecarConnect(socketPath, &modules);
 
-    // check if the address is null
-    if (address == NULL) {
-        throwException(env, "Error extracting address");
-        return NULL;
+    if (error != NULL) {
+        throwException(env, error);
+        return false;
     }
 
-    // extract language and country
-    const char *language = (jlanguage != NULL ? (*env)->GetStringUTFChars(env, jlanguage, NULL) : NULL);
-    const char *country = (jcountry != NULL ? (*env)->GetStringUTFChars(env, jcountry, NULL) : NULL);
+    // nothing is loaded locally, so the FFM backend stays off and every call goes through the result cache
+    return true;
+}
 
-    // create options struct with the language and country
-    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+/*
+ * Helper function to load the core module plus the given modules, or only the core module when lazy
+ * @param env the JNI environment
+ * @param dataDir the data directory, or NULL for the default one
+ * @param modules the MODULE_* bits of the modules that may be used
+ * @param lazy true to load the non-core modules on first use instead of now
+ * @return true if setup succeeded, false if an exception was thrown
+ */
+bool setupModules(JNIEnv *env, const char* dataDir, jint modules, bool lazy) {
+    // POSTAL4J_SIDECAR points every setup at a sidecar daemon, so existing applications share its models unchanged
+    const char *sidecarPath = getenv("POSTAL4J_SIDECAR");
 
-    options.language = (char*)language;
-    options.country = (char*)country;
+    if (sidecarPath != NULL && *sidecarPath != '\0') {
+        return connectSidecar(env, sidecarPath);
+    }
 
-    // parse the address
-    jobject resultMap = parseAddressWithOptions(env, (char*)address, &options);
+    // keep the data directory around for modules loaded later
+    if (dataDir != NULL) {
+        moduleDataDir = strdup(dataDir);
 
-    // free the strings
-    if (language != NULL) {
-        (*env)->ReleaseStringUTFChars(env, jlanguage, language);
+        if (moduleDataDir == NULL) {
+            throwException(env, "Error copying data directory");
+            return false;
+        }
     }
-    if (country != NULL) {
-        (*env)->ReleaseStringUTFChars(env, jcountry, country);
+
+    // every other module builds on the core one, so it is always enabled and loaded up front
+    enabledModules = modules | MODULE_EXPANSION;
+
+    if (!loadModules(env, lazy ? MODULE_EXPANSION : enabledModules)) {
+        unloadModules();
+        return false;
     }
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
 
-    // return the result map
-    return resultMap;
+    return true;
 }
 
 /*
- * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    expandAddress
- * Signature: (Ljava/lang/String;)[Ljava/lang/String;
+ * Helper function to load the given modules that are not loaded yet, in dependency order
+ * @param env the JNI environment
+ * @param modules the MODULE_* bits of the modules to load
+ * @return true if all of the modules are loaded, false if an exception was thrown
  */
-JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddress__Ljava_lang_String_2
-  (JNIEnv *env, jclass cls, jstring jaddress) {
+bool loadModules(JNIEnv *env, jint modules) {
+    bool loaded = true;
 
-    if (!initialized) {
-        throwException(env, "LibPostal not initialized - call setup() first");
-        return NULL;
-    }
+    // serializes concurrent first uses, the loser of the race finds the module already loaded
+    pthread_mutex_lock(&moduleLock);
 
-    // extract the address from the JNI string
-    const char *address = (*env)->GetStringUTFChars(env, jaddress, 0);
+    for (size_t i = 0; i < NUM_LIBPOSTAL_MODULES && loaded; i++) {
+        const libpostalModule_t *module = &libpostalModules[i];
 
-    // check if the address is null
-    if (address == NULL) {
-        throwException(env, "Error extracting address");
-        return NULL;
+        if ((modules & module->bit) == 0 || (atomic_load(&loadedModules) & module->bit) != 0) {
+            continue;
+        }
+
+        loaded = moduleDataDir == NULL ? module->setup() : module->setupDatadir(moduleDataDir);
+
+        if (loaded) {
+            atomic_fetch_or(&loadedModules, module->bit);
+        } else {
+            throwException(env, moduleDataDir == NULL ? module->setupError : module->setupDatadirError);
+        }
     }
 
-    // get the default normalize options
-    libpostal_normalize_options_t options = libpostal_get_default_options();
+    publishDirectModules(env);
 
-    // expand the address
-    jobjectArray resultArray = expandAddressWithOptions(env, (char*)address, &options);
+    pthread_mutex_unlock(&moduleLock);
 
-    // free the address string
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
+    return loaded;
+}
 
-    // return the result array
-    return resultArray;
+/*
+ * Helper function to tear down the loaded modules in reverse order and forget the setup settings
+ */
+void unloadModules(void) {
+    pthread_mutex_lock(&moduleLock);
+
+    for (size_t i = NUM_LIBPOSTAL_MODULES; i > 0; i--) {
+        const libpostalModule_t *module = &libpostalModules[i - 1];
+
+        if ((atomic_load(&loadedModules) & module->bit) != 0) {
+            module->teardown();
+            atomic_fetch_and(&loadedModules, ~module->bit);
+        }
+    }
+
+    enabledModules = 0;
+    free(moduleDataDir);
+    moduleDataDir = NULL;
+
+    pthread_mutex_unlock(&moduleLock);
 }
 
 /*
- * Helper function to expand an address with options
+ * Helper function to check setup was done and the given modules are loaded, loading enabled ones on first use
  * @param env the JNI environment
- * @param address the address string
- * @param options the normalize options
- * @return the result array
+ * @param modules the MODULE_* bits of the modules the call needs
+ * @return true if the modules are loaded, false if an exception was thrown
  */
-jobjectArray expandAddressWithOptions(JNIEnv *env, char* address, libpostal_normalize_options_t* options) {
-    // expand the address
-    size_t numExpansions;
-    char **expansions = libpostal_expand_address(address, *options, &numExpansions);
+bool requireModules(JNIEnv *env, jint modules) {
+    if (!enterCall(env)) {
+        return false;
+    }
 
-    if (expansions == NULL) {
-        throwException(env, "Error expanding address");
-        return NULL;
+    if (sidecarActive()) {
+        throwException(env, "LibPostal sidecar only serves parse and expand calls");
+        return false;
     }
 
-    return createResultArray(env, expansions, numExpansions);
+    return requireLoadedModules(env, modules);
 }
 
 /*
- * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    expandAddress
- * Signature: (Ljava/lang/String;[Ljava/lang/String;ZZZZZZZZZZZZZZZZZZI)[Ljava/lang/String;
+ * Helper function to enter a call, the caller declares LIFECYCLE_CALL so the call is left again when it returns
+ * @param env the JNI environment
+ * @return true if setup was done, teardown waits for the call from now on; false if an exception was thrown
  */
-JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddress__Ljava_lang_String_2_3Ljava_lang_String_2ZZZZZZZZZZZZZZZZZZI
-  (JNIEnv *env, jclass cls, jstring jaddress, jobjectArray languages,
-   jboolean latinAscii, jboolean transliterate, jboolean stripAccents,
-   jboolean decompose, jboolean lowercase, jboolean trimString,
-   jboolean dropParentheticals, jboolean replaceNumericHyphens,
-   jboolean deleteNumericHyphens, jboolean splitAlphaFromNumeric,
-   jboolean replaceWordHyphens, jboolean deleteWordHyphens,
-   jboolean deleteFinalPeriods, jboolean deleteAcronymPeriods,
-   jboolean dropEnglishPossessives, jboolean deleteApostrophes,
-   jboolean expandNumex, jboolean romanNumerals, jint addressComponents) {
-
-    if (!initialized) {
+bool enterCall(JNIEnv *env) {
+    if (!lifecycleEnter()) {
         throwException(env, "LibPostal not initialized - call setup() first");
-        return NULL;
+        return false;
     }
 
-    // extract the address from the JNI string
-    const char *address = (*env)->GetStringUTFChars(env, jaddress, 0);
+    return true;
+}
+
+/*
+ * Helper function to check the given modules are loaded, loading enabled ones on first use
+ * @param env the JNI environment
+ * @param modules the MODULE_* bits of the modules the call needs
+ * @return true if the modules are loaded, false if an exception was thrown
+ */
+bool requireLoadedModules(JNIEnv *env, jint modules) {
+    jint missing = modules & ~atomic_load(&loadedModules);
+
+    if (missing == 0) {
+        return true;
+    }
+
+    jint disabled = missing & ~enabledModules;
+
+    if (disabled != 0) {
+        for (size_t i = 0; i < NUM_LIBPOSTAL_MODULES; i++) {
+            if ((disabled & libpostalModules[i].bit) != 0) {
+                char message[160];
+                snprintf(message, sizeof(message), "LibPostal %s module not enabled - include it in setup()%s", libpostalModules[i].name,
+                    libpostalModules[i].bit == MODULE_CLASSIFIER ? " or pass the languages" : "");
+                throwException(env, message);
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    return loadModules(env, missing);
+}
+
+/*
+ * Helper function for the parse/expand calls, which a connected sidecar daemon serves with its own modules
+ * @param env the JNI environment
+ * @param modules the MODULE_* bits of the modules the call needs
+ * @return true if the modules are available, false if an exception was thrown
+ */
+bool requireServedModules(JNIEnv *env, jint modules) {
+    if (!enterCall(env)) {
+        return false;
+    }
+
+    if (!sidecarActive()) {
+        return requireLoadedModules(env, modules);
+    }
+
+    jint missing = modules & ~sidecarModules();
+
+    for (size_t i = 0; i < NUM_LIBPOSTAL_MODULES; i++) {
+        if ((missing & libpostalModules[i].bit) != 0) {
+            char message[160];
+            snprintf(message, sizeof(message), "LibPostal %s module not loaded by the sidecar daemon%s", libpostalModules[i].name,
+                libpostalModules[i].bit == MODULE_CLASSIFIER ? " - pass the languages" : "");
+            throwException(env, message);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Helper function to get the modules a call with the given languages needs
+ * @param env the JNI environment
+ * @param jlanguages the language codes, or NULL
+ * @return the MODULE_* bits, including the classifier when libpostal has to detect the languages
+ */
+jint languageModules(JNIEnv *env, jobjectArray jlanguages) {
+    if (jlanguages == NULL || (*env)->GetArrayLength(env, jlanguages) == 0) {
+        return MODULE_EXPANSION | MODULE_CLASSIFIER;
+    }
+
+    return MODULE_EXPANSION;
+}
+
+/*
+ * Helper function to get the modules an expansion with the given NormalizeOptions handle needs
+ * @param handle the native options, or 0 for the libpostal defaults
+ * @return the MODULE_* bits, including the classifier when libpostal has to detect the languages
+ */
+jint normalizeOptionsModules(jlong handle) {
+    if (handle == 0 || ((libpostal_normalize_options_t*)(intptr_t)handle)->num_languages == 0) {
+        return MODULE_EXPANSION | MODULE_CLASSIFIER;
+    }
+
+    return MODULE_EXPANSION;
+}
+
+/*
+ * Helper function to publish the loaded modules to LibPostal.directModules, the modules the FFM backend may call
+ * libpostal for directly. None while not initialized, while the result cache is on or while metrics are recorded,
+ * so those calls stay on JNI. Skipped while an exception is pending, JNI allows no field access then; the field
+ * is already 0 after a failed setup and otherwise holds at most the loaded modules, which only keeps calls on JNI.
+ * @param env the JNI environment
+ */
+void publishDirectModules(JNIEnv *env) {
+    LIFECYCLE_CALL;
+
+    if ((*env)->ExceptionCheck(env)) {
+        return;
+    }
+
+    // entered like a call, so teardown never frees the cache under it and nothing is published once it drained
+    jint modules = 0;
+
+    if (lifecycleEnter()) {
+        cacheStats_t stats;
+        cacheGetStats(&stats);
+
+        modules = (stats.capacity == 0 && !diskCacheActive() && !metricsEnabled() ? atomic_load(&loadedModules) : 0);
+    }
+
+    (*env)->SetStaticIntField(env, libPostalClass, directModulesField, modules);
+}
+
+/*
+ * Helper function to end the metrics of a batch call, batches record their size rather than an input
+ * @param error true if the call threw
+ * @param count the number of addresses in the batch
+ */
+void endBatchMetrics(bool error, size_t count) {
+    if (!metricsEnabled()) {
+        return;
+    }
+
+    char input[32];
+    snprintf(input, sizeof(input), "[%zu addresses]", count);
+
+    metricsEnd(error, input);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    loadModules
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_loadModules
+  (JNIEnv *env, jclass cls, jint modules) {
+
+    LIFECYCLE_CALL;
+
+    requireModules(env, modules);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    loadedModules
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_loadedModules
+  (JNIEnv *env, jclass cls) {
+
+    return atomic_load(&loadedModules);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    getWorkerThreads
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_getWorkerThreads
+  (JNIEnv *env, jclass cls) {
+
+    return poolWorkers();
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    getCacheStats
+ * Signature: ()Lcom/dnebinger/postal4j/CacheStats;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_getCacheStats
+  (JNIEnv *env, jclass cls) {
+
+    LIFECYCLE_CALL;
+
+    // teardown frees the cache, all zero while not set up
+    cacheStats_t stats = { 0 };
+
+    if (lifecycleEnter()) {
+        cacheGetStats(&stats);
+    }
+
+    return (*env)->NewObject(env, cacheStatsClass, cacheStatsInit, (jlong)stats.hits, (jlong)stats.misses,
+        (jlong)stats.evictions, (jlong)stats.entries, (jlong)stats.capacity);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    clearCache
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_clearCache
+  (JNIEnv *env, jclass cls) {
+
+    LIFECYCLE_CALL;
+
+    if (lifecycleEnter()) {
+        cacheClear();
+    }
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setDiskCacheNative
+ * Signature: (Ljava/lang/String;J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setDiskCacheNative
+  (JNIEnv *env, jclass cls, jstring path, jlong bytes) {
+
+    if (path != NULL && (bytes < MIN_DISK_CACHE_BYTES || bytes > MAX_DISK_CACHE_BYTES)) {
+        throwException(env, "Disk cache size must be between 1 MB and 1 TB");
+        return;
+    }
+
+    char *copy = NULL;
+
+    if (path != NULL) {
+        const char *pathStr = (*env)->GetStringUTFChars(env, path, NULL);
+
+        if (pathStr == NULL) {
+            throwException(env, "Error extracting disk cache path");
+            return;
+        }
+
+        copy = strdup(pathStr);
+        (*env)->ReleaseStringUTFChars(env, path, pathStr);
+
+        if (copy == NULL) {
+            throwException(env, "Error copying disk cache path");
+            return;
+        }
+    }
+
+    // only read by setup, a running setup keeps the file it opened
+    pthread_mutex_lock(&diskCacheLock);
+    free(diskCachePath);
+    diskCachePath = copy;
+    diskCacheBytes = (size_t)bytes;
+    pthread_mutex_unlock(&diskCacheLock);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    getDiskCacheStats
+ * Signature: ()Lcom/dnebinger/postal4j/DiskCacheStats;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_getDiskCacheStats
+  (JNIEnv *env, jclass cls) {
+
+    LIFECYCLE_CALL;
+
+    // teardown closes the file, all zero while not set up
+    diskCacheStats_t stats = { 0 };
+
+    if (lifecycleEnter()) {
+        diskCacheGetStats(&stats);
+    }
+
+    return (*env)->NewObject(env, diskCacheStatsClass, diskCacheStatsInit, (jlong)stats.hits, (jlong)stats.misses,
+        (jlong)stats.stores, (jlong)stats.skipped, (jlong)stats.slots, (jlong)stats.fileBytes);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setMetricsEnabledNative
+ * Signature: (ZI)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setMetricsEnabledNative
+  (JNIEnv *env, jclass cls, jboolean enabled, jint slowInputs) {
+
+    if (!enabled) {
+        metricsDisable();
+    } else if (slowInputs < 0 || !metricsEnable((size_t)slowInputs)) {
+        throwException(env, "Slow inputs must be between 0 and 1024");
+        return;
+    }
+
+    // the FFM backend is not timed, so it is bypassed while metrics are on
+    publishDirectModules(env);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isMetricsEnabled
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_dnebinger_postal4j_LibPostal_isMetricsEnabled
+  (JNIEnv *env, jclass cls) {
+
+    return metricsEnabled();
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    resetMetrics
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_resetMetrics
+  (JNIEnv *env, jclass cls) {
+
+    metricsReset();
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    metricsSnapshot
+ * Signature: ([J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_metricsSnapshot
+  (JNIEnv *env, jclass cls, jlongArray jcounters) {
+
+    if (jcounters == NULL || (*env)->GetArrayLength(env, jcounters) != METRICS_SNAPSHOT_LONGS) {
+        throwException(env, "Metrics array has the wrong length");
+        return;
+    }
+
+    int64_t *counters = malloc(METRICS_SNAPSHOT_LONGS * sizeof(int64_t));
+
+    if (counters == NULL) {
+        throwException(env, "Error allocating metrics snapshot");
+        return;
+    }
+
+    metricsSnapshot(counters);
+
+    (*env)->SetLongArrayRegion(env, jcounters, 0, METRICS_SNAPSHOT_LONGS, (const jlong*)counters);
+
+    free(counters);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    slowInputs
+ * Signature: ([J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_slowInputs
+  (JNIEnv *env, jclass cls, jlongArray jfields) {
+
+    // per slow input: entry point, timestamp, then the nanoseconds of every stage
+    const jsize fieldsPerInput = 2 + NUM_METRICS_STAGES;
+    jsize capacity = (jfields != NULL ? (*env)->GetArrayLength(env, jfields) / fieldsPerInput : 0);
+
+    if (capacity > MAX_METRICS_SLOW_INPUTS) {
+        capacity = MAX_METRICS_SLOW_INPUTS;
+    }
+
+    metricsSlowInput_t *inputs = (capacity > 0 ? malloc((size_t)capacity * sizeof(metricsSlowInput_t)) : NULL);
+
+    if (capacity > 0 && inputs == NULL) {
+        throwException(env, "Error allocating slow inputs");
+        return NULL;
+    }
+
+    size_t count = (capacity > 0 ? metricsSlowInputs(inputs, (size_t)capacity) : 0);
+    jobjectArray result = (*env)->NewObjectArray(env, (jsize)count, stringClass, NULL);
+
+    for (size_t i = 0; result != NULL && i < count; i++) {
+        jlong fields[2 + NUM_METRICS_STAGES];
+
+        fields[0] = inputs[i].entry;
+        fields[1] = inputs[i].timestampMillis;
+
+        for (size_t s = 0; s < NUM_METRICS_STAGES; s++) {
+            fields[2 + s] = inputs[i].stageNanos[s];
+        }
+
+        (*env)->SetLongArrayRegion(env, jfields, (jsize)i * fieldsPerInput, fieldsPerInput, fields);
+
+        jstring input = newStringFromUtf8(env, inputs[i].input);
+
+        if (input == NULL) {
+            result = NULL;
+            break;
+        }
+
+        (*env)->SetObjectArrayElement(env, result, (jsize)i, input);
+        (*env)->DeleteLocalRef(env, input);
+    }
+
+    free(inputs);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    teardownNative
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_teardownNative
+  (JNIEnv *env, jclass cls) {
+
+    // the calls this thread is inside could never finish
+    if (lifecycleDepth() > 0) {
+        throwException(env, "LibPostal teardown called from inside a LibPostal call");
+        return;
+    }
+
+    // stops new calls and waits for the running ones, a setup started meanwhile waits for the teardown
+    if (!lifecycleBeginTeardown()) {
+        return;
+    }
+
+    // no JNI call is left to republish the modules, so once the direct backend's calls drain nothing uses them
+    (*env)->CallStaticVoidMethod(env, libPostalClass, awaitDirectCallsMethod);
+
+    releaseServices();
+
+    lifecycleEndTeardown();
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressNative
+ * Signature: (Ljava/lang/String;)Ljava/util/Map;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressNative__Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jstring jaddress) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+    
+    metricsBegin(METRICS_PARSE);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // initialize the address parser options
+    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    jobject resultMap = parseAddressWithOptions(env, (char*)address, &options, NULL);
+    metricsEnd(resultMap == NULL, address);
+
+    // free the address string
+    releaseUtf8String(&addressString);
+
+    // return the result map
+    return resultMap;
+}
+
+/*
+ * Helper function to parse an address with options
+ * @param env the JNI environment
+ * @param address the address string
+ * @param options the address parser options
+ * @param labelCache the batch label cache, or NULL to create fresh label strings
+ * @return the result map
+ */
+jobject parseAddressWithOptions(JNIEnv *env, char* address, libpostal_address_parser_options_t* options, labelCache_t* labelCache) {
+    // parse the address
+    libpostal_address_parser_response_t *response = cachedParseAddress(address, *options);
+    metricsStage(METRICS_STAGE_LIBPOSTAL);
+
+    if (response == NULL) {
+        throwException(env, "Error parsing address");
+        return NULL;
+    }
+
+    jobject resultMap = createResultMap(env, response, labelCache);
+
+    // done with the response
+    libpostal_address_parser_response_destroy(response);
+
+    // return the result map
+    return resultMap;
+}
+
+/*
+ * Helper function to create the result map for a parser response
+ * @param env the JNI environment
+ * @param response the parser response, still owned by the caller
+ * @param labelCache the batch label cache, or NULL to create fresh label strings
+ * @return the result map
+ */
+jobject createResultMap(JNIEnv *env, libpostal_address_parser_response_t* response, labelCache_t* labelCache) {
+    // Create HashMap<String, String> directly that we will return to the caller
+    jobject resultMap = (*env)->NewObject(env, hashMapClass, hashMapInit);
+
+    if (resultMap == NULL) {
+        throwException(env, "Error creating result map");
+        return NULL;
+    }
+
+    // populate the hash map with the address components
+    for (size_t i = 0; i < response->num_components; i++) {
+        // reuse the batch label string when we have one, otherwise create a new one
+        jstring jlabel = (labelCache != NULL ? cachedLabelString(env, labelCache, response->labels[i]) : NULL);
+        int localLabel = (jlabel == NULL);
+
+        if (localLabel) {
+            jlabel = newStringFromUtf8(env, response->labels[i]);
+        }
+
+        jstring jvalue = newStringFromUtf8(env, response->components[i]);
+
+        // put the label and value into the hash map
+        jobject previous = (*env)->CallObjectMethod(env, resultMap, hashMapPut, jlabel, jvalue);
+
+        // Clean up the local table pointers immediately
+        if (previous != NULL) {
+            (*env)->DeleteLocalRef(env, previous);
+        }
+        if (localLabel) {
+            (*env)->DeleteLocalRef(env, jlabel);
+        }
+        (*env)->DeleteLocalRef(env, jvalue);
+    }
+
+    // return the result map
+    return resultMap;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressNative
+ * Signature: (Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Ljava/util/Map;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressNative__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jstring jaddress, jstring jlanguage, jstring jcountry) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_PARSE);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // extract language and country
+    utf8String_t languageString;
+    const char *language = getUtf8String(env, jlanguage, &languageString);
+    utf8String_t countryString;
+    const char *country = getUtf8String(env, jcountry, &countryString);
+
+    // create options struct with the language and country
+    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+
+    options.language = (char*)language;
+    options.country = (char*)country;
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    // parse the address
+    jobject resultMap = parseAddressWithOptions(env, (char*)address, &options, NULL);
+    metricsEnd(resultMap == NULL, address);
+
+    // free the strings
+    releaseUtf8String(&languageString);
+    releaseUtf8String(&countryString);
+    releaseUtf8String(&addressString);
+
+    // return the result map
+    return resultMap;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddresses
+ * Signature: ([Ljava/lang/String;)[Ljava/util/Map;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddresses___3Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses) {
+
+    return parseAddressBatch(env, jaddresses, NULL, NULL);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddresses
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)[Ljava/util/Map;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddresses___3Ljava_lang_String_2_3Ljava_lang_String_2_3Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses, jobjectArray jlanguages, jobjectArray jcountries) {
+
+    return parseAddressBatch(env, jaddresses, jlanguages, jcountries);
+}
+
+/*
+ * Helper function to parse a batch of addresses in a single native call
+ * @param env the JNI environment
+ * @param jaddresses the addresses to parse
+ * @param jlanguages the per-address language hints, or NULL
+ * @param jcountries the per-address country hints, or NULL
+ * @return the array of result maps, in the same order as the addresses
+ */
+jobjectArray parseAddressBatch(JNIEnv *env, jobjectArray jaddresses, jobjectArray jlanguages, jobjectArray jcountries) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_PARSE_BATCH);
+
+    // parse every address on the worker pool
+    parseBatch_t batch;
+
+    if (!runParseBatch(env, jaddresses, jlanguages, jcountries, &batch)) {
+        endBatchMetrics(true, batch.addresses.count);
+        cleanupParseBatch(&batch);
+        return NULL;
+    }
+
+    // create the result array
+    jobjectArray resultArray = (*env)->NewObjectArray(env, (jsize)batch.addresses.count, mapClass, NULL);
+
+    if (resultArray == NULL) {
+        throwException(env, "Error creating result array");
+        endBatchMetrics(true, batch.addresses.count);
+        cleanupParseBatch(&batch);
+        return NULL;
+    }
+
+    // convert the responses in input order, sharing the label strings across the batch
+    labelCache_t labelCache = { 0 };
+
+    for (size_t i = 0; i < batch.addresses.count; i++) {
+        if (batch.responses[i] == NULL) {
+            throwException(env, "Error parsing address");
+            break;
+        }
+
+        jobject resultMap = createResultMap(env, batch.responses[i], &labelCache);
+
+        if (resultMap == NULL) {
+            break;
+        }
+
+        (*env)->SetObjectArrayElement(env, resultArray, (jsize)i, resultMap);
+        (*env)->DeleteLocalRef(env, resultMap);
+    }
+
+    cleanupLabelCache(env, &labelCache);
+    endBatchMetrics((*env)->ExceptionCheck(env), batch.addresses.count);
+    cleanupParseBatch(&batch);
+
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->DeleteLocalRef(env, resultArray);
+        return NULL;
+    }
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Helper function to transcode a Java String to standard UTF-8, reading the chars through the thread-local chunk
+ * (GetStringRegion copies without allocating, unlike GetStringUTFChars or GetStringCritical on compact strings)
+ * @param env the JNI environment
+ * @param jstr the string
+ * @param length the string length in UTF-16 units
+ * @param target where to write, with room for UTF8_BYTES_PER_UTF16_UNIT * length + 1 bytes
+ * @return the number of bytes written, not counting the NUL terminator
+ */
+size_t transcodeString(JNIEnv *env, jstring jstr, jsize length, char* target) {
+    size_t written = 0;
+    jsize start = 0;
+
+    while (start < length) {
+        jsize count = (length - start < UTF16_CHUNK_UNITS ? length - start : UTF16_CHUNK_UNITS);
+
+        (*env)->GetStringRegion(env, jstr, start, count, utf16Chunk);
+
+        // keep a surrogate pair in one chunk, the high half is read again with the next chunk
+        if (start + count < length && count > 1 && utf16IsHighSurrogate(utf16Chunk[count - 1])) {
+            count--;
+        }
+
+        written += utf16ToUtf8((const uint16_t*)utf16Chunk, (size_t)count, target + written);
+        start += count;
+    }
+
+    target[written] = '\0';
+    return written;
+}
+
+/*
+ * Helper function to get a Java String as NUL terminated standard UTF-8
+ * @param env the JNI environment
+ * @param jstr the string, may be NULL
+ * @param str the storage for the transcoded string, release it with releaseUtf8String
+ * @return the UTF-8 string, or NULL when jstr is NULL or the allocation failed
+ */
+const char* getUtf8String(JNIEnv *env, jstring jstr, utf8String_t* str) {
+    str->chars = NULL;
+
+    if (jstr == NULL) {
+        return NULL;
+    }
+
+    jsize length = (*env)->GetStringLength(env, jstr);
+    size_t capacity = (size_t)length * UTF8_BYTES_PER_UTF16_UNIT + 1;
+    char *chars = (capacity <= UTF8_INLINE_CAPACITY ? str->inlineChars : malloc(capacity));
+
+    if (chars == NULL) {
+        return NULL;
+    }
+
+    transcodeString(env, jstr, length, chars);
+
+    str->chars = chars;
+    return chars;
+}
+
+/*
+ * Helper function to free a string from getUtf8String
+ * @param str the transcoded string
+ */
+void releaseUtf8String(utf8String_t* str) {
+    if (str->chars != str->inlineChars) {
+        free(str->chars);
+    }
+
+    str->chars = NULL;
+}
+
+/*
+ * Helper function to create a Java String from a NUL terminated standard UTF-8 libpostal result. NewStringUTF
+ * only takes modified UTF-8, which splits a 4 byte sequence into one char per byte, so anything beyond ASCII is
+ * decoded here and handed over as UTF-16.
+ * @param env the JNI environment
+ * @param value the UTF-8 string
+ * @return the string, or NULL if an exception was thrown
+ */
+jstring newStringFromUtf8(JNIEnv *env, const char* value) {
+    size_t length = 0;
+    bool ascii = true;
+
+    for (const unsigned char *c = (const unsigned char*)value; *c != '\0'; c++, length++) {
+        ascii = ascii && *c < 0x80;
+    }
+
+    if (ascii) {
+        return (*env)->NewStringUTF(env, value);
+    }
+
+    // the thread-local chunk is free again once an input string was transcoded
+    jchar *chars = (length <= UTF16_CHUNK_UNITS ? utf16Chunk : malloc(length * sizeof(jchar)));
+
+    if (chars == NULL) {
+        throwException(env, "Error allocating string");
+        return NULL;
+    }
+
+    size_t units = utf8ToUtf16(value, length, (uint16_t*)chars);
+    jstring result = (*env)->NewString(env, chars, (jsize)units);
+
+    if (chars != utf16Chunk) {
+        free(chars);
+    }
+
+    return result;
+}
+
+/*
+ * Helper function to copy a String[] into a native string batch
+ * @param env the JNI environment
+ * @param jstrings the strings, a NULL array gives a batch where every element is null
+ * @param allowNulls whether null elements are allowed
+ * @param batch the batch to populate, release it with cleanupStringBatch
+ * @return true on success, false if an exception was thrown
+ */
+bool loadStringBatch(JNIEnv *env, jobjectArray jstrings, bool allowNulls, stringBatch_t* batch) {
+    bufferInit(&batch->data);
+    batch->offsets = NULL;
+    batch->count = 0;
+
+    if (jstrings == NULL) {
+        return true;
+    }
+
+    size_t count = (size_t)(*env)->GetArrayLength(env, jstrings);
+
+    if (count == 0) {
+        return true;
+    }
+
+    batch->offsets = malloc(count * sizeof(size_t));
+
+    if (batch->offsets == NULL) {
+        throwException(env, "Error allocating batch");
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        jstring jstr = (*env)->GetObjectArrayElement(env, jstrings, (jsize)i);
+
+        if (jstr == NULL) {
+            if (!allowNulls) {
+                throwException(env, "Addresses array must not contain null elements");
+                return false;
+            }
+
+            batch->offsets[i] = NO_STRING;
+            batch->count++;
+            continue;
+        }
+
+        // transcode the string straight into the batch block, no intermediate allocation
+        jsize length = (*env)->GetStringLength(env, jstr);
+
+        if (!bufferReserve(&batch->data, (size_t)length * UTF8_BYTES_PER_UTF16_UNIT + 1)) {
+            (*env)->DeleteLocalRef(env, jstr);
+            throwException(env, "Error allocating batch");
+            return false;
+        }
+
+        size_t utfLength = transcodeString(env, jstr, length, batch->data.data + batch->data.length);
+
+        batch->offsets[i] = batch->data.length;
+        batch->data.length += utfLength + 1;
+        batch->count++;
+
+        (*env)->DeleteLocalRef(env, jstr);
+    }
+
+    return true;
+}
+
+/*
+ * Helper function to get a string from a batch
+ * @param batch the batch
+ * @param index the string index
+ * @return the string, or NULL for null elements and empty batches
+ */
+char* stringBatchGet(stringBatch_t* batch, size_t index) {
+    if (index >= batch->count || batch->offsets[index] == NO_STRING) {
+        return NULL;
+    }
+
+    return batch->data.data + batch->offsets[index];
+}
+
+/*
+ * Helper function to free a string batch
+ * @param batch the batch
+ */
+void cleanupStringBatch(stringBatch_t* batch) {
+    bufferFree(&batch->data);
+    free(batch->offsets);
+    batch->offsets = NULL;
+    batch->count = 0;
+}
+
+/*
+ * Helper function to load a batch of addresses and parse them on the worker pool
+ * @param env the JNI environment
+ * @param jaddresses the addresses to parse
+ * @param jlanguages the per-address language hints, or NULL
+ * @param jcountries the per-address country hints, or NULL
+ * @param batch the batch to populate, always release it with cleanupParseBatch
+ * @return true on success, false if an exception was thrown
+ */
+bool runParseBatch(JNIEnv *env, jobjectArray jaddresses, jobjectArray jlanguages, jobjectArray jcountries, parseBatch_t* batch) {
+    memset(batch, 0, sizeof(parseBatch_t));
+
+    if (jaddresses == NULL) {
+        throwException(env, "Addresses array must not be null");
+        return false;
+    }
+
+    jsize count = (*env)->GetArrayLength(env, jaddresses);
+
+    // the hint arrays are optional, but when present they must line up with the addresses
+    if (jlanguages != NULL && (*env)->GetArrayLength(env, jlanguages) != count) {
+        throwException(env, "Languages array length must match the addresses array length");
+        return false;
+    }
+    if (jcountries != NULL && (*env)->GetArrayLength(env, jcountries) != count) {
+        throwException(env, "Countries array length must match the addresses array length");
+        return false;
+    }
+
+    // copy the inputs out of the JVM so the workers never touch JNI
+    if (!loadStringBatch(env, jaddresses, false, &batch->addresses) ||
+        !loadStringBatch(env, jlanguages, true, &batch->languages) ||
+        !loadStringBatch(env, jcountries, true, &batch->countries)) {
+        return false;
+    }
+
+    if (count > 0) {
+        batch->responses = calloc((size_t)count, sizeof(libpostal_address_parser_response_t*));
+
+        if (batch->responses == NULL) {
+            throwException(env, "Error allocating batch");
+            return false;
+        }
+    }
+
+    metricsStage(METRICS_STAGE_INPUT);
+    poolRun((size_t)count, parseBatchTask, batch);
+    metricsStage(METRICS_STAGE_LIBPOSTAL);
+
+    return true;
+}
+
+/*
+ * Pool task that parses one address of a batch into its response slot
+ * @param index the address index
+ * @param context the parse batch
+ */
+void parseBatchTask(size_t index, void* context) {
+    parseBatch_t *batch = (parseBatch_t*)context;
+
+    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+
+    options.language = stringBatchGet(&batch->languages, index);
+    options.country = stringBatchGet(&batch->countries, index);
+
+    batch->responses[index] = cachedParseAddress(stringBatchGet(&batch->addresses, index), options);
+}
+
+/*
+ * Helper function to free a parse batch and any responses still in it
+ * @param batch the batch
+ */
+void cleanupParseBatch(parseBatch_t* batch) {
+    if (batch->responses != NULL) {
+        for (size_t i = 0; i < batch->addresses.count; i++) {
+            if (batch->responses[i] != NULL) {
+                libpostal_address_parser_response_destroy(batch->responses[i]);
+            }
+        }
+        free(batch->responses);
+        batch->responses = NULL;
+    }
+
+    cleanupStringBatch(&batch->addresses);
+    cleanupStringBatch(&batch->languages);
+    cleanupStringBatch(&batch->countries);
+}
+
+/*
+ * Helper function to load a batch of addresses and expand them on the worker pool
+ * @param env the JNI environment
+ * @param jaddresses the addresses to expand
+ * @param batch the batch to populate, with options and root already set; always release it with cleanupExpandBatch
+ * @return true on success, false if an exception was thrown
+ */
+bool runExpandBatch(JNIEnv *env, jobjectArray jaddresses, expandBatch_t* batch) {
+    batch->expansions = NULL;
+    batch->numExpansions = NULL;
+
+    if (!loadStringBatch(env, jaddresses, false, &batch->addresses)) {
+        return false;
+    }
+
+    size_t count = batch->addresses.count;
+
+    if (count > 0) {
+        batch->expansions = calloc(count, sizeof(char**));
+        batch->numExpansions = calloc(count, sizeof(size_t));
+
+        if (batch->expansions == NULL || batch->numExpansions == NULL) {
+            throwException(env, "Error allocating batch");
+            return false;
+        }
+    }
+
+    metricsStage(METRICS_STAGE_INPUT);
+    poolRun(count, expandBatchTask, batch);
+    metricsStage(METRICS_STAGE_LIBPOSTAL);
+
+    return true;
+}
+
+/*
+ * Pool task that expands one address of a batch into its expansion slot
+ * @param index the address index
+ * @param context the expand batch
+ */
+void expandBatchTask(size_t index, void* context) {
+    expandBatch_t *batch = (expandBatch_t*)context;
+    char *address = stringBatchGet(&batch->addresses, index);
+
+    batch->expansions[index] = cachedExpandAddress(address, batch->options, batch->root, &batch->numExpansions[index]);
+}
+
+/*
+ * Helper function to free an expand batch and any expansions still in it
+ * @param batch the batch
+ */
+void cleanupExpandBatch(expandBatch_t* batch) {
+    if (batch->expansions != NULL) {
+        for (size_t i = 0; i < batch->addresses.count; i++) {
+            if (batch->expansions[i] != NULL) {
+                libpostal_expansion_array_destroy(batch->expansions[i], batch->numExpansions[i]);
+            }
+        }
+        free(batch->expansions);
+        batch->expansions = NULL;
+    }
+
+    free(batch->numExpansions);
+    batch->numExpansions = NULL;
+
+    cleanupStringBatch(&batch->addresses);
+}
+
+/*
+ * Helper function to convert the expansions of a batch into a String[][] in input order
+ * @param env the JNI environment
+ * @param batch the expand batch, expansions are consumed as they are converted
+ * @return the result array, or NULL if an exception was thrown
+ */
+jobjectArray createExpandBatchResult(JNIEnv *env, expandBatch_t* batch) {
+    jobjectArray resultArray = (*env)->NewObjectArray(env, (jsize)batch->addresses.count, stringArrayClass, NULL);
+
+    if (resultArray == NULL) {
+        throwException(env, "Error creating result array");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < batch->addresses.count; i++) {
+        if (batch->expansions[i] == NULL) {
+            throwException(env, batch->root ? "Error expanding root address" : "Error expanding address");
+            (*env)->DeleteLocalRef(env, resultArray);
+            return NULL;
+        }
+
+        // createResultArray frees the expansions, success or not
+        jobjectArray expansions = createResultArray(env, batch->expansions[i], batch->numExpansions[i]);
+        batch->expansions[i] = NULL;
+
+        if (expansions == NULL) {
+            (*env)->DeleteLocalRef(env, resultArray);
+            return NULL;
+        }
+
+        (*env)->SetObjectArrayElement(env, resultArray, (jsize)i, expansions);
+        (*env)->DeleteLocalRef(env, expansions);
+    }
+
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressBatch
+ * Signature: ([Ljava/lang/String;JZ)[[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressBatch
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses, jlong handle, jboolean root) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(handle))) {
+        return NULL;
+    }
+
+    if (jaddresses == NULL) {
+        throwException(env, "Addresses array must not be null");
+        return NULL;
+    }
+
+    // a 0 handle selects the libpostal defaults, the workers share the options read-only
+    expandBatch_t batch;
+    batch.options = (handle != 0 ? *(libpostal_normalize_options_t*)(intptr_t)handle : libpostal_get_default_options());
+    batch.root = root;
+
+    jobjectArray resultArray = NULL;
+
+    metricsBegin(METRICS_EXPAND_BATCH);
+
+    if (runExpandBatch(env, jaddresses, &batch)) {
+        resultArray = createExpandBatchResult(env, &batch);
+    }
+
+    endBatchMetrics(resultArray == NULL, batch.addresses.count);
+
+    cleanupExpandBatch(&batch);
+
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressToNative
+ * Signature: (Ljava/lang/String;I[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressToNative
+  (JNIEnv *env, jclass cls, jstring jaddress, jint format, jbyteArray jarray, jobject jbuffer, jint offset, jint limit) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER) || !checkRecordOutput(env, format, jarray, jbuffer, offset, limit)) {
+        return -1;
+    }
+
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        return -1;
+    }
+
+    libpostal_address_parser_response_t *response = cachedParseAddress((char*)address, libpostal_get_address_parser_default_options());
+
+    releaseUtf8String(&addressString);
+
+    if (response == NULL) {
+        throwException(env, "Error parsing address");
+        return -1;
+    }
+
+    // formatted natively and copied out once, no Java object is created
+    nativeBuffer_t record;
+    bufferInit(&record);
+
+    bool formatted = formatParseRecord(&record, (recordFormat_t)format, response);
+    libpostal_address_parser_response_destroy(response);
+
+    jint length = -1;
+
+    if (!formatted || record.length > INT32_MAX) {
+        throwException(env, "Error formatting parse result");
+    } else {
+        length = (jint)record.length;
+
+        // a record that does not fit is not written, the caller retries with a larger buffer
+        if (length <= limit - offset && !writeRecordOutput(env, jarray, jbuffer, offset, &record)) {
+            length = -1;
+        }
+    }
+
+    bufferFree(&record);
+
+    return length;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressToNative
+ * Signature: (Ljava/lang/String;JI[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressToNative
+  (JNIEnv *env, jclass cls, jstring jaddress, jlong handle, jint format, jbyteArray jarray, jobject jbuffer, jint offset, jint limit) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(handle)) || !checkRecordOutput(env, format, jarray, jbuffer, offset, limit)) {
+        return -1;
+    }
+
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        return -1;
+    }
+
+    // a 0 handle selects the libpostal defaults
+    libpostal_normalize_options_t options = (handle != 0 ? *(libpostal_normalize_options_t*)(intptr_t)handle : libpostal_get_default_options());
+    size_t numExpansions = 0;
+    char **expansions = cachedExpandAddress((char*)address, options, false, &numExpansions);
+
+    releaseUtf8String(&addressString);
+
+    if (expansions == NULL) {
+        throwException(env, "Error expanding address");
+        return -1;
+    }
+
+    nativeBuffer_t record;
+    bufferInit(&record);
+
+    bool formatted = formatExpansionRecord(&record, (recordFormat_t)format, expansions, numExpansions);
+    libpostal_expansion_array_destroy(expansions, numExpansions);
+
+    jint length = -1;
+
+    if (!formatted || record.length > INT32_MAX) {
+        throwException(env, "Error formatting expansions");
+    } else {
+        length = (jint)record.length;
+
+        if (length <= limit - offset && !writeRecordOutput(env, jarray, jbuffer, offset, &record)) {
+            length = -1;
+        }
+    }
+
+    bufferFree(&record);
+
+    return length;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressesToNative
+ * Signature: ([Ljava/lang/String;I[BLjava/nio/ByteBuffer;II[I)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressesToNative
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses, jint format, jbyteArray jarray, jobject jbuffer, jint offset, jint limit,
+   jintArray jends) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER) || !checkRecordOutput(env, format, jarray, jbuffer, offset, limit)) {
+        return -1;
+    }
+
+    if (jaddresses == NULL || jends == NULL) {
+        throwException(env, "Addresses and ends arrays must not be null");
+        return -1;
+    }
+
+    if ((*env)->GetArrayLength(env, jends) < (*env)->GetArrayLength(env, jaddresses)) {
+        throwException(env, "Ends array must be at least as long as the addresses array");
+        return -1;
+    }
+
+    parseBatch_t batch;
+    nativeBuffer_t records;
+    size_t *ends = NULL;
+    jint written = -1;
+
+    bufferInit(&records);
+
+    // parsed on the workers, then formatted in input order until the output is full
+    if (runParseBatch(env, jaddresses, NULL, NULL, &batch)) {
+        size_t count = batch.addresses.count;
+        size_t space = (size_t)(limit - offset);
+        bool formatted = true;
+
+        if (count > 0 && (ends = malloc(count * sizeof(size_t))) == NULL) {
+            formatted = false;
+        }
+
+        for (size_t i = 0; formatted && i < count; i++) {
+            size_t start = records.length;
+
+            formatted = formatParseRecord(&records, (recordFormat_t)format, batch.responses[i]);
+            ends[i] = records.length;
+
+            if (formatted && records.length > space) {
+                records.length = start;
+                count = i;
+            }
+        }
+
+        if (!formatted) {
+            throwException(env, "Error formatting parse results");
+        } else {
+            written = writeRecordBatch(env, jarray, jbuffer, offset, jends, count, &records, ends);
+        }
+    }
+
+    cleanupParseBatch(&batch);
+    bufferFree(&records);
+    free(ends);
+
+    return written;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressesToNative
+ * Signature: ([Ljava/lang/String;JI[BLjava/nio/ByteBuffer;II[I)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressesToNative
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses, jlong handle, jint format, jbyteArray jarray, jobject jbuffer, jint offset,
+   jint limit, jintArray jends) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(handle)) || !checkRecordOutput(env, format, jarray, jbuffer, offset, limit)) {
+        return -1;
+    }
+
+    if (jaddresses == NULL || jends == NULL) {
+        throwException(env, "Addresses and ends arrays must not be null");
+        return -1;
+    }
+
+    if ((*env)->GetArrayLength(env, jends) < (*env)->GetArrayLength(env, jaddresses)) {
+        throwException(env, "Ends array must be at least as long as the addresses array");
+        return -1;
+    }
+
+    expandBatch_t batch;
+    batch.options = (handle != 0 ? *(libpostal_normalize_options_t*)(intptr_t)handle : libpostal_get_default_options());
+    batch.root = false;
+
+    nativeBuffer_t records;
+    size_t *ends = NULL;
+    jint written = -1;
+
+    bufferInit(&records);
+
+    if (runExpandBatch(env, jaddresses, &batch)) {
+        size_t count = batch.addresses.count;
+        size_t space = (size_t)(limit - offset);
+        bool formatted = true;
+
+        if (count > 0 && (ends = malloc(count * sizeof(size_t))) == NULL) {
+            formatted = false;
+        }
+
+        for (size_t i = 0; formatted && i < count; i++) {
+            size_t start = records.length;
+
+            formatted = formatExpansionRecord(&records, (recordFormat_t)format, batch.expansions[i], batch.numExpansions[i]);
+            ends[i] = records.length;
+
+            if (formatted && records.length > space) {
+                records.length = start;
+                count = i;
+            }
+        }
+
+        if (!formatted) {
+            throwException(env, "Error formatting expansions");
+        } else {
+            written = writeRecordBatch(env, jarray, jbuffer, offset, jends, count, &records, ends);
+        }
+    }
+
+    cleanupExpandBatch(&batch);
+    bufferFree(&records);
+    free(ends);
+
+    return written;
+}
+
+/*
+ * Helper function to check the arguments of a call writing records to a caller buffer
+ * @param env the JNI environment
+ * @param format the RecordFormat ordinal
+ * @param jarray the output array, or NULL
+ * @param jbuffer the direct output buffer when jarray is NULL
+ * @param offset the absolute offset the records start at
+ * @param limit the absolute offset the records must end by
+ * @return true if the arguments are valid, false if an exception was thrown
+ */
+bool checkRecordOutput(JNIEnv *env, jint format, jbyteArray jarray, jobject jbuffer, jint offset, jint limit) {
+    if (format < 0 || format >= NUM_RECORD_FORMATS) {
+        throwException(env, "Unknown record format");
+        return false;
+    }
+
+    if (jarray == NULL && jbuffer == NULL) {
+        throwException(env, "Output buffer must not be null");
+        return false;
+    }
+
+    jlong capacity = (jarray != NULL ? (jlong)(*env)->GetArrayLength(env, jarray) : (*env)->GetDirectBufferCapacity(env, jbuffer));
+
+    if (offset < 0 || offset > limit || (jlong)limit > capacity) {
+        throwException(env, "Output range out of bounds");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Helper function to copy formatted records into the caller's array or direct buffer
+ * @param env the JNI environment
+ * @param jarray the output array, or NULL
+ * @param jbuffer the direct output buffer when jarray is NULL
+ * @param offset the absolute offset to write at, the records are known to fit
+ * @param records the records
+ * @return true on success, false if an exception was thrown
+ */
+bool writeRecordOutput(JNIEnv *env, jbyteArray jarray, jobject jbuffer, jint offset, const nativeBuffer_t* records) {
+    if (records->length == 0) {
+        return true;
+    }
+
+    if (jarray != NULL) {
+        (*env)->SetByteArrayRegion(env, jarray, offset, (jsize)records->length, (const jbyte*)records->data);
+        return !(*env)->ExceptionCheck(env);
+    }
+
+    char *address = (*env)->GetDirectBufferAddress(env, jbuffer);
+
+    if (address == NULL) {
+        throwException(env, "Error accessing output buffer");
+        return false;
+    }
+
+    memcpy(address + offset, records->data, records->length);
+
+    return true;
+}
+
+/*
+ * Helper function to write the records of a batch that fit and their end offsets
+ * @param env the JNI environment
+ * @param jarray the output array, or NULL
+ * @param jbuffer the direct output buffer when jarray is NULL
+ * @param offset the absolute offset the records start at
+ * @param jends receives the absolute end offset of every written record
+ * @param count the number of records that fit
+ * @param records the records that fit, back to back
+ * @param ends the end of every record within records
+ * @return the number of records written, -1 if an exception was thrown
+ */
+jint writeRecordBatch(JNIEnv *env, jbyteArray jarray, jobject jbuffer, jint offset, jintArray jends, size_t count,
+    const nativeBuffer_t* records, const size_t* ends) {
+
+    if (!writeRecordOutput(env, jarray, jbuffer, offset, records)) {
+        return -1;
+    }
+
+    if (count > 0) {
+        jint *absoluteEnds = (*env)->GetPrimitiveArrayCritical(env, jends, NULL);
+
+        if (absoluteEnds == NULL) {
+            throwException(env, "Error accessing ends array");
+            return -1;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            absoluteEnds[i] = offset + (jint)ends[i];
+        }
+
+        (*env)->ReleasePrimitiveArrayCritical(env, jends, absoluteEnds, 0);
+    }
+
+    return (jint)count;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    matchScoreNative
+ * Signature: (Ljava/lang/String;Ljava/lang/String;J)F
+ */
+JNIEXPORT jfloat JNICALL Java_com_dnebinger_postal4j_LibPostal_matchScoreNative
+  (JNIEnv *env, jclass cls, jstring jleft, jstring jright, jlong handle) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(handle))) {
+        return 0.0f;
+    }
+
+    // a missing address matches nothing
+    if (jleft == NULL || jright == NULL) {
+        return 0.0f;
+    }
+
+    libpostal_normalize_options_t options = (handle != 0 ? *(libpostal_normalize_options_t*)(intptr_t)handle : libpostal_get_default_options());
+
+    utf8String_t leftString;
+    utf8String_t rightString;
+    const char *left = getUtf8String(env, jleft, &leftString);
+    const char *right = (left != NULL ? getUtf8String(env, jright, &rightString) : NULL);
+    jfloat score = 0.0f;
+
+    if (right == NULL) {
+        throwException(env, "Error extracting addresses");
+    } else {
+        score = matchScore((char*)left, (char*)right, options);
+
+        if (score == MATCH_ERROR) {
+            throwException(env, "Error expanding address");
+            score = 0.0f;
+        }
+    }
+
+    if (left != NULL) {
+        releaseUtf8String(&leftString);
+    }
+    if (right != NULL) {
+        releaseUtf8String(&rightString);
+    }
+
+    return score;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    matchScoreBatch
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;J)[F
+ */
+JNIEXPORT jfloatArray JNICALL Java_com_dnebinger_postal4j_LibPostal_matchScoreBatch
+  (JNIEnv *env, jclass cls, jobjectArray jleft, jobjectArray jright, jlong handle) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(handle))) {
+        return NULL;
+    }
+
+    if (jleft == NULL || jright == NULL || (*env)->GetArrayLength(env, jleft) != (*env)->GetArrayLength(env, jright)) {
+        throwException(env, "Left and right addresses must not be null and must have the same length");
+        return NULL;
+    }
+
+    matchBatch_t batch;
+    memset(&batch, 0, sizeof(matchBatch_t));
+    batch.options = (handle != 0 ? *(libpostal_normalize_options_t*)(intptr_t)handle : libpostal_get_default_options());
+
+    jfloatArray result = NULL;
+
+    // null elements are missing addresses, scored 0
+    if (loadStringBatch(env, jleft, true, &batch.left) && loadStringBatch(env, jright, true, &batch.right)) {
+        size_t count = batch.left.count;
+        batch.scores = malloc((count + 1) * sizeof(jfloat));
+
+        if (batch.scores == NULL) {
+            throwException(env, "Error allocating batch");
+        } else {
+            poolRun(count, matchBatchTask, &batch);
+
+            bool failed = false;
+
+            for (size_t i = 0; i < count && !failed; i++) {
+                failed = (batch.scores[i] == MATCH_ERROR);
+            }
+
+            if (failed) {
+                throwException(env, "Error expanding address");
+            } else if ((result = (*env)->NewFloatArray(env, (jsize)count)) == NULL) {
+                throwException(env, "Error creating result array");
+            } else if (count > 0) {
+                (*env)->SetFloatArrayRegion(env, result, 0, (jsize)count, batch.scores);
+            }
+        }
+    }
+
+    cleanupMatchBatch(&batch);
+
+    return result;
+}
+
+/*
+ * Pool task that scores one pair of a batch into its score slot
+ * @param index the pair index
+ * @param context the match batch
+ */
+void matchBatchTask(size_t index, void* context) {
+    matchBatch_t *batch = (matchBatch_t*)context;
+    char *left = stringBatchGet(&batch->left, index);
+    char *right = stringBatchGet(&batch->right, index);
+
+    batch->scores[index] = (left != NULL && right != NULL ? matchScore(left, right, batch->options) : 0.0f);
+}
+
+/*
+ * Helper function to free a match batch
+ * @param batch the batch
+ */
+void cleanupMatchBatch(matchBatch_t* batch) {
+    cleanupStringBatch(&batch->left);
+    cleanupStringBatch(&batch->right);
+    free(batch->scores);
+    batch->scores = NULL;
+}
+
+/*
+ * Helper function to get the shared string for a label within a batch
+ * @param env the JNI environment
+ * @param labelCache the batch label cache
+ * @param label the label
+ * @return the cached label string, or NULL if it could not be cached
+ */
+jstring cachedLabelString(JNIEnv *env, labelCache_t* labelCache, const char* label) {
+    for (size_t i = 0; i < labelCache->count; i++) {
+        if (strcmp(labelCache->names[i], label) == 0) {
+            return labelCache->strings[i];
+        }
+    }
+
+    if (labelCache->count >= MAX_CACHED_LABELS) {
+        return NULL;
+    }
+
+    // the label strings are global refs so they outlive the per-address local frames
+    jstring local = newStringFromUtf8(env, label);
+
+    if (local == NULL) {
+        return NULL;
+    }
+
+    jstring global = (*env)->NewGlobalRef(env, local);
+    (*env)->DeleteLocalRef(env, local);
+
+    char *name = strdup(label);
+
+    if (global == NULL || name == NULL) {
+        if (global != NULL) {
+            (*env)->DeleteGlobalRef(env, global);
+        }
+        free(name);
+        return NULL;
+    }
+
+    labelCache->names[labelCache->count] = name;
+    labelCache->strings[labelCache->count] = global;
+    labelCache->count++;
+
+    return global;
+}
+
+/*
+ * Helper function to release the label strings cached for a batch
+ * @param env the JNI environment
+ * @param labelCache the batch label cache
+ */
+void cleanupLabelCache(JNIEnv *env, labelCache_t* labelCache) {
+    for (size_t i = 0; i < labelCache->count; i++) {
+        (*env)->DeleteGlobalRef(env, labelCache->strings[i]);
+        free(labelCache->names[i]);
+    }
+
+    labelCache->count = 0;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressCompact
+ * Signature: (Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressCompact__Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jstring jaddress) {
+
+    return Java_com_dnebinger_postal4j_LibPostal_parseAddressCompact__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2(
+        env, cls, jaddress, NULL, NULL);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressCompact
+ * Signature: (Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressCompact__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jstring jaddress, jstring jlanguage, jstring jcountry) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_PARSE_COMPACT);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // extract language and country
+    utf8String_t languageString;
+    const char *language = getUtf8String(env, jlanguage, &languageString);
+    utf8String_t countryString;
+    const char *country = getUtf8String(env, jcountry, &countryString);
+
+    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+
+    options.language = (char*)language;
+    options.country = (char*)country;
+
+    // parse the address into the columnar buffers
+    columnarResult_t columnar;
+    initColumnarResult(&columnar);
+
+    jobject result = NULL;
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    if (parseAddressCompactWithOptions(env, (char*)address, &options, &columnar)) {
+        result = createParsedAddress(env, &columnar);
+    }
+
+    metricsEnd(result == NULL, address);
+
+    cleanupColumnarResult(&columnar);
+
+    // free the strings
+    releaseUtf8String(&languageString);
+    releaseUtf8String(&countryString);
+    releaseUtf8String(&addressString);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressesCompact
+ * Signature: ([Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddressBatch;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressesCompact___3Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses) {
+
+    return Java_com_dnebinger_postal4j_LibPostal_parseAddressesCompact___3Ljava_lang_String_2_3Ljava_lang_String_2_3Ljava_lang_String_2(
+        env, cls, jaddresses, NULL, NULL);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressesCompact
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddressBatch;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressesCompact___3Ljava_lang_String_2_3Ljava_lang_String_2_3Ljava_lang_String_2
+  (JNIEnv *env, jclass cls, jobjectArray jaddresses, jobjectArray jlanguages, jobjectArray jcountries) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_PARSE_BATCH);
+
+    // parse every address on the worker pool
+    parseBatch_t batch;
+
+    if (!runParseBatch(env, jaddresses, jlanguages, jcountries, &batch)) {
+        endBatchMetrics(true, batch.addresses.count);
+        cleanupParseBatch(&batch);
+        return NULL;
+    }
+
+    // append the responses to the same columnar buffers, in input order
+    columnarResult_t columnar;
+    initColumnarResult(&columnar);
+
+    jobject result = NULL;
+    bool success = true;
+
+    for (size_t i = 0; success && i < batch.addresses.count; i++) {
+        if (batch.responses[i] == NULL) {
+            throwException(env, "Error parsing address");
+            success = false;
+        } else {
+            success = beginColumnarRecord(env, &columnar) && appendColumnarComponents(env, &columnar, batch.responses[i]);
+        }
+    }
+
+    if (success) {
+        result = createParsedAddressBatch(env, &columnar);
+    }
+
+    endBatchMetrics(result == NULL, batch.addresses.count);
+
+    cleanupColumnarResult(&columnar);
+    cleanupParseBatch(&batch);
+
+    return result;
+}
+
+/*
+ * Helper function to parse an address with options into columnar buffers
+ * @param env the JNI environment
+ * @param address the address string
+ * @param options the address parser options
+ * @param columnar the columnar result the parsed components are appended to
+ * @return true on success, false if an exception was thrown
+ */
+bool parseAddressCompactWithOptions(JNIEnv *env, char* address, libpostal_address_parser_options_t* options, columnarResult_t* columnar) {
+    // parse the address
+    libpostal_address_parser_response_t *response = cachedParseAddress(address, *options);
+    metricsStage(METRICS_STAGE_LIBPOSTAL);
+
+    if (response == NULL) {
+        throwException(env, "Error parsing address");
+        return false;
+    }
+
+    bool success = beginColumnarRecord(env, columnar) && appendColumnarComponents(env, columnar, response);
+
+    // done with the response
+    libpostal_address_parser_response_destroy(response);
+
+    return success;
+}
+
+/*
+ * Helper function to initialize an empty columnar result
+ * @param columnar the columnar result
+ */
+void initColumnarResult(columnarResult_t* columnar) {
+    bufferInit(&columnar->records);
+    bufferInit(&columnar->labels);
+    bufferInit(&columnar->values);
+    bufferInit(&columnar->offsets);
+    columnar->numRecords = 0;
+    columnar->numComponents = 0;
+}
+
+/*
+ * Helper function to free the buffers of a columnar result
+ * @param columnar the columnar result
+ */
+void cleanupColumnarResult(columnarResult_t* columnar) {
+    bufferFree(&columnar->records);
+    bufferFree(&columnar->labels);
+    bufferFree(&columnar->values);
+    bufferFree(&columnar->offsets);
+    columnar->numRecords = 0;
+    columnar->numComponents = 0;
+}
+
+/*
+ * Helper function to start a new record, recording the index of its first component
+ * @param env the JNI environment
+ * @param columnar the columnar result
+ * @return true on success, false if an exception was thrown
+ */
+bool beginColumnarRecord(JNIEnv *env, columnarResult_t* columnar) {
+    if (!bufferAppendInt(&columnar->records, (int32_t)columnar->numComponents)) {
+        throwException(env, "Error allocating parse result");
+        return false;
+    }
+
+    columnar->numRecords++;
+
+    return true;
+}
+
+/*
+ * Helper function to append the components of a parser response to a columnar result
+ * @param env the JNI environment
+ * @param columnar the columnar result
+ * @param response the parser response
+ * @return true on success, false if an exception was thrown
+ */
+bool appendColumnarComponents(JNIEnv *env, columnarResult_t* columnar, libpostal_address_parser_response_t* response) {
+    for (size_t i = 0; i < response->num_components; i++) {
+        int ordinal = addressLabelOrdinal(response->labels[i]);
+
+        if (ordinal < 0) {
+            throwException(env, "Unknown address label returned by libpostal");
+            return false;
+        }
+
+        size_t length = strlen(response->components[i]);
+
+        // offsets are Java ints, so the packed values have to stay below 2GB
+        if (columnar->values.length + length > INT32_MAX || columnar->numComponents >= INT32_MAX) {
+            throwException(env, "Parse result too large");
+            return false;
+        }
+
+        if (!bufferAppendByte(&columnar->labels, (uint8_t)ordinal) ||
+            !bufferAppendInt(&columnar->offsets, (int32_t)columnar->values.length) ||
+            !bufferAppend(&columnar->values, response->components[i], length)) {
+            throwException(env, "Error allocating parse result");
+            return false;
+        }
+
+        columnar->numComponents++;
+    }
+
+    return true;
+}
+
+/*
+ * Helper function to copy a native buffer into a new Java byte array
+ * @param env the JNI environment
+ * @param buffer the buffer
+ * @return the byte array, or NULL if an exception was thrown
+ */
+jbyteArray createByteArray(JNIEnv *env, nativeBuffer_t* buffer) {
+    jbyteArray array = (*env)->NewByteArray(env, (jsize)buffer->length);
+
+    if (array != NULL && buffer->length > 0) {
+        (*env)->SetByteArrayRegion(env, array, 0, (jsize)buffer->length, (const jbyte*)buffer->data);
+    }
+
+    return array;
+}
+
+/*
+ * Helper function to copy a native buffer of ints into a new Java int array
+ * @param env the JNI environment
+ * @param buffer the buffer of native order ints
+ * @return the int array, or NULL if an exception was thrown
+ */
+jintArray createIntArray(JNIEnv *env, nativeBuffer_t* buffer) {
+    jsize length = (jsize)(buffer->length / sizeof(int32_t));
+    jintArray array = (*env)->NewIntArray(env, length);
+
+    if (array != NULL && length > 0) {
+        (*env)->SetIntArrayRegion(env, array, 0, length, (const jint*)buffer->data);
+    }
+
+    return array;
+}
+
+/*
+ * Helper function to create a ParsedAddress from a single record columnar result
+ * @param env the JNI environment
+ * @param columnar the columnar result
+ * @return the parsed address, or NULL if an exception was thrown
+ */
+jobject createParsedAddress(JNIEnv *env, columnarResult_t* columnar) {
+    // close the offsets table with the end of the last value
+    if (!bufferAppendInt(&columnar->offsets, (int32_t)columnar->values.length)) {
+        throwException(env, "Error allocating parse result");
+        return NULL;
+    }
+
+    jbyteArray labels = createByteArray(env, &columnar->labels);
+    jbyteArray values = (labels != NULL ? createByteArray(env, &columnar->values) : NULL);
+    jintArray offsets = (values != NULL ? createIntArray(env, &columnar->offsets) : NULL);
+
+    if (offsets == NULL) {
+        throwException(env, "Error creating parse result");
+        return NULL;
+    }
+
+    jobject result = (*env)->NewObject(env, parsedAddressClass, parsedAddressInit, labels, values, offsets);
+
+    (*env)->DeleteLocalRef(env, labels);
+    (*env)->DeleteLocalRef(env, values);
+    (*env)->DeleteLocalRef(env, offsets);
+
+    return result;
+}
+
+/*
+ * Helper function to create a ParsedAddressBatch from a columnar result
+ * @param env the JNI environment
+ * @param columnar the columnar result
+ * @return the parsed address batch, or NULL if an exception was thrown
+ */
+jobject createParsedAddressBatch(JNIEnv *env, columnarResult_t* columnar) {
+    // close the record and offsets tables
+    if (!bufferAppendInt(&columnar->records, (int32_t)columnar->numComponents) ||
+        !bufferAppendInt(&columnar->offsets, (int32_t)columnar->values.length)) {
+        throwException(env, "Error allocating parse result");
+        return NULL;
+    }
+
+    jintArray records = createIntArray(env, &columnar->records);
+    jbyteArray labels = (records != NULL ? createByteArray(env, &columnar->labels) : NULL);
+    jbyteArray values = (labels != NULL ? createByteArray(env, &columnar->values) : NULL);
+    jintArray offsets = (values != NULL ? createIntArray(env, &columnar->offsets) : NULL);
+
+    if (offsets == NULL) {
+        throwException(env, "Error creating parse result");
+        return NULL;
+    }
+
+    jobject result = (*env)->NewObject(env, parsedAddressBatchClass, parsedAddressBatchInit, records, labels, values, offsets);
+
+    (*env)->DeleteLocalRef(env, records);
+    (*env)->DeleteLocalRef(env, labels);
+    (*env)->DeleteLocalRef(env, values);
+    (*env)->DeleteLocalRef(env, offsets);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)Ljava/util/Map;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressUtf8
+  (JNIEnv *env, jclass cls, jbyteArray jarray, jobject jbuffer, jint offset, jint length) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_PARSE);
+
+    // get the UTF-8 bytes, no transcoding is done
+    utf8Input_t input;
+    const char *error = getUtf8Input(env, jarray, jbuffer, offset, length, &input);
+
+    if (error != NULL) {
+        throwException(env, error);
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    jobject resultMap = parseAddressWithOptions(env, input.data, &options, NULL);
+    metricsEnd(resultMap == NULL, input.data);
+
+    releaseUtf8Input(&input);
+
+    return resultMap;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressCompactUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)Lcom/dnebinger/postal4j/ParsedAddress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressCompactUtf8
+  (JNIEnv *env, jclass cls, jbyteArray jarray, jobject jbuffer, jint offset, jint length) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, MODULE_PARSER)) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_PARSE_COMPACT);
+
+    // get the UTF-8 bytes, no transcoding is done
+    utf8Input_t input;
+    const char *error = getUtf8Input(env, jarray, jbuffer, offset, length, &input);
+
+    if (error != NULL) {
+        throwException(env, error);
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+
+    columnarResult_t columnar;
+    initColumnarResult(&columnar);
+
+    jobject result = NULL;
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    if (parseAddressCompactWithOptions(env, input.data, &options, &columnar)) {
+        result = createParsedAddress(env, &columnar);
+    }
+
+    metricsEnd(result == NULL, input.data);
+
+    cleanupColumnarResult(&columnar);
+    releaseUtf8Input(&input);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressUtf8
+  (JNIEnv *env, jclass cls, jbyteArray jarray, jobject jbuffer, jint offset, jint length) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(0))) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_EXPAND);
+
+    // get the UTF-8 bytes, no transcoding is done
+    utf8Input_t input;
+    const char *error = getUtf8Input(env, jarray, jbuffer, offset, length, &input);
+
+    if (error != NULL) {
+        throwException(env, error);
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    jobjectArray resultArray = expandAddressWithOptions(env, input.data, &options);
+    metricsEnd(resultArray == NULL, input.data);
+
+    releaseUtf8Input(&input);
+
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandRootAddressUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddressUtf8
+  (JNIEnv *env, jclass cls, jbyteArray jarray, jobject jbuffer, jint offset, jint length) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(0))) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_EXPAND_ROOT);
+
+    // get the UTF-8 bytes, no transcoding is done
+    utf8Input_t input;
+    const char *error = getUtf8Input(env, jarray, jbuffer, offset, length, &input);
+
+    if (error != NULL) {
+        throwException(env, error);
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    jobjectArray resultArray = expandRootAddressWithOptions(env, input.data, &options);
+    metricsEnd(resultArray == NULL, input.data);
+
+    releaseUtf8Input(&input);
+
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressNative
+ * Signature: (Ljava/lang/String;)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressNative
+  (JNIEnv *env, jclass cls, jstring jaddress) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(0))) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_EXPAND);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // get the default normalize options
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    // expand the address
+    jobjectArray resultArray = expandAddressWithOptions(env, (char*)address, &options);
+    metricsEnd(resultArray == NULL, address);
+
+    // free the address string
+    releaseUtf8String(&addressString);
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Helper function to expand an address with options
+ * @param env the JNI environment
+ * @param address the address string
+ * @param options the normalize options
+ * @return the result array
+ */
+jobjectArray expandAddressWithOptions(JNIEnv *env, char* address, libpostal_normalize_options_t* options) {
+    // expand the address
+    size_t numExpansions;
+    char **expansions = cachedExpandAddress(address, *options, false, &numExpansions);
+    metricsStage(METRICS_STAGE_LIBPOSTAL);
+
+    if (expansions == NULL) {
+        throwException(env, "Error expanding address");
+        return NULL;
+    }
+
+    return createResultArray(env, expansions, numExpansions);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddress
+ * Signature: (Ljava/lang/String;[Ljava/lang/String;ZZZZZZZZZZZZZZZZZZI)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddress__Ljava_lang_String_2_3Ljava_lang_String_2ZZZZZZZZZZZZZZZZZZI
+  (JNIEnv *env, jclass cls, jstring jaddress, jobjectArray languages,
+   jboolean latinAscii, jboolean transliterate, jboolean stripAccents,
+   jboolean decompose, jboolean lowercase, jboolean trimString,
+   jboolean dropParentheticals, jboolean replaceNumericHyphens,
+   jboolean deleteNumericHyphens, jboolean splitAlphaFromNumeric,
+   jboolean replaceWordHyphens, jboolean deleteWordHyphens,
+   jboolean deleteFinalPeriods, jboolean deleteAcronymPeriods,
+   jboolean dropEnglishPossessives, jboolean deleteApostrophes,
+   jboolean expandNumex, jboolean romanNumerals, jint addressComponents) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, languageModules(env, languages))) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_EXPAND);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // create the normalize options struct
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+ 
+    updateNormalizeOptions(env, &options,languages, latinAscii, transliterate, stripAccents, decompose, lowercase, trimString,
+        dropParentheticals, replaceNumericHyphens, deleteNumericHyphens, splitAlphaFromNumeric, replaceWordHyphens, deleteWordHyphens, deleteFinalPeriods,
+        deleteAcronymPeriods, dropEnglishPossessives, deleteApostrophes, expandNumex, romanNumerals, addressComponents);
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    // expand the address
+    jobjectArray resultArray = expandAddressWithOptions(env, (char*)address, &options);
+    metricsEnd(resultArray == NULL, address);
+
+    // free the normalize options
+    cleanupNormalizeOptions(&options);
+
+    // free the address string
+    releaseUtf8String(&addressString);
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandRootAddressNative
+ * Signature: (Ljava/lang/String;)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddressNative
+  (JNIEnv *env, jclass cls, jstring jaddress) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(0))) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_EXPAND_ROOT);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // get the default normalize options
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    // expand the address
+    jobjectArray resultArray = expandRootAddressWithOptions(env, (char*)address, &options);
+    metricsEnd(resultArray == NULL, address);
+
+    // free the address string
+    releaseUtf8String(&addressString);
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Helper function to expand a root address with options
+ * @param env the JNI environment
+ * @param address the address string
+ * @param options the normalize options
+ * @return the result array
+ */
+jobjectArray expandRootAddressWithOptions(JNIEnv *env, char* address, libpostal_normalize_options_t* options) {
+    // expand the address
+    size_t numExpansions;
+    char **expansions = cachedExpandAddress(address, *options, true, &numExpansions);
+    metricsStage(METRICS_STAGE_LIBPOSTAL);
+
+    if (expansions == NULL) {
+        throwException(env, "Error expanding root address");
+        return NULL;
+    }
+
+    return createResultArray(env, expansions, numExpansions);
+}
+
+/*
+ * Helper function to create a result array
+ * @param env the JNI environment
+ * @param expansions the expansions
+ * @param numExpansions the number of expansions
+ * @return the result array
+ */
+jobjectArray createResultArray(JNIEnv *env, char** expansions, size_t numExpansions) {
+    // create the result array
+    jobjectArray resultArray = (*env)->NewObjectArray(env, numExpansions, stringClass, NULL);
+
+    if (resultArray == NULL) {
+        throwException(env, "Error creating result array");
+        libpostal_expansion_array_destroy(expansions, numExpansions);
+        return NULL;
+    }
+
+    // populate the result array
+    for (size_t i = 0; i < numExpansions; i++) {
+        // create new string for the expansion
+        jstring jexpansion = newStringFromUtf8(env, expansions[i]);
+
+        if (jexpansion == NULL) {
+            throwException(env, "Error creating expansion string");
+            // clean up previous allocations
+            for (size_t j = 0; j < i; j++) {
+                jstring jexpansion = (*env)->GetObjectArrayElement(env, resultArray, j);
+                (*env)->DeleteLocalRef(env, jexpansion);
+            }
+
+            (*env)->DeleteLocalRef(env, resultArray);
+
+            libpostal_expansion_array_destroy(expansions, numExpansions);
+            
+            return NULL;
+        }
+
+        // set the expansion in the result array
+        (*env)->SetObjectArrayElement(env, resultArray, i, jexpansion);
+        
+        // We can safely release the local reference now
+        (*env)->DeleteLocalRef(env, jexpansion);
+    }
+
+    // done with the expansions
+    libpostal_expansion_array_destroy(expansions, numExpansions);
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandRootAddress
+ * Signature: (Ljava/lang/String;[Ljava/lang/String;ZZZZZZZZZZZZZZZZZZI)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddress__Ljava_lang_String_2_3Ljava_lang_String_2ZZZZZZZZZZZZZZZZZZI
+  (JNIEnv *env, jclass cls, jstring jaddress, jobjectArray languages,
+   jboolean latinAscii, jboolean transliterate, jboolean stripAccents,
+   jboolean decompose, jboolean lowercase, jboolean trimString,
+   jboolean dropParentheticals, jboolean replaceNumericHyphens,
+   jboolean deleteNumericHyphens, jboolean splitAlphaFromNumeric,
+   jboolean replaceWordHyphens, jboolean deleteWordHyphens,
+   jboolean deleteFinalPeriods, jboolean deleteAcronymPeriods,
+   jboolean dropEnglishPossessives, jboolean deleteApostrophes,
+   jboolean expandNumex, jboolean romanNumerals, jint addressComponents) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, languageModules(env, languages))) {
+        return NULL;
+    }
+
+    metricsBegin(METRICS_EXPAND_ROOT);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    // create the normalize options
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    updateNormalizeOptions(env, &options, languages, latinAscii, transliterate, stripAccents, decompose, lowercase, trimString,
+        dropParentheticals, replaceNumericHyphens, deleteNumericHyphens, splitAlphaFromNumeric, replaceWordHyphens, deleteWordHyphens, deleteFinalPeriods,
+        deleteAcronymPeriods, dropEnglishPossessives, deleteApostrophes, expandNumex, romanNumerals, addressComponents);
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    // expand the address
+    jobjectArray resultArray = expandRootAddressWithOptions(env, (char*)address, &options);
+    metricsEnd(resultArray == NULL, address);
+
+    // free the address string
+    releaseUtf8String(&addressString);
+
+    // free the normalize options
+    cleanupNormalizeOptions(&options);
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultNormalizeFlags
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultNormalizeFlags
+  (JNIEnv *env, jclass cls) {
+
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    return normalizeOptionsFlags(&options);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultAddressComponents
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultAddressComponents
+  (JNIEnv *env, jclass cls) {
+
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+
+    return options.address_components;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    createNormalizeOptions
+ * Signature: ([Ljava/lang/String;II)J
+ */
+JNIEXPORT jlong JNICALL Java_com_dnebinger_postal4j_LibPostal_createNormalizeOptions
+  (JNIEnv *env, jclass cls, jobjectArray languages, jint flags, jint addressComponents) {
+
+    // the handle owns the struct and its language strings until destroyNormalizeOptions
+    libpostal_normalize_options_t *options = malloc(sizeof(libpostal_normalize_options_t));
+
+    if (options == NULL) {
+        throwException(env, "Error allocating normalize options");
+        return 0;
+    }
+
+    *options = libpostal_get_default_options();
+
+    updateNormalizeOptions(env, options, languages,
+        (flags & NORMALIZE_LATIN_ASCII) != 0,
+        (flags & NORMALIZE_TRANSLITERATE) != 0,
+        (flags & NORMALIZE_STRIP_ACCENTS) != 0,
+        (flags & NORMALIZE_DECOMPOSE) != 0,
+        (flags & NORMALIZE_LOWERCASE) != 0,
+        (flags & NORMALIZE_TRIM_STRING) != 0,
+        (flags & NORMALIZE_DROP_PARENTHETICALS) != 0,
+        (flags & NORMALIZE_REPLACE_NUMERIC_HYPHENS) != 0,
+        (flags & NORMALIZE_DELETE_NUMERIC_HYPHENS) != 0,
+        (flags & NORMALIZE_SPLIT_ALPHA_FROM_NUMERIC) != 0,
+        (flags & NORMALIZE_REPLACE_WORD_HYPHENS) != 0,
+        (flags & NORMALIZE_DELETE_WORD_HYPHENS) != 0,
+        (flags & NORMALIZE_DELETE_FINAL_PERIODS) != 0,
+        (flags & NORMALIZE_DELETE_ACRONYM_PERIODS) != 0,
+        (flags & NORMALIZE_DROP_ENGLISH_POSSESSIVES) != 0,
+        (flags & NORMALIZE_DELETE_APOSTROPHES) != 0,
+        (flags & NORMALIZE_EXPAND_NUMEX) != 0,
+        (flags & NORMALIZE_ROMAN_NUMERALS) != 0,
+        addressComponents);
+
+    return (jlong)(intptr_t)options;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    destroyNormalizeOptions
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_destroyNormalizeOptions
+  (JNIEnv *env, jclass cls, jlong handle) {
+
+    libpostal_normalize_options_t *options = (libpostal_normalize_options_t*)(intptr_t)handle;
+
+    if (options != NULL) {
+        cleanupNormalizeOptions(options);
+        free(options);
+    }
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressWithHandle
+ * Signature: (Ljava/lang/String;JZ)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressWithHandle
+  (JNIEnv *env, jclass cls, jstring jaddress, jlong handle, jboolean root) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, normalizeOptionsModules(handle))) {
+        return NULL;
+    }
+
+    libpostal_normalize_options_t *options = normalizeOptionsHandle(env, handle);
+
+    if (options == NULL) {
+        return NULL;
+    }
+
+    metricsBegin(root ? METRICS_EXPAND_ROOT : METRICS_EXPAND);
+
+    // extract the address from the JNI string
+    utf8String_t addressString;
+    const char *address = getUtf8String(env, jaddress, &addressString);
+
+    // check if the address is null
+    if (address == NULL) {
+        throwException(env, "Error extracting address");
+        metricsEnd(true, NULL);
+        return NULL;
+    }
+
+    metricsStage(METRICS_STAGE_INPUT);
+
+    // the options are used as-is, nothing is marshaled or allocated for them
+    jobjectArray resultArray = (root
+        ? expandRootAddressWithOptions(env, (char*)address, options)
+        : expandAddressWithOptions(env, (char*)address, options));
+    metricsEnd(resultArray == NULL, address);
+
+    // free the address string
+    releaseUtf8String(&addressString);
+
+    // return the result array
+    return resultArray;
+}
+
+/*
+ * Helper function to resolve a NormalizeOptions handle
+ * @param env the JNI environment
+ * @param handle the handle, 0 for the libpostal default options is not accepted here
+ * @return the options, or NULL if an exception was thrown
+ */
+libpostal_normalize_options_t* normalizeOptionsHandle(JNIEnv *env, jlong handle) {
+    if (handle == 0) {
+        throwException(env, "NormalizeOptions has been closed");
+        return NULL;
+    }
+
+    return (libpostal_normalize_options_t*)(intptr_t)handle;
+}
+
+/*
+ * Helper function to pack the boolean normalize options into NormalizeOptions flags
+ * @param options the normalize options
+ * @return the flags
+ */
+jint normalizeOptionsFlags(libpostal_normalize_options_t* options) {
+    jint flags = 0;
+
+    if (options->latin_ascii) flags |= NORMALIZE_LATIN_ASCII;
+    if (options->transliterate) flags |= NORMALIZE_TRANSLITERATE;
+    if (options->strip_accents) flags |= NORMALIZE_STRIP_ACCENTS;
+    if (options->decompose) flags |= NORMALIZE_DECOMPOSE;
+    if (options->lowercase) flags |= NORMALIZE_LOWERCASE;
+    if (options->trim_string) flags |= NORMALIZE_TRIM_STRING;
+    if (options->drop_parentheticals) flags |= NORMALIZE_DROP_PARENTHETICALS;
+    if (options->replace_numeric_hyphens) flags |= NORMALIZE_REPLACE_NUMERIC_HYPHENS;
+    if (options->delete_numeric_hyphens) flags |= NORMALIZE_DELETE_NUMERIC_HYPHENS;
+    if (options->split_alpha_from_numeric) flags |= NORMALIZE_SPLIT_ALPHA_FROM_NUMERIC;
+    if (options->replace_word_hyphens) flags |= NORMALIZE_REPLACE_WORD_HYPHENS;
+    if (options->delete_word_hyphens) flags |= NORMALIZE_DELETE_WORD_HYPHENS;
+    if (options->delete_final_periods) flags |= NORMALIZE_DELETE_FINAL_PERIODS;
+    if (options->delete_acronym_periods) flags |= NORMALIZE_DELETE_ACRONYM_PERIODS;
+    if (options->drop_english_possessives) flags |= NORMALIZE_DROP_ENGLISH_POSSESSIVES;
+    if (options->delete_apostrophes) flags |= NORMALIZE_DELETE_APOSTROPHES;
+    if (options->expand_numex) flags |= NORMALIZE_EXPAND_NUMEX;
+    if (options->roman_numerals) flags |= NORMALIZE_ROMAN_NUMERALS;
+
+    return flags;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultNearDupeHashFlags
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultNearDupeHashFlags
+  (JNIEnv *env, jclass cls) {
+
+    libpostal_near_dupe_hash_options_t options = libpostal_get_near_dupe_hash_default_options();
+
+    return nearDupeHashFlags(&options);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultGeohashPrecision
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultGeohashPrecision
+  (JNIEnv *env, jclass cls) {
+
+    libpostal_near_dupe_hash_options_t options = libpostal_get_near_dupe_hash_default_options();
+
+    return (jint)options.geohash_precision;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    nearDupeHashesNative
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;IIDD)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_nearDupeHashesNative
+  (JNIEnv *env, jclass cls, jobjectArray jlabels, jobjectArray jvalues, jobjectArray jlanguages, jint flags, jint geohashPrecision,
+   jdouble latitude, jdouble longitude) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return NULL;
+    }
+
+    componentList_t components;
+    stringBatch_t languageStrings;
+    char **languages = NULL;
+    size_t numLanguages = 0;
+    jobjectArray resultArray = NULL;
+
+    bufferInit(&languageStrings.data);
+    languageStrings.offsets = NULL;
+    languageStrings.count = 0;
+
+    if (loadComponents(env, jlabels, jvalues, &components)
+            && loadLanguages(env, jlanguages, &languageStrings, &languages, &numLanguages)) {
+        size_t numHashes = 0;
+        char **hashes = nearDupeHashes(components.count, components.labels, components.values, nearDupeHashOptions(flags, geohashPrecision),
+            latitude, longitude, numLanguages, languages, &numHashes);
+
+        // createResultArray frees the hashes, a NULL result just means no hashes
+        resultArray = createResultArray(env, hashes, (hashes != NULL ? numHashes : 0));
+    }
+
+    free(languages);
+    cleanupComponents(&components);
+    cleanupStringBatch(&languageStrings);
+
+    return resultArray;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    nearDupeNameHashesNative
+ * Signature: (Ljava/lang/String;J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_nearDupeNameHashesNative
+  (JNIEnv *env, jclass cls, jstring jname, jlong handle) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, normalizeOptionsModules(handle))) {
+        return NULL;
+    }
+
+    utf8String_t nameString;
+    const char *name = getUtf8String(env, jname, &nameString);
+
+    if (name == NULL) {
+        throwException(env, "Error extracting name");
+        return NULL;
+    }
+
+    // a 0 handle selects the libpostal default normalize options
+    libpostal_normalize_options_t options = (handle != 0 ? *(libpostal_normalize_options_t*)(intptr_t)handle : libpostal_get_default_options());
+
+    size_t numHashes = 0;
+    char **hashes = libpostal_near_dupe_name_hashes((char*)name, options, &numHashes);
+
+    releaseUtf8String(&nameString);
+
+    return createResultArray(env, hashes, (hashes != NULL ? numHashes : 0));
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    nearDupeHashBatch
+ * Signature: ([I[B[B[I[D[D[Ljava/lang/String;II)Lcom/dnebinger/postal4j/NearDupeHashBatch;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_nearDupeHashBatch
+  (JNIEnv *env, jclass cls, jintArray jrecordOffsets, jbyteArray jlabels, jbyteArray jvalues, jintArray jvalueOffsets,
+   jdoubleArray jlatitudes, jdoubleArray jlongitudes, jobjectArray jlanguages, jint flags, jint geohashPrecision) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return NULL;
+    }
+
+    nearDupeBatch_t batch;
+    memset(&batch, 0, sizeof(nearDupeBatch_t));
+    bufferInit(&batch.valueData);
+    bufferInit(&batch.languageStrings.data);
+
+    batch.options = nearDupeHashOptions(flags, geohashPrecision);
+
+    jobject result = NULL;
+
+    if (loadNearDupeBatch(env, jrecordOffsets, jlabels, jvalues, jvalueOffsets, jlatitudes, jlongitudes, &batch)
+            && loadLanguages(env, jlanguages, &batch.languageStrings, &batch.languages, &batch.numLanguages)) {
+        // hash every record on the pool, then pack the hashes on this thread
+        poolRun(batch.numRecords, nearDupeBatchTask, &batch);
+
+        result = createNearDupeHashBatch(env, &batch);
+    }
+
+    cleanupNearDupeBatch(&batch);
+
+    return result;
+}
+
+/*
+ * Helper function to build near dupe hash options from NearDupeHashOptions flags
+ * @param flags the flags
+ * @param geohashPrecision the geohash precision
+ * @return the options, without a latitude/longitude
+ */
+libpostal_near_dupe_hash_options_t nearDupeHashOptions(jint flags, jint geohashPrecision) {
+    libpostal_near_dupe_hash_options_t options = libpostal_get_near_dupe_hash_default_options();
+
+    options.with_name = (flags & NEAR_DUPE_WITH_NAME) != 0;
+    options.with_address = (flags & NEAR_DUPE_WITH_ADDRESS) != 0;
+    options.with_unit = (flags & NEAR_DUPE_WITH_UNIT) != 0;
+    options.with_city_or_equivalent = (flags & NEAR_DUPE_WITH_CITY_OR_EQUIVALENT) != 0;
+    options.with_small_containing_boundaries = (flags & NEAR_DUPE_WITH_SMALL_CONTAINING_BOUNDARIES) != 0;
+    options.with_postal_code = (flags & NEAR_DUPE_WITH_POSTAL_CODE) != 0;
+    options.with_latlon = (flags & NEAR_DUPE_WITH_LATLON) != 0;
+    options.name_and_address_keys = (flags & NEAR_DUPE_NAME_AND_ADDRESS_KEYS) != 0;
+    options.name_only_keys = (flags & NEAR_DUPE_NAME_ONLY_KEYS) != 0;
+    options.address_only_keys = (flags & NEAR_DUPE_ADDRESS_ONLY_KEYS) != 0;
+    options.geohash_precision = (uint32_t)geohashPrecision;
+
+    return options;
+}
+
+/*
+ * Helper function to pack the boolean near dupe hash options into NearDupeHashOptions flags
+ * @param options the near dupe hash options
+ * @return the flags
+ */
+jint nearDupeHashFlags(libpostal_near_dupe_hash_options_t* options) {
+    jint flags = 0;
+
+    if (options->with_name) flags |= NEAR_DUPE_WITH_NAME;
+    if (options->with_address) flags |= NEAR_DUPE_WITH_ADDRESS;
+    if (options->with_unit) flags |= NEAR_DUPE_WITH_UNIT;
+    if (options->with_city_or_equivalent) flags |= NEAR_DUPE_WITH_CITY_OR_EQUIVALENT;
+    if (options->with_small_containing_boundaries) flags |= NEAR_DUPE_WITH_SMALL_CONTAINING_BOUNDARIES;
+    if (options->with_postal_code) flags |= NEAR_DUPE_WITH_POSTAL_CODE;
+    if (options->with_latlon) flags |= NEAR_DUPE_WITH_LATLON;
+    if (options->name_and_address_keys) flags |= NEAR_DUPE_NAME_AND_ADDRESS_KEYS;
+    if (options->name_only_keys) flags |= NEAR_DUPE_NAME_ONLY_KEYS;
+    if (options->address_only_keys) flags |= NEAR_DUPE_ADDRESS_ONLY_KEYS;
+
+    return flags;
+}
+
+/*
+ * Helper function to load an optional language array as libpostal language pointers
+ * @param env the JNI environment
+ * @param jlanguages the languages, or NULL
+ * @param strings the string batch holding the languages, release it with cleanupStringBatch
+ * @param languages set to the language pointers (into strings), free it with free
+ * @param numLanguages set to the number of languages
+ * @return true on success, false if an exception was thrown
+ */
+bool loadLanguages(JNIEnv *env, jobjectArray jlanguages, stringBatch_t* strings, char*** languages, size_t* numLanguages) {
+    *languages = NULL;
+    *numLanguages = 0;
+
+    if (!loadStringBatch(env, jlanguages, false, strings)) {
+        return false;
+    }
+
+    if (strings->count == 0) {
+        return true;
+    }
+
+    *languages = malloc(strings->count * sizeof(char*));
+
+    if (*languages == NULL) {
+        throwException(env, "Error allocating languages");
+        return false;
+    }
+
+    for (size_t i = 0; i < strings->count; i++) {
+        (*languages)[i] = stringBatchGet(strings, i);
+    }
+
+    *numLanguages = strings->count;
+
+    return true;
+}
+
+/*
+ * Helper function to compute the near dupe hashes of one record
+ * @param numComponents the number of components
+ * @param labels the component labels
+ * @param values the component values
+ * @param options the near dupe hash options
+ * @param latitude the latitude, NaN for none
+ * @param longitude the longitude, NaN for none
+ * @param numLanguages the number of languages, 0 to let libpostal classify them
+ * @param languages the languages
+ * @param numHashes set to the number of hashes
+ * @return the hashes, or NULL if there are none
+ */
+char** nearDupeHashes(size_t numComponents, char** labels, char** values, libpostal_near_dupe_hash_options_t options,
+    double latitude, double longitude, size_t numLanguages, char** languages, size_t* numHashes) {
+
+    // geohashes only for records that actually have coordinates
+    if (options.with_latlon && !isnan(latitude) && !isnan(longitude)) {
+        options.latitude = latitude;
+        options.longitude = longitude;
+    } else {
+        options.with_latlon = false;
+    }
+
+    *numHashes = 0;
+
+    if (numLanguages > 0) {
+        return libpostal_near_dupe_hashes_languages(numComponents, labels, values, options, numLanguages, languages, numHashes);
+    }
+
+    return libpostal_near_dupe_hashes(numComponents, labels, values, options, numHashes);
+}
+
+/*
+ * Helper function to copy flat near dupe input out of the Java arrays and validate it
+ * @param env the JNI environment
+ * @param jrecordOffsets the index of the first component of each record, plus the component count
+ * @param jlabels the component labels as AddressLabel ordinals
+ * @param jvalues the packed UTF-8 component values
+ * @param jvalueOffsets the start of each value in jvalues, plus the end of the last one
+ * @param jlatitudes the per-record latitudes, or NULL
+ * @param jlongitudes the per-record longitudes, or NULL
+ * @param batch the batch to populate, always release it with cleanupNearDupeBatch
+ * @return true on success, false if an exception was thrown
+ */
+bool loadNearDupeBatch(JNIEnv *env, jintArray jrecordOffsets, jbyteArray jlabels, jbyteArray jvalues, jintArray jvalueOffsets,
+    jdoubleArray jlatitudes, jdoubleArray jlongitudes, nearDupeBatch_t* batch) {
+
+    if (jrecordOffsets == NULL || jlabels == NULL || jvalues == NULL || jvalueOffsets == NULL) {
+        throwException(env, "Record offsets, labels, values and value offsets must not be null");
+        return false;
+    }
+
+    jsize numRecordOffsets = (*env)->GetArrayLength(env, jrecordOffsets);
+    jsize numComponents = (*env)->GetArrayLength(env, jlabels);
+    jsize valuesLength = (*env)->GetArrayLength(env, jvalues);
+
+    if (numRecordOffsets < 1 || (*env)->GetArrayLength(env, jvalueOffsets) != numComponents + 1) {
+        throwException(env, "Record offsets need one entry per record plus one, value offsets one per label plus one");
+        return false;
+    }
+
+    size_t numRecords = (size_t)numRecordOffsets - 1;
+
+    if ((jlatitudes == NULL) != (jlongitudes == NULL)
+            || (jlatitudes != NULL && ((*env)->GetArrayLength(env, jlatitudes) != (jsize)numRecords
+                || (*env)->GetArrayLength(env, jlongitudes) != (jsize)numRecords))) {
+        throwException(env, "Latitudes and longitudes must both be null or have one entry per record");
+        return false;
+    }
+
+    batch->numRecords = numRecords;
+    batch->recordOffsets = malloc((size_t)numRecordOffsets * sizeof(jint));
+    batch->labels = malloc(((size_t)numComponents + 1) * sizeof(char*));
+    batch->values = malloc(((size_t)numComponents + 1) * sizeof(char*));
+    batch->hashes = calloc(numRecords + 1, sizeof(char**));
+    batch->numHashes = calloc(numRecords + 1, sizeof(size_t));
+
+    jint *valueOffsets = malloc(((size_t)numComponents + 1) * sizeof(jint));
+    jbyte *labelOrdinals = malloc((size_t)numComponents + 1);
+
+    if (jlatitudes != NULL) {
+        batch->latitudes = malloc((numRecords + 1) * sizeof(jdouble));
+        batch->longitudes = malloc((numRecords + 1) * sizeof(jdouble));
+    }
+
+    bool ok = batch->recordOffsets != NULL && batch->labels != NULL && batch->values != NULL && batch->hashes != NULL
+        && batch->numHashes != NULL && valueOffsets != NULL && labelOrdinals != NULL
+        && (jlatitudes == NULL || (batch->latitudes != NULL && batch->longitudes != NULL))
+        && bufferReserve(&batch->valueData, (size_t)valuesLength + (size_t)numComponents);
+
+    if (!ok) {
+        free(valueOffsets);
+        free(labelOrdinals);
+        throwException(env, "Error allocating near dupe hash batch");
+        return false;
+    }
+
+    (*env)->GetIntArrayRegion(env, jrecordOffsets, 0, numRecordOffsets, batch->recordOffsets);
+    (*env)->GetIntArrayRegion(env, jvalueOffsets, 0, numComponents + 1, valueOffsets);
+    (*env)->GetByteArrayRegion(env, jlabels, 0, numComponents, labelOrdinals);
+
+    if (jlatitudes != NULL) {
+        (*env)->GetDoubleArrayRegion(env, jlatitudes, 0, (jsize)numRecords, batch->latitudes);
+        (*env)->GetDoubleArrayRegion(env, jlongitudes, 0, (jsize)numRecords, batch->longitudes);
+    }
+
+    // records must cover the components in order
+    for (size_t i = 0; ok && i < numRecords; i++) {
+        ok = batch->recordOffsets[i] >= 0 && batch->recordOffsets[i] <= batch->recordOffsets[i + 1]
+            && batch->recordOffsets[i + 1] <= numComponents;
+    }
+
+    if (!ok) {
+        free(valueOffsets);
+        free(labelOrdinals);
+        throwException(env, "Record offsets must be ascending and within the labels");
+        return false;
+    }
+
+    for (jsize i = 0; ok && i < numComponents; i++) {
+        ok = labelOrdinals[i] >= 0 && labelOrdinals[i] < NUM_ADDRESS_LABELS && valueOffsets[i] >= 0
+            && valueOffsets[i] <= valueOffsets[i + 1] && valueOffsets[i + 1] <= valuesLength;
+    }
+
+    if (!ok) {
+        free(valueOffsets);
+        free(labelOrdinals);
+        throwException(env, "Invalid address label ordinal or value offsets");
+        return false;
+    }
+
+    // copy each value NUL-terminated, the values array is pinned only for the copy loop
+    jbyte *values = (*env)->GetPrimitiveArrayCritical(env, jvalues, NULL);
+
+    if (values == NULL) {
+        free(valueOffsets);
+        free(labelOrdinals);
+        throwException(env, "Error reading values");
+        return false;
+    }
+
+    char *target = batch->valueData.data;
+
+    for (jsize i = 0; i < numComponents; i++) {
+        size_t length = (size_t)(valueOffsets[i + 1] - valueOffsets[i]);
+
+        memcpy(target, values + valueOffsets[i], length);
+        target[length] = '\0';
+
+        batch->labels[i] = (char*)addressLabelName(labelOrdinals[i]);
+        batch->values[i] = target;
+        target += length + 1;
+    }
+
+    (*env)->ReleasePrimitiveArrayCritical(env, jvalues, values, JNI_ABORT);
+
+    batch->valueData.length = (size_t)(target - batch->valueData.data);
+
+    free(valueOffsets);
+    free(labelOrdinals);
+
+    return true;
+}
+
+/*
+ * Pool task that hashes one record of a batch into its hash slot
+ * @param index the record index
+ * @param context the near dupe batch
+ */
+void nearDupeBatchTask(size_t index, void* context) {
+    nearDupeBatch_t *batch = (nearDupeBatch_t*)context;
+    size_t first = (size_t)batch->recordOffsets[index];
+    size_t count = (size_t)batch->recordOffsets[index + 1] - first;
+
+    batch->hashes[index] = nearDupeHashes(count, batch->labels + first, batch->values + first, batch->options,
+        batch->latitudes != NULL ? batch->latitudes[index] : NAN, batch->longitudes != NULL ? batch->longitudes[index] : NAN,
+        batch->numLanguages, batch->languages, &batch->numHashes[index]);
+}
+
+/*
+ * Helper function to free a near dupe batch and any hashes still in it
+ * @param batch the batch
+ */
+void cleanupNearDupeBatch(nearDupeBatch_t* batch) {
+    if (batch->hashes != NULL) {
+        for (size_t i = 0; i < batch->numRecords; i++) {
+            if (batch->hashes[i] != NULL) {
+                libpostal_expansion_array_destroy(batch->hashes[i], batch->numHashes[i]);
+            }
+        }
+    }
+
+    free(batch->hashes);
+    free(batch->numHashes);
+    free(batch->recordOffsets);
+    free(batch->labels);
+    free(batch->values);
+    free(batch->latitudes);
+    free(batch->longitudes);
+    free(batch->languages);
+    bufferFree(&batch->valueData);
+    cleanupStringBatch(&batch->languageStrings);
+    memset(batch, 0, sizeof(nearDupeBatch_t));
+}
+
+/*
+ * Helper function to pack the hashes of a batch into a NearDupeHashBatch in record order
+ * @param env the JNI environment
+ * @param batch the near dupe batch
+ * @return the hash batch, or NULL if an exception was thrown
+ */
+jobject createNearDupeHashBatch(JNIEnv *env, nearDupeBatch_t* batch) {
+    nativeBuffer_t records;
+    nativeBuffer_t hashes;
+    nativeBuffer_t offsets;
+    bufferInit(&records);
+    bufferInit(&hashes);
+    bufferInit(&offsets);
+
+    size_t numHashes = 0;
+    bool ok = true;
+
+    for (size_t i = 0; ok && i < batch->numRecords; i++) {
+        ok = bufferAppendInt(&records, (int32_t)numHashes);
+
+        for (size_t j = 0; ok && batch->hashes[i] != NULL && j < batch->numHashes[i]; j++) {
+            size_t length = strlen(batch->hashes[i][j]);
+
+            // offsets are Java ints, so the packed hashes have to stay below 2GB
+            ok = hashes.length + length <= INT32_MAX && bufferAppendInt(&offsets, (int32_t)hashes.length)
+                && bufferAppend(&hashes, batch->hashes[i][j], length);
+            numHashes++;
+        }
+    }
+
+    ok = ok && bufferAppendInt(&records, (int32_t)numHashes) && bufferAppendInt(&offsets, (int32_t)hashes.length);
+
+    jobject result = NULL;
+
+    if (!ok) {
+        throwException(env, "Error allocating near dupe hash result");
+    } else {
+        jintArray jrecords = createIntArray(env, &records);
+        jbyteArray jhashes = (jrecords != NULL ? createByteArray(env, &hashes) : NULL);
+        jintArray joffsets = (jhashes != NULL ? createIntArray(env, &offsets) : NULL);
+
+        if (joffsets == NULL) {
+            throwException(env, "Error creating near dupe hash result");
+        } else {
+            result = (*env)->NewObject(env, nearDupeHashBatchClass, nearDupeHashBatchInit, jrecords, jhashes, joffsets);
+        }
+
+        (*env)->DeleteLocalRef(env, jrecords);
+        (*env)->DeleteLocalRef(env, jhashes);
+        (*env)->DeleteLocalRef(env, joffsets);
+    }
+
+    bufferFree(&records);
+    bufferFree(&hashes);
+    bufferFree(&offsets);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    openBlockingIndex
+ * Signature: (Ljava/lang/String;[Ljava/lang/String;II)J
+ */
+JNIEXPORT jlong JNICALL Java_com_dnebinger_postal4j_LibPostal_openBlockingIndex
+  (JNIEnv *env, jclass cls, jstring jpath, jobjectArray jlanguages, jint flags, jint geohashPrecision) {
+
+    if (jpath == NULL) {
+        throwException(env, "Index path must not be null");
+        return 0;
+    }
+
+    indexHandle_t *handle = calloc(1, sizeof(indexHandle_t));
+
+    if (handle == NULL) {
+        throwException(env, "Error allocating index");
+        return 0;
+    }
+
+    handle->options = nearDupeHashOptions(flags, geohashPrecision);
+
+    if (!loadLanguages(env, jlanguages, &handle->languageStrings, &handle->languages, &handle->numLanguages)) {
+        cleanupIndexHandle(handle);
+        return 0;
+    }
+
+    // the options are stored with the index, reopening it with other options would query with keys it never had
+    char meta[INDEX_MAX_META];
+    int length = snprintf(meta, sizeof(meta), "flags=%d geohashPrecision=%d languages=", (int)flags, (int)geohashPrecision);
+
+    for (size_t i = 0; i < handle->numLanguages && length > 0 && (size_t)length < sizeof(meta); i++) {
+        length += snprintf(meta + length, sizeof(meta) - (size_t)length, "%s%s", (i > 0 ? "," : ""), handle->languages[i]);
+    }
+
+    if (length < 0 || (size_t)length >= sizeof(meta)) {
+        throwException(env, "Too many index languages");
+        cleanupIndexHandle(handle);
+        return 0;
+    }
+
+    const char *path = (*env)->GetStringUTFChars(env, jpath, NULL);
+
+    if (path == NULL) {
+        throwException(env, "Error extracting index path");
+        cleanupIndexHandle(handle);
+        return 0;
+    }
+
+    const char *error = indexOpen(path, meta, &handle->index);
+
+    (*env)->ReleaseStringUTFChars(env, jpath, path);
+
+    if (error != NULL) {
+        throwException(env, error);
+        cleanupIndexHandle(handle);
+        return 0;
+    }
+
+    return (jlong)(intptr_t)handle;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    closeBlockingIndex
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_closeBlockingIndex
+  (JNIEnv *env, jclass cls, jlong jhandle) {
+
+    if (jhandle == 0) {
+        return;
+    }
+
+    indexHandle_t *handle = (indexHandle_t*)(intptr_t)jhandle;
+    const char *error = indexClose(handle->index);
+
+    handle->index = NULL;
+    cleanupIndexHandle(handle);
+
+    if (error != NULL) {
+        throwException(env, error);
+    }
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    flushBlockingIndex
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_flushBlockingIndex
+  (JNIEnv *env, jclass cls, jlong jhandle) {
+
+    indexHandle_t *handle = indexHandle(env, jhandle);
+
+    if (handle == NULL) {
+        return;
+    }
+
+    const char *error = indexFlush(handle->index);
+
+    if (error != NULL) {
+        throwException(env, error);
+    }
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexStats
+ * Signature: (J)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexStats
+  (JNIEnv *env, jclass cls, jlong jhandle) {
+
+    indexHandle_t *handle = indexHandle(env, jhandle);
+
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    indexStats_t stats;
+    indexGetStats(handle->index, &stats);
+
+    jlong values[4] = { (jlong)stats.records, (jlong)stats.keys, (jlong)stats.postings, (jlong)stats.fileBytes };
+    jlongArray result = (*env)->NewLongArray(env, 4);
+
+    if (result == NULL) {
+        throwException(env, "Error creating result array");
+        return NULL;
+    }
+
+    (*env)->SetLongArrayRegion(env, result, 0, 4, values);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexAdd
+ * Signature: (JJ[Ljava/lang/String;[Ljava/lang/String;DD)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexAdd
+  (JNIEnv *env, jclass cls, jlong jhandle, jlong id, jobjectArray jlabels, jobjectArray jvalues, jdouble latitude, jdouble longitude) {
+
+    LIFECYCLE_CALL;
+
+    indexHandle_t *handle = indexHandle(env, jhandle);
+
+    if (handle == NULL || !requireModules(env, indexModules(handle))) {
+        return;
+    }
+
+    size_t numHashes = 0;
+    bool ok = false;
+    char **hashes = indexRecordHashes(env, handle, jlabels, jvalues, latitude, longitude, &numHashes, &ok);
+
+    if (ok) {
+        int64_t recordId = (int64_t)id;
+        const char *error = indexAdd(handle->index, 1, &recordId, &hashes, &numHashes);
+
+        if (error != NULL) {
+            throwException(env, error);
+        }
+    }
+
+    if (hashes != NULL) {
+        libpostal_expansion_array_destroy(hashes, numHashes);
+    }
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexAddBatch
+ * Signature: (J[J[I[B[B[I[D[D)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexAddBatch
+  (JNIEnv *env, jclass cls, jlong jhandle, jlongArray jids, jintArray jrecordOffsets, jbyteArray jlabels, jbyteArray jvalues,
+   jintArray jvalueOffsets, jdoubleArray jlatitudes, jdoubleArray jlongitudes) {
+
+    LIFECYCLE_CALL;
+
+    indexHandle_t *handle = indexHandle(env, jhandle);
+
+    if (handle == NULL || !requireModules(env, indexModules(handle))) {
+        return;
+    }
+
+    if (jids == NULL || jrecordOffsets == NULL
+            || (*env)->GetArrayLength(env, jids) + 1 != (*env)->GetArrayLength(env, jrecordOffsets)) {
+        throwException(env, "Ids must not be null and must have one entry per record");
+        return;
+    }
+
+    nearDupeBatch_t batch;
+    memset(&batch, 0, sizeof(nearDupeBatch_t));
+    bufferInit(&batch.valueData);
+    bufferInit(&batch.languageStrings.data);
+
+    batch.options = handle->options;
+
+    if (loadNearDupeBatch(env, jrecordOffsets, jlabels, jvalues, jvalueOffsets, jlatitudes, jlongitudes, &batch)) {
+        int64_t *ids = malloc((batch.numRecords + 1) * sizeof(int64_t));
+
+        if (ids == NULL) {
+            throwException(env, "Error allocating ids");
+        } else {
+            (*env)->GetLongArrayRegion(env, jids, 0, (jsize)batch.numRecords, (jlong*)ids);
+
+            // the index's languages are borrowed for the hashing, the batch must not free them
+            batch.languages = handle->languages;
+            batch.numLanguages = handle->numLanguages;
+
+            // hash every record on the pool, then append them all under one index lock
+            poolRun(batch.numRecords, nearDupeBatchTask, &batch);
+
+            batch.languages = NULL;
+
+            const char *error = indexAdd(handle->index, batch.numRecords, ids, batch.hashes, batch.numHashes);
+
+            if (error != NULL) {
+                throwException(env, error);
+            }
+
+            free(ids);
+        }
+    }
+
+    cleanupNearDupeBatch(&batch);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexQuery
+ * Signature: (J[Ljava/lang/String;[Ljava/lang/String;DDI)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexQuery
+  (JNIEnv *env, jclass cls, jlong jhandle, jobjectArray jlabels, jobjectArray jvalues, jdouble latitude, jdouble longitude,
+   jint maxPostings) {
+
+    LIFECYCLE_CALL;
+
+    indexHandle_t *handle = indexHandle(env, jhandle);
+
+    if (handle == NULL || !requireModules(env, indexModules(handle))) {
+        return NULL;
+    }
+
+    size_t numHashes = 0;
+    bool ok = false;
+    char **hashes = indexRecordHashes(env, handle, jlabels, jvalues, latitude, longitude, &numHashes, &ok);
+    jlongArray result = NULL;
+
+    if (ok) {
+        int64_t *ids = NULL;
+        size_t numIds = 0;
+        const char *error = indexQuery(handle->index, hashes, (hashes != NULL ? numHashes : 0),
+            (size_t)(maxPostings > 0 ? maxPostings : 0), &ids, &numIds);
+
+        if (error != NULL) {
+            throwException(env, error);
+        } else if (numIds > INT32_MAX || (result = (*env)->NewLongArray(env, (jsize)numIds)) == NULL) {
+            throwException(env, "Error creating result array");
+        } else if (numIds > 0) {
+            (*env)->SetLongArrayRegion(env, result, 0, (jsize)numIds, (jlong*)ids);
+        }
+
+        free(ids);
+    }
+
+    if (hashes != NULL) {
+        libpostal_expansion_array_destroy(hashes, numHashes);
+    }
+
+    return result;
+}
+
+/*
+ * Helper function to resolve a BlockingIndex handle
+ * @param env the JNI environment
+ * @param handle the handle
+ * @return the index handle, or NULL if an exception was thrown
+ */
+indexHandle_t* indexHandle(JNIEnv *env, jlong handle) {
+    if (handle == 0) {
+        throwException(env, "BlockingIndex has been closed");
+        return NULL;
+    }
+
+    return (indexHandle_t*)(intptr_t)handle;
+}
+
+/*
+ * Helper function to get the modules an index needs to hash records
+ * @param handle the index handle
+ * @return the modules
+ */
+jint indexModules(indexHandle_t* handle) {
+    return handle->numLanguages > 0 ? MODULE_EXPANSION : (MODULE_EXPANSION | MODULE_CLASSIFIER);
+}
+
+/*
+ * Helper function to compute the blocking keys of one record with an index's options
+ * @param env the JNI environment
+ * @param handle the index handle
+ * @param jlabels the component labels
+ * @param jvalues the component values
+ * @param latitude the latitude, NaN for none
+ * @param longitude the longitude, NaN for none
+ * @param numHashes set to the number of hashes
+ * @param ok set to false if an exception was thrown
+ * @return the hashes, or NULL if there are none, free them with libpostal_expansion_array_destroy
+ */
+char** indexRecordHashes(JNIEnv *env, indexHandle_t* handle, jobjectArray jlabels, jobjectArray jvalues, jdouble latitude,
+    jdouble longitude, size_t* numHashes, bool* ok) {
+
+    componentList_t components;
+    char **hashes = NULL;
+
+    *numHashes = 0;
+    *ok = loadComponents(env, jlabels, jvalues, &components);
+
+    if (*ok) {
+        hashes = nearDupeHashes(components.count, components.labels, components.values, handle->options, latitude, longitude,
+            handle->numLanguages, handle->languages, numHashes);
+    }
+
+    cleanupComponents(&components);
+
+    return hashes;
+}
+
+/*
+ * Helper function to free an index handle, the index itself must already be closed
+ * @param handle the index handle
+ */
+void cleanupIndexHandle(indexHandle_t* handle) {
+    free(handle->languages);
+    cleanupStringBatch(&handle->languageStrings);
+    free(handle);
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isDuplicateNative
+ * Signature: (ILjava/lang/String;Ljava/lang/String;[Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_isDuplicateNative
+  (JNIEnv *env, jclass cls, jint component, jstring jvalue1, jstring jvalue2, jobjectArray jlanguages) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return LIBPOSTAL_NULL_DUPLICATE_STATUS;
+    }
+
+    duplicateFunction_t compare = duplicateFunction(env, component);
+
+    if (compare == NULL) {
+        return LIBPOSTAL_NULL_DUPLICATE_STATUS;
+    }
+
+    // a missing value can't be compared
+    if (jvalue1 == NULL || jvalue2 == NULL) {
+        return LIBPOSTAL_NULL_DUPLICATE_STATUS;
+    }
+
+    stringBatch_t languageStrings;
+    char **languages = NULL;
+    size_t numLanguages = 0;
+    jint status = LIBPOSTAL_NULL_DUPLICATE_STATUS;
+
+    if (loadLanguages(env, jlanguages, &languageStrings, &languages, &numLanguages)) {
+        utf8String_t value1String;
+        utf8String_t value2String;
+        const char *value1 = getUtf8String(env, jvalue1, &value1String);
+        const char *value2 = (value1 != NULL ? getUtf8String(env, jvalue2, &value2String) : NULL);
+
+        if (value2 == NULL) {
+            throwException(env, "Error extracting values");
+        } else {
+            status = compare((char*)value1, (char*)value2, libpostal_get_duplicate_options_with_languages(numLanguages, languages));
+        }
+
+        if (value1 != NULL) {
+            releaseUtf8String(&value1String);
+        }
+        if (value2 != NULL) {
+            releaseUtf8String(&value2String);
+        }
+    }
+
+    free(languages);
+    cleanupStringBatch(&languageStrings);
+
+    return status;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isToponymDuplicateNative
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_isToponymDuplicateNative
+  (JNIEnv *env, jclass cls, jobjectArray jlabels1, jobjectArray jvalues1, jobjectArray jlabels2, jobjectArray jvalues2,
+   jobjectArray jlanguages) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return LIBPOSTAL_NULL_DUPLICATE_STATUS;
+    }
+
+    componentList_t components1;
+    componentList_t components2;
+    stringBatch_t languageStrings;
+    char **languages = NULL;
+    size_t numLanguages = 0;
+    jint status = LIBPOSTAL_NULL_DUPLICATE_STATUS;
+
+    memset(&components2, 0, sizeof(componentList_t));
+    memset(&languageStrings, 0, sizeof(stringBatch_t));
+
+    if (loadComponents(env, jlabels1, jvalues1, &components1) && loadComponents(env, jlabels2, jvalues2, &components2)
+            && loadLanguages(env, jlanguages, &languageStrings, &languages, &numLanguages)) {
+        status = libpostal_is_toponym_duplicate(components1.count, components1.labels, components1.values,
+            components2.count, components2.labels, components2.values,
+            libpostal_get_duplicate_options_with_languages(numLanguages, languages));
+    }
+
+    free(languages);
+    cleanupComponents(&components1);
+    cleanupComponents(&components2);
+    cleanupStringBatch(&languageStrings);
+
+    return status;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isDuplicateBatch
+ * Signature: (I[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_dnebinger_postal4j_LibPostal_isDuplicateBatch
+  (JNIEnv *env, jclass cls, jint component, jobjectArray jleft, jobjectArray jright, jobjectArray jlanguages) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return NULL;
+    }
+
+    if (jleft == NULL || jright == NULL || (*env)->GetArrayLength(env, jleft) != (*env)->GetArrayLength(env, jright)) {
+        throwException(env, "Left and right values must not be null and must have the same length");
+        return NULL;
+    }
+
+    duplicateBatch_t batch;
+    memset(&batch, 0, sizeof(duplicateBatch_t));
+
+    jbyteArray result = NULL;
+
+    // null elements are missing values, compared as LIBPOSTAL_NULL_DUPLICATE_STATUS
+    batch.compare = duplicateFunction(env, component);
+
+    if (batch.compare != NULL && loadStringBatch(env, jleft, true, &batch.left) && loadStringBatch(env, jright, true, &batch.right)) {
+        result = runDuplicateBatch(env, &batch, jlanguages);
+    }
+
+    cleanupDuplicateBatch(&batch);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isDuplicateBatchUtf8
+ * Signature: (I[B[I[B[I[Ljava/lang/String;)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_dnebinger_postal4j_LibPostal_isDuplicateBatchUtf8
+  (JNIEnv *env, jclass cls, jint component, jbyteArray jleftValues, jintArray jleftOffsets, jbyteArray jrightValues,
+   jintArray jrightOffsets, jobjectArray jlanguages) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return NULL;
+    }
+
+    duplicateBatch_t batch;
+    memset(&batch, 0, sizeof(duplicateBatch_t));
+
+    jbyteArray result = NULL;
+
+    batch.compare = duplicateFunction(env, component);
+
+    if (batch.compare != NULL && loadPackedStringBatch(env, jleftValues, jleftOffsets, &batch.left)
+            && loadPackedStringBatch(env, jrightValues, jrightOffsets, &batch.right)) {
+        if (batch.left.count != batch.right.count) {
+            throwException(env, "Left and right values must have the same number of pairs");
+        } else {
+            result = runDuplicateBatch(env, &batch, jlanguages);
+        }
+    }
+
+    cleanupDuplicateBatch(&batch);
+
+    return result;
+}
+
+/*
+ * Helper function to load the labels and values of one record
+ * @param env the JNI environment
+ * @param jlabels the labels
+ * @param jvalues the values, same length as the labels
+ * @param components the components to populate, always release them with cleanupComponents
+ * @return true on success, false if an exception was thrown
+ */
+bool loadComponents(JNIEnv *env, jobjectArray jlabels, jobjectArray jvalues, componentList_t* components) {
+    memset(components, 0, sizeof(componentList_t));
+
+    if (jlabels == NULL || jvalues == NULL) {
+        throwException(env, "Labels and values must not be null");
+        return false;
+    }
+
+    if ((*env)->GetArrayLength(env, jlabels) != (*env)->GetArrayLength(env, jvalues)) {
+        throwException(env, "Labels and values must have the same length");
+        return false;
+    }
+
+    if (!loadStringBatch(env, jlabels, false, &components->labelStrings) || !loadStringBatch(env, jvalues, false, &components->valueStrings)) {
+        return false;
+    }
+
+    size_t count = components->labelStrings.count;
+
+    components->labels = malloc((count + 1) * sizeof(char*));
+    components->values = malloc((count + 1) * sizeof(char*));
+
+    if (components->labels == NULL || components->values == NULL) {
+        throwException(env, "Error allocating address components");
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        components->labels[i] = stringBatchGet(&components->labelStrings, i);
+        components->values[i] = stringBatchGet(&components->valueStrings, i);
+    }
+
+    components->count = count;
+
+    return true;
+}
+
+/*
+ * Helper function to free the components of a record
+ * @param components the components
+ */
+void cleanupComponents(componentList_t* components) {
+    free(components->labels);
+    free(components->values);
+    cleanupStringBatch(&components->labelStrings);
+    cleanupStringBatch(&components->valueStrings);
+    memset(components, 0, sizeof(componentList_t));
+}
+
+/*
+ * Helper function to look up the comparator for a DuplicateComponent ordinal
+ * @param env the JNI environment
+ * @param component the ordinal
+ * @return the comparator, or NULL if an exception was thrown
+ */
+duplicateFunction_t duplicateFunction(JNIEnv *env, jint component) {
+    if (component < 0 || (size_t)component >= NUM_DUPLICATE_COMPONENTS) {
+        throwException(env, "Unknown duplicate component");
+        return NULL;
+    }
+
+    return duplicateFunctions[component];
+}
+
+/*
+ * Helper function to load packed UTF-8 values into a string batch, NUL-terminating each value
+ * @param env the JNI environment
+ * @param jvalues the packed UTF-8 values
+ * @param joffsets the start of each value, plus the end of the last one; a negative start marks a missing value
+ * @param batch the batch to populate, release it with cleanupStringBatch
+ * @return true on success, false if an exception was thrown
+ */
+bool loadPackedStringBatch(JNIEnv *env, jbyteArray jvalues, jintArray joffsets, stringBatch_t* batch) {
+    bufferInit(&batch->data);
+    batch->offsets = NULL;
+    batch->count = 0;
+
+    if (jvalues == NULL || joffsets == NULL || (*env)->GetArrayLength(env, joffsets) < 1) {
+        throwException(env, "Values must not be null and offsets need one entry per value plus one");
+        return false;
+    }
+
+    jsize numOffsets = (*env)->GetArrayLength(env, joffsets);
+    jsize valuesLength = (*env)->GetArrayLength(env, jvalues);
+    size_t count = (size_t)numOffsets - 1;
+
+    jint *offsets = malloc((size_t)numOffsets * sizeof(jint));
+    batch->offsets = malloc((count + 1) * sizeof(size_t));
+
+    if (offsets == NULL || batch->offsets == NULL || !bufferReserve(&batch->data, (size_t)valuesLength + count)) {
+        free(offsets);
+        throwException(env, "Error allocating batch");
+        return false;
+    }
+
+    (*env)->GetIntArrayRegion(env, joffsets, 0, numOffsets, offsets);
+
+    // a value ends where the next present value starts
+    jint end = offsets[count];
+    bool ok = end >= 0 && end <= valuesLength;
+
+    for (size_t i = count; ok && i-- > 0;) {
+        if (offsets[i] >= 0) {
+            ok = offsets[i] <= end;
+            end = offsets[i];
+        }
+    }
+
+    if (!ok) {
+        free(offsets);
+        throwException(env, "Value offsets must be ascending and within the values");
+        return false;
+    }
+
+    jbyte *values = (*env)->GetPrimitiveArrayCritical(env, jvalues, NULL);
+
+    if (values == NULL) {
+        free(offsets);
+        throwException(env, "Error reading values");
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (offsets[i] < 0) {
+            batch->offsets[i] = NO_STRING;
+            continue;
+        }
+
+        // the next present offset is the end of this value
+        size_t next = i + 1;
+        while (next < count && offsets[next] < 0) {
+            next++;
+        }
+
+        size_t length = (size_t)(offsets[next] - offsets[i]);
+        char *target = batch->data.data + batch->data.length;
+
+        memcpy(target, values + offsets[i], length);
+        target[length] = '\0';
+
+        batch->offsets[i] = batch->data.length;
+        batch->data.length += length + 1;
+    }
+
+    (*env)->ReleasePrimitiveArrayCritical(env, jvalues, values, JNI_ABORT);
+
+    batch->count = count;
+    free(offsets);
+
+    return true;
+}
+
+/*
+ * Helper function to compare the loaded pairs of a batch on the worker pool
+ * @param env the JNI environment
+ * @param batch the batch, with compare and both sides loaded
+ * @param jlanguages the languages shared by every pair, or NULL
+ * @return the status codes in pair order, or NULL if an exception was thrown
+ */
+jbyteArray runDuplicateBatch(JNIEnv *env, duplicateBatch_t* batch, jobjectArray jlanguages) {
+    char **languages = NULL;
+    size_t numLanguages = 0;
+    size_t count = batch->left.count;
+    jbyteArray result = NULL;
+
+    if (!loadLanguages(env, jlanguages, &batch->languageStrings, &languages, &numLanguages)) {
+        return NULL;
+    }
+
+    batch->options = libpostal_get_duplicate_options_with_languages(numLanguages, languages);
+    batch->statuses = malloc(count + 1);
+
+    if (batch->statuses == NULL) {
+        throwException(env, "Error allocating batch");
+    } else {
+        poolRun(count, duplicateBatchTask, batch);
+
+        result = (*env)->NewByteArray(env, (jsize)count);
+
+        if (result == NULL) {
+            throwException(env, "Error creating result array");
+        } else if (count > 0) {
+            (*env)->SetByteArrayRegion(env, result, 0, (jsize)count, batch->statuses);
+        }
+    }
+
+    free(languages);
+
+    return result;
+}
+
+/*
+ * Pool task that compares one pair of a batch into its status slot
+ * @param index the pair index
+ * @param context the duplicate batch
+ */
+void duplicateBatchTask(size_t index, void* context) {
+    duplicateBatch_t *batch = (duplicateBatch_t*)context;
+    char *left = stringBatchGet(&batch->left, index);
+    char *right = stringBatchGet(&batch->right, index);
+
+    batch->statuses[index] = (jbyte)(left != NULL && right != NULL
+        ? batch->compare(left, right, batch->options)
+        : LIBPOSTAL_NULL_DUPLICATE_STATUS);
+}
+
+/*
+ * Helper function to free a duplicate batch
+ * @param batch the batch
+ */
+void cleanupDuplicateBatch(duplicateBatch_t* batch) {
+    cleanupStringBatch(&batch->left);
+    cleanupStringBatch(&batch->right);
+    cleanupStringBatch(&batch->languageStrings);
+    free(batch->statuses);
+    batch->statuses = NULL;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultFuzzyDuplicateThresholds
+ * Signature: ()[D
+ */
+JNIEXPORT jdoubleArray JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultFuzzyDuplicateThresholds
+  (JNIEnv *env, jclass cls) {
+
+    libpostal_fuzzy_duplicate_options_t options = libpostal_get_default_fuzzy_duplicate_options();
+    jdouble thresholds[2] = { options.needs_review_threshold, options.likely_dupe_threshold };
+
+    jdoubleArray result = (*env)->NewDoubleArray(env, 2);
+
+    if (result == NULL) {
+        throwException(env, "Error creating result array");
+        return NULL;
+    }
+
+    (*env)->SetDoubleArrayRegion(env, result, 0, 2, thresholds);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    fuzzyDuplicateBatch
+ * Signature: (Z[B[I[D[B[I[D[I[Ljava/lang/String;DD[B[D)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_fuzzyDuplicateBatch
+  (JNIEnv *env, jclass cls, jboolean street, jbyteArray jqueryTokens, jintArray jqueryOffsets, jdoubleArray jqueryScores,
+   jbyteArray jcandidateTokens, jintArray jcandidateTokenOffsets, jdoubleArray jcandidateScores, jintArray jcandidateOffsets,
+   jobjectArray jlanguages, jdouble needsReviewThreshold, jdouble likelyDupeThreshold, jbyteArray jstatuses, jdoubleArray jsimilarities) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, languageModules(env, jlanguages))) {
+        return;
+    }
+
+    if (jcandidateOffsets == NULL || jstatuses == NULL || jsimilarities == NULL || (*env)->GetArrayLength(env, jcandidateOffsets) < 1) {
+        throwException(env, "Candidate offsets need one entry per candidate plus one");
+        return;
+    }
+
+    fuzzyBatch_t batch;
+    memset(&batch, 0, sizeof(fuzzyBatch_t));
+
+    jsize numCandidateOffsets = (*env)->GetArrayLength(env, jcandidateOffsets);
+    batch.numCandidates = (size_t)numCandidateOffsets - 1;
+    batch.compare = (street ? libpostal_is_street_duplicate_fuzzy : libpostal_is_name_duplicate_fuzzy);
+
+    size_t numLanguages = 0;
+    bool ok = loadTokens(env, jqueryTokens, jqueryOffsets, jqueryScores, &batch.query)
+        && loadTokens(env, jcandidateTokens, jcandidateTokenOffsets, jcandidateScores, &batch.candidates)
+        && loadLanguages(env, jlanguages, &batch.languageStrings, &batch.languages, &numLanguages);
+
+    if (ok && ((*env)->GetArrayLength(env, jstatuses) < (jsize)batch.numCandidates
+            || (*env)->GetArrayLength(env, jsimilarities) < (jsize)batch.numCandidates)) {
+        throwException(env, "Status and similarity arrays need one entry per candidate");
+        ok = false;
+    }
+
+    if (ok) {
+        batch.candidateOffsets = malloc((size_t)numCandidateOffsets * sizeof(jint));
+        batch.statuses = malloc(batch.numCandidates + 1);
+        batch.similarities = malloc((batch.numCandidates + 1) * sizeof(jdouble));
+
+        if (batch.candidateOffsets == NULL || batch.statuses == NULL || batch.similarities == NULL) {
+            throwException(env, "Error allocating batch");
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        (*env)->GetIntArrayRegion(env, jcandidateOffsets, 0, numCandidateOffsets, batch.candidateOffsets);
+
+        // candidates must cover the candidate tokens in order
+        for (size_t i = 0; ok && i < batch.numCandidates; i++) {
+            ok = batch.candidateOffsets[i] >= 0 && batch.candidateOffsets[i] <= batch.candidateOffsets[i + 1]
+                && (size_t)batch.candidateOffsets[i + 1] <= batch.candidates.strings.count;
+        }
+
+        if (!ok) {
+            throwException(env, "Candidate offsets must be ascending and within the candidate tokens");
+        }
+    }
+
+    if (ok) {
+        batch.options = libpostal_get_default_fuzzy_duplicate_options_with_languages(numLanguages, batch.languages);
+        batch.options.needs_review_threshold = needsReviewThreshold;
+        batch.options.likely_dupe_threshold = likelyDupeThreshold;
+
+        poolRun(batch.numCandidates, fuzzyBatchTask, &batch);
+
+        (*env)->SetByteArrayRegion(env, jstatuses, 0, (jsize)batch.numCandidates, batch.statuses);
+        (*env)->SetDoubleArrayRegion(env, jsimilarities, 0, (jsize)batch.numCandidates, batch.similarities);
+    }
+
+    cleanupTokens(&batch.query);
+    cleanupTokens(&batch.candidates);
+    cleanupStringBatch(&batch.languageStrings);
+    free(batch.languages);
+    free(batch.candidateOffsets);
+    free(batch.statuses);
+    free(batch.similarities);
+}
+
+/*
+ * Helper function to load packed tokens and their scores
+ * @param env the JNI environment
+ * @param jtokens the packed UTF-8 tokens
+ * @param joffsets the start of each token, plus the end of the last one
+ * @param jscores the score of each token
+ * @param tokens the token list to populate, always release it with cleanupTokens
+ * @return true on success, false if an exception was thrown
+ */
+bool loadTokens(JNIEnv *env, jbyteArray jtokens, jintArray joffsets, jdoubleArray jscores, tokenList_t* tokens) {
+    memset(tokens, 0, sizeof(tokenList_t));
+
+    if (!loadPackedStringBatch(env, jtokens, joffsets, &tokens->strings)) {
+        return false;
+    }
 
-    // check if the address is null
-    if (address == NULL) {
-        throwException(env, "Error extracting address");
+    size_t count = tokens->strings.count;
+
+    if (jscores == NULL || (*env)->GetArrayLength(env, jscores) != (jsize)count) {
+        throwException(env, "Token scores need one entry per token");
+        return false;
+    }
+
+    tokens->tokens = malloc((count + 1) * sizeof(char*));
+    tokens->scores = malloc((count + 1) * sizeof(double));
+
+    if (tokens->tokens == NULL || tokens->scores == NULL) {
+        throwException(env, "Error allocating tokens");
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        tokens->tokens[i] = stringBatchGet(&tokens->strings, i);
+
+        if (tokens->tokens[i] == NULL) {
+            throwException(env, "Token offsets must not be negative");
+            return false;
+        }
+    }
+
+    (*env)->GetDoubleArrayRegion(env, jscores, 0, (jsize)count, tokens->scores);
+
+    return true;
+}
+
+/*
+ * Helper function to free a token list
+ * @param tokens the token list
+ */
+void cleanupTokens(tokenList_t* tokens) {
+    free(tokens->tokens);
+    free(tokens->scores);
+    cleanupStringBatch(&tokens->strings);
+    memset(tokens, 0, sizeof(tokenList_t));
+}
+
+/*
+ * Pool task that scores the query against one candidate of a batch
+ * @param index the candidate index
+ * @param context the fuzzy batch
+ */
+void fuzzyBatchTask(size_t index, void* context) {
+    fuzzyBatch_t *batch = (fuzzyBatch_t*)context;
+    size_t first = (size_t)batch->candidateOffsets[index];
+    size_t count = (size_t)batch->candidateOffsets[index + 1] - first;
+
+    libpostal_fuzzy_duplicate_status_t result = batch->compare(batch->query.strings.count, batch->query.tokens, batch->query.scores,
+        count, batch->candidates.tokens + first, batch->candidates.scores + first, batch->options);
+
+    batch->statuses[index] = (jbyte)result.status;
+    batch->similarities[index] = result.similarity;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    tokenize
+ * Signature: (Ljava/lang/String;Z)[I
+ */
+JNIEXPORT jintArray JNICALL Java_com_dnebinger_postal4j_LibPostal_tokenize__Ljava_lang_String_2Z
+  (JNIEnv *env, jclass cls, jstring jinput, jboolean whitespace) {
+
+    utf8String_t inputString;
+    const char *input = getUtf8String(env, jinput, &inputString);
+
+    if (input == NULL) {
+        throwException(env, "Error extracting input");
         return NULL;
     }
 
-    // create the normalize options struct
-    libpostal_normalize_options_t options = libpostal_get_default_options();
- 
-    updateNormalizeOptions(env, &options,languages, latinAscii, transliterate, stripAccents, decompose, lowercase, trimString,
-        dropParentheticals, replaceNumericHyphens, deleteNumericHyphens, splitAlphaFromNumeric, replaceWordHyphens, deleteWordHyphens, deleteFinalPeriods,
-        deleteAcronymPeriods, dropEnglishPossessives, deleteApostrophes, expandNumex, romanNumerals, addressComponents);
+    size_t numTokens = 0;
+    libpostal_token_t *tokens = libpostal_tokenize((char*)input, whitespace, &numTokens);
 
-    // expand the address
-    jobjectArray resultArray = expandAddressWithOptions(env, (char*)address, &options);
+    jintArray result = NULL;
+    jint *triples = (numTokens > 0 ? malloc(numTokens * 3 * sizeof(jint)) : NULL);
 
-    // free the normalize options
-    cleanupNormalizeOptions(&options);
+    if (tokens == NULL || (numTokens > 0 && triples == NULL)) {
+        throwException(env, "Error tokenizing input");
+    } else {
+        // libpostal reports byte offsets, Java wants UTF-16 offsets. Tokens come in input order so one pass converts
+        // them all; every byte other than a continuation byte starts one UTF-16 unit, 4 byte sequences start two.
+        size_t position = 0;
+        jint units = 0;
 
-    // free the address string
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
+        for (size_t i = 0; i < numTokens; i++) {
+            for (; position < tokens[i].offset; position++) {
+                units += ((input[position] & 0xC0) != 0x80) + ((input[position] & 0xF8) == 0xF0);
+            }
 
-    // return the result array
-    return resultArray;
+            jint start = units;
+
+            for (; position < tokens[i].offset + tokens[i].len; position++) {
+                units += ((input[position] & 0xC0) != 0x80) + ((input[position] & 0xF8) == 0xF0);
+            }
+
+            triples[i * 3] = start;
+            triples[i * 3 + 1] = units - start;
+            triples[i * 3 + 2] = (jint)tokens[i].type;
+        }
+
+        result = (*env)->NewIntArray(env, (jsize)(numTokens * 3));
+
+        if (result != NULL && numTokens > 0) {
+            (*env)->SetIntArrayRegion(env, result, 0, (jsize)(numTokens * 3), triples);
+        }
+    }
+
+    free(triples);
+    free(tokens);
+    releaseUtf8String(&inputString);
+
+    return result;
 }
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    expandRootAddress
- * Signature: (Ljava/lang/String;)[Ljava/lang/String;
+ * Method:    tokenizeUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;IIZ[I)I
  */
-JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddress__Ljava_lang_String_2
-  (JNIEnv *env, jclass cls, jstring jaddress) {
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_tokenizeUtf8
+  (JNIEnv *env, jclass cls, jbyteArray jarray, jobject jbuffer, jint offset, jint length, jboolean whitespace, jintArray jtokens) {
 
-    if (!initialized) {
-        throwException(env, "LibPostal not initialized - call setup() first");
+    if (jtokens == NULL) {
+        throwException(env, "Token buffer must not be null");
+        return -1;
+    }
+
+    // get the UTF-8 bytes, no transcoding is done
+    utf8Input_t input;
+    const char *error = getUtf8Input(env, jarray, jbuffer, offset, length, &input);
+
+    if (error != NULL) {
+        throwException(env, error);
+        return -1;
+    }
+
+    size_t numTokens = 0;
+    libpostal_token_t *tokens = libpostal_tokenize(input.data, whitespace, &numTokens);
+
+    releaseUtf8Input(&input);
+
+    if (tokens == NULL) {
+        throwException(env, "Error tokenizing input");
+        return -1;
+    }
+
+    // byte offsets are already what the caller wants, write as many triples as fit straight into the caller's buffer
+    size_t capacity = (size_t)(*env)->GetArrayLength(env, jtokens) / 3;
+    size_t count = (numTokens < capacity ? numTokens : capacity);
+
+    if (count > 0) {
+        jint *triples = (*env)->GetPrimitiveArrayCritical(env, jtokens, NULL);
+
+        if (triples == NULL) {
+            free(tokens);
+            throwException(env, "Error accessing token buffer");
+            return -1;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            triples[i * 3] = (jint)tokens[i].offset;
+            triples[i * 3 + 1] = (jint)tokens[i].len;
+            triples[i * 3 + 2] = (jint)tokens[i].type;
+        }
+
+        (*env)->ReleasePrimitiveArrayCritical(env, jtokens, triples, 0);
+    }
+
+    free(tokens);
+
+    // the full count, a caller seeing more tokens than fit can retry with a larger buffer
+    return (jint)numTokens;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    normalizeStringNative
+ * Signature: (Ljava/lang/String;J[Ljava/lang/String;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_dnebinger_postal4j_LibPostal_normalizeStringNative
+  (JNIEnv *env, jclass cls, jstring jinput, jlong options, jobjectArray jlanguages) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, MODULE_EXPANSION)) {
         return NULL;
     }
 
-    // extract the address from the JNI string
-    const char *address = (*env)->GetStringUTFChars(env, jaddress, 0);
+    stringBatch_t languageStrings;
+    char **languages = NULL;
+    size_t numLanguages = 0;
+    jstring result = NULL;
 
-    // check if the address is null
-    if (address == NULL) {
-        throwException(env, "Error extracting address");
+    if (loadLanguages(env, jlanguages, &languageStrings, &languages, &numLanguages)) {
+        utf8String_t inputString;
+        const char *input = getUtf8String(env, jinput, &inputString);
+
+        if (input == NULL) {
+            throwException(env, "Error extracting input");
+        } else {
+            char *normalized = libpostal_normalize_string_languages((char*)input, (uint64_t)options, numLanguages, languages);
+
+            // libpostal returns NULL for input it can't normalize, e.g. an empty string
+            if (normalized != NULL) {
+                result = newStringFromUtf8(env, normalized);
+                free(normalized);
+            }
+
+            releaseUtf8String(&inputString);
+        }
+    }
+
+    free(languages);
+    cleanupStringBatch(&languageStrings);
+
+    return result;
+}
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    normalizedTokensNative
+ * Signature: (Ljava/lang/String;JJZ[Ljava/lang/String;)Lcom/dnebinger/postal4j/NormalizedTokens;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_normalizedTokensNative
+  (JNIEnv *env, jclass cls, jstring jinput, jlong stringOptions, jlong tokenOptions, jboolean whitespace, jobjectArray jlanguages) {
+
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, MODULE_EXPANSION)) {
         return NULL;
     }
 
-    // get the default normalize options
-    libpostal_normalize_options_t options = libpostal_get_default_options();
+    stringBatch_t languageStrings;
+    char **languages = NULL;
+    size_t numLanguages = 0;
+    jobject result = NULL;
 
-    // expand the address
-    jobjectArray resultArray = expandRootAddressWithOptions(env, (char*)address, &options);
+    if (loadLanguages(env, jlanguages, &languageStrings, &languages, &numLanguages)) {
+        utf8String_t inputString;
+        const char *input = getUtf8String(env, jinput, &inputString);
 
-    // free the address string
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
+        if (input == NULL) {
+            throwException(env, "Error extracting input");
+        } else {
+            size_t numTokens = 0;
+            libpostal_normalized_token_t *tokens = libpostal_normalized_tokens_languages((char*)input, (uint64_t)stringOptions,
+                (uint64_t)tokenOptions, whitespace, numLanguages, languages, &numTokens);
 
-    // return the result array
-    return resultArray;
+            result = createNormalizedTokens(env, tokens, tokens != NULL ? numTokens : 0);
+
+            for (size_t i = 0; tokens != NULL && i < numTokens; i++) {
+                free(tokens[i].str);
+            }
+            free(tokens);
+
+            releaseUtf8String(&inputString);
+        }
+    }
+
+    free(languages);
+    cleanupStringBatch(&languageStrings);
+
+    return result;
 }
 
 /*
- * Helper function to expand a root address with options
+ * Helper function to create a NormalizedTokens from libpostal normalized tokens
  * @param env the JNI environment
- * @param address the address string
- * @param options the normalize options
- * @return the result array
+ * @param tokens the normalized tokens, still owned by the caller
+ * @param numTokens the number of tokens
+ * @return the normalized tokens, or NULL if an exception was thrown
  */
-jobjectArray expandRootAddressWithOptions(JNIEnv *env, char* address, libpostal_normalize_options_t* options) {
-    // expand the address
-    size_t numExpansions;
-    char **expansions = libpostal_expand_address_root(address, *options, &numExpansions);
+jobject createNormalizedTokens(JNIEnv *env, libpostal_normalized_token_t* tokens, size_t numTokens) {
+    jobjectArray strings = (*env)->NewObjectArray(env, (jsize)numTokens, stringClass, NULL);
+    jintArray types = (strings != NULL ? (*env)->NewIntArray(env, (jsize)numTokens) : NULL);
 
-    if (expansions == NULL) {
-        throwException(env, "Error expanding root address");
+    if (types == NULL) {
+        throwException(env, "Error creating normalized tokens");
         return NULL;
     }
 
-    return createResultArray(env, expansions, numExpansions);
+    for (size_t i = 0; i < numTokens; i++) {
+        jstring string = newStringFromUtf8(env, tokens[i].str);
+
+        if (string == NULL) {
+            throwException(env, "Error creating token string");
+            return NULL;
+        }
+
+        (*env)->SetObjectArrayElement(env, strings, (jsize)i, string);
+        (*env)->DeleteLocalRef(env, string);
+
+        jint type = (jint)tokens[i].token.type;
+        (*env)->SetIntArrayRegion(env, types, (jsize)i, 1, &type);
+    }
+
+    return (*env)->NewObject(env, normalizedTokensClass, normalizedTokensInit, strings, types);
 }
 
 /*
- * Helper function to create a result array
- * @param env the JNI environment
- * @param expansions the expansions
- * @param numExpansions the number of expansions
- * @return the result array
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    normalizeStringBatch
+ * Signature: ([Ljava/lang/String;J[Ljava/lang/String;)[Ljava/lang/String;
  */
-jobjectArray createResultArray(JNIEnv *env, char** expansions, size_t numExpansions) {
-    // create the result array
-    jobjectArray resultArray = (*env)->NewObjectArray(env, numExpansions, stringClass, NULL);
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_normalizeStringBatch
+  (JNIEnv *env, jclass cls, jobjectArray jinputs, jlong options, jobjectArray jlanguages) {
 
-    if (resultArray == NULL) {
-        throwException(env, "Error creating result array");
-        libpostal_expansion_array_destroy(expansions, numExpansions);
+    LIFECYCLE_CALL;
+
+    if (!requireModules(env, MODULE_EXPANSION)) {
         return NULL;
     }
 
-    // populate the result array
-    for (size_t i = 0; i < numExpansions; i++) {
-        // create new string for the expansion
-        jstring jexpansion = (*env)->NewStringUTF(env, expansions[i]);
+    if (jinputs == NULL) {
+        throwException(env, "Inputs must not be null");
+        return NULL;
+    }
 
-        if (jexpansion == NULL) {
-            throwException(env, "Error creating expansion string");
-            // clean up previous allocations
-            for (size_t j = 0; j < i; j++) {
-                jstring jexpansion = (*env)->GetObjectArrayElement(env, resultArray, j);
-                (*env)->DeleteLocalRef(env, jexpansion);
-            }
+    normalizeBatch_t batch;
+    memset(&batch, 0, sizeof(normalizeBatch_t));
+    bufferInit(&batch.inputs.data);
+    bufferInit(&batch.languageStrings.data);
+    batch.options = (uint64_t)options;
 
-            (*env)->DeleteLocalRef(env, resultArray);
+    jobjectArray result = NULL;
 
-            libpostal_expansion_array_destroy(expansions, numExpansions);
-            
-            return NULL;
+    // copy everything out first so the workers never touch the JNI environment
+    if (loadStringBatch(env, jinputs, true, &batch.inputs) &&
+        loadLanguages(env, jlanguages, &batch.languageStrings, &batch.languages, &batch.numLanguages)) {
+
+        size_t count = batch.inputs.count;
+        batch.results = (count > 0 ? calloc(count, sizeof(char*)) : NULL);
+
+        if (count > 0 && batch.results == NULL) {
+            throwException(env, "Error allocating batch");
+        } else {
+            poolRun(count, normalizeBatchTask, &batch);
+
+            result = (*env)->NewObjectArray(env, (jsize)count, stringClass, NULL);
+
+            for (size_t i = 0; result != NULL && i < count; i++) {
+                if (batch.results[i] == NULL) {
+                    continue;
+                }
+
+                jstring string = newStringFromUtf8(env, batch.results[i]);
+
+                if (string == NULL) {
+                    throwException(env, "Error creating normalized string");
+                    result = NULL;
+                    break;
+                }
+
+                (*env)->SetObjectArrayElement(env, result, (jsize)i, string);
+                (*env)->DeleteLocalRef(env, string);
+            }
         }
+    }
 
-        // set the expansion in the result array
-        (*env)->SetObjectArrayElement(env, resultArray, i, jexpansion);
-        
-        // We can safely release the local reference now
-        (*env)->DeleteLocalRef(env, jexpansion);
+    cleanupNormalizeBatch(&batch);
+
+    return result;
+}
+
+/*
+ * Pool task that normalizes one string of a batch into its result slot
+ * @param index the input index
+ * @param context the normalize batch
+ */
+void normalizeBatchTask(size_t index, void* context) {
+    normalizeBatch_t *batch = (normalizeBatch_t*)context;
+    char *input = stringBatchGet(&batch->inputs, index);
+
+    // null inputs stay null
+    if (input != NULL) {
+        batch->results[index] = libpostal_normalize_string_languages(input, batch->options, batch->numLanguages, batch->languages);
     }
+}
 
-    // done with the expansions
-    libpostal_expansion_array_destroy(expansions, numExpansions);
+/*
+ * Helper function to free a normalize batch and any results still in it
+ * @param batch the batch
+ */
+void cleanupNormalizeBatch(normalizeBatch_t* batch) {
+    if (batch->results != NULL) {
+        for (size_t i = 0; i < batch->inputs.count; i++) {
+            free(batch->results[i]);
+        }
+        free(batch->results);
+        batch->results = NULL;
+    }
 
-    // return the result array
-    return resultArray;
+    free(batch->languages);
+    batch->languages = NULL;
+
+    cleanupStringBatch(&batch->languageStrings);
+    cleanupStringBatch(&batch->inputs);
 }
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    expandRootAddress
- * Signature: (Ljava/lang/String;[Ljava/lang/String;ZZZZZZZZZZZZZZZZZZI)[Ljava/lang/String;
+ * Method:    bulkProcessFile
+ * Signature: (Ljava/lang/String;Ljava/lang/String;IIIJLcom/dnebinger/postal4j/BulkProgressListener;)Lcom/dnebinger/postal4j/BulkProgress;
  */
-JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddress__Ljava_lang_String_2_3Ljava_lang_String_2ZZZZZZZZZZZZZZZZZZI
-  (JNIEnv *env, jclass cls, jstring jaddress, jobjectArray languages,
-   jboolean latinAscii, jboolean transliterate, jboolean stripAccents,
-   jboolean decompose, jboolean lowercase, jboolean trimString,
-   jboolean dropParentheticals, jboolean replaceNumericHyphens,
-   jboolean deleteNumericHyphens, jboolean splitAlphaFromNumeric,
-   jboolean replaceWordHyphens, jboolean deleteWordHyphens,
-   jboolean deleteFinalPeriods, jboolean deleteAcronymPeriods,
-   jboolean dropEnglishPossessives, jboolean deleteApostrophes,
-   jboolean expandNumex, jboolean romanNumerals, jint addressComponents) {
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_bulkProcessFile
+  (JNIEnv *env, jclass cls, jstring jinputPath, jstring joutputPath, jint mode, jint format, jint chunkLines, jlong handle,
+   jobject jlistener) {
 
-    if (!initialized) {
-        throwException(env, "LibPostal not initialized - call setup() first");
+    LIFECYCLE_CALL;
+
+    if (!requireServedModules(env, mode == BULK_PARSE ? MODULE_PARSER : normalizeOptionsModules(handle))) {
         return NULL;
     }
 
-    // extract the address from the JNI string
-    const char *address = (*env)->GetStringUTFChars(env, jaddress, 0);
-
-    // check if the address is null
-    if (address == NULL) {
-        throwException(env, "Error extracting address");
+    if (jinputPath == NULL || joutputPath == NULL) {
+        throwException(env, "Input and output paths must not be null");
         return NULL;
     }
 
-    // create the normalize options
-    libpostal_normalize_options_t options = libpostal_get_default_options();
+    bulkOptions_t options;
+    bulkDefaultOptions(&options);
+    options.mode = (bulkMode_t)mode;
+    options.format = (bulkFormat_t)format;
 
-    updateNormalizeOptions(env, &options, languages, latinAscii, transliterate, stripAccents, decompose, lowercase, trimString,
-        dropParentheticals, replaceNumericHyphens, deleteNumericHyphens, splitAlphaFromNumeric, replaceWordHyphens, deleteWordHyphens, deleteFinalPeriods,
-        deleteAcronymPeriods, dropEnglishPossessives, deleteApostrophes, expandNumex, romanNumerals, addressComponents);
+    if (chunkLines > 0) {
+        options.chunkLines = (size_t)chunkLines;
+    }
 
-    // expand the address
-    jobjectArray resultArray = expandRootAddressWithOptions(env, (char*)address, &options);
+    // a 0 handle selects the libpostal default normalize options
+    if (handle != 0) {
+        options.normalizeOptions = (libpostal_normalize_options_t*)(intptr_t)handle;
+    }
 
-    // free the address string
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
+    bulkListener_t listener = { env, jlistener, NULL };
 
-    // free the normalize options
-    cleanupNormalizeOptions(&options);
+    if (jlistener != NULL) {
+        jclass listenerClass = (*env)->GetObjectClass(env, jlistener);
+        listener.onProgress = (*env)->GetMethodID(env, listenerClass, "onProgress", "(Lcom/dnebinger/postal4j/BulkProgress;)V");
+        (*env)->DeleteLocalRef(env, listenerClass);
 
-    // return the result array
-    return resultArray;
+        if (listener.onProgress == NULL) {
+            return NULL;
+        }
+
+        options.progress = bulkProgressCallback;
+        options.progressContext = &listener;
+    }
+
+    const char *inputPath = (*env)->GetStringUTFChars(env, jinputPath, 0);
+    const char *outputPath = (inputPath != NULL ? (*env)->GetStringUTFChars(env, joutputPath, 0) : NULL);
+    jobject result = NULL;
+
+    if (outputPath == NULL) {
+        throwException(env, "Error extracting paths");
+    } else {
+        bulkProgress_t progress;
+        const char *error = bulkProcessFile(inputPath, outputPath, &options, &progress);
+
+        if (error == NULL) {
+            result = createBulkProgress(env, &progress);
+        } else if (!(*env)->ExceptionCheck(env)) {
+            // an exception from the listener already explains the stop
+            throwException(env, error);
+        }
+    }
+
+    if (inputPath != NULL) {
+        (*env)->ReleaseStringUTFChars(env, jinputPath, inputPath);
+    }
+    if (outputPath != NULL) {
+        (*env)->ReleaseStringUTFChars(env, joutputPath, outputPath);
+    }
+
+    return result;
+}
+
+/*
+ * Bulk progress callback that forwards the counters to the Java listener
+ * @param progress the current counters
+ * @param context the bulk listener
+ * @return false to stop the run if the listener threw
+ */
+bool bulkProgressCallback(const bulkProgress_t* progress, void* context) {
+    bulkListener_t *listener = (bulkListener_t*)context;
+    JNIEnv *env = listener->env;
+
+    jobject jprogress = createBulkProgress(env, progress);
+
+    if (jprogress == NULL) {
+        return false;
+    }
+
+    (*env)->CallVoidMethod(env, listener->listener, listener->onProgress, jprogress);
+    (*env)->DeleteLocalRef(env, jprogress);
+
+    return !(*env)->ExceptionCheck(env);
+}
+
+/*
+ * Helper function to create a BulkProgress from the native counters
+ * @param env the JNI environment
+ * @param progress the counters
+ * @return the bulk progress, or NULL if an exception was thrown
+ */
+jobject createBulkProgress(JNIEnv *env, const bulkProgress_t* progress) {
+    return (*env)->NewObject(env, bulkProgressClass, bulkProgressInit, (jlong)progress->lines, (jlong)progress->bytesRead,
+        (jlong)progress->totalBytes, (jlong)progress->bytesWritten, (jdouble)progress->elapsedSeconds);
 }
 
 /*
@@ -31,34 +31,234 @@ JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_S
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    teardown
+ * Method:    setup
+ * Signature: (Ljava/lang/String;I)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2I
+  (JNIEnv *, jclass, jstring, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setup
+ * Signature: (Ljava/lang/String;II)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setup__Ljava_lang_String_2II
+  (JNIEnv *, jclass, jstring, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setupWithModules
+ * Signature: (Ljava/lang/String;IIIZ)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setupWithModules
+  (JNIEnv *, jclass, jstring, jint, jint, jint, jboolean);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setupSidecar
+ * Signature: (Ljava/lang/String;II)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setupSidecar
+  (JNIEnv *, jclass, jstring, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    sidecarConnected
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_dnebinger_postal4j_LibPostal_sidecarConnected
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    loadModules
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_loadModules
+  (JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    loadedModules
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_loadedModules
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    getWorkerThreads
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_getWorkerThreads
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    teardownNative
  * Signature: ()V
  */
-JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_teardown
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_teardownNative
   (JNIEnv *, jclass);
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    parseAddress
+ * Method:    parseAddressNative
  * Signature: (Ljava/lang/String;)Ljava/util/Map;
  */
-JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddress__Ljava_lang_String_2
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressNative__Ljava_lang_String_2
   (JNIEnv *, jclass, jstring);
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    parseAddress
+ * Method:    parseAddressNative
  * Signature: (Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Ljava/util/Map;
  */
-JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddress__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressNative__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2
   (JNIEnv *, jclass, jstring, jstring, jstring);
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    expandAddress
+ * Method:    parseAddresses
+ * Signature: ([Ljava/lang/String;)[Ljava/util/Map;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddresses___3Ljava_lang_String_2
+  (JNIEnv *, jclass, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddresses
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)[Ljava/util/Map;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddresses___3Ljava_lang_String_2_3Ljava_lang_String_2_3Ljava_lang_String_2
+  (JNIEnv *, jclass, jobjectArray, jobjectArray, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressBatch
+ * Signature: ([Ljava/lang/String;JZ)[[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressBatch
+  (JNIEnv *, jclass, jobjectArray, jlong, jboolean);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressToNative
+ * Signature: (Ljava/lang/String;I[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressToNative
+  (JNIEnv *, jclass, jstring, jint, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressToNative
+ * Signature: (Ljava/lang/String;JI[BLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressToNative
+  (JNIEnv *, jclass, jstring, jlong, jint, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressesToNative
+ * Signature: ([Ljava/lang/String;I[BLjava/nio/ByteBuffer;II[I)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressesToNative
+  (JNIEnv *, jclass, jobjectArray, jint, jbyteArray, jobject, jint, jint, jintArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressesToNative
+ * Signature: ([Ljava/lang/String;JI[BLjava/nio/ByteBuffer;II[I)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressesToNative
+  (JNIEnv *, jclass, jobjectArray, jlong, jint, jbyteArray, jobject, jint, jint, jintArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    matchScoreNative
+ * Signature: (Ljava/lang/String;Ljava/lang/String;J)F
+ */
+JNIEXPORT jfloat JNICALL Java_com_dnebinger_postal4j_LibPostal_matchScoreNative
+  (JNIEnv *, jclass, jstring, jstring, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    matchScoreBatch
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;J)[F
+ */
+JNIEXPORT jfloatArray JNICALL Java_com_dnebinger_postal4j_LibPostal_matchScoreBatch
+  (JNIEnv *, jclass, jobjectArray, jobjectArray, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressCompact
+ * Signature: (Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressCompact__Ljava_lang_String_2
+  (JNIEnv *, jclass, jstring);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressCompact
+ * Signature: (Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressCompact__Ljava_lang_String_2Ljava_lang_String_2Ljava_lang_String_2
+  (JNIEnv *, jclass, jstring, jstring, jstring);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressesCompact
+ * Signature: ([Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddressBatch;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressesCompact___3Ljava_lang_String_2
+  (JNIEnv *, jclass, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressesCompact
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)Lcom/dnebinger/postal4j/ParsedAddressBatch;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressesCompact___3Ljava_lang_String_2_3Ljava_lang_String_2_3Ljava_lang_String_2
+  (JNIEnv *, jclass, jobjectArray, jobjectArray, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)Ljava/util/Map;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressUtf8
+  (JNIEnv *, jclass, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    parseAddressCompactUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)Lcom/dnebinger/postal4j/ParsedAddress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_parseAddressCompactUtf8
+  (JNIEnv *, jclass, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressUtf8
+  (JNIEnv *, jclass, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandRootAddressUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;II)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddressUtf8
+  (JNIEnv *, jclass, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressNative
  * Signature: (Ljava/lang/String;)[Ljava/lang/String;
  */
-JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddress__Ljava_lang_String_2
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressNative
   (JNIEnv *, jclass, jstring);
 
 /*
@@ -71,10 +271,10 @@ JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddre
 
 /*
  * Class:     com_dnebinger_postal4j_LibPostal
- * Method:    expandRootAddress
+ * Method:    expandRootAddressNative
  * Signature: (Ljava/lang/String;)[Ljava/lang/String;
  */
-JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddress__Ljava_lang_String_2
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddressNative
   (JNIEnv *, jclass, jstring);
 
 /*
@@ -85,6 +285,311 @@ JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootA
 JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandRootAddress__Ljava_lang_String_2_3Ljava_lang_String_2ZZZZZZZZZZZZZZZZZZI
   (JNIEnv *, jclass, jstring, jobjectArray, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jboolean, jint);
 
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultNormalizeFlags
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultNormalizeFlags
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultAddressComponents
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultAddressComponents
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    createNormalizeOptions
+ * Signature: ([Ljava/lang/String;II)J
+ */
+JNIEXPORT jlong JNICALL Java_com_dnebinger_postal4j_LibPostal_createNormalizeOptions
+  (JNIEnv *, jclass, jobjectArray, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    destroyNormalizeOptions
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_destroyNormalizeOptions
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    expandAddressWithHandle
+ * Signature: (Ljava/lang/String;JZ)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_expandAddressWithHandle
+  (JNIEnv *, jclass, jstring, jlong, jboolean);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    getCacheStats
+ * Signature: ()Lcom/dnebinger/postal4j/CacheStats;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_getCacheStats
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    clearCache
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_clearCache
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setDiskCacheNative
+ * Signature: (Ljava/lang/String;J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setDiskCacheNative
+  (JNIEnv *, jclass, jstring, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    getDiskCacheStats
+ * Signature: ()Lcom/dnebinger/postal4j/DiskCacheStats;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_getDiskCacheStats
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    setMetricsEnabledNative
+ * Signature: (ZI)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_setMetricsEnabledNative
+  (JNIEnv *, jclass, jboolean, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isMetricsEnabled
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_dnebinger_postal4j_LibPostal_isMetricsEnabled
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    resetMetrics
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_resetMetrics
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    metricsSnapshot
+ * Signature: ([J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_metricsSnapshot
+  (JNIEnv *, jclass, jlongArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    slowInputs
+ * Signature: ([J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_slowInputs
+  (JNIEnv *, jclass, jlongArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultNearDupeHashFlags
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultNearDupeHashFlags
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultGeohashPrecision
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultGeohashPrecision
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    nearDupeHashesNative
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;IIDD)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_nearDupeHashesNative
+  (JNIEnv *, jclass, jobjectArray, jobjectArray, jobjectArray, jint, jint, jdouble, jdouble);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    nearDupeNameHashesNative
+ * Signature: (Ljava/lang/String;J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_nearDupeNameHashesNative
+  (JNIEnv *, jclass, jstring, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    nearDupeHashBatch
+ * Signature: ([I[B[B[I[D[D[Ljava/lang/String;II)Lcom/dnebinger/postal4j/NearDupeHashBatch;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_nearDupeHashBatch
+  (JNIEnv *, jclass, jintArray, jbyteArray, jbyteArray, jintArray, jdoubleArray, jdoubleArray, jobjectArray, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    openBlockingIndex
+ * Signature: (Ljava/lang/String;[Ljava/lang/String;II)J
+ */
+JNIEXPORT jlong JNICALL Java_com_dnebinger_postal4j_LibPostal_openBlockingIndex
+  (JNIEnv *, jclass, jstring, jobjectArray, jint, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    closeBlockingIndex
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_closeBlockingIndex
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    flushBlockingIndex
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_flushBlockingIndex
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexStats
+ * Signature: (J)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexStats
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexAdd
+ * Signature: (JJ[Ljava/lang/String;[Ljava/lang/String;DD)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexAdd
+  (JNIEnv *, jclass, jlong, jlong, jobjectArray, jobjectArray, jdouble, jdouble);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexAddBatch
+ * Signature: (J[J[I[B[B[I[D[D)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexAddBatch
+  (JNIEnv *, jclass, jlong, jlongArray, jintArray, jbyteArray, jbyteArray, jintArray, jdoubleArray, jdoubleArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    blockingIndexQuery
+ * Signature: (J[Ljava/lang/String;[Ljava/lang/String;DDI)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_dnebinger_postal4j_LibPostal_blockingIndexQuery
+  (JNIEnv *, jclass, jlong, jobjectArray, jobjectArray, jdouble, jdouble, jint);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isDuplicateNative
+ * Signature: (ILjava/lang/String;Ljava/lang/String;[Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_isDuplicateNative
+  (JNIEnv *, jclass, jint, jstring, jstring, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isToponymDuplicateNative
+ * Signature: ([Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_isToponymDuplicateNative
+  (JNIEnv *, jclass, jobjectArray, jobjectArray, jobjectArray, jobjectArray, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isDuplicateBatch
+ * Signature: (I[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_dnebinger_postal4j_LibPostal_isDuplicateBatch
+  (JNIEnv *, jclass, jint, jobjectArray, jobjectArray, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    isDuplicateBatchUtf8
+ * Signature: (I[B[I[B[I[Ljava/lang/String;)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_com_dnebinger_postal4j_LibPostal_isDuplicateBatchUtf8
+  (JNIEnv *, jclass, jint, jbyteArray, jintArray, jbyteArray, jintArray, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    defaultFuzzyDuplicateThresholds
+ * Signature: ()[D
+ */
+JNIEXPORT jdoubleArray JNICALL Java_com_dnebinger_postal4j_LibPostal_defaultFuzzyDuplicateThresholds
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    fuzzyDuplicateBatch
+ * Signature: (Z[B[I[D[B[I[D[I[Ljava/lang/String;DD[B[D)V
+ */
+JNIEXPORT void JNICALL Java_com_dnebinger_postal4j_LibPostal_fuzzyDuplicateBatch
+  (JNIEnv *, jclass, jboolean, jbyteArray, jintArray, jdoubleArray, jbyteArray, jintArray, jdoubleArray, jintArray, jobjectArray,
+   jdouble, jdouble, jbyteArray, jdoubleArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    tokenize
+ * Signature: (Ljava/lang/String;Z)[I
+ */
+JNIEXPORT jintArray JNICALL Java_com_dnebinger_postal4j_LibPostal_tokenize__Ljava_lang_String_2Z
+  (JNIEnv *, jclass, jstring, jboolean);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    tokenizeUtf8
+ * Signature: ([BLjava/nio/ByteBuffer;IIZ[I)I
+ */
+JNIEXPORT jint JNICALL Java_com_dnebinger_postal4j_LibPostal_tokenizeUtf8
+  (JNIEnv *, jclass, jbyteArray, jobject, jint, jint, jboolean, jintArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    normalizeStringNative
+ * Signature: (Ljava/lang/String;J[Ljava/lang/String;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_dnebinger_postal4j_LibPostal_normalizeStringNative
+  (JNIEnv *, jclass, jstring, jlong, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    normalizedTokensNative
+ * Signature: (Ljava/lang/String;JJZ[Ljava/lang/String;)Lcom/dnebinger/postal4j/NormalizedTokens;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_normalizedTokensNative
+  (JNIEnv *, jclass, jstring, jlong, jlong, jboolean, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    normalizeStringBatch
+ * Signature: ([Ljava/lang/String;J[Ljava/lang/String;)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_dnebinger_postal4j_LibPostal_normalizeStringBatch
+  (JNIEnv *, jclass, jobjectArray, jlong, jobjectArray);
+
+/*
+ * Class:     com_dnebinger_postal4j_LibPostal
+ * Method:    bulkProcessFile
+ * Signature: (Ljava/lang/String;Ljava/lang/String;IIIJLcom/dnebinger/postal4j/BulkProgressListener;)Lcom/dnebinger/postal4j/BulkProgress;
+ */
+JNIEXPORT jobject JNICALL Java_com_dnebinger_postal4j_LibPostal_bulkProcessFile
+  (JNIEnv *, jclass, jstring, jstring, jint, jint, jint, jlong, jobject);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,63 @@
+/*
+ * postal4j_labels.c
+ * Fixed table of libpostal address parser labels, in AddressLabel enum order
+ */
+
+#include "postal4j_labels.h"
+#include <string.h>
+
+// The order here is the ordinal order of com.dnebinger.postal4j.AddressLabel
+static const char *addressLabels[NUM_ADDRESS_LABELS] = {
+    "house",
+    "category",
+    "near",
+    "house_number",
+    "road",
+    "unit",
+    "level",
+    "staircase",
+    "entrance",
+    "po_box",
+    "postcode",
+    "suburb",
+    "city_district",
+    "city",
+    "island",
+    "state_district",
+    "state",
+    "country_region",
+    "country",
+    "world_region"
+};
+
+/*
+ * Look up the ordinal for a label
+ * @param label the label returned by the libpostal parser
+ * @return the label ordinal, or -1 if the label is unknown
+ */
+int addressLabelOrdinal(const char *label) {
+    if (label == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < NUM_ADDRESS_LABELS; i++) {
+        if (strcmp(addressLabels[i], label) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Look up the label for an ordinal
+ * @param ordinal the label ordinal
+ * @return the label, or NULL if the ordinal is out of range
+ */
+const char *addressLabelName(int ordinal) {
+    if (ordinal < 0 || ordinal >= NUM_ADDRESS_LABELS) {
+        return NULL;
+    }
+
+    return addressLabels[ordinal];
+}
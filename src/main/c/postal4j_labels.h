@@ -0,0 +1,23 @@
+/*
+ * postal4j_labels.h
+ * Fixed table of libpostal address parser labels, in AddressLabel enum order
+ */
+
+#ifndef POSTAL4J_LABELS_H
+#define POSTAL4J_LABELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Must match the number of constants in com.dnebinger.postal4j.AddressLabel
+#define NUM_ADDRESS_LABELS 20
+
+int addressLabelOrdinal(const char *label);
+const char *addressLabelName(int ordinal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_LABELS_H */
@@ -0,0 +1,193 @@
+/*
+ * postal4j_lifecycle.c
+ * Setup/teardown state and the per-thread in-flight call tracking that lets teardown wait for running calls
+ *
+ * Every thread has its own slot holding the depth of the calls it is inside, on its own cache line, so entering
+ * a call is a store to a line no other thread writes plus a load of the shared state, with no lock and no
+ * contended read-modify-write. A call stores its depth before loading the state and teardown stores the state
+ * before loading the depths (both sequentially consistent), so either the call sees the teardown and backs out
+ * or teardown sees the call and waits for it. Slots are linked into a global list (CAS push) and handed to the
+ * next new thread when their thread exits, the same way as the metrics blocks.
+ */
+
+#include "postal4j_lifecycle.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SLOT_BYTES 64
+
+// Yields before teardown starts sleeping between checks of a busy slot
+#define DRAIN_SPINS 64
+#define DRAIN_SLEEP_NANOS 100000
+
+typedef struct lifecycleSlot {
+    atomic_int depth;
+    atomic_bool inUse;
+    struct lifecycleSlot *next;
+} lifecycleSlot_t;
+
+static atomic_int state = LIFECYCLE_STOPPED;
+static _Atomic(lifecycleSlot_t*) slots = NULL;
+static pthread_key_t threadKey;
+static pthread_once_t threadKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t transitionLock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local lifecycleSlot_t *threadSlot = NULL;
+
+/*
+ * Thread exit hook, hands the thread's slot to the next thread that needs one
+ * @param slot the exiting thread's slot, never inside a call
+ */
+static void releaseThreadSlot(void *slot) {
+    atomic_store_explicit(&((lifecycleSlot_t*)slot)->inUse, false, memory_order_release);
+}
+
+static void createThreadKey(void) {
+    pthread_key_create(&threadKey, releaseThreadSlot);
+}
+
+/*
+ * Get the calling thread's slot, reusing one of an exited thread or adding a new one to the list
+ * @return the slot, or NULL if none could be allocated
+ */
+static lifecycleSlot_t *currentSlot(void) {
+    if (threadSlot != NULL) {
+        return threadSlot;
+    }
+
+    pthread_once(&threadKeyOnce, createThreadKey);
+
+    lifecycleSlot_t *slot = NULL;
+
+    for (lifecycleSlot_t *candidate = atomic_load(&slots); candidate != NULL && slot == NULL; candidate = candidate->next) {
+        bool free = false;
+
+        if (atomic_compare_exchange_strong(&candidate->inUse, &free, true)) {
+            slot = candidate;
+        }
+    }
+
+    if (slot == NULL) {
+        // a whole cache line per slot, so threads entering calls never write to each other's lines
+        slot = aligned_alloc(SLOT_BYTES, SLOT_BYTES);
+
+        if (slot == NULL) {
+            return NULL;
+        }
+
+        memset(slot, 0, SLOT_BYTES);
+        atomic_init(&slot->depth, 0);
+        atomic_init(&slot->inUse, true);
+        slot->next = atomic_load(&slots);
+
+        while (!atomic_compare_exchange_weak(&slots, &slot->next, slot)) {
+        }
+    }
+
+    pthread_setspecific(threadKey, slot);
+    threadSlot = slot;
+
+    return slot;
+}
+
+bool lifecycleEnter(void) {
+    lifecycleSlot_t *slot = currentSlot();
+
+    if (slot == NULL) {
+        return false;
+    }
+
+    int depth = atomic_load_explicit(&slot->depth, memory_order_relaxed);
+
+    atomic_store(&slot->depth, depth + 1);
+
+    if (atomic_load(&state) == LIFECYCLE_RUNNING) {
+        return true;
+    }
+
+    atomic_store_explicit(&slot->depth, depth, memory_order_release);
+    return false;
+}
+
+int lifecycleDepth(void) {
+    return threadSlot != NULL ? atomic_load_explicit(&threadSlot->depth, memory_order_relaxed) : 0;
+}
+
+void lifecycleRestore(const int *depth) {
+    // release, so everything the call did happens before a teardown that sees the slot drop
+    if (threadSlot != NULL && atomic_load_explicit(&threadSlot->depth, memory_order_relaxed) != *depth) {
+        atomic_store_explicit(&threadSlot->depth, *depth, memory_order_release);
+    }
+}
+
+bool lifecycleBeginSetup(void) {
+    // a setup from inside a call (e.g. a bulk progress listener) would wait on a teardown waiting on that call
+    if (lifecycleDepth() > 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&transitionLock);
+
+    if (atomic_load(&state) != LIFECYCLE_STOPPED) {
+        pthread_mutex_unlock(&transitionLock);
+        return false;
+    }
+
+    atomic_store(&state, LIFECYCLE_STARTING);
+    return true;
+}
+
+void lifecycleEndSetup(bool running) {
+    atomic_store(&state, running ? LIFECYCLE_RUNNING : LIFECYCLE_STOPPED);
+    pthread_mutex_unlock(&transitionLock);
+}
+
+/*
+ * Wait until a slot's thread has left its calls
+ * @param slot the slot
+ */
+static void drainSlot(lifecycleSlot_t *slot) {
+    for (int spins = 0; atomic_load_explicit(&slot->depth, memory_order_acquire) != 0; spins++) {
+        if (spins < DRAIN_SPINS) {
+            sched_yield();
+        } else {
+            struct timespec pause = { 0, DRAIN_SLEEP_NANOS };
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+bool lifecycleBeginTeardown(void) {
+    if (lifecycleDepth() > 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&transitionLock);
+
+    if (atomic_load(&state) != LIFECYCLE_RUNNING) {
+        pthread_mutex_unlock(&transitionLock);
+        return false;
+    }
+
+    atomic_store(&state, LIFECYCLE_DRAINING);
+
+    // a slot added after this walk belongs to a thread that will see the new state
+    for (lifecycleSlot_t *slot = atomic_load(&slots); slot != NULL; slot = slot->next) {
+        drainSlot(slot);
+    }
+
+    return true;
+}
+
+void lifecycleEndTeardown(void) {
+    atomic_store(&state, LIFECYCLE_STOPPED);
+    pthread_mutex_unlock(&transitionLock);
+}
+
+bool lifecycleRunning(void) {
+    return atomic_load(&state) == LIFECYCLE_RUNNING;
+}
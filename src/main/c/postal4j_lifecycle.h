@@ -0,0 +1,47 @@
+/*
+ * postal4j_lifecycle.h
+ * Setup/teardown state and the per-thread in-flight call tracking that lets teardown wait for running calls
+ */
+
+#ifndef POSTAL4J_LIFECYCLE_H
+#define POSTAL4J_LIFECYCLE_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    LIFECYCLE_STOPPED = 0,
+    LIFECYCLE_STARTING,
+    LIFECYCLE_RUNNING,
+    LIFECYCLE_DRAINING
+} lifecycleState_t;
+
+// Every function that calls lifecycleEnter (directly or through requireModules) declares LIFECYCLE_CALL first.
+// It records the thread's call depth and restores it when the function returns, on every return path, so each
+// successful lifecycleEnter is matched without explicit leave calls.
+#define LIFECYCLE_CALL int lifecycleCallDepth __attribute__((cleanup(lifecycleRestore))) = lifecycleDepth()
+
+// Call side, lock-free: the thread marks itself in a call and then checks the state, false if not running
+bool lifecycleEnter(void);
+int lifecycleDepth(void);
+void lifecycleRestore(const int *depth);
+
+// Setup side, serialized by a lock that the call side never takes. A setup or teardown started while another one
+// runs waits for it. Begin returns false (without holding the lock) when the state does not allow the transition.
+bool lifecycleBeginSetup(void);
+void lifecycleEndSetup(bool running);
+
+// Stops new calls and waits until no thread is inside one, the caller must not be inside a call itself
+bool lifecycleBeginTeardown(void);
+void lifecycleEndTeardown(void);
+
+bool lifecycleRunning(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POSTAL4J_LIFECYCLE_H
@@ -0,0 +1,172 @@
+/*
+ * postal4j_match.c
+ * Address pair match scoring over hashed libpostal expansion sets
+ *
+ * Each side is expanded (through the result cache, so repeated addresses cost one lookup), every expansion is
+ * reduced to a 64-bit hash and the hashes are sorted and deduplicated, so the overlap of two sets is a single
+ * merge pass over two small integer arrays instead of string comparisons.
+ */
+
+#include "postal4j_match.h"
+#include "postal4j_cache.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Expansion sets up to this size are hashed on the stack, libpostal rarely produces more
+#define INLINE_HASHES 32
+
+typedef struct {
+    uint64_t *hashes;
+    size_t count;
+    uint64_t inlineHashes[INLINE_HASHES];
+} expansionSet_t;
+
+/*
+ * 64-bit FNV-1a hash of a NUL terminated string
+ * @param value the string
+ * @return the hash
+ */
+static uint64_t hashExpansion(const char *value) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const char *c = value; *c != '\0'; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static int compareHashes(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+
+    return (left > right) - (left < right);
+}
+
+/*
+ * Expand an address into a sorted set of expansion hashes
+ * @param address the address
+ * @param options the normalize options
+ * @param root true for the root expansions
+ * @param set the set to populate, always release it with releaseExpansionSet
+ * @return true on success, false if the address could not be expanded
+ */
+static bool loadExpansionSet(char *address, libpostal_normalize_options_t options, bool root, expansionSet_t *set) {
+    set->hashes = set->inlineHashes;
+    set->count = 0;
+
+    size_t numExpansions = 0;
+    char **expansions = cachedExpandAddress(address, options, root, &numExpansions);
+
+    if (expansions == NULL) {
+        return false;
+    }
+
+    if (numExpansions > INLINE_HASHES) {
+        set->hashes = malloc(numExpansions * sizeof(uint64_t));
+
+        if (set->hashes == NULL) {
+            set->hashes = set->inlineHashes;
+            libpostal_expansion_array_destroy(expansions, numExpansions);
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < numExpansions; i++) {
+        set->hashes[i] = hashExpansion(expansions[i]);
+    }
+
+    libpostal_expansion_array_destroy(expansions, numExpansions);
+
+    qsort(set->hashes, numExpansions, sizeof(uint64_t), compareHashes);
+
+    // drop duplicates in place, e.g. two normalizations that land on the same string
+    for (size_t i = 0; i < numExpansions; i++) {
+        if (set->count == 0 || set->hashes[set->count - 1] != set->hashes[i]) {
+            set->hashes[set->count++] = set->hashes[i];
+        }
+    }
+
+    return true;
+}
+
+static void releaseExpansionSet(expansionSet_t *set) {
+    if (set->hashes != set->inlineHashes) {
+        free(set->hashes);
+    }
+}
+
+/*
+ * Jaccard similarity of two sorted hash sets
+ * @param left the left set
+ * @param right the right set
+ * @return the similarity, 0 when either set is empty
+ */
+static float jaccard(const expansionSet_t *left, const expansionSet_t *right) {
+    size_t shared = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < left->count && j < right->count) {
+        if (left->hashes[i] == right->hashes[j]) {
+            shared++;
+            i++;
+            j++;
+        } else if (left->hashes[i] < right->hashes[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+
+    return shared > 0 ? (float)shared / (float)(left->count + right->count - shared) : 0.0f;
+}
+
+/*
+ * Score a pair on one kind of expansion
+ * @param left the left address
+ * @param right the right address
+ * @param options the normalize options
+ * @param root true for the root expansions
+ * @return the similarity, or MATCH_ERROR
+ */
+static float expansionScore(char *left, char *right, libpostal_normalize_options_t options, bool root) {
+    expansionSet_t leftSet;
+    expansionSet_t rightSet;
+    float score = MATCH_ERROR;
+
+    if (loadExpansionSet(left, options, root, &leftSet)) {
+        if (loadExpansionSet(right, options, root, &rightSet)) {
+            score = jaccard(&leftSet, &rightSet);
+        }
+
+        releaseExpansionSet(&rightSet);
+    }
+
+    releaseExpansionSet(&leftSet);
+
+    return score;
+}
+
+float matchScore(char *left, char *right, libpostal_normalize_options_t options) {
+    // the same text always expands to the same set
+    if (strcmp(left, right) == 0) {
+        return 1.0f;
+    }
+
+    float score = expansionScore(left, right, options, false);
+
+    // root expansions drop street types, directions, unit designators etc., so pairs that only differ in those still score
+    if (score == 0.0f) {
+        score = expansionScore(left, right, options, true);
+
+        if (score > 0.0f) {
+            score *= MATCH_ROOT_WEIGHT;
+        }
+    }
+
+    return score;
+}
@@ -0,0 +1,30 @@
+/*
+ * postal4j_match.h
+ * Address pair match scoring over hashed libpostal expansion sets
+ */
+
+#ifndef POSTAL4J_MATCH_H
+#define POSTAL4J_MATCH_H
+
+#include <libpostal.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Weight of a score that only matched on root expansions, at most 0.5. This is not a separate band: a weak full-expansion
+// match (a small overlap of large sets) can still score below a strong root-only one
+#define MATCH_ROOT_WEIGHT 0.5f
+
+// Returned by matchScore when an address could not be expanded
+#define MATCH_ERROR (-1.0f)
+
+// Jaccard similarity in [0, 1] of the expansion sets of two addresses, falling back to the weighted similarity of
+// their root expansions when the full sets share nothing. Safe to call from the worker pool.
+float matchScore(char *left, char *right, libpostal_normalize_options_t options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_MATCH_H */
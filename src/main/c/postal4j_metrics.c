@@ -0,0 +1,422 @@
+/*
+ * postal4j_metrics.c
+ * Optional per-entry-point, per-stage latency histograms and slowest-input capture
+ *
+ * Every thread records into its own block of counters, so the hot path is a few relaxed loads and stores
+ * with no locks and no shared cache lines. Blocks are linked into a global list (CAS push) that snapshots
+ * walk and sum; a thread's block is handed to the next new thread when it exits, so counts are never lost.
+ * Only calls slower than the fastest captured slow input take the slow-input lock.
+ */
+
+#include "postal4j_metrics.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+    _Atomic uint64_t buckets[METRICS_BUCKETS];
+} histogram_t;
+
+typedef struct {
+    _Atomic uint64_t calls;
+    _Atomic uint64_t errors;
+    histogram_t stages[NUM_METRICS_STAGES];
+} entryMetrics_t;
+
+typedef struct threadMetrics {
+    entryMetrics_t entries[NUM_METRICS_ENTRIES];
+    atomic_bool inUse;
+    struct threadMetrics *next;
+} threadMetrics_t;
+
+// The call being timed on this thread
+typedef struct {
+    bool active;
+    metricsEntry_t entry;
+    uint64_t start;
+    uint64_t last;
+    uint64_t stageNanos[NUM_METRICS_STAGES];
+} callTimer_t;
+
+static atomic_bool enabled = false;
+static _Atomic(threadMetrics_t*) threadBlocks = NULL;
+static pthread_key_t threadKey;
+static pthread_once_t threadKeyOnce = PTHREAD_ONCE_INIT;
+
+static _Thread_local threadMetrics_t *threadBlock = NULL;
+static _Thread_local callTimer_t timer;
+
+// Slowest calls, unordered; threshold is the fastest of them once full so faster calls skip the lock
+static pthread_mutex_t slowLock = PTHREAD_MUTEX_INITIALIZER;
+static metricsSlowInput_t *slowInputs = NULL;
+static size_t slowCapacity = 0;
+static size_t slowCount = 0;
+static _Atomic uint64_t slowThreshold = UINT64_MAX;
+
+static uint64_t nowNanos(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * Relaxed add for a counter only its owning thread writes, no locked instruction needed
+ * @param counter the counter
+ * @param value the value to add
+ */
+static inline void addRelaxed(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/*
+ * Get the histogram bucket of a value
+ * @param nanos the value
+ * @return the bucket index
+ */
+static size_t bucketIndex(uint64_t nanos) {
+    if (nanos < METRICS_SUB_BUCKETS) {
+        return (size_t)nanos;
+    }
+
+    int exponent = 63 - __builtin_clzll(nanos);
+
+    if (exponent >= METRICS_MAX_EXPONENT) {
+        return METRICS_BUCKETS - 1;
+    }
+
+    return (size_t)(exponent - 2) * METRICS_SUB_BUCKETS + (size_t)((nanos >> (exponent - 3)) & (METRICS_SUB_BUCKETS - 1));
+}
+
+static void recordValue(histogram_t *histogram, uint64_t nanos) {
+    addRelaxed(&histogram->count, 1);
+    addRelaxed(&histogram->sum, nanos);
+    addRelaxed(&histogram->buckets[bucketIndex(nanos)], 1);
+
+    if (nanos > atomic_load_explicit(&histogram->max, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max, nanos, memory_order_relaxed);
+    }
+}
+
+/*
+ * Thread exit hook, hands the thread's block to the next thread that needs one
+ * @param block the exiting thread's block
+ */
+static void releaseThreadBlock(void *block) {
+    atomic_store_explicit(&((threadMetrics_t*)block)->inUse, false, memory_order_release);
+}
+
+static void createThreadKey(void) {
+    pthread_key_create(&threadKey, releaseThreadBlock);
+}
+
+/*
+ * Get the calling thread's block, reusing one of an exited thread or adding a new one to the list
+ * @return the block, or NULL if none could be allocated
+ */
+static threadMetrics_t *currentThreadBlock(void) {
+    if (threadBlock != NULL) {
+        return threadBlock;
+    }
+
+    pthread_once(&threadKeyOnce, createThreadKey);
+
+    threadMetrics_t *block = NULL;
+
+    for (threadMetrics_t *candidate = atomic_load(&threadBlocks); candidate != NULL && block == NULL; candidate = candidate->next) {
+        bool free = false;
+
+        if (atomic_compare_exchange_strong(&candidate->inUse, &free, true)) {
+            block = candidate;
+        }
+    }
+
+    if (block == NULL) {
+        block = calloc(1, sizeof(threadMetrics_t));
+
+        if (block == NULL) {
+            return NULL;
+        }
+
+        atomic_init(&block->inUse, true);
+        block->next = atomic_load(&threadBlocks);
+
+        while (!atomic_compare_exchange_weak(&threadBlocks, &block->next, block)) {
+        }
+    }
+
+    pthread_setspecific(threadKey, block);
+    threadBlock = block;
+
+    return block;
+}
+
+bool metricsEnable(size_t slowInputs_) {
+    if (slowInputs_ > MAX_METRICS_SLOW_INPUTS) {
+        return false;
+    }
+
+    pthread_mutex_lock(&slowLock);
+
+    if (slowInputs_ != slowCapacity) {
+        metricsSlowInput_t *resized = (slowInputs_ > 0 ? calloc(slowInputs_, sizeof(metricsSlowInput_t)) : NULL);
+
+        if (slowInputs_ > 0 && resized == NULL) {
+            pthread_mutex_unlock(&slowLock);
+            return false;
+        }
+
+        free(slowInputs);
+        slowInputs = resized;
+        slowCapacity = slowInputs_;
+        slowCount = 0;
+        atomic_store(&slowThreshold, slowCapacity > 0 ? 0 : UINT64_MAX);
+    }
+
+    pthread_mutex_unlock(&slowLock);
+
+    atomic_store(&enabled, true);
+    return true;
+}
+
+void metricsDisable(void) {
+    atomic_store(&enabled, false);
+}
+
+bool metricsEnabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+void metricsReset(void) {
+    // racing calls may keep a few counts from before the reset, the counters stay single-writer
+    for (threadMetrics_t *block = atomic_load(&threadBlocks); block != NULL; block = block->next) {
+        for (size_t e = 0; e < NUM_METRICS_ENTRIES; e++) {
+            entryMetrics_t *entry = &block->entries[e];
+
+            atomic_store_explicit(&entry->calls, 0, memory_order_relaxed);
+            atomic_store_explicit(&entry->errors, 0, memory_order_relaxed);
+
+            for (size_t s = 0; s < NUM_METRICS_STAGES; s++) {
+                histogram_t *histogram = &entry->stages[s];
+
+                atomic_store_explicit(&histogram->count, 0, memory_order_relaxed);
+                atomic_store_explicit(&histogram->sum, 0, memory_order_relaxed);
+                atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
+
+                for (size_t b = 0; b < METRICS_BUCKETS; b++) {
+                    atomic_store_explicit(&histogram->buckets[b], 0, memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    pthread_mutex_lock(&slowLock);
+    slowCount = 0;
+    atomic_store(&slowThreshold, slowCapacity > 0 ? 0 : UINT64_MAX);
+    pthread_mutex_unlock(&slowLock);
+}
+
+void metricsBegin(metricsEntry_t entry) {
+    timer.active = metricsEnabled();
+
+    if (!timer.active) {
+        return;
+    }
+
+    timer.entry = entry;
+    timer.start = nowNanos();
+    timer.last = timer.start;
+    memset(timer.stageNanos, 0, sizeof(timer.stageNanos));
+}
+
+void metricsStage(metricsStage_t stage) {
+    if (!timer.active) {
+        return;
+    }
+
+    uint64_t now = nowNanos();
+
+    timer.stageNanos[stage] += now - timer.last;
+    timer.last = now;
+}
+
+/*
+ * Copy at most METRICS_SLOW_INPUT_BYTES - 1 bytes of a UTF-8 string, not splitting a character
+ * @param target the NUL terminated copy
+ * @param input the input, or NULL
+ */
+static void copyInput(char *target, const char *input) {
+    size_t length = (input != NULL ? strnlen(input, METRICS_SLOW_INPUT_BYTES) : 0);
+
+    if (length == METRICS_SLOW_INPUT_BYTES) {
+        length--;
+
+        while (length > 0 && ((unsigned char)input[length] & 0xC0) == 0x80) {
+            length--;
+        }
+    }
+
+    if (length > 0) {
+        memcpy(target, input, length);
+    }
+
+    target[length] = '\0';
+}
+
+/*
+ * Capture a call if it is one of the slowest so far
+ * @param total the call's total time
+ * @param input the call's input
+ */
+static void captureSlowInput(uint64_t total, const char *input) {
+    pthread_mutex_lock(&slowLock);
+
+    size_t slot = slowCount;
+
+    if (slowCount == slowCapacity) {
+        // replace the fastest captured call if this one is slower
+        slot = 0;
+
+        for (size_t i = 1; i < slowCount; i++) {
+            if (slowInputs[i].stageNanos[METRICS_STAGE_TOTAL] < slowInputs[slot].stageNanos[METRICS_STAGE_TOTAL]) {
+                slot = i;
+            }
+        }
+
+        if (slowCount == 0 || (uint64_t)slowInputs[slot].stageNanos[METRICS_STAGE_TOTAL] >= total) {
+            pthread_mutex_unlock(&slowLock);
+            return;
+        }
+    } else {
+        slowCount++;
+    }
+
+    metricsSlowInput_t *captured = &slowInputs[slot];
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+
+    captured->entry = timer.entry;
+    captured->timestampMillis = (int64_t)wall.tv_sec * 1000 + wall.tv_nsec / 1000000;
+
+    for (size_t s = 0; s < NUM_METRICS_STAGES; s++) {
+        captured->stageNanos[s] = (int64_t)timer.stageNanos[s];
+    }
+
+    copyInput(captured->input, input);
+
+    // once full, only calls slower than the fastest captured one need the lock
+    if (slowCount == slowCapacity) {
+        uint64_t fastest = UINT64_MAX;
+
+        for (size_t i = 0; i < slowCount; i++) {
+            if ((uint64_t)slowInputs[i].stageNanos[METRICS_STAGE_TOTAL] < fastest) {
+                fastest = (uint64_t)slowInputs[i].stageNanos[METRICS_STAGE_TOTAL];
+            }
+        }
+
+        atomic_store(&slowThreshold, fastest);
+    }
+
+    pthread_mutex_unlock(&slowLock);
+}
+
+void metricsEnd(bool error, const char *input) {
+    if (!timer.active) {
+        return;
+    }
+
+    timer.active = false;
+
+    uint64_t now = nowNanos();
+
+    timer.stageNanos[METRICS_STAGE_RESULT] += now - timer.last;
+    timer.stageNanos[METRICS_STAGE_TOTAL] = now - timer.start;
+
+    threadMetrics_t *block = currentThreadBlock();
+
+    if (block == NULL) {
+        return;
+    }
+
+    entryMetrics_t *entry = &block->entries[timer.entry];
+
+    addRelaxed(&entry->calls, 1);
+
+    if (error) {
+        addRelaxed(&entry->errors, 1);
+    }
+
+    for (size_t s = 0; s < NUM_METRICS_STAGES; s++) {
+        recordValue(&entry->stages[s], timer.stageNanos[s]);
+    }
+
+    if (timer.stageNanos[METRICS_STAGE_TOTAL] > atomic_load_explicit(&slowThreshold, memory_order_relaxed)) {
+        captureSlowInput(timer.stageNanos[METRICS_STAGE_TOTAL], input);
+    }
+}
+
+void metricsSnapshot(int64_t *out) {
+    memset(out, 0, METRICS_SNAPSHOT_LONGS * sizeof(int64_t));
+
+    for (threadMetrics_t *block = atomic_load(&threadBlocks); block != NULL; block = block->next) {
+        for (size_t e = 0; e < NUM_METRICS_ENTRIES; e++) {
+            entryMetrics_t *entry = &block->entries[e];
+            int64_t *entryOut = out + e * METRICS_ENTRY_LONGS;
+
+            entryOut[0] += (int64_t)atomic_load_explicit(&entry->calls, memory_order_relaxed);
+            entryOut[1] += (int64_t)atomic_load_explicit(&entry->errors, memory_order_relaxed);
+
+            for (size_t s = 0; s < NUM_METRICS_STAGES; s++) {
+                histogram_t *histogram = &entry->stages[s];
+                int64_t *stageOut = entryOut + 2 + s * METRICS_STAGE_LONGS;
+                int64_t max = (int64_t)atomic_load_explicit(&histogram->max, memory_order_relaxed);
+
+                stageOut[0] += (int64_t)atomic_load_explicit(&histogram->count, memory_order_relaxed);
+                stageOut[1] += (int64_t)atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+                stageOut[2] = (max > stageOut[2] ? max : stageOut[2]);
+
+                for (size_t b = 0; b < METRICS_BUCKETS; b++) {
+                    stageOut[3 + b] += (int64_t)atomic_load_explicit(&histogram->buckets[b], memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+
+static int compareSlowest(const void *left, const void *right) {
+    int64_t l = ((const metricsSlowInput_t*)left)->stageNanos[METRICS_STAGE_TOTAL];
+    int64_t r = ((const metricsSlowInput_t*)right)->stageNanos[METRICS_STAGE_TOTAL];
+
+    return (l < r) - (l > r);
+}
+
+size_t metricsSlowInputs(metricsSlowInput_t *out, size_t capacity) {
+    pthread_mutex_lock(&slowLock);
+
+    size_t count = (slowCount < capacity ? slowCount : capacity);
+
+    if (slowCount <= capacity) {
+        memcpy(out, slowInputs, count * sizeof(metricsSlowInput_t));
+    } else {
+        // more captured than asked for, sort a copy so the slowest ones are returned
+        metricsSlowInput_t *sorted = malloc(slowCount * sizeof(metricsSlowInput_t));
+
+        if (sorted == NULL) {
+            count = 0;
+        } else {
+            memcpy(sorted, slowInputs, slowCount * sizeof(metricsSlowInput_t));
+            qsort(sorted, slowCount, sizeof(metricsSlowInput_t), compareSlowest);
+            memcpy(out, sorted, count * sizeof(metricsSlowInput_t));
+            free(sorted);
+        }
+    }
+
+    pthread_mutex_unlock(&slowLock);
+
+    qsort(out, count, sizeof(metricsSlowInput_t), compareSlowest);
+    return count;
+}
@@ -0,0 +1,81 @@
+/*
+ * postal4j_metrics.h
+ * Optional per-entry-point, per-stage latency histograms and slowest-input capture
+ */
+
+#ifndef POSTAL4J_METRICS_H
+#define POSTAL4J_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The order here is the ordinal order of com.dnebinger.postal4j.MetricsEntryPoint
+typedef enum {
+    METRICS_PARSE = 0,
+    METRICS_PARSE_COMPACT,
+    METRICS_EXPAND,
+    METRICS_EXPAND_ROOT,
+    METRICS_PARSE_BATCH,
+    METRICS_EXPAND_BATCH,
+    NUM_METRICS_ENTRIES
+} metricsEntry_t;
+
+// The order here is the ordinal order of com.dnebinger.postal4j.MetricsStage
+typedef enum {
+    METRICS_STAGE_INPUT = 0,
+    METRICS_STAGE_LIBPOSTAL,
+    METRICS_STAGE_RESULT,
+    METRICS_STAGE_TOTAL,
+    NUM_METRICS_STAGES
+} metricsStage_t;
+
+// Log-linear histogram: values below 8 ns are exact, above that every power of two is split into 8 buckets
+// (12.5% precision), up to 2^40 ns (about 18 minutes) where the last bucket collects everything longer
+#define METRICS_SUB_BUCKETS 8
+#define METRICS_MAX_EXPONENT 40
+#define METRICS_BUCKETS ((METRICS_MAX_EXPONENT - 2) * METRICS_SUB_BUCKETS)
+
+// Snapshot layout, per entry point: calls, errors, then per stage: count, total ns, max ns and the bucket counts
+#define METRICS_STAGE_LONGS (3 + METRICS_BUCKETS)
+#define METRICS_ENTRY_LONGS (2 + NUM_METRICS_STAGES * METRICS_STAGE_LONGS)
+#define METRICS_SNAPSHOT_LONGS (NUM_METRICS_ENTRIES * METRICS_ENTRY_LONGS)
+
+// Slow inputs keep at most this many UTF-8 bytes of the input
+#define METRICS_SLOW_INPUT_BYTES 256
+#define MAX_METRICS_SLOW_INPUTS 1024
+
+typedef struct {
+    metricsEntry_t entry;
+    int64_t timestampMillis;
+    int64_t stageNanos[NUM_METRICS_STAGES];
+    char input[METRICS_SLOW_INPUT_BYTES];
+} metricsSlowInput_t;
+
+// Turns recording on, keeping the slowest slowInputs calls (0 for none); changing the capacity drops the captured inputs
+bool metricsEnable(size_t slowInputs);
+void metricsDisable(void);
+bool metricsEnabled(void);
+void metricsReset(void);
+
+// Call timing on the calling thread: begin, mark the end of each stage, end. All three do nothing while disabled.
+// The time since the last mark is added to the RESULT stage at the end, TOTAL is the whole call.
+void metricsBegin(metricsEntry_t entry);
+void metricsStage(metricsStage_t stage);
+void metricsEnd(bool error, const char *input);
+
+// Sums the counters of every thread into out (METRICS_SNAPSHOT_LONGS values)
+void metricsSnapshot(int64_t *out);
+
+// Copies the captured slow inputs, slowest first, returns the number copied
+size_t metricsSlowInputs(metricsSlowInput_t *out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_METRICS_H */
@@ -0,0 +1,326 @@
+/*
+ * postal4j_pool.c
+ * Native work-stealing worker pool used to spread batch requests across cores
+ *
+ * Every batch is split into one contiguous index range per participant (the workers plus the
+ * calling thread). A participant takes indexes one at a time from the front of its own range,
+ * and once that is empty steals the back half of the largest remaining range of another
+ * participant. Ranges are a single 64-bit word (begin << 32 | end) updated with CAS, so owners
+ * and thieves never take a lock, and an expensive address only delays its own range until
+ * someone steals the rest of it.
+ */
+
+#include "postal4j_pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CACHE_LINE_SIZE 64
+
+// A participant's range, padded so owners and thieves on different ranges do not share cache lines
+typedef struct {
+    _Atomic uint64_t range;
+    char padding[CACHE_LINE_SIZE - sizeof(uint64_t)];
+} workRange_t;
+
+typedef struct {
+    poolTask_t task;
+    void *context;
+    size_t numParticipants;
+    workRange_t *ranges;
+} poolJob_t;
+
+typedef struct {
+    pthread_t *threads;
+    int numWorkers;
+    pthread_mutex_t mutex;
+    pthread_cond_t jobReady;
+    pthread_cond_t jobDone;
+    pthread_mutex_t runMutex;
+    poolJob_t *job;
+    uint64_t generation;
+    int finished;
+    bool shutdown;
+} workerPool_t;
+
+static workerPool_t *pool = NULL;
+
+static inline uint64_t packRange(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+static inline uint32_t rangeBegin(uint64_t range) {
+    return (uint32_t)(range >> 32);
+}
+
+static inline uint32_t rangeEnd(uint64_t range) {
+    return (uint32_t)range;
+}
+
+/*
+ * Take the next index from the front of a range
+ * @param workRange the range
+ * @param index set to the index taken
+ * @return true if an index was taken, false if the range is empty
+ */
+static bool popFront(workRange_t *workRange, uint32_t *index) {
+    uint64_t range = atomic_load_explicit(&workRange->range, memory_order_acquire);
+
+    while (rangeBegin(range) < rangeEnd(range)) {
+        if (atomic_compare_exchange_weak_explicit(&workRange->range, &range, packRange(rangeBegin(range) + 1, rangeEnd(range)),
+                memory_order_acq_rel, memory_order_acquire)) {
+            *index = rangeBegin(range);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Steal the back half of the largest range of another participant and make it our own range
+ * @param job the job
+ * @param self the index of the stealing participant
+ * @return true if work was stolen, false if every range is empty
+ */
+static bool steal(poolJob_t *job, size_t self) {
+    for (;;) {
+        size_t victim = job->numParticipants;
+        uint64_t victimRange = 0;
+        uint32_t largest = 0;
+
+        for (size_t i = 0; i < job->numParticipants; i++) {
+            if (i == self) {
+                continue;
+            }
+
+            uint64_t range = atomic_load_explicit(&job->ranges[i].range, memory_order_acquire);
+            uint32_t remaining = (rangeBegin(range) < rangeEnd(range) ? rangeEnd(range) - rangeBegin(range) : 0);
+
+            if (remaining > largest) {
+                largest = remaining;
+                victim = i;
+                victimRange = range;
+            }
+        }
+
+        if (victim == job->numParticipants) {
+            return false;
+        }
+
+        uint32_t half = (largest + 1) / 2;
+        uint32_t begin = rangeBegin(victimRange);
+        uint32_t end = rangeEnd(victimRange);
+
+        // shrink the victim's range from the back, retry the scan if the victim moved meanwhile
+        if (atomic_compare_exchange_strong_explicit(&job->ranges[victim].range, &victimRange, packRange(begin, end - half),
+                memory_order_acq_rel, memory_order_acquire)) {
+            // our own range is empty, so nobody else will modify it until we publish the stolen work
+            atomic_store_explicit(&job->ranges[self].range, packRange(end - half, end), memory_order_release);
+            return true;
+        }
+    }
+}
+
+/*
+ * Run a participant until no work is left anywhere in the job
+ * @param job the job
+ * @param self the index of the participant
+ */
+static void runParticipant(poolJob_t *job, size_t self) {
+    uint32_t index;
+
+    do {
+        while (popFront(&job->ranges[self], &index)) {
+            job->task(index, job->context);
+        }
+    } while (steal(job, self));
+}
+
+/*
+ * Worker thread main loop
+ * @param arg the participant index of the worker
+ * @return NULL
+ */
+static void *workerMain(void *arg) {
+    size_t self = (size_t)(uintptr_t)arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->jobReady, &pool->mutex);
+        }
+
+        if (pool->shutdown) {
+            break;
+        }
+
+        seen = pool->generation;
+        poolJob_t *job = pool->job;
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        runParticipant(job, self);
+
+        pthread_mutex_lock(&pool->mutex);
+
+        if (++pool->finished == pool->numWorkers) {
+            pthread_cond_signal(&pool->jobDone);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+/*
+ * Start the worker pool
+ * @param numWorkers the number of worker threads, 0 runs every batch on the calling thread
+ * @return true on success, false if the threads could not be started
+ */
+bool poolStart(int numWorkers) {
+    if (pool != NULL || numWorkers < 0 || numWorkers > MAX_POOL_WORKERS) {
+        return false;
+    }
+
+    if (numWorkers == 0) {
+        return true;
+    }
+
+    workerPool_t *created = calloc(1, sizeof(workerPool_t));
+
+    if (created == NULL) {
+        return false;
+    }
+
+    created->threads = calloc((size_t)numWorkers, sizeof(pthread_t));
+
+    if (created->threads == NULL) {
+        free(created);
+        return false;
+    }
+
+    pthread_mutex_init(&created->mutex, NULL);
+    pthread_mutex_init(&created->runMutex, NULL);
+    pthread_cond_init(&created->jobReady, NULL);
+    pthread_cond_init(&created->jobDone, NULL);
+
+    pool = created;
+
+    // the calling thread is participant 0, workers are 1..numWorkers
+    for (int i = 0; i < numWorkers; i++) {
+        if (pthread_create(&created->threads[i], NULL, workerMain, (void*)(uintptr_t)(i + 1)) != 0) {
+            created->numWorkers = i;
+            poolStop();
+            return false;
+        }
+    }
+
+    created->numWorkers = numWorkers;
+
+    return true;
+}
+
+/*
+ * Stop the worker pool and join its threads, no batch may be running
+ */
+void poolStop(void) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->jobReady);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->numWorkers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->jobDone);
+    pthread_cond_destroy(&pool->jobReady);
+    pthread_mutex_destroy(&pool->runMutex);
+    pthread_mutex_destroy(&pool->mutex);
+
+    free(pool->threads);
+    free(pool);
+    pool = NULL;
+}
+
+/*
+ * @return the number of worker threads, 0 when batches run on the calling thread
+ */
+int poolWorkers(void) {
+    return (pool != NULL ? pool->numWorkers : 0);
+}
+
+/*
+ * Run a task for every index of a batch and wait for all of them to complete.
+ * The calling thread takes part in the work. When the pool is already busy with another
+ * batch the calling thread runs its batch alone rather than queueing behind it.
+ * @param count the number of indexes
+ * @param task the task
+ * @param context the task context
+ */
+void poolRun(size_t count, poolTask_t task, void *context) {
+    if (count == 0) {
+        return;
+    }
+
+    if (pool == NULL || count == 1 || count > UINT32_MAX || pthread_mutex_trylock(&pool->runMutex) != 0) {
+        for (size_t i = 0; i < count; i++) {
+            task(i, context);
+        }
+        return;
+    }
+
+    size_t numParticipants = (size_t)pool->numWorkers + 1;
+    workRange_t *ranges = NULL;
+
+    if (posix_memalign((void**)&ranges, CACHE_LINE_SIZE, numParticipants * sizeof(workRange_t)) != 0) {
+        pthread_mutex_unlock(&pool->runMutex);
+
+        for (size_t i = 0; i < count; i++) {
+            task(i, context);
+        }
+        return;
+    }
+
+    // split the batch evenly, stealing evens out whatever imbalance the address lengths cause
+    for (size_t i = 0; i < numParticipants; i++) {
+        uint32_t begin = (uint32_t)(count * i / numParticipants);
+        uint32_t end = (uint32_t)(count * (i + 1) / numParticipants);
+
+        atomic_init(&ranges[i].range, packRange(begin, end));
+    }
+
+    poolJob_t job = { task, context, numParticipants, ranges };
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = &job;
+    pool->finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->jobReady);
+    pthread_mutex_unlock(&pool->mutex);
+
+    runParticipant(&job, 0);
+
+    // every worker has to leave the job before its ranges can be freed
+    pthread_mutex_lock(&pool->mutex);
+
+    while (pool->finished < pool->numWorkers) {
+        pthread_cond_wait(&pool->jobDone, &pool->mutex);
+    }
+
+    pool->job = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+
+    free(ranges);
+
+    pthread_mutex_unlock(&pool->runMutex);
+}
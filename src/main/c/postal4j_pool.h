@@ -0,0 +1,31 @@
+/*
+ * postal4j_pool.h
+ * Native work-stealing worker pool used to spread batch requests across cores
+ */
+
+#ifndef POSTAL4J_POOL_H
+#define POSTAL4J_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Upper bound on the number of worker threads
+#define MAX_POOL_WORKERS 1024
+
+// Task invoked once for every index of a batch, must not call back into the JVM
+typedef void (*poolTask_t)(size_t index, void *context);
+
+bool poolStart(int numWorkers);
+void poolStop(void);
+int poolWorkers(void);
+void poolRun(size_t count, poolTask_t task, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_POOL_H */
@@ -0,0 +1,184 @@
+/*
+ * postal4j_results.c
+ * Flat serialization of libpostal parse and expand results, used by the result cache and the sidecar
+ *
+ * A result is a uint32 string count followed by that many NUL terminated strings: label/value pairs
+ * for a parse, one string per expansion for an expand. Decoding rebuilds the result with malloc'd
+ * strings, compatible with the libpostal destroy functions.
+ */
+
+#include "postal4j_results.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Read the string count at the front of a serialized result
+ * @param value the serialized result
+ * @param strings set to the first string
+ * @return the count
+ */
+static uint32_t readCount(const nativeBuffer_t *value, const char **strings) {
+    uint32_t count;
+
+    memcpy(&count, value->data, sizeof(count));
+    *strings = value->data + sizeof(count);
+
+    return count;
+}
+
+/*
+ * Copy the next string out of a serialized result
+ * @param strings the current string, advanced past it
+ * @return the malloc'd copy, or NULL if out of memory
+ */
+static char *nextString(const char **strings) {
+    size_t length = strlen(*strings) + 1;
+    char *copy = malloc(length);
+
+    if (copy != NULL) {
+        memcpy(copy, *strings, length);
+    }
+
+    *strings += length;
+
+    return copy;
+}
+
+/*
+ * Rebuild a parser response from a serialized result
+ * @return the response, or NULL if out of memory
+ */
+libpostal_address_parser_response_t *decodeParseResponse(const nativeBuffer_t *value) {
+    const char *strings;
+    uint32_t count = readCount(value, &strings);
+
+    libpostal_address_parser_response_t *response = calloc(1, sizeof(libpostal_address_parser_response_t));
+
+    if (response == NULL) {
+        return NULL;
+    }
+
+    response->components = calloc(count + 1, sizeof(char*));
+    response->labels = calloc(count + 1, sizeof(char*));
+
+    if (response->components == NULL || response->labels == NULL) {
+        libpostal_address_parser_response_destroy(response);
+        return NULL;
+    }
+
+    // num_components only grows as strings are copied, so a partial response is destroyed cleanly
+    for (uint32_t i = 0; i < count; i++) {
+        response->num_components = i + 1;
+        response->labels[i] = nextString(&strings);
+        response->components[i] = nextString(&strings);
+
+        if (response->labels[i] == NULL || response->components[i] == NULL) {
+            libpostal_address_parser_response_destroy(response);
+            return NULL;
+        }
+    }
+
+    return response;
+}
+
+/*
+ * Rebuild an expansion array from a serialized result
+ * @param n set to the number of expansions
+ * @return the expansions, or NULL if out of memory
+ */
+char **decodeExpansions(const nativeBuffer_t *value, size_t *n) {
+    const char *strings;
+    uint32_t count = readCount(value, &strings);
+
+    char **expansions = calloc(count + 1, sizeof(char*));
+
+    if (expansions == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        expansions[i] = nextString(&strings);
+
+        if (expansions[i] == NULL) {
+            libpostal_expansion_array_destroy(expansions, i);
+            return NULL;
+        }
+    }
+
+    *n = count;
+
+    return expansions;
+}
+
+/*
+ * Serialize a parser response
+ * @return true on success, false if out of memory
+ */
+bool encodeParseResponse(nativeBuffer_t *value, libpostal_address_parser_response_t *response) {
+    uint32_t count = (uint32_t)response->num_components;
+
+    if (!bufferAppend(value, &count, sizeof(count))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < response->num_components; i++) {
+        if (!bufferAppend(value, response->labels[i], strlen(response->labels[i]) + 1)
+                || !bufferAppend(value, response->components[i], strlen(response->components[i]) + 1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Serialize an expansion array
+ * @return true on success, false if out of memory
+ */
+bool encodeExpansions(nativeBuffer_t *value, char **expansions, size_t n) {
+    uint32_t count = (uint32_t)n;
+
+    if (!bufferAppend(value, &count, sizeof(count))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (!bufferAppend(value, expansions[i], strlen(expansions[i]) + 1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Check untrusted bytes hold a complete serialized result, so decoding stays within them
+ * @param data the bytes
+ * @param length the number of bytes
+ * @param pairs true for a parse result, whose strings come in label/value pairs
+ * @return true if the count fits and every counted string is NUL terminated within the bytes
+ */
+bool validResults(const char *data, size_t length, bool pairs) {
+    uint32_t count;
+
+    if (length < sizeof(count)) {
+        return false;
+    }
+
+    memcpy(&count, data, sizeof(count));
+
+    uint64_t strings = (pairs ? 2 * (uint64_t)count : count);
+    size_t offset = sizeof(count);
+
+    for (uint64_t i = 0; i < strings; i++) {
+        const char *end = memchr(data + offset, '\0', length - offset);
+
+        if (end == NULL) {
+            return false;
+        }
+
+        offset = (size_t)(end - data) + 1;
+    }
+
+    return true;
+}
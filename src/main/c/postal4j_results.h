@@ -0,0 +1,33 @@
+/*
+ * postal4j_results.h
+ * Flat serialization of libpostal parse and expand results
+ */
+
+#ifndef POSTAL4J_RESULTS_H
+#define POSTAL4J_RESULTS_H
+
+#include "postal4j_buffer.h"
+#include <libpostal.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Append a result to a buffer, false if out of memory
+bool encodeParseResponse(nativeBuffer_t *value, libpostal_address_parser_response_t *response);
+bool encodeExpansions(nativeBuffer_t *value, char **expansions, size_t n);
+
+// Rebuild a result from a well formed serialized one, NULL if out of memory. Free it with the matching libpostal destroy function.
+libpostal_address_parser_response_t *decodeParseResponse(const nativeBuffer_t *value);
+char **decodeExpansions(const nativeBuffer_t *value, size_t *n);
+
+// Check untrusted bytes hold a complete serialized result, pairs for a parse result
+bool validResults(const char *data, size_t length, bool pairs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_RESULTS_H */
@@ -0,0 +1,913 @@
+/*
+ * postal4j_sidecar.c
+ * Sidecar daemon that loads the libpostal models once per host and serves parse/expand calls to
+ * every JVM on it, over a Unix domain socket with the payloads in shared memory
+ *
+ * Every client thread has its own connection and its own shared memory segment, created by the
+ * client and handed to the daemon with SCM_RIGHTS when connecting. A call writes the request into
+ * the segment and sends an 8 byte header over the socket, the daemon's thread for that connection
+ * writes the serialized result (see postal4j_results.h) over the request and answers with another
+ * header. Calls are synchronous, so one request slot per connection is all the ring a thread needs,
+ * and no payload byte ever goes through the socket.
+ *
+ * A client could shrink its segment while the daemon has it mapped and kill the daemon with SIGBUS.
+ * On Linux segments are memfds sealed against shrinking and the daemon maps no other kind; where
+ * there are no seals only clients running as the daemon's user, who could kill it anyway, are served.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "postal4j_sidecar.h"
+#include "postal4j_buffer.h"
+#include "postal4j_cache.h"
+#include "postal4j_results.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#if defined(MFD_ALLOW_SEALING) && defined(F_GET_SEALS)
+#define SEALED_SHARED_MEMORY 1
+#define SHM_SEALS (F_SEAL_SHRINK | F_SEAL_SEAL)
+#endif
+
+// Permissions of the daemon socket, clients need write access to connect
+#define SOCKET_MODE 0660
+
+// How often the accept loop checks the stop flag
+#define ACCEPT_POLL_MILLIS 250
+
+// Upper bound on the languages of an expand request
+#define MAX_SIDECAR_LANGUAGES 256
+
+// Fixed part of an expand request, followed by the languages and then the address as NUL terminated strings
+typedef struct {
+    uint8_t flags[18];
+    uint16_t addressComponents;
+    uint32_t numLanguages;
+} expandHeader_t;
+
+typedef struct {
+    int socket;
+    char *shm;
+    uint64_t generation;
+} sidecarConnection_t;
+
+// One accepted client on the daemon side
+typedef struct serverConnection {
+    int socket;
+    int modules;
+    struct serverConnection *next;
+} serverConnection_t;
+
+// Client state, the path only changes while no calls are running (setup/teardown)
+static pthread_mutex_t clientLock = PTHREAD_MUTEX_INITIALIZER;
+static char clientPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static atomic_bool active = false;
+static atomic_int servedModules = 0;
+static _Atomic uint64_t generation = 0;
+static atomic_uint shmCounter = 0;
+static pthread_key_t connectionKey;
+static pthread_once_t connectionKeyOnce = PTHREAD_ONCE_INIT;
+static _Thread_local sidecarConnection_t *threadConnection = NULL;
+
+// Daemon state, the open connections are shut down when serving stops
+static pthread_mutex_t serverLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t serverDone = PTHREAD_COND_INITIALIZER;
+static serverConnection_t *serverConnections = NULL;
+
+/*
+ * Send a whole message, retrying short writes
+ * @return true on success
+ */
+static bool sendAll(int fd, const void *data, size_t length) {
+    const char *next = data;
+
+    while (length > 0) {
+        ssize_t sent = send(fd, next, length, SEND_FLAGS);
+
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+
+        next += sent;
+        length -= (size_t)sent;
+    }
+
+    return true;
+}
+
+/*
+ * Receive a whole message, retrying short reads
+ * @return true on success, false on error or when the peer closed the connection
+ */
+static bool recvAll(int fd, void *data, size_t length) {
+    char *next = data;
+
+    while (length > 0) {
+        ssize_t received = recv(fd, next, length, 0);
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+
+        next += received;
+        length -= (size_t)received;
+    }
+
+    return true;
+}
+
+/*
+ * Fill in a Unix domain socket address
+ * @return false if the path does not fit
+ */
+static bool socketAddress(const char *path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        return false;
+    }
+
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+static void packOptions(const libpostal_normalize_options_t *options, expandHeader_t *header) {
+    const bool flags[18] = {
+        options->latin_ascii, options->transliterate, options->strip_accents, options->decompose, options->lowercase,
+        options->trim_string, options->drop_parentheticals, options->replace_numeric_hyphens, options->delete_numeric_hyphens,
+        options->split_alpha_from_numeric, options->replace_word_hyphens, options->delete_word_hyphens,
+        options->delete_final_periods, options->delete_acronym_periods, options->drop_english_possessives,
+        options->delete_apostrophes, options->expand_numex, options->roman_numerals
+    };
+
+    for (size_t i = 0; i < 18; i++) {
+        header->flags[i] = flags[i];
+    }
+
+    header->addressComponents = options->address_components;
+    header->numLanguages = (uint32_t)options->num_languages;
+}
+
+static void unpackOptions(const expandHeader_t *header, libpostal_normalize_options_t *options) {
+    bool *flags[18] = {
+        &options->latin_ascii, &options->transliterate, &options->strip_accents, &options->decompose, &options->lowercase,
+        &options->trim_string, &options->drop_parentheticals, &options->replace_numeric_hyphens, &options->delete_numeric_hyphens,
+        &options->split_alpha_from_numeric, &options->replace_word_hyphens, &options->delete_word_hyphens,
+        &options->delete_final_periods, &options->delete_acronym_periods, &options->drop_english_possessives,
+        &options->delete_apostrophes, &options->expand_numex, &options->roman_numerals
+    };
+
+    for (size_t i = 0; i < 18; i++) {
+        *flags[i] = header->flags[i] != 0;
+    }
+
+    options->address_components = header->addressComponents;
+}
+
+/*
+ * Close a client connection and unmap its shared memory
+ * @param connection the connection, may be NULL
+ */
+static void closeConnection(sidecarConnection_t *connection) {
+    if (connection == NULL) {
+        return;
+    }
+
+    close(connection->socket);
+    munmap(connection->shm, SIDECAR_SHM_BYTES);
+    free(connection);
+}
+
+// Thread exit hook, closes the exiting thread's connection
+static void releaseConnection(void *connection) {
+    closeConnection((sidecarConnection_t*)connection);
+}
+
+static void createConnectionKey(void) {
+    pthread_key_create(&connectionKey, releaseConnection);
+}
+
+/*
+ * Create an anonymous shared memory segment, sealed against shrinking where possible, otherwise
+ * unlinked again before anyone else can open it
+ * @return the file descriptor, or -1 on error
+ */
+static int createSharedMemory(void) {
+#ifdef SEALED_SHARED_MEMORY
+    int fd = memfd_create("postal4j-sidecar", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, SIDECAR_SHM_BYTES) != 0 || fcntl(fd, F_ADD_SEALS, SHM_SEALS) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+#else
+    char name[32];
+    snprintf(name, sizeof(name), "/p4j.%d.%u", (int)getpid(), atomic_fetch_add(&shmCounter, 1));
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    shm_unlink(name);
+
+    if (ftruncate(fd, SIDECAR_SHM_BYTES) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+#endif
+}
+
+/*
+ * Connect to the daemon and hand it a new shared memory segment
+ * @param path the socket path
+ * @param modules set to the modules the daemon serves
+ * @param error set to the error message on failure
+ * @return the connection, or NULL on failure
+ */
+static sidecarConnection_t *openConnection(const char *path, int *modules, const char **error) {
+    struct sockaddr_un address;
+
+    if (!socketAddress(path, &address)) {
+        *error = "Sidecar socket path is too long";
+        return NULL;
+    }
+
+    sidecarConnection_t *connection = calloc(1, sizeof(sidecarConnection_t));
+    int shmFd = createSharedMemory();
+
+    if (connection == NULL || shmFd < 0) {
+        *error = "Error creating sidecar shared memory";
+        free(connection);
+        if (shmFd >= 0) {
+            close(shmFd);
+        }
+        return NULL;
+    }
+
+    connection->shm = mmap(NULL, SIDECAR_SHM_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    connection->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (connection->shm == MAP_FAILED || connection->socket < 0) {
+        *error = "Error creating sidecar connection";
+        if (connection->shm != MAP_FAILED) {
+            munmap(connection->shm, SIDECAR_SHM_BYTES);
+        }
+        if (connection->socket >= 0) {
+            close(connection->socket);
+        }
+        close(shmFd);
+        free(connection);
+        return NULL;
+    }
+
+    if (connect(connection->socket, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        *error = "Error connecting to the sidecar daemon";
+        close(shmFd);
+        closeConnection(connection);
+        return NULL;
+    }
+
+    // the hello carries the shared memory descriptor
+    sidecarHello_t hello = { SIDECAR_MAGIC, SIDECAR_VERSION, SIDECAR_SHM_BYTES };
+    struct iovec iov = { &hello, sizeof(hello) };
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr message = { 0 };
+
+    memset(control, 0, sizeof(control));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &shmFd, sizeof(int));
+
+    ssize_t sent;
+
+    do {
+        sent = sendmsg(connection->socket, &message, SEND_FLAGS);
+    } while (sent < 0 && errno == EINTR);
+
+    // the daemon has its own descriptor now, the mapping keeps the segment alive on this side
+    close(shmFd);
+
+    sidecarWelcome_t welcome;
+
+    if (sent != (ssize_t)sizeof(hello) || !recvAll(connection->socket, &welcome, sizeof(welcome))) {
+        *error = "Error connecting to the sidecar daemon";
+        closeConnection(connection);
+        return NULL;
+    }
+
+    if (welcome.magic != SIDECAR_MAGIC || welcome.version != SIDECAR_VERSION || welcome.status != SIDECAR_OK) {
+        *error = "Sidecar daemon refused the connection, is it the same postal4j version?";
+        closeConnection(connection);
+        return NULL;
+    }
+
+    *modules = welcome.modules;
+
+    return connection;
+}
+
+/*
+ * Connect to a sidecar daemon, checking it from the calling thread
+ * @param socketPath the daemon's socket
+ * @param modules set to the modules the daemon serves
+ * @return NULL on success, otherwise the error message
+ */
+const char *sidecarConnect(const char *socketPath, int *modules) {
+    const char *error = NULL;
+    sidecarConnection_t *connection = openConnection(socketPath, modules, &error);
+
+    if (connection == NULL) {
+        return error;
+    }
+
+    pthread_once(&connectionKeyOnce, createConnectionKey);
+    pthread_mutex_lock(&clientLock);
+
+    strcpy(clientPath, socketPath);
+    connection->generation = atomic_fetch_add(&generation, 1) + 1;
+    atomic_store(&servedModules, *modules);
+    atomic_store(&active, true);
+
+    pthread_mutex_unlock(&clientLock);
+
+    // keep the checked connection as this thread's
+    closeConnection(threadConnection);
+    threadConnection = connection;
+    pthread_setspecific(connectionKey, connection);
+
+    return NULL;
+}
+
+/*
+ * Stop using the daemon, threads close their connections on their next call or when they exit
+ */
+void sidecarDisconnect(void) {
+    pthread_mutex_lock(&clientLock);
+
+    atomic_store(&active, false);
+    atomic_store(&servedModules, 0);
+    atomic_fetch_add(&generation, 1);
+
+    pthread_mutex_unlock(&clientLock);
+
+    if (threadConnection != NULL) {
+        closeConnection(threadConnection);
+        threadConnection = NULL;
+        pthread_setspecific(connectionKey, NULL);
+    }
+}
+
+bool sidecarActive(void) {
+    return atomic_load_explicit(&active, memory_order_acquire);
+}
+
+int sidecarModules(void) {
+    return atomic_load(&servedModules);
+}
+
+/*
+ * Get the calling thread's connection, opening a new one on first use or after a reconnect
+ * @return the connection, or NULL if the daemon cannot be reached
+ */
+static sidecarConnection_t *currentConnection(void) {
+    uint64_t current = atomic_load(&generation);
+
+    if (threadConnection != NULL && threadConnection->generation == current) {
+        return threadConnection;
+    }
+
+    closeConnection(threadConnection);
+    threadConnection = NULL;
+    pthread_setspecific(connectionKey, NULL);
+
+    char path[sizeof(clientPath)];
+
+    pthread_mutex_lock(&clientLock);
+    strcpy(path, clientPath);
+    current = atomic_load(&generation);
+    pthread_mutex_unlock(&clientLock);
+
+    int modules;
+    const char *error;
+    sidecarConnection_t *connection = openConnection(path, &modules, &error);
+
+    if (connection == NULL) {
+        return NULL;
+    }
+
+    connection->generation = current;
+    threadConnection = connection;
+    pthread_setspecific(connectionKey, connection);
+
+    return connection;
+}
+
+/*
+ * Send the request in the calling thread's shared memory and wait for the response
+ * @param connection the calling thread's connection
+ * @param op the operation
+ * @param length the request length
+ * @param response set to the response header
+ * @return true if a response arrived; on failure the connection is dropped so the next call reconnects
+ */
+static bool sidecarCall(sidecarConnection_t *connection, sidecarOp_t op, size_t length, sidecarResponse_t *response) {
+    sidecarRequest_t request = { (uint32_t)op, (uint32_t)length };
+
+    if (sendAll(connection->socket, &request, sizeof(request)) && recvAll(connection->socket, response, sizeof(*response))
+            && response->length <= SIDECAR_SHM_BYTES) {
+        return true;
+    }
+
+    closeConnection(connection);
+    threadConnection = NULL;
+    pthread_setspecific(connectionKey, NULL);
+
+    return false;
+}
+
+/*
+ * Append a NUL terminated string to a request being built in shared memory
+ * @param shm the shared memory
+ * @param length the request length so far, advanced past the string
+ * @param value the string, NULL is sent as an empty string
+ * @return false if the request does not fit
+ */
+static bool appendRequestString(char *shm, size_t *length, const char *value) {
+    size_t size = (value != NULL ? strlen(value) : 0) + 1;
+
+    if (size > SIDECAR_SHM_BYTES - *length) {
+        return false;
+    }
+
+    if (value != NULL) {
+        memcpy(shm + *length, value, size);
+    } else {
+        shm[*length] = '\0';
+    }
+
+    *length += size;
+    return true;
+}
+
+/*
+ * Parse an address on the daemon
+ * @return the response, to be freed with libpostal_address_parser_response_destroy, or NULL on error
+ */
+libpostal_address_parser_response_t *sidecarParseAddress(char *address, libpostal_address_parser_options_t options) {
+    sidecarConnection_t *connection = currentConnection();
+
+    if (connection == NULL) {
+        return NULL;
+    }
+
+    size_t length = 0;
+    sidecarResponse_t response;
+
+    if (!appendRequestString(connection->shm, &length, address) || !appendRequestString(connection->shm, &length, options.language)
+            || !appendRequestString(connection->shm, &length, options.country)
+            || !sidecarCall(connection, SIDECAR_PARSE, length, &response)) {
+        return NULL;
+    }
+
+    if (response.status != SIDECAR_OK || !validResults(connection->shm, response.length, true)) {
+        return NULL;
+    }
+
+    nativeBuffer_t value = { connection->shm, response.length, response.length };
+
+    return decodeParseResponse(&value);
+}
+
+/*
+ * Expand an address on the daemon
+ * @param n set to the number of expansions
+ * @return the expansions, to be freed with libpostal_expansion_array_destroy, or NULL on error
+ */
+char **sidecarExpandAddress(char *address, libpostal_normalize_options_t options, bool root, size_t *n) {
+    sidecarConnection_t *connection = currentConnection();
+
+    if (connection == NULL || options.num_languages > MAX_SIDECAR_LANGUAGES) {
+        return NULL;
+    }
+
+    expandHeader_t header;
+    packOptions(&options, &header);
+    memcpy(connection->shm, &header, sizeof(header));
+
+    size_t length = sizeof(header);
+    bool fits = true;
+
+    for (size_t i = 0; fits && i < options.num_languages; i++) {
+        fits = appendRequestString(connection->shm, &length, options.languages[i]);
+    }
+
+    sidecarResponse_t response;
+
+    if (!fits || !appendRequestString(connection->shm, &length, address)
+            || !sidecarCall(connection, root ? SIDECAR_EXPAND_ROOT : SIDECAR_EXPAND, length, &response)) {
+        return NULL;
+    }
+
+    if (response.status != SIDECAR_OK || !validResults(connection->shm, response.length, false)) {
+        return NULL;
+    }
+
+    nativeBuffer_t value = { connection->shm, response.length, response.length };
+
+    return decodeExpansions(&value, n);
+}
+
+/*
+ * Read the next NUL terminated string of a request
+ * @param request the request
+ * @param length the request length
+ * @param offset the current offset, advanced past the string
+ * @return the string, or NULL if the request ends first
+ */
+static char *nextRequestString(char *request, size_t length, size_t *offset) {
+    char *end = (*offset < length ? memchr(request + *offset, '\0', length - *offset) : NULL);
+
+    if (end == NULL) {
+        return NULL;
+    }
+
+    char *value = request + *offset;
+    *offset = (size_t)(end - request) + 1;
+
+    return value;
+}
+
+/*
+ * Run one request copied out of the shared memory
+ * @param op the operation
+ * @param request the request, modifiable
+ * @param length the request length
+ * @param modules the modules the daemon loaded
+ * @param value the serialized result
+ * @return the response status
+ */
+static sidecarStatus_t serveRequest(uint32_t op, char *request, size_t length, int modules, nativeBuffer_t *value) {
+    size_t offset = 0;
+
+    if (op == SIDECAR_PARSE) {
+        if ((modules & SIDECAR_MODULE_PARSER) == 0) {
+            return SIDECAR_MODULE_MISSING;
+        }
+
+        char *address = nextRequestString(request, length, &offset);
+        char *language = nextRequestString(request, length, &offset);
+        char *country = nextRequestString(request, length, &offset);
+
+        if (country == NULL) {
+            return SIDECAR_BAD_REQUEST;
+        }
+
+        libpostal_address_parser_options_t options = libpostal_get_address_parser_default_options();
+        options.language = (*language != '\0' ? language : NULL);
+        options.country = (*country != '\0' ? country : NULL);
+
+        libpostal_address_parser_response_t *response = cachedParseAddress(address, options);
+
+        if (response == NULL) {
+            return SIDECAR_ERROR;
+        }
+
+        bool encoded = encodeParseResponse(value, response);
+        libpostal_address_parser_response_destroy(response);
+
+        return encoded ? SIDECAR_OK : SIDECAR_ERROR;
+    }
+
+    if (op != SIDECAR_EXPAND && op != SIDECAR_EXPAND_ROOT) {
+        return SIDECAR_BAD_REQUEST;
+    }
+
+    expandHeader_t header;
+
+    if (length < sizeof(header)) {
+        return SIDECAR_BAD_REQUEST;
+    }
+
+    memcpy(&header, request, sizeof(header));
+    offset = sizeof(header);
+
+    if (header.numLanguages > MAX_SIDECAR_LANGUAGES) {
+        return SIDECAR_BAD_REQUEST;
+    }
+
+    // without languages libpostal has to detect them
+    if ((modules & (header.numLanguages == 0 ? SIDECAR_MODULE_CLASSIFIER : SIDECAR_MODULE_EXPANSION)) == 0) {
+        return SIDECAR_MODULE_MISSING;
+    }
+
+    char *languages[MAX_SIDECAR_LANGUAGES];
+
+    for (uint32_t i = 0; i < header.numLanguages; i++) {
+        if ((languages[i] = nextRequestString(request, length, &offset)) == NULL) {
+            return SIDECAR_BAD_REQUEST;
+        }
+    }
+
+    char *address = nextRequestString(request, length, &offset);
+
+    if (address == NULL) {
+        return SIDECAR_BAD_REQUEST;
+    }
+
+    libpostal_normalize_options_t options = libpostal_get_default_options();
+    unpackOptions(&header, &options);
+    options.languages = (header.numLanguages > 0 ? languages : NULL);
+    options.num_languages = header.numLanguages;
+
+    size_t n;
+    char **expansions = cachedExpandAddress(address, options, op == SIDECAR_EXPAND_ROOT, &n);
+
+    if (expansions == NULL) {
+        return SIDECAR_ERROR;
+    }
+
+    bool encoded = encodeExpansions(value, expansions, n);
+    libpostal_expansion_array_destroy(expansions, n);
+
+    return encoded ? SIDECAR_OK : SIDECAR_ERROR;
+}
+
+/*
+ * Check that a client's shared memory can be mapped without the client being able to shrink it
+ * under the daemon
+ * @param socket the client socket
+ * @param shmFd the shared memory descriptor
+ * @return true if it is safe to map
+ */
+static bool trustedSharedMemory(int socket, int shmFd) {
+#ifdef SEALED_SHARED_MEMORY
+    (void)socket;
+    int seals = fcntl(shmFd, F_GET_SEALS);
+
+    return seals >= 0 && (seals & SHM_SEALS) == SHM_SEALS;
+#else
+    (void)shmFd;
+    uid_t uid;
+    gid_t gid;
+
+    return getpeereid(socket, &uid, &gid) == 0 && uid == geteuid();
+#endif
+}
+
+/*
+ * Accept the client's hello and map its shared memory
+ * @param socket the client socket
+ * @return the mapping, or MAP_FAILED
+ */
+static char *acceptHello(int socket) {
+    sidecarHello_t hello;
+    struct iovec iov = { &hello, sizeof(hello) };
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr message = { 0 };
+
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received;
+
+    do {
+        received = recvmsg(socket, &message, 0);
+    } while (received < 0 && errno == EINTR);
+
+    struct cmsghdr *header = (received == (ssize_t)sizeof(hello) ? CMSG_FIRSTHDR(&message) : NULL);
+
+    if (header == NULL || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+        return MAP_FAILED;
+    }
+
+    int shmFd;
+    memcpy(&shmFd, CMSG_DATA(header), sizeof(int));
+
+    struct stat status;
+    char *shm = MAP_FAILED;
+
+    if (hello.magic == SIDECAR_MAGIC && hello.version == SIDECAR_VERSION && hello.shmBytes == SIDECAR_SHM_BYTES
+            && trustedSharedMemory(socket, shmFd) && fstat(shmFd, &status) == 0 && status.st_size >= SIDECAR_SHM_BYTES) {
+        shm = mmap(NULL, SIDECAR_SHM_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    }
+
+    close(shmFd);
+
+    return shm;
+}
+
+/*
+ * Daemon thread serving one client connection until it closes
+ * @param context the server connection
+ * @return NULL
+ */
+static void *serveConnection(void *context) {
+    serverConnection_t *connection = (serverConnection_t*)context;
+    char *shm = acceptHello(connection->socket);
+
+    sidecarWelcome_t welcome = { SIDECAR_MAGIC, SIDECAR_VERSION, shm != MAP_FAILED ? SIDECAR_OK : SIDECAR_BAD_REQUEST, connection->modules };
+    bool open = sendAll(connection->socket, &welcome, sizeof(welcome)) && shm != MAP_FAILED;
+
+    // the request is copied out first, so the client cannot change it under libpostal
+    nativeBuffer_t request;
+    nativeBuffer_t value;
+    bufferInit(&request);
+    bufferInit(&value);
+
+    sidecarRequest_t header;
+
+    while (open && recvAll(connection->socket, &header, sizeof(header))) {
+        sidecarResponse_t response = { SIDECAR_BAD_REQUEST, 0 };
+
+        bufferReset(&request);
+        bufferReset(&value);
+
+        if (header.length <= SIDECAR_SHM_BYTES && bufferAppend(&request, shm, header.length)) {
+            response.status = serveRequest(header.op, request.data, request.length, connection->modules, &value);
+        }
+
+        if (response.status == SIDECAR_OK && value.length > SIDECAR_SHM_BYTES) {
+            response.status = SIDECAR_TOO_LARGE;
+        } else if (response.status == SIDECAR_OK) {
+            memcpy(shm, value.data, value.length);
+            response.length = (uint32_t)value.length;
+        }
+
+        open = sendAll(connection->socket, &response, sizeof(response));
+    }
+
+    bufferFree(&request);
+    bufferFree(&value);
+
+    if (shm != MAP_FAILED) {
+        munmap(shm, SIDECAR_SHM_BYTES);
+    }
+
+    // unlink from the open connections, the last one out wakes a stopping server
+    pthread_mutex_lock(&serverLock);
+
+    for (serverConnection_t **link = &serverConnections; *link != NULL; link = &(*link)->next) {
+        if (*link == connection) {
+            *link = connection->next;
+            break;
+        }
+    }
+
+    pthread_cond_broadcast(&serverDone);
+    pthread_mutex_unlock(&serverLock);
+
+    close(connection->socket);
+    free(connection);
+
+    return NULL;
+}
+
+/*
+ * Serve the loaded modules on a Unix domain socket until stop is set
+ * @param socketPath the socket path, a stale socket there is replaced but no other kind of file
+ * @param modules the SIDECAR_MODULE_* bits of the loaded modules
+ * @param stop set from a signal handler to stop serving
+ * @return NULL on a clean stop, otherwise the error message
+ */
+const char *sidecarServe(const char *socketPath, int modules, volatile sig_atomic_t *stop) {
+    struct sockaddr_un address;
+
+    if (!socketAddress(socketPath, &address)) {
+        return "Socket path is too long";
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0) {
+        return "Error creating socket";
+    }
+
+    struct stat existing;
+
+    if (lstat(socketPath, &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            close(listener);
+            return "Socket path exists and is not a socket";
+        }
+
+        unlink(socketPath);
+    }
+
+    // the socket file gets its mode at bind, a umask is the only portable way to set it before anyone can connect
+    mode_t mask = umask(~SOCKET_MODE & 0777);
+    bool bound = (bind(listener, (struct sockaddr*)&address, sizeof(address)) == 0);
+    umask(mask);
+
+    struct stat created;
+
+    if (!bound || lstat(socketPath, &created) != 0 || listen(listener, SOMAXCONN) != 0) {
+        close(listener);
+        return "Error binding socket";
+    }
+
+    while (!*stop) {
+        struct pollfd ready = { listener, POLLIN, 0 };
+
+        if (poll(&ready, 1, ACCEPT_POLL_MILLIS) <= 0) {
+            continue;
+        }
+
+        int client = accept(listener, NULL, NULL);
+
+        if (client < 0) {
+            continue;
+        }
+
+        serverConnection_t *connection = malloc(sizeof(serverConnection_t));
+        pthread_t thread;
+
+        if (connection == NULL) {
+            close(client);
+            continue;
+        }
+
+        connection->socket = client;
+        connection->modules = modules;
+
+        pthread_mutex_lock(&serverLock);
+        connection->next = serverConnections;
+        serverConnections = connection;
+
+        if (pthread_create(&thread, NULL, serveConnection, connection) == 0) {
+            pthread_detach(thread);
+        } else {
+            serverConnections = connection->next;
+            close(client);
+            free(connection);
+        }
+
+        pthread_mutex_unlock(&serverLock);
+    }
+
+    close(listener);
+
+    // leave the path alone if another daemon has taken it over meanwhile
+    if (lstat(socketPath, &existing) == 0 && existing.st_dev == created.st_dev && existing.st_ino == created.st_ino) {
+        unlink(socketPath);
+    }
+
+    // wake the connection threads out of recv and wait for them, they may be inside libpostal
+    pthread_mutex_lock(&serverLock);
+
+    for (serverConnection_t *connection = serverConnections; connection != NULL; connection = connection->next) {
+        shutdown(connection->socket, SHUT_RDWR);
+    }
+
+    while (serverConnections != NULL) {
+        pthread_cond_wait(&serverDone, &serverLock);
+    }
+
+    pthread_mutex_unlock(&serverLock);
+
+    return NULL;
+}
@@ -0,0 +1,92 @@
+/*
+ * postal4j_sidecar.h
+ * Sidecar daemon that loads the libpostal models once per host and serves parse/expand calls to
+ * every JVM on it, over a Unix domain socket with the payloads in shared memory
+ */
+
+#ifndef POSTAL4J_SIDECAR_H
+#define POSTAL4J_SIDECAR_H
+
+#include <libpostal.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// First bytes of the hello and welcome messages, "P4JS" in little endian
+#define SIDECAR_MAGIC 0x534a3450
+#define SIDECAR_VERSION 2
+
+// Shared memory per connection, holding one request and then its response
+#define SIDECAR_SHM_BYTES (1 << 20)
+
+// Module bits, the same as MODULE_* in postal4j_jni.c and LibPostalModule
+#define SIDECAR_MODULE_EXPANSION (1 << 0)
+#define SIDECAR_MODULE_PARSER (1 << 1)
+#define SIDECAR_MODULE_CLASSIFIER (1 << 2)
+
+typedef enum {
+    SIDECAR_PARSE = 1,
+    SIDECAR_EXPAND = 2,
+    SIDECAR_EXPAND_ROOT = 3
+} sidecarOp_t;
+
+typedef enum {
+    SIDECAR_OK = 0,
+    SIDECAR_ERROR = 1,
+    SIDECAR_BAD_REQUEST = 2,
+    SIDECAR_MODULE_MISSING = 3,
+    SIDECAR_TOO_LARGE = 4
+} sidecarStatus_t;
+
+// Client -> daemon once per connection, sent along with the shared memory file descriptor
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t shmBytes;
+} sidecarHello_t;
+
+// Daemon -> client in reply, modules are the SIDECAR_MODULE_* bits the daemon loaded
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t status;
+    int32_t modules;
+} sidecarWelcome_t;
+
+// Client -> daemon per call, the payload is at the start of the shared memory
+typedef struct {
+    uint32_t op;
+    uint32_t length;
+} sidecarRequest_t;
+
+// Daemon -> client per call, a serialized result (see postal4j_results.h) at the start of the shared memory
+typedef struct {
+    int32_t status;
+    uint32_t length;
+} sidecarResponse_t;
+
+// Client side, used instead of libpostal by the result cache while connected.
+// Connecting checks the daemon from the calling thread, every other thread opens its own connection on its first call.
+// Returns NULL on success (with the daemon's modules), otherwise the error message.
+const char *sidecarConnect(const char *socketPath, int *modules);
+void sidecarDisconnect(void);
+bool sidecarActive(void);
+int sidecarModules(void);
+
+libpostal_address_parser_response_t *sidecarParseAddress(char *address, libpostal_address_parser_options_t options);
+char **sidecarExpandAddress(char *address, libpostal_normalize_options_t options, bool root, size_t *n);
+
+// Daemon side, serves the loaded modules until stop is set. The socket file is replaced and removed again on return.
+// Returns NULL on a clean stop, otherwise the error message.
+const char *sidecarServe(const char *socketPath, int modules, volatile sig_atomic_t *stop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_SIDECAR_H */
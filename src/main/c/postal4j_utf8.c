@@ -0,0 +1,269 @@
+/*
+ * postal4j_utf8.c
+ * UTF-16 to standard UTF-8 transcoding, and back for results
+ *
+ * Addresses are mostly ASCII even in non-Latin scripts (numbers, postcodes, separators), so runs of ASCII are
+ * narrowed a vector at a time: NEON on aarch64, SSE2 on x86-64 with an AVX2 variant picked at runtime when the
+ * CPU has it. Everything else goes through the scalar encoder one character at a time.
+ */
+
+#include "postal4j_utf8.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define UTF8_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define UTF8_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+/*
+ * Copy the scalar ASCII units at the start of the input
+ * @param src the UTF-16 input
+ * @param length the number of input units
+ * @param dst the UTF-8 output
+ * @return the number of units copied
+ */
+static size_t copyAsciiScalar(const uint16_t *src, size_t length, char *dst) {
+    size_t i = 0;
+
+    while (i < length && src[i] < 0x80) {
+        dst[i] = (char)src[i];
+        i++;
+    }
+
+    return i;
+}
+
+#if UTF8_X86
+
+#if defined(__GNUC__) || defined(__clang__)
+#define UTF8_AVX2 1
+
+/*
+ * Copy the ASCII units at the start of the input, 32 units per step
+ * @param src the UTF-16 input
+ * @param length the number of input units
+ * @param dst the UTF-8 output
+ * @return the number of units copied
+ */
+__attribute__((target("avx2")))
+static size_t copyAsciiAvx2(const uint16_t *src, size_t length, char *dst) {
+    const __m256i nonAscii = _mm256_set1_epi16((short)0xFF80);
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i low = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i high = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+
+        if (!_mm256_testz_si256(_mm256_or_si256(low, high), nonAscii)) {
+            break;
+        }
+
+        // packus narrows within each 128-bit lane, the permute puts the four 64-bit quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), packed);
+    }
+
+    return i + copyAsciiScalar(src + i, length - i, dst + i);
+}
+#endif
+
+/*
+ * Copy the ASCII units at the start of the input, 16 units per step
+ * @param src the UTF-16 input
+ * @param length the number of input units
+ * @param dst the UTF-8 output
+ * @return the number of units copied
+ */
+static size_t copyAsciiSse2(const uint16_t *src, size_t length, char *dst) {
+    const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i low = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i high = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        __m128i bits = _mm_and_si128(_mm_or_si128(low, high), nonAscii);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, zero)) != 0xFFFF) {
+            break;
+        }
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(low, high));
+    }
+
+    return i + copyAsciiScalar(src + i, length - i, dst + i);
+}
+
+#elif UTF8_NEON
+
+/*
+ * Copy the ASCII units at the start of the input, 16 units per step
+ * @param src the UTF-16 input
+ * @param length the number of input units
+ * @param dst the UTF-8 output
+ * @return the number of units copied
+ */
+static size_t copyAsciiNeon(const uint16_t *src, size_t length, char *dst) {
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        uint16x8_t low = vld1q_u16(src + i);
+        uint16x8_t high = vld1q_u16(src + i + 8);
+
+        if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80) {
+            break;
+        }
+
+        vst1q_u8((uint8_t*)(dst + i), vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+    }
+
+    return i + copyAsciiScalar(src + i, length - i, dst + i);
+}
+
+#endif
+
+/*
+ * Copy the ASCII units at the start of the input with the widest vectors the CPU has
+ * @param src the UTF-16 input
+ * @param length the number of input units
+ * @param dst the UTF-8 output
+ * @return the number of units copied
+ */
+static size_t copyAscii(const uint16_t *src, size_t length, char *dst) {
+#if UTF8_X86
+#if UTF8_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return copyAsciiAvx2(src, length, dst);
+    }
+#endif
+    return copyAsciiSse2(src, length, dst);
+#elif UTF8_NEON
+    return copyAsciiNeon(src, length, dst);
+#else
+    return copyAsciiScalar(src, length, dst);
+#endif
+}
+
+size_t utf16ToUtf8(const uint16_t *src, size_t length, char *dst) {
+    unsigned char *out = (unsigned char*)dst;
+    size_t i = 0;
+
+    while (i < length) {
+        uint32_t c = src[i];
+
+        if (c < 0x80) {
+            size_t run = copyAscii(src + i, length - i, (char*)out);
+            i += run;
+            out += run;
+            continue;
+        }
+
+        i++;
+
+        if (c < 0x800) {
+            *out++ = (unsigned char)(0xC0 | (c >> 6));
+            *out++ = (unsigned char)(0x80 | (c & 0x3F));
+            continue;
+        }
+
+        if ((c & 0xF800) == 0xD800) {
+            // a high surrogate followed by a low one is one supplementary character, any other surrogate is invalid
+            if (utf16IsHighSurrogate((uint16_t)c) && i < length && (src[i] & 0xFC00) == 0xDC00) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (src[i] - 0xDC00u);
+                i++;
+
+                *out++ = (unsigned char)(0xF0 | (c >> 18));
+                *out++ = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+                *out++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+                *out++ = (unsigned char)(0x80 | (c & 0x3F));
+                continue;
+            }
+
+            c = REPLACEMENT_CHARACTER;
+        }
+
+        *out++ = (unsigned char)(0xE0 | (c >> 12));
+        *out++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+        *out++ = (unsigned char)(0x80 | (c & 0x3F));
+    }
+
+    return (size_t)(out - (unsigned char*)dst);
+}
+
+/*
+ * Decode one multi-byte UTF-8 sequence
+ * @param src the sequence, its lead byte at src[0]
+ * @param length the bytes available
+ * @param c receives the code point, U+FFFD when the sequence is invalid
+ * @return the number of bytes consumed, at least 1
+ */
+static size_t decodeUtf8Sequence(const unsigned char *src, size_t length, uint32_t *c) {
+    unsigned char lead = src[0];
+    size_t needed;
+    uint32_t min;
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        needed = 2;
+        min = 0x80;
+        *c = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        needed = 3;
+        min = 0x800;
+        *c = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        needed = 4;
+        min = 0x10000;
+        *c = lead & 0x07;
+    } else {
+        *c = REPLACEMENT_CHARACTER;
+        return 1;
+    }
+
+    for (size_t i = 1; i < needed; i++) {
+        if (i >= length || (src[i] & 0xC0) != 0x80) {
+            *c = REPLACEMENT_CHARACTER;
+            return i;
+        }
+
+        *c = (*c << 6) | (src[i] & 0x3F);
+    }
+
+    // overlong forms, surrogates and values past U+10FFFF are invalid
+    if (*c < min || (*c & 0xFFFFF800) == 0xD800 || *c > 0x10FFFF) {
+        *c = REPLACEMENT_CHARACTER;
+    }
+
+    return needed;
+}
+
+size_t utf8ToUtf16(const char *src, size_t length, uint16_t *dst) {
+    const unsigned char *in = (const unsigned char*)src;
+    uint16_t *out = dst;
+    size_t i = 0;
+
+    while (i < length) {
+        uint32_t c = in[i];
+
+        if (c < 0x80) {
+            *out++ = (uint16_t)c;
+            i++;
+            continue;
+        }
+
+        i += decodeUtf8Sequence(in + i, length - i, &c);
+
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            *out++ = (uint16_t)(0xD800 | (c >> 10));
+            *out++ = (uint16_t)(0xDC00 | (c & 0x3FF));
+        } else {
+            *out++ = (uint16_t)c;
+        }
+    }
+
+    return (size_t)(out - dst);
+}
@@ -0,0 +1,37 @@
+/*
+ * postal4j_utf8.h
+ * UTF-16 to standard UTF-8 transcoding with a vectorized ASCII fast path, and standard UTF-8 back to UTF-16
+ */
+
+#ifndef POSTAL4J_UTF8_H
+#define POSTAL4J_UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Worst case UTF-8 bytes per UTF-16 unit (a BMP character above U+07FF), a surrogate pair takes 4 bytes for 2 units
+#define UTF8_BYTES_PER_UTF16_UNIT 3
+
+// Transcodes UTF-16 to standard UTF-8: supplementary characters become 4 byte sequences (not modified UTF-8's
+// surrogate halves), unpaired surrogates become U+FFFD. dst needs room for UTF8_BYTES_PER_UTF16_UNIT * length bytes,
+// no NUL terminator is written. Returns the number of bytes written.
+size_t utf16ToUtf8(const uint16_t *src, size_t length, char *dst);
+
+// Decodes standard UTF-8 (4 byte sequences become surrogate pairs), invalid sequences become U+FFFD. dst needs room
+// for length units, UTF-16 never takes more units than UTF-8 takes bytes. Returns the number of units written.
+size_t utf8ToUtf16(const char *src, size_t length, uint16_t *dst);
+
+// Whether a UTF-16 unit is the first half of a surrogate pair
+static inline int utf16IsHighSurrogate(uint16_t unit) {
+    return (unit & 0xFC00) == 0xD800;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSTAL4J_UTF8_H */
@@ -0,0 +1,66 @@
+package com.dnebinger.postal4j;
+
+/**
+ * The fixed set of labels produced by the libpostal address parser.
+ * The declaration order is shared with the native label table, do not reorder.
+ */
+public enum AddressLabel {
+    HOUSE("house"),
+    CATEGORY("category"),
+    NEAR("near"),
+    HOUSE_NUMBER("house_number"),
+    ROAD("road"),
+    UNIT("unit"),
+    LEVEL("level"),
+    STAIRCASE("staircase"),
+    ENTRANCE("entrance"),
+    PO_BOX("po_box"),
+    POSTCODE("postcode"),
+    SUBURB("suburb"),
+    CITY_DISTRICT("city_district"),
+    CITY("city"),
+    ISLAND("island"),
+    STATE_DISTRICT("state_district"),
+    STATE("state"),
+    COUNTRY_REGION("country_region"),
+    COUNTRY("country"),
+    WORLD_REGION("world_region");
+
+    private static final AddressLabel[] VALUES = values();
+
+    private final String label;
+
+    AddressLabel(String label) {
+        this.label = label;
+    }
+
+    /**
+     * Returns the label as libpostal names it, e.g. {@code house_number}.
+     *
+     * @return the libpostal label
+     */
+    public String label() {
+        return label;
+    }
+
+    /**
+     * Looks up a label by its libpostal name.
+     *
+     * @param label the libpostal label, e.g. {@code road}
+     * @return the matching label
+     * @throws IllegalArgumentException if the label is unknown
+     */
+    public static AddressLabel fromLabel(String label) {
+        for (AddressLabel value : VALUES) {
+            if (value.label.equals(label)) {
+                return value;
+            }
+        }
+
+        throw new IllegalArgumentException("Unknown address label: " + label);
+    }
+
+    static AddressLabel fromOrdinal(int ordinal) {
+        return VALUES[ordinal];
+    }
+}
@@ -0,0 +1,16 @@
+package com.dnebinger.postal4j;
+
+/**
+ * What an async call does when the {@link AsyncExecutor} already holds as many requests as its threads plus its queue depth.
+ */
+public enum AsyncBackpressure {
+    /**
+     * The submitting thread waits for a slot. A virtual thread unmounts while waiting, so this never pins a carrier.
+     */
+    BLOCK,
+
+    /**
+     * The call returns a future failed with {@link java.util.concurrent.RejectedExecutionException} right away.
+     */
+    REJECT
+}
@@ -0,0 +1,151 @@
+package com.dnebinger.postal4j;
+
+import java.util.Objects;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.Semaphore;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.function.Supplier;
+
+/**
+ * Fixed pool of platform threads that run the blocking native calls behind the async API, see
+ * {@link LibPostal#setupAsync(int, int, AsyncBackpressure)}.
+ * At most {@code threads} calls are inside libpostal at once and at most {@code queueDepth} more wait for a thread,
+ * further submissions block or are rejected depending on the {@link AsyncBackpressure}.
+ */
+public final class AsyncExecutor implements AutoCloseable {
+
+    private static final AtomicInteger POOL_IDS = new AtomicInteger();
+
+    private final int threads;
+    private final int queueDepth;
+    private final AsyncBackpressure backpressure;
+    private final Semaphore slots;
+    private final ExecutorService executor;
+
+    public AsyncExecutor(int threads, int queueDepth, AsyncBackpressure backpressure) {
+        if (threads < 1) {
+            throw new IllegalArgumentException("threads must be positive: " + threads);
+        }
+        if (queueDepth < 0) {
+            throw new IllegalArgumentException("queueDepth must not be negative: " + queueDepth);
+        }
+
+        this.threads = threads;
+        this.queueDepth = queueDepth;
+        this.backpressure = Objects.requireNonNull(backpressure, "backpressure");
+        this.slots = new Semaphore(threads + queueDepth);
+
+        // the semaphore bounds the work queue, so the executor's own queue never grows past queueDepth
+        String prefix = "postal4j-async-" + POOL_IDS.incrementAndGet() + "-";
+        AtomicInteger threadIds = new AtomicInteger();
+        ThreadFactory factory = runnable -> {
+            Thread thread = new Thread(runnable, prefix + threadIds.incrementAndGet());
+            thread.setDaemon(true);
+            return thread;
+        };
+        this.executor = Executors.newFixedThreadPool(threads, factory);
+    }
+
+    /**
+     * Runs the call on one of the pool threads.
+     * @param call the blocking call
+     * @return the future completed with the call's result or exception
+     */
+    public <T> CompletableFuture<T> submit(Supplier<T> call) {
+        Objects.requireNonNull(call, "call");
+
+        try {
+            if (!acquire()) {
+                return CompletableFuture.failedFuture(new RejectedExecutionException(
+                    "Async queue is full (" + threads + " threads, queue depth " + queueDepth + ")"));
+            }
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            return CompletableFuture.failedFuture(e);
+        }
+
+        CompletableFuture<T> future = new CompletableFuture<>();
+
+        try {
+            executor.execute(() -> {
+                try {
+                    future.complete(call.get());
+                } catch (Throwable t) {
+                    future.completeExceptionally(t);
+                } finally {
+                    slots.release();
+                }
+            });
+        } catch (RejectedExecutionException e) {
+            slots.release();
+            future.completeExceptionally(e);
+        }
+
+        return future;
+    }
+
+    private boolean acquire() throws InterruptedException {
+        if (backpressure == AsyncBackpressure.REJECT) {
+            return slots.tryAcquire();
+        }
+
+        slots.acquire();
+        return true;
+    }
+
+    /**
+     * @return the number of pool threads, the most calls inside libpostal at once
+     */
+    public int getThreads() {
+        return threads;
+    }
+
+    /**
+     * @return the number of calls that may wait for a thread
+     */
+    public int getQueueDepth() {
+        return queueDepth;
+    }
+
+    /**
+     * @return what happens to submissions past the queue depth
+     */
+    public AsyncBackpressure getBackpressure() {
+        return backpressure;
+    }
+
+    /**
+     * @return the number of submitted calls that have not completed yet, running or queued
+     */
+    public int getPending() {
+        return threads + queueDepth - slots.availablePermits();
+    }
+
+    /**
+     * Stops accepting calls and waits for the pending ones to complete.
+     */
+    @Override
+    public void close() {
+        executor.shutdown();
+
+        boolean interrupted = false;
+        while (true) {
+            try {
+                if (executor.awaitTermination(1, TimeUnit.MINUTES)) {
+                    break;
+                }
+            } catch (InterruptedException e) {
+                interrupted = true;
+            }
+        }
+
+        if (interrupted) {
+            Thread.currentThread().interrupt();
+        }
+    }
+}
@@ -0,0 +1,225 @@
+package com.dnebinger.postal4j;
+
+import java.lang.ref.Cleaner;
+import java.lang.ref.Reference;
+import java.nio.file.Path;
+import java.util.Objects;
+
+/**
+ * Persistent blocking index for entity resolution: records are added with an id, their near-duplicate hashes
+ * (see {@link LibPostal#nearDupeHashes}) are stored natively in a memory-mapped file as hash to id posting lists,
+ * and a query returns the ids of the records sharing at least one hash with a new address.
+ * <p>
+ * The file is reopened by mapping it, without reading or rebuilding anything, and new records can be appended
+ * at any time. The index keeps the options it was created with and refuses to open with different ones. Adds
+ * and queries are safe from multiple threads (queries run concurrently, adds exclusively). Call {@link #flush()}
+ * or {@link #close()} to persist the appended records; a file that was not flushed after its last add is refused
+ * on reopen. Close it only when no other thread is using it.
+ */
+public final class BlockingIndex implements AutoCloseable {
+
+    private static final Cleaner CLEANER = Cleaner.create();
+
+    private final Path path;
+    private final NearDupeHashOptions options;
+    private final Handle handle;
+    private final Cleaner.Cleanable cleanable;
+
+    private BlockingIndex(Path path, NearDupeHashOptions options) {
+        this.path = path;
+        this.options = options;
+        this.handle = new Handle(LibPostal.openBlockingIndex(path.toString(), options.languages(), options.getFlags(),
+            options.getGeohashPrecision()));
+        this.cleanable = CLEANER.register(this, handle);
+    }
+
+    /**
+     * Opens an index file, creating it when it does not exist yet. An index file can only be open once at a time.
+     * @param path the index file
+     * @param options the near-duplicate hash options of the keys, must be the ones the file was created with
+     */
+    public static BlockingIndex open(Path path, NearDupeHashOptions options) {
+        return new BlockingIndex(Objects.requireNonNull(path, "path"), Objects.requireNonNull(options, "options"));
+    }
+
+    public Path getPath() {
+        return path;
+    }
+
+    public NearDupeHashOptions getOptions() {
+        return options;
+    }
+
+    /**
+     * Adds a record. Labels are libpostal parser labels (see AddressLabel), values the matching component values.
+     */
+    public void add(long id, String[] labels, String[] values) {
+        add(id, labels, values, Double.NaN, Double.NaN);
+    }
+
+    // The coordinates only add geohash keys when the options have WITH_LATLON set
+    public void add(long id, String[] labels, String[] values, double latitude, double longitude) {
+        try {
+            LibPostal.blockingIndexAdd(handle(), id, labels, values, latitude, longitude);
+        } finally {
+            Reference.reachabilityFence(this);
+        }
+    }
+
+    public void add(long id, ParsedAddress address) {
+        add(id, labels(address), values(address));
+    }
+
+    /**
+     * Adds a batch of parsed records in one native call, hashed on the native worker threads.
+     * @param ids one id per record
+     * @param latitudes the per-record latitudes (NaN for none), or null
+     * @param longitudes the per-record longitudes (NaN for none), or null
+     */
+    public void add(long[] ids, ParsedAddressBatch batch, double[] latitudes, double[] longitudes) {
+        add(ids, batch.recordOffsets(), batch.labels(), batch.values(), batch.offsets(), latitudes, longitudes);
+    }
+
+    // Flat form, laid out as for LibPostal.nearDupeHashes(int[], byte[], byte[], int[], double[], double[], NearDupeHashOptions)
+    public void add(long[] ids, int[] recordOffsets, byte[] labels, byte[] values, int[] valueOffsets, double[] latitudes,
+        double[] longitudes) {
+        try {
+            LibPostal.blockingIndexAddBatch(handle(), ids, recordOffsets, labels, values, valueOffsets, latitudes, longitudes);
+        } finally {
+            Reference.reachabilityFence(this);
+        }
+    }
+
+    /**
+     * @return the sorted, distinct ids of the records sharing at least one near-duplicate hash with the address
+     */
+    public long[] candidates(String[] labels, String[] values) {
+        return candidates(labels, values, Double.NaN, Double.NaN, 0);
+    }
+
+    public long[] candidates(ParsedAddress address) {
+        return candidates(labels(address), values(address), Double.NaN, Double.NaN, 0);
+    }
+
+    /**
+     * @param maxPostings hashes shared by more records than this are skipped (e.g. a key covering a whole city),
+     *                    0 for no limit
+     */
+    public long[] candidates(String[] labels, String[] values, double latitude, double longitude, int maxPostings) {
+        try {
+            return LibPostal.blockingIndexQuery(handle(), labels, values, latitude, longitude, maxPostings);
+        } finally {
+            Reference.reachabilityFence(this);
+        }
+    }
+
+    /**
+     * @return the number of records added
+     */
+    public long size() {
+        return stats()[0];
+    }
+
+    /**
+     * @return the number of distinct hashes
+     */
+    public long keyCount() {
+        return stats()[1];
+    }
+
+    /**
+     * @return the number of (hash, id) postings
+     */
+    public long postingCount() {
+        return stats()[2];
+    }
+
+    /**
+     * @return the bytes in use in the index file
+     */
+    public long fileBytes() {
+        return stats()[3];
+    }
+
+    /**
+     * Writes the appended records to disk and marks the file clean.
+     */
+    public void flush() {
+        try {
+            LibPostal.flushBlockingIndex(handle());
+        } finally {
+            Reference.reachabilityFence(this);
+        }
+    }
+
+    public boolean isClosed() {
+        return handle.address == 0;
+    }
+
+    /**
+     * Flushes and closes the index file. Calls on a closed index throw an IllegalStateException.
+     */
+    @Override
+    public void close() {
+        cleanable.clean();
+    }
+
+    @Override
+    public String toString() {
+        return "BlockingIndex{path=" + path + ", options=" + options + "}";
+    }
+
+    private long[] stats() {
+        try {
+            return LibPostal.blockingIndexStats(handle());
+        } finally {
+            Reference.reachabilityFence(this);
+        }
+    }
+
+    private long handle() {
+        long address = handle.address;
+
+        if (address == 0) {
+            throw new IllegalStateException("BlockingIndex has been closed");
+        }
+
+        return address;
+    }
+
+    private static String[] labels(ParsedAddress address) {
+        String[] labels = new String[address.size()];
+
+        for (int i = 0; i < labels.length; i++) {
+            labels[i] = address.label(i).label();
+        }
+
+        return labels;
+    }
+
+    private static String[] values(ParsedAddress address) {
+        String[] values = new String[address.size()];
+
+        for (int i = 0; i < values.length; i++) {
+            values[i] = address.value(i);
+        }
+
+        return values;
+    }
+
+    // Cleaning action, must not reference the BlockingIndex itself
+    private static final class Handle implements Runnable {
+        private volatile long address;
+
+        private Handle(long address) {
+            this.address = address;
+        }
+
+        @Override
+        public void run() {
+            long current = address;
+            address = 0;
+            LibPostal.closeBlockingIndex(current);
+        }
+    }
+}
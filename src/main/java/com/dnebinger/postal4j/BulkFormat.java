@@ -0,0 +1,22 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Output format of a bulk file run, one record per input line in input order.
+ * The declaration order is shared with the native bulk formats, do not reorder.
+ */
+public enum BulkFormat {
+    /**
+     * One line per record. Parse lines have one tab separated column per {@link AddressLabel}, in enum order,
+     * with repeated labels joined by a space. Expand lines have one column per expansion.
+     * Tabs, newlines, carriage returns and backslashes in values are escaped as {@code \t \n \r \\}.
+     */
+    TSV,
+
+    /**
+     * The header {@code "P4JB"}, a version byte (1), the {@link BulkMode} ordinal byte and two zero bytes, then one record
+     * per line with little-endian uint32 integers. Parse records are the component count, then per component the
+     * {@link AddressLabel} ordinal byte (0xFF followed by a length byte and the label for unknown labels), the value
+     * length and the UTF-8 value. Expand records are the expansion count, then per expansion its length and UTF-8 bytes.
+     */
+    BINARY
+}
@@ -0,0 +1,11 @@
+package com.dnebinger.postal4j;
+
+/**
+ * What a bulk file run does with every line, see {@link LibPostal#processFile(String, String, BulkMode, BulkFormat)}.
+ * The declaration order is shared with the native bulk modes, do not reorder.
+ */
+public enum BulkMode {
+    PARSE,
+    EXPAND,
+    EXPAND_ROOT
+}
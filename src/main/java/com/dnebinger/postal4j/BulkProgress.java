@@ -0,0 +1,77 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Counters of a bulk file run, reported while it runs and returned when it completes.
+ */
+public final class BulkProgress {
+
+    private final long lines;
+    private final long bytesRead;
+    private final long totalBytes;
+    private final long bytesWritten;
+    private final double elapsedSeconds;
+
+    // Called from native code
+    BulkProgress(long lines, long bytesRead, long totalBytes, long bytesWritten, double elapsedSeconds) {
+        this.lines = lines;
+        this.bytesRead = bytesRead;
+        this.totalBytes = totalBytes;
+        this.bytesWritten = bytesWritten;
+        this.elapsedSeconds = elapsedSeconds;
+    }
+
+    /**
+     * @return the number of lines processed
+     */
+    public long getLines() {
+        return lines;
+    }
+
+    /**
+     * @return the number of input bytes processed
+     */
+    public long getBytesRead() {
+        return bytesRead;
+    }
+
+    /**
+     * @return the input file size
+     */
+    public long getTotalBytes() {
+        return totalBytes;
+    }
+
+    /**
+     * @return the number of output bytes written, while running this trails the processed lines
+     */
+    public long getBytesWritten() {
+        return bytesWritten;
+    }
+
+    /**
+     * @return the seconds since the run started
+     */
+    public double getElapsedSeconds() {
+        return elapsedSeconds;
+    }
+
+    /**
+     * @return the fraction of the input processed, 1 for an empty input
+     */
+    public double fractionDone() {
+        return totalBytes == 0 ? 1.0 : (double) bytesRead / totalBytes;
+    }
+
+    /**
+     * @return the throughput so far in lines per second
+     */
+    public double linesPerSecond() {
+        return elapsedSeconds <= 0 ? 0.0 : lines / elapsedSeconds;
+    }
+
+    @Override
+    public String toString() {
+        return "BulkProgress{lines=" + lines + ", bytesRead=" + bytesRead + ", totalBytes=" + totalBytes +
+            ", bytesWritten=" + bytesWritten + ", elapsedSeconds=" + elapsedSeconds + "}";
+    }
+}
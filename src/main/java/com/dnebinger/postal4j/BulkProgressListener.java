@@ -0,0 +1,10 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Receives the counters of a bulk file run after every chunk, on the thread that started the run.
+ * Throwing stops the run, the exception propagates out of {@link LibPostal#processFile}.
+ */
+@FunctionalInterface
+public interface BulkProgressListener {
+    void onProgress(BulkProgress progress);
+}
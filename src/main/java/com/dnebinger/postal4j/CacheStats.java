@@ -0,0 +1,72 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Snapshot of the native result cache counters, see {@link LibPostal#setup(String, int, int)}.
+ * All values are zero when the cache is disabled.
+ */
+public final class CacheStats {
+
+    private final long hits;
+    private final long misses;
+    private final long evictions;
+    private final long entries;
+    private final long capacity;
+
+    // Called from native code
+    CacheStats(long hits, long misses, long evictions, long entries, long capacity) {
+        this.hits = hits;
+        this.misses = misses;
+        this.evictions = evictions;
+        this.entries = entries;
+        this.capacity = capacity;
+    }
+
+    /**
+     * @return the number of lookups served from the cache without calling libpostal
+     */
+    public long getHits() {
+        return hits;
+    }
+
+    /**
+     * @return the number of lookups that had to call libpostal
+     */
+    public long getMisses() {
+        return misses;
+    }
+
+    /**
+     * @return the number of results dropped to make room for newer ones
+     */
+    public long getEvictions() {
+        return evictions;
+    }
+
+    /**
+     * @return the number of results currently cached
+     */
+    public long getEntries() {
+        return entries;
+    }
+
+    /**
+     * @return the maximum number of cached results, 0 if the cache is disabled
+     */
+    public long getCapacity() {
+        return capacity;
+    }
+
+    /**
+     * @return the fraction of lookups that were hits, 0 when there were no lookups
+     */
+    public double hitRate() {
+        long lookups = hits + misses;
+        return lookups == 0 ? 0.0 : (double) hits / lookups;
+    }
+
+    @Override
+    public String toString() {
+        return "CacheStats{hits=" + hits + ", misses=" + misses + ", evictions=" + evictions +
+            ", entries=" + entries + ", capacity=" + capacity + "}";
+    }
+}
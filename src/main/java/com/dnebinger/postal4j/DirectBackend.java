@@ -0,0 +1,54 @@
+package com.dnebinger.postal4j;
+
+import java.util.Map;
+
+/**
+ * The single-address libpostal calls made without going through JNI, see {@link LibPostal#getBackend()}.
+ * The only implementation, {@code FfmBackend}, lives in the JDK 22+ part of the multi-release jar and is looked up
+ * reflectively, so older JDKs never see it. Callers check the needed modules are loaded before calling.
+ */
+interface DirectBackend {
+
+    // System property choosing the backend: "jni", "ffm", or unset to use FFM when available
+    String BACKEND_PROPERTY = "postal4j.backend";
+
+    /**
+     * @return the backend name reported by {@link LibPostal#getBackend()}
+     */
+    String name();
+
+    Map<String, String> parseAddress(String address, String language, String country);
+
+    String[] expandAddress(String address, boolean root);
+
+    /**
+     * @return the FFM backend, or null when it is turned off or not available on this JDK
+     * @throws IllegalStateException when the FFM backend was asked for but is not available
+     */
+    static DirectBackend load() {
+        String backend = System.getProperty(BACKEND_PROPERTY, "");
+
+        if (backend.equalsIgnoreCase("jni")) {
+            return null;
+        }
+
+        try {
+            if (Runtime.version().feature() >= 22) {
+                Class<?> type = Class.forName("com.dnebinger.postal4j.FfmBackend");
+                return (DirectBackend) type.getDeclaredConstructor().newInstance();
+            }
+        } catch (ReflectiveOperationException | LinkageError | RuntimeException e) {
+            if (backend.equalsIgnoreCase("ffm")) {
+                throw new IllegalStateException("FFM backend not available", e);
+            }
+
+            return null;
+        }
+
+        if (backend.equalsIgnoreCase("ffm")) {
+            throw new IllegalStateException("FFM backend needs JDK 22 or newer");
+        }
+
+        return null;
+    }
+}
@@ -0,0 +1,81 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Snapshot of the disk cache counters of this process, see {@link LibPostal#setDiskCache}.
+ * All values are zero when no disk cache is open.
+ */
+public final class DiskCacheStats {
+
+    private final long hits;
+    private final long misses;
+    private final long stores;
+    private final long skipped;
+    private final long slots;
+    private final long fileBytes;
+
+    // Called from native code
+    DiskCacheStats(long hits, long misses, long stores, long skipped, long slots, long fileBytes) {
+        this.hits = hits;
+        this.misses = misses;
+        this.stores = stores;
+        this.skipped = skipped;
+        this.slots = slots;
+        this.fileBytes = fileBytes;
+    }
+
+    /**
+     * @return the number of memory cache misses served from the file
+     */
+    public long getHits() {
+        return hits;
+    }
+
+    /**
+     * @return the number of lookups not found in the file, including entries of other libpostal data versions
+     */
+    public long getMisses() {
+        return misses;
+    }
+
+    /**
+     * @return the number of results written to the file
+     */
+    public long getStores() {
+        return stores;
+    }
+
+    /**
+     * @return the number of results not written, too large for a slot or their slot was being written by another process
+     */
+    public long getSkipped() {
+        return skipped;
+    }
+
+    /**
+     * @return the number of entry slots in the file
+     */
+    public long getSlots() {
+        return slots;
+    }
+
+    /**
+     * @return the size of the file
+     */
+    public long getFileBytes() {
+        return fileBytes;
+    }
+
+    /**
+     * @return the fraction of lookups that were hits, 0 when there were no lookups
+     */
+    public double hitRate() {
+        long lookups = hits + misses;
+        return lookups == 0 ? 0.0 : (double) hits / lookups;
+    }
+
+    @Override
+    public String toString() {
+        return "DiskCacheStats{hits=" + hits + ", misses=" + misses + ", stores=" + stores + ", skipped=" + skipped +
+            ", slots=" + slots + ", fileBytes=" + fileBytes + "}";
+    }
+}
@@ -0,0 +1,15 @@
+package com.dnebinger.postal4j;
+
+/**
+ * The address fields libpostal can compare pairwise, one per {@code libpostal_is_*_duplicate} function.
+ * The declaration order is shared with the native comparator table, do not reorder.
+ */
+public enum DuplicateComponent {
+    NAME,
+    STREET,
+    HOUSE_NUMBER,
+    PO_BOX,
+    UNIT,
+    FLOOR,
+    POSTAL_CODE
+}
@@ -0,0 +1,51 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Result of a libpostal pairwise duplicate check, ordered from least to most similar.
+ * The codes are libpostal's {@code libpostal_duplicate_status_t} values, as returned in the batch byte arrays.
+ */
+public enum DuplicateStatus {
+    NULL_DUPLICATE(-1),
+    NON_DUPLICATE(0),
+    POSSIBLE_DUPLICATE_NEEDS_REVIEW(3),
+    LIKELY_DUPLICATE(6),
+    EXACT_DUPLICATE(9);
+
+    private final int code;
+
+    DuplicateStatus(int code) {
+        this.code = code;
+    }
+
+    /**
+     * @return the libpostal status code
+     */
+    public int code() {
+        return code;
+    }
+
+    /**
+     * @return true for {@link #LIKELY_DUPLICATE} and {@link #EXACT_DUPLICATE}
+     */
+    public boolean isDuplicate() {
+        return code >= LIKELY_DUPLICATE.code;
+    }
+
+    /**
+     * Looks up a status by its libpostal code.
+     *
+     * @param code the libpostal status code
+     * @return the matching status
+     * @throws IllegalArgumentException if the code is unknown
+     */
+    public static DuplicateStatus fromCode(int code) {
+        switch (code) {
+            case -1: return NULL_DUPLICATE;
+            case 0: return NON_DUPLICATE;
+            case 3: return POSSIBLE_DUPLICATE_NEEDS_REVIEW;
+            case 6: return LIKELY_DUPLICATE;
+            case 9: return EXACT_DUPLICATE;
+            default: throw new IllegalArgumentException("Unknown duplicate status code: " + code);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Results of scoring one query against many candidates: one status code and one similarity per candidate,
+ * in candidate order, held in primitive arrays.
+ */
+public final class FuzzyDuplicateBatch {
+
+    private final byte[] statuses;
+    private final double[] similarities;
+
+    FuzzyDuplicateBatch(byte[] statuses, double[] similarities) {
+        this.statuses = statuses;
+        this.similarities = similarities;
+    }
+
+    /**
+     * @return the number of candidates
+     */
+    public int size() {
+        return statuses.length;
+    }
+
+    /**
+     * @param candidate the candidate index
+     * @return the status of the candidate
+     */
+    public DuplicateStatus status(int candidate) {
+        return DuplicateStatus.fromCode(statuses[candidate]);
+    }
+
+    /**
+     * @param candidate the candidate index
+     * @return the similarity of the candidate to the query, 0 to 1
+     */
+    public double similarity(int candidate) {
+        return similarities[candidate];
+    }
+
+    /**
+     * @return the status codes (see {@link DuplicateStatus#fromCode}), not copied
+     */
+    public byte[] statusCodes() {
+        return statuses;
+    }
+
+    /**
+     * @return the similarities, not copied
+     */
+    public double[] similarities() {
+        return similarities;
+    }
+}
@@ -0,0 +1,90 @@
+package com.dnebinger.postal4j;
+
+import java.util.Arrays;
+import java.util.Objects;
+
+/**
+ * Immutable options for the fuzzy duplicate checks: optional language hints and the similarity
+ * thresholds for {@link DuplicateStatus#POSSIBLE_DUPLICATE_NEEDS_REVIEW} and {@link DuplicateStatus#LIKELY_DUPLICATE}.
+ * Build with {@link #builder()}, which starts from the libpostal defaults.
+ */
+public final class FuzzyDuplicateOptions {
+
+    private final String[] languages;
+    private final double needsReviewThreshold;
+    private final double likelyDupeThreshold;
+
+    private FuzzyDuplicateOptions(Builder builder) {
+        this.languages = builder.languages;
+        this.needsReviewThreshold = builder.needsReviewThreshold;
+        this.likelyDupeThreshold = builder.likelyDupeThreshold;
+    }
+
+    public static Builder builder() {
+        return new Builder();
+    }
+
+    public String[] getLanguages() {
+        return languages == null ? null : languages.clone();
+    }
+
+    public double getNeedsReviewThreshold() {
+        return needsReviewThreshold;
+    }
+
+    public double getLikelyDupeThreshold() {
+        return likelyDupeThreshold;
+    }
+
+    // Passed to native code as-is
+    String[] languages() {
+        return languages;
+    }
+
+    @Override
+    public String toString() {
+        return "FuzzyDuplicateOptions{languages=" + Arrays.toString(languages) + ", needsReviewThreshold=" + needsReviewThreshold +
+            ", likelyDupeThreshold=" + likelyDupeThreshold + "}";
+    }
+
+    public static final class Builder {
+        private String[] languages;
+        private double needsReviewThreshold;
+        private double likelyDupeThreshold;
+
+        private Builder() {
+            double[] thresholds = LibPostal.defaultFuzzyDuplicateThresholds();
+
+            this.needsReviewThreshold = thresholds[0];
+            this.likelyDupeThreshold = thresholds[1];
+        }
+
+        public Builder languages(String... languages) {
+            if (languages == null || languages.length == 0) {
+                this.languages = null;
+            } else {
+                for (String language : languages) {
+                    Objects.requireNonNull(language, "language");
+                }
+
+                this.languages = languages.clone();
+            }
+
+            return this;
+        }
+
+        public Builder needsReviewThreshold(double needsReviewThreshold) {
+            this.needsReviewThreshold = needsReviewThreshold;
+            return this;
+        }
+
+        public Builder likelyDupeThreshold(double likelyDupeThreshold) {
+            this.likelyDupeThreshold = likelyDupeThreshold;
+            return this;
+        }
+
+        public FuzzyDuplicateOptions build() {
+            return new FuzzyDuplicateOptions(this);
+        }
+    }
+}
@@ -0,0 +1,31 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Result of a single fuzzy duplicate check: the status and the similarity it was derived from.
+ */
+public final class FuzzyDuplicateResult {
+
+    private final DuplicateStatus status;
+    private final double similarity;
+
+    FuzzyDuplicateResult(DuplicateStatus status, double similarity) {
+        this.status = status;
+        this.similarity = similarity;
+    }
+
+    public DuplicateStatus getStatus() {
+        return status;
+    }
+
+    /**
+     * @return the weighted token similarity, 0 to 1
+     */
+    public double getSimilarity() {
+        return similarity;
+    }
+
+    @Override
+    public String toString() {
+        return "FuzzyDuplicateResult{status=" + status + ", similarity=" + similarity + "}";
+    }
+}
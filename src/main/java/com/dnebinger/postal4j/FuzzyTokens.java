@@ -0,0 +1,154 @@
+package com.dnebinger.postal4j;
+
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.Objects;
+
+/**
+ * Scored tokens for the fuzzy duplicate checks, packed as one UTF-8 array with an offsets table and a
+ * parallel score array, so they cross JNI as three primitive arrays instead of a String per token.
+ * Scores are TF-IDF style weights: rarer, more distinctive tokens should score higher.
+ */
+public final class FuzzyTokens {
+
+    private final byte[] tokens;
+    private final int[] offsets;
+    private final double[] scores;
+
+    /**
+     * Wraps already packed tokens, the arrays are not copied.
+     *
+     * @param tokens the packed UTF-8 tokens
+     * @param offsets the start of each token in {@code tokens}, plus the end of the last one
+     * @param scores the score of each token
+     */
+    public FuzzyTokens(byte[] tokens, int[] offsets, double[] scores) {
+        this.tokens = Objects.requireNonNull(tokens, "tokens");
+        this.offsets = Objects.requireNonNull(offsets, "offsets");
+        this.scores = Objects.requireNonNull(scores, "scores");
+
+        if (offsets.length != scores.length + 1) {
+            throw new IllegalArgumentException("Offsets need one entry per score plus one");
+        }
+    }
+
+    /**
+     * Packs tokens and their scores.
+     *
+     * @param tokens the tokens
+     * @param scores the score of each token
+     * @return the packed tokens
+     */
+    public static FuzzyTokens of(String[] tokens, double[] scores) {
+        if (tokens.length != scores.length) {
+            throw new IllegalArgumentException("Tokens and scores must have the same length");
+        }
+
+        Builder builder = new Builder(tokens.length);
+
+        for (int i = 0; i < tokens.length; i++) {
+            builder.add(tokens[i], scores[i]);
+        }
+
+        return builder.build();
+    }
+
+    public static Builder builder() {
+        return new Builder(16);
+    }
+
+    /**
+     * @return the number of tokens
+     */
+    public int size() {
+        return scores.length;
+    }
+
+    /**
+     * @param index the token index
+     * @return the token, decoded from UTF-8
+     */
+    public String token(int index) {
+        Objects.checkIndex(index, size());
+
+        return new String(tokens, offsets[index], offsets[index + 1] - offsets[index], StandardCharsets.UTF_8);
+    }
+
+    /**
+     * @param index the token index
+     * @return the score of the token
+     */
+    public double score(int index) {
+        return scores[Objects.checkIndex(index, size())];
+    }
+
+    // Passed to native code as-is
+    byte[] tokens() {
+        return tokens;
+    }
+
+    int[] offsets() {
+        return offsets;
+    }
+
+    double[] scores() {
+        return scores;
+    }
+
+    /**
+     * Accumulates tokens without creating a String per token. When packing the candidates of a batch,
+     * record {@link #size()} before adding each candidate's tokens to get the candidate offsets.
+     */
+    public static final class Builder {
+        private byte[] tokens;
+        private int[] offsets;
+        private double[] scores;
+        private int length;
+        private int count;
+
+        private Builder(int capacity) {
+            this.tokens = new byte[Math.max(capacity * 8, 16)];
+            this.offsets = new int[Math.max(capacity, 1) + 1];
+            this.scores = new double[Math.max(capacity, 1)];
+        }
+
+        public Builder add(String token, double score) {
+            byte[] utf8 = token.getBytes(StandardCharsets.UTF_8);
+            return add(utf8, 0, utf8.length, score);
+        }
+
+        public Builder add(byte[] utf8, int offset, int tokenLength, double score) {
+            Objects.checkFromIndexSize(offset, tokenLength, utf8.length);
+
+            if (length + tokenLength > tokens.length) {
+                tokens = Arrays.copyOf(tokens, Math.max(tokens.length * 2, length + tokenLength));
+            }
+            if (count == scores.length) {
+                scores = Arrays.copyOf(scores, count * 2);
+                offsets = Arrays.copyOf(offsets, count * 2 + 1);
+            }
+
+            System.arraycopy(utf8, offset, tokens, length, tokenLength);
+            offsets[count] = length;
+            scores[count] = score;
+            length += tokenLength;
+            count++;
+
+            return this;
+        }
+
+        /**
+         * @return the number of tokens added so far
+         */
+        public int size() {
+            return count;
+        }
+
+        public FuzzyTokens build() {
+            int[] packedOffsets = Arrays.copyOf(offsets, count + 1);
+            packedOffsets[count] = length;
+
+            return new FuzzyTokens(Arrays.copyOf(tokens, length), packedOffsets, Arrays.copyOf(scores, count));
+        }
+    }
+}
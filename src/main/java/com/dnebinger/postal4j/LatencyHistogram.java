@@ -0,0 +1,121 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Latency distribution of one stage of one entry point, see {@link LibPostalMetrics#getLatency(MetricsEntryPoint, MetricsStage)}.
+ * Values below 8 ns are exact, above that every power of two is split into 8 buckets, so percentiles are within 12.5%.
+ */
+public final class LatencyHistogram {
+
+    // Bucket layout, shared with postal4j_metrics.h
+    static final int SUB_BUCKETS = 8;
+    static final int MAX_EXPONENT = 40;
+    static final int BUCKETS = (MAX_EXPONENT - 2) * SUB_BUCKETS;
+
+    // count, total, max and the bucket counts
+    static final int LONGS = 3 + BUCKETS;
+
+    private final long count;
+    private final long totalNanos;
+    private final long maxNanos;
+    private final long[] buckets;
+
+    LatencyHistogram(long[] counters, int offset) {
+        this.count = counters[offset];
+        this.totalNanos = counters[offset + 1];
+        this.maxNanos = counters[offset + 2];
+        this.buckets = new long[BUCKETS];
+
+        System.arraycopy(counters, offset + 3, buckets, 0, BUCKETS);
+    }
+
+    /**
+     * @return the number of recorded calls
+     */
+    public long getCount() {
+        return count;
+    }
+
+    /**
+     * @return the sum of all recorded values
+     */
+    public long getTotalNanos() {
+        return totalNanos;
+    }
+
+    /**
+     * @return the largest recorded value
+     */
+    public long getMaxNanos() {
+        return maxNanos;
+    }
+
+    /**
+     * @return the mean of the recorded values, 0 when there are none
+     */
+    public double getMeanNanos() {
+        return count == 0 ? 0.0 : (double) totalNanos / count;
+    }
+
+    /**
+     * @param percentile the percentile, from 0 to 100
+     * @return the highest value of the bucket holding the percentile (capped at the maximum), 0 when there are no values
+     */
+    public long getPercentileNanos(double percentile) {
+        if (percentile < 0.0 || percentile > 100.0) {
+            throw new IllegalArgumentException("Percentile must be between 0 and 100");
+        }
+
+        if (count == 0) {
+            return 0;
+        }
+
+        long rank = Math.max(1, (long) Math.ceil(percentile / 100.0 * count));
+        long seen = 0;
+
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += buckets[i];
+
+            if (seen >= rank) {
+                return Math.min(bucketHighestValue(i), maxNanos);
+            }
+        }
+
+        // the per-thread counters are read one at a time, so a snapshot taken during calls may be a little off
+        return maxNanos;
+    }
+
+    /**
+     * @return the number of values in each bucket, see {@link #bucketLowestValue(int)}
+     */
+    public long[] getBuckets() {
+        return buckets.clone();
+    }
+
+    /**
+     * @param bucket the bucket index
+     * @return the smallest value counted in the bucket
+     */
+    public static long bucketLowestValue(int bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+
+        int exponent = bucket / SUB_BUCKETS + 2;
+
+        return (long) (SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - 3);
+    }
+
+    /**
+     * @param bucket the bucket index
+     * @return the largest value counted in the bucket, the last bucket also counts everything longer
+     */
+    public static long bucketHighestValue(int bucket) {
+        return bucket == BUCKETS - 1 ? Long.MAX_VALUE : bucketLowestValue(bucket + 1) - 1;
+    }
+
+    @Override
+    public String toString() {
+        return "LatencyHistogram{count=" + count + ", meanNanos=" + Math.round(getMeanNanos()) + ", p50Nanos=" + getPercentileNanos(50) +
+            ", p99Nanos=" + getPercentileNanos(99) + ", maxNanos=" + maxNanos + "}";
+    }
+}
@@ -1,6 +1,24 @@
 package com.dnebinger.postal4j;
 
+import java.io.BufferedReader;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InputStreamReader;
+import java.io.UncheckedIOException;
+import java.lang.ref.Reference;
+import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
 import java.util.Map;
+import java.util.Objects;
+import java.util.Set;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.atomic.AtomicIntegerArray;
+import java.util.concurrent.locks.LockSupport;
 
 /**
  * JNI wrapper for the libpostal C library.
@@ -15,21 +33,961 @@ public class LibPostal {
     // Native method declarations will be added here
     public static native void setup();
     public static native void setup(String dataDir);
-    public static native void teardown();
+
+    // Waits for a running background setup first, so its late success cannot leave libpostal loaded
+    public static void teardown() {
+        CompletableFuture<SetupReport> setup;
+
+        synchronized (LibPostal.class) {
+            setup = backgroundSetup;
+            backgroundSetup = null;
+        }
+
+        if (setup != null) {
+            setup.handle((report, error) -> null).join();
+        }
+
+        teardownNative();
+    }
+
+    private static native void teardownNative();
+
+    // Setup with native batch workers - batch calls are split across the workers with work stealing.
+    // A null dataDir uses the default data directory, 0 workers runs batches on the calling thread.
+    public static native void setup(String dataDir, int workerThreads);
+    public static native int getWorkerThreads();
+
+    // Setup with workers and a native result cache holding up to cacheEntries parse/expand results (0 disables it).
+    // Keys are the input with whitespace collapsed and case folded (when libpostal lowercases anyway) plus the
+    // options/language/country, a hit is served without calling libpostal.
+    public static native void setup(String dataDir, int workerThreads, int cacheEntries);
+    public static native CacheStats getCacheStats();
+    public static native void clearCache();
+
+    // Persistent disk cache behind the result cache, opened by the next setup (with an explicit dataDir) and closed by
+    // teardown. Results are kept in a memory-mapped file that survives restarts and is shared by every process on the
+    // host using it. Entries are tagged with the libpostal data version (fingerprinted from the data files), so results
+    // of older data are ignored and overwritten. An existing file keeps the size it was created with, a null path turns
+    // the disk cache off. clearCache leaves the file alone; sidecar clients skip it, give the daemon --disk-cache instead.
+    public static void setDiskCache(Path file, long sizeBytes) {
+        setDiskCacheNative(file == null ? null : file.toString(), sizeBytes);
+    }
+
+    private static native void setDiskCacheNative(String path, long sizeBytes);
+    public static native DiskCacheStats getDiskCacheStats();
+
+    // Setup loading only the given modules (EXPANSION is always loaded), so e.g. expansion-only services skip the
+    // multi-GB parser. When lazy, the modules are loaded on first use instead of during setup. Calls needing a module
+    // outside the set throw, expand/dedupe calls without languages need CLASSIFIER to detect them.
+    public static void setup(String dataDir, Set<LibPostalModule> modules) {
+        setup(dataDir, 0, 0, modules, false);
+    }
+
+    public static void setup(String dataDir, Set<LibPostalModule> modules, boolean lazy) {
+        setup(dataDir, 0, 0, modules, lazy);
+    }
+
+    public static void setup(String dataDir, int workerThreads, int cacheEntries, Set<LibPostalModule> modules, boolean lazy) {
+        Objects.requireNonNull(modules, "modules");
+        setupWithModules(dataDir, workerThreads, cacheEntries, LibPostalModule.toMask(modules), lazy);
+    }
+
+    // Loads the given enabled modules now, e.g. to warm up a lazy setup off the request path
+    public static void loadModules(Set<LibPostalModule> modules) {
+        Objects.requireNonNull(modules, "modules");
+        loadModules(LibPostalModule.toMask(modules));
+    }
+
+    // The modules currently loaded, teardown() unloads exactly these
+    public static Set<LibPostalModule> getLoadedModules() {
+        return LibPostalModule.fromMask(loadedModules());
+    }
+
+    private static native void setupWithModules(String dataDir, int workerThreads, int cacheEntries, int modules, boolean lazy);
+    private static native void loadModules(int modules);
+    private static native int loadedModules();
+
+    // Setup against a postal4jSidecar daemon instead of loading the models, so every JVM on a host shares one copy of them.
+    // Parse/expand calls (single, batch, compact, UTF-8 and bulk file) are served by the daemon through shared memory,
+    // the other calls throw. Setting the POSTAL4J_SIDECAR environment variable to the socket path makes every setup()
+    // connect to the daemon instead, with no code change.
+    public static void setupSidecar(String socketPath) {
+        setupSidecar(socketPath, 0, 0);
+    }
+
+    public static native void setupSidecar(String socketPath, int workerThreads, int cacheEntries);
+    private static native boolean sidecarConnected();
+
+    // Background setup - loads libpostal on a daemon thread, then runs a warmup corpus through parse and expand so the
+    // first real requests find the models paged in and the code paths warm. The future completes with the load and warmup
+    // times, isReady() turns true at the same moment and can back a readiness probe. Calls made while libpostal is still
+    // loading throw as before setup(), once it is loaded they work alongside the warmup.
+    // A null warmup collection uses the bundled multilingual corpus, an empty one skips the warmup.
+    private static final String WARMUP_CORPUS = "warmup-addresses.txt";
+
+    private static volatile CompletableFuture<SetupReport> backgroundSetup;
+
+    public static CompletableFuture<SetupReport> setupInBackground() {
+        return setupInBackground(null, 0, 0, null);
+    }
+
+    public static CompletableFuture<SetupReport> setupInBackground(String dataDir) {
+        return setupInBackground(dataDir, 0, 0, null);
+    }
+
+    public static CompletableFuture<SetupReport> setupInBackground(String dataDir, int workerThreads, int cacheEntries,
+                                                                   Collection<String> warmupAddresses) {
+        List<String> warmup = (warmupAddresses != null ? List.copyOf(warmupAddresses) : null);
+        CompletableFuture<SetupReport> future = new CompletableFuture<>();
+
+        synchronized (LibPostal.class) {
+            if (backgroundSetup != null && !backgroundSetup.isDone()) {
+                throw new IllegalStateException("LibPostal background setup already running");
+            }
+            backgroundSetup = future;
+        }
+
+        Thread thread = new Thread(() -> {
+            try {
+                future.complete(runSetup(dataDir, workerThreads, cacheEntries, warmup));
+            } catch (Throwable t) {
+                future.completeExceptionally(t);
+            }
+        }, "postal4j-setup");
+        thread.setDaemon(true);
+        thread.start();
+
+        return future;
+    }
+
+    // True once the last setupInBackground has loaded and warmed up libpostal, false again after teardown()
+    public static boolean isReady() {
+        CompletableFuture<SetupReport> setup = backgroundSetup;
+        return setup != null && setup.isDone() && !setup.isCompletedExceptionally();
+    }
+
+    private static SetupReport runSetup(String dataDir, int workerThreads, int cacheEntries, List<String> warmup) {
+        long start = System.nanoTime();
+        setup(dataDir, workerThreads, cacheEntries);
+        long loaded = System.nanoTime();
+
+        List<String> addresses = (warmup != null ? warmup : loadWarmupCorpus());
+
+        if (addresses.isEmpty()) {
+            return new SetupReport(loaded - start, 0, 0);
+        }
+
+        // the single-address calls warm whichever backend serves them, the batch calls warm the native workers
+        for (String address : addresses) {
+            parseAddress(address);
+            expandAddress(address);
+        }
+
+        String[] batch = addresses.toArray(new String[0]);
+        parseAddresses(batch);
+        expandAddresses(batch);
+
+        // keep the cache statistics about real traffic
+        if (cacheEntries > 0) {
+            clearCache();
+        }
+
+        return new SetupReport(loaded - start, System.nanoTime() - loaded, addresses.size());
+    }
+
+    private static List<String> loadWarmupCorpus() {
+        try (InputStream in = LibPostal.class.getResourceAsStream(WARMUP_CORPUS)) {
+            if (in == null) {
+                throw new IllegalStateException("Warmup corpus not found: " + WARMUP_CORPUS);
+            }
+
+            List<String> addresses = new ArrayList<>();
+            BufferedReader reader = new BufferedReader(new InputStreamReader(in, StandardCharsets.UTF_8));
+
+            for (String line = reader.readLine(); line != null; line = reader.readLine()) {
+                if (!line.isBlank() && !line.startsWith("#")) {
+                    addresses.add(line);
+                }
+            }
+
+            return addresses;
+        } catch (IOException e) {
+            throw new UncheckedIOException("Error reading the warmup corpus", e);
+        }
+    }
+
+    // Backend - on JDK 22+ (multi-release jar) the single-address parse/expand calls below go straight to libpostal through
+    // FFM downcalls, skipping the JNI transition and String copies. Calls only take that path once their modules are loaded
+    // and while the result cache is off, everything else stays on JNI. -Dpostal4j.backend=jni turns the FFM backend off.
+    private static final DirectBackend DIRECT = DirectBackend.load();
+
+    // The MODULE_* bits the direct backend may use, kept up to date by the native setup/teardown/module loading
+    private static volatile int directModules;
+
+    // Direct calls in flight, striped by thread with one stripe per cache line so callers rarely share a counter.
+    // A call counts itself before checking directModules and teardown clears directModules before reading the
+    // counts, so either the call falls back to JNI or teardown waits for it (see awaitDirectCalls).
+    private static final int DIRECT_STRIPES = 64;
+    private static final int DIRECT_STRIPE_INTS = 16;
+    private static final AtomicIntegerArray DIRECT_CALLS = new AtomicIntegerArray(DIRECT_STRIPES * DIRECT_STRIPE_INTS);
+
+    // "sidecar" while connected to a sidecar daemon, "ffm" when the FFM backend is available, otherwise "jni"
+    public static String getBackend() {
+        if (sidecarConnected()) {
+            return "sidecar";
+        }
+
+        return DIRECT != null ? DIRECT.name() : "jni";
+    }
+
+    // Counts a direct call in, returning its stripe, or -1 (not counted) when the call has to go through JNI
+    private static int enterDirect(int modules) {
+        if (DIRECT == null) {
+            return -1;
+        }
+
+        int stripe = (int) (Thread.currentThread().getId() & (DIRECT_STRIPES - 1)) * DIRECT_STRIPE_INTS;
+        DIRECT_CALLS.getAndIncrement(stripe);
+
+        if ((directModules & modules) == modules) {
+            return stripe;
+        }
+
+        DIRECT_CALLS.getAndDecrement(stripe);
+        return -1;
+    }
+
+    private static void leaveDirect(int stripe) {
+        DIRECT_CALLS.getAndDecrement(stripe);
+    }
+
+    // Called from the native teardown once no JNI call is left running, before the modules are unloaded
+    private static void awaitDirectCalls() {
+        directModules = 0;
+
+        for (int stripe = 0; stripe < DIRECT_STRIPES * DIRECT_STRIPE_INTS; stripe += DIRECT_STRIPE_INTS) {
+            while (DIRECT_CALLS.get(stripe) != 0) {
+                LockSupport.parkNanos(100_000);
+            }
+        }
+    }
 
     // Address Parsing - returns label:value pairs
-    public static native Map<String, String> parseAddress(String address);
-    public static native Map<String, String> parseAddress(String address, String language, String country);
+    public static Map<String, String> parseAddress(String address) {
+        int stripe = enterDirect(LibPostalModule.PARSER.mask());
+
+        if (stripe >= 0) {
+            try {
+                return DIRECT.parseAddress(address, null, null);
+            } finally {
+                leaveDirect(stripe);
+            }
+        }
+
+        return parseAddressNative(address);
+    }
+
+    public static Map<String, String> parseAddress(String address, String language, String country) {
+        int stripe = enterDirect(LibPostalModule.PARSER.mask());
+
+        if (stripe >= 0) {
+            try {
+                return DIRECT.parseAddress(address, language, country);
+            } finally {
+                leaveDirect(stripe);
+            }
+        }
+
+        return parseAddressNative(address, language, country);
+    }
+
+    private static native Map<String, String> parseAddressNative(String address);
+    private static native Map<String, String> parseAddressNative(String address, String language, String country);
+
+    // Batch Address Parsing - one native call per batch, results are in the same order as the addresses.
+    // The languages/countries arrays may be null, otherwise they must match the addresses length (null elements allowed).
+    public static native Map<String, String>[] parseAddresses(String[] addresses);
+    public static native Map<String, String>[] parseAddresses(String[] addresses, String[] languages, String[] countries);
+
+    // Batch Address Expansion - one native call per batch, expansions are in the same order as the addresses
+    public static String[][] expandAddresses(String[] addresses) {
+        return expandAddressBatch(addresses, 0, false);
+    }
+
+    public static String[][] expandRootAddresses(String[] addresses) {
+        return expandAddressBatch(addresses, 0, true);
+    }
+
+    public static String[][] expandAddresses(String[] addresses, NormalizeOptions options) {
+        try {
+            return expandAddressBatch(addresses, options.handle(), false);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    public static String[][] expandRootAddresses(String[] addresses, NormalizeOptions options) {
+        try {
+            return expandAddressBatch(addresses, options.handle(), true);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    // A 0 handle expands with the libpostal default options
+    private static native String[][] expandAddressBatch(String[] addresses, long optionsHandle, boolean root);
+
+    // Compact Address Parsing - labels as AddressLabel ordinals and values as packed UTF-8, Strings are only created on demand
+    public static native ParsedAddress parseAddressCompact(String address);
+    public static native ParsedAddress parseAddressCompact(String address, String language, String country);
+    public static native ParsedAddressBatch parseAddressesCompact(String[] addresses);
+    public static native ParsedAddressBatch parseAddressesCompact(String[] addresses, String[] languages, String[] countries);
 
     // Address Expansion - returns normalized variations (using defaults)
-    public static native String[] expandAddress(String address);
+    public static String[] expandAddress(String address) {
+        int stripe = enterDirect(DEFAULT_EXPAND_MODULES);
+
+        if (stripe >= 0) {
+            try {
+                return DIRECT.expandAddress(address, false);
+            } finally {
+                leaveDirect(stripe);
+            }
+        }
+
+        return expandAddressNative(address);
+    }
+
     public static native String[] expandAddress(String address, String[] languages, boolean latinAscii, boolean transliterate, boolean stripAccents,
         boolean decompose, boolean lowercase, boolean trimString, boolean dropParentheticals, boolean replaceNumericHyphens, boolean deleteNumericHyphens,
         boolean splitAlphaFromNumeric, boolean replaceWordHyphens, boolean deleteWordHyphens, boolean deleteFinalPeriods, boolean deleteAcronymPeriods,
         boolean dropEnglishPossessives, boolean deleteApostrophes, boolean expandNumex, boolean romanNumerals, int addressComponents);
-    public static native String[] expandRootAddress(String address);
+    public static String[] expandRootAddress(String address) {
+        int stripe = enterDirect(DEFAULT_EXPAND_MODULES);
+
+        if (stripe >= 0) {
+            try {
+                return DIRECT.expandAddress(address, true);
+            } finally {
+                leaveDirect(stripe);
+            }
+        }
+
+        return expandRootAddressNative(address);
+    }
+
     public static native String[] expandRootAddress(String address, String[] languages, boolean latinAscii, boolean transliterate, boolean stripAccents,
         boolean decompose, boolean lowercase, boolean trimString, boolean dropParentheticals, boolean replaceNumericHyphens, boolean deleteNumericHyphens,
         boolean splitAlphaFromNumeric, boolean replaceWordHyphens, boolean deleteWordHyphens, boolean deleteFinalPeriods, boolean deleteAcronymPeriods,
         boolean dropEnglishPossessives, boolean deleteApostrophes, boolean expandNumex, boolean romanNumerals, int addressComponents);
+
+    // the default options detect the languages
+    private static final int DEFAULT_EXPAND_MODULES = LibPostalModule.EXPANSION.mask() | LibPostalModule.CLASSIFIER.mask();
+
+    private static native String[] expandAddressNative(String address);
+    private static native String[] expandRootAddressNative(String address);
+
+    // Address Expansion with precompiled options - see NormalizeOptions
+    public static String[] expandAddress(String address, NormalizeOptions options) {
+        try {
+            return expandAddressWithHandle(address, options.handle(), false);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    public static String[] expandRootAddress(String address, NormalizeOptions options) {
+        try {
+            return expandAddressWithHandle(address, options.handle(), true);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    private static native String[] expandAddressWithHandle(String address, long optionsHandle, boolean root);
+
+    // NormalizeOptions support - the handle owns a native libpostal_normalize_options_t
+    static native int defaultNormalizeFlags();
+    static native int defaultAddressComponents();
+    static native long createNormalizeOptions(String[] languages, int flags, int addressComponents);
+    static native void destroyNormalizeOptions(long optionsHandle);
+
+    // Near-Duplicate Hashing - blocking keys for record linkage, records sharing a hash are candidate duplicates.
+    // Labels are libpostal parser labels (see AddressLabel), values the matching component values.
+    public static String[] nearDupeHashes(String[] labels, String[] values, NearDupeHashOptions options) {
+        return nearDupeHashesNative(labels, values, options.languages(), options.getFlags(), options.getGeohashPrecision(), Double.NaN, Double.NaN);
+    }
+
+    // Adds geohash keys for the coordinates, regardless of the WITH_LATLON flag
+    public static String[] nearDupeHashes(String[] labels, String[] values, double latitude, double longitude, NearDupeHashOptions options) {
+        return nearDupeHashesNative(labels, values, options.languages(), options.getFlags() | NearDupeHashOptions.WITH_LATLON,
+            options.getGeohashPrecision(), latitude, longitude);
+    }
+
+    public static String[] nearDupeHashes(ParsedAddress address, NearDupeHashOptions options) {
+        String[] labels = new String[address.size()];
+        String[] values = new String[address.size()];
+
+        for (int i = 0; i < labels.length; i++) {
+            labels[i] = address.label(i).label();
+            values[i] = address.value(i);
+        }
+
+        return nearDupeHashes(labels, values, options);
+    }
+
+    // Batch Near-Duplicate Hashing - one native call for many records, hashed on the native workers.
+    // The latitudes/longitudes may be null, otherwise they have one entry per record (NaN for none) and add geohash
+    // keys when WITH_LATLON is set.
+    public static NearDupeHashBatch nearDupeHashes(ParsedAddressBatch batch, double[] latitudes, double[] longitudes, NearDupeHashOptions options) {
+        return nearDupeHashes(batch.recordOffsets(), batch.labels(), batch.values(), batch.offsets(), latitudes, longitudes, options);
+    }
+
+    // Flat form: recordOffsets[i] is the first component of record i (plus a final entry with the component count),
+    // labels are AddressLabel ordinals, values packed UTF-8 with valueOffsets[j] the start of component j (plus the end).
+    public static NearDupeHashBatch nearDupeHashes(int[] recordOffsets, byte[] labels, byte[] values, int[] valueOffsets,
+        double[] latitudes, double[] longitudes, NearDupeHashOptions options) {
+        return nearDupeHashBatch(recordOffsets, labels, values, valueOffsets, latitudes, longitudes, options.languages(),
+            options.getFlags(), options.getGeohashPrecision());
+    }
+
+    // Name hashes for matching venue/person names on their own
+    public static String[] nearDupeNameHashes(String name) {
+        return nearDupeNameHashesNative(name, 0);
+    }
+
+    public static String[] nearDupeNameHashes(String name, NormalizeOptions options) {
+        try {
+            return nearDupeNameHashesNative(name, options.handle());
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    private static native String[] nearDupeHashesNative(String[] labels, String[] values, String[] languages, int flags, int geohashPrecision,
+        double latitude, double longitude);
+    private static native String[] nearDupeNameHashesNative(String name, long optionsHandle);
+    private static native NearDupeHashBatch nearDupeHashBatch(int[] recordOffsets, byte[] labels, byte[] values, int[] valueOffsets,
+        double[] latitudes, double[] longitudes, String[] languages, int flags, int geohashPrecision);
+
+    // NearDupeHashOptions support
+    static native int defaultNearDupeHashFlags();
+    static native int defaultGeohashPrecision();
+
+    // BlockingIndex support, the handle owns the mapped index file until closed
+    static native long openBlockingIndex(String path, String[] languages, int flags, int geohashPrecision);
+    static native void closeBlockingIndex(long indexHandle);
+    static native void flushBlockingIndex(long indexHandle);
+    // {records, keys, postings, fileBytes}
+    static native long[] blockingIndexStats(long indexHandle);
+    static native void blockingIndexAdd(long indexHandle, long id, String[] labels, String[] values, double latitude, double longitude);
+    static native void blockingIndexAddBatch(long indexHandle, long[] ids, int[] recordOffsets, byte[] labels, byte[] values,
+        int[] valueOffsets, double[] latitudes, double[] longitudes);
+    static native long[] blockingIndexQuery(long indexHandle, String[] labels, String[] values, double latitude, double longitude,
+        int maxPostings);
+
+    // Pairwise Duplicate Checks - libpostal's is_*_duplicate comparators, languages are optional hints
+    public static DuplicateStatus isNameDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.NAME, value1, value2, languages);
+    }
+
+    public static DuplicateStatus isStreetDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.STREET, value1, value2, languages);
+    }
+
+    public static DuplicateStatus isHouseNumberDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.HOUSE_NUMBER, value1, value2, languages);
+    }
+
+    public static DuplicateStatus isPoBoxDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.PO_BOX, value1, value2, languages);
+    }
+
+    public static DuplicateStatus isUnitDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.UNIT, value1, value2, languages);
+    }
+
+    public static DuplicateStatus isFloorDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.FLOOR, value1, value2, languages);
+    }
+
+    public static DuplicateStatus isPostalCodeDuplicate(String value1, String value2, String... languages) {
+        return isDuplicate(DuplicateComponent.POSTAL_CODE, value1, value2, languages);
+    }
+
+    // A null value is NULL_DUPLICATE
+    public static DuplicateStatus isDuplicate(DuplicateComponent component, String value1, String value2, String... languages) {
+        return DuplicateStatus.fromCode(isDuplicateNative(component.ordinal(), value1, value2, emptyToNull(languages)));
+    }
+
+    // Toponyms compare the place components (city, state, country, ...) of two addresses as labels/values
+    public static DuplicateStatus isToponymDuplicate(String[] labels1, String[] values1, String[] labels2, String[] values2, String... languages) {
+        return DuplicateStatus.fromCode(isToponymDuplicateNative(labels1, values1, labels2, values2, emptyToNull(languages)));
+    }
+
+    // Batch Duplicate Checks - one native call for many (left[i], right[i]) pairs, compared on the native workers.
+    // Returns one DuplicateStatus code per pair (see DuplicateStatus.fromCode), null elements give NULL_DUPLICATE.
+    public static byte[] isDuplicate(DuplicateComponent component, String[] left, String[] right, String... languages) {
+        return isDuplicateBatch(component.ordinal(), left, right, emptyToNull(languages));
+    }
+
+    // Packed UTF-8 form: offsets[i] is the start of value i (negative for a missing value) plus a final end offset
+    public static byte[] isDuplicate(DuplicateComponent component, byte[] leftValues, int[] leftOffsets, byte[] rightValues, int[] rightOffsets,
+        String... languages) {
+        return isDuplicateBatchUtf8(component.ordinal(), leftValues, leftOffsets, rightValues, rightOffsets, emptyToNull(languages));
+    }
+
+    // Address Match Scoring - Jaccard similarity in [0, 1] of the two addresses' expansion sets, compared as hashes natively.
+    // When the full expansions share nothing the root expansions are compared instead, at half weight, so such a score is
+    // at most 0.5 (a weak full-expansion match can still score lower). A null address scores 0.
+    public static float matchScore(String address1, String address2) {
+        return matchScoreNative(address1, address2, 0);
+    }
+
+    public static float matchScore(String address1, String address2, NormalizeOptions options) {
+        try {
+            return matchScoreNative(address1, address2, options.handle());
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    // Batch Match Scoring - one native call for many (left[i], right[i]) pairs, scored on the native workers
+    public static float[] matchScores(String[] left, String[] right) {
+        return matchScoreBatch(left, right, 0);
+    }
+
+    public static float[] matchScores(String[] left, String[] right, NormalizeOptions options) {
+        try {
+            return matchScoreBatch(left, right, options.handle());
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    // A 0 handle expands with the libpostal default options
+    private static native float matchScoreNative(String address1, String address2, long optionsHandle);
+    private static native float[] matchScoreBatch(String[] left, String[] right, long optionsHandle);
+
+    // Fuzzy Duplicate Checks - weighted token similarity of names/streets, tokens are packed with their scores
+    public static FuzzyDuplicateResult isNameDuplicateFuzzy(FuzzyTokens tokens1, FuzzyTokens tokens2, FuzzyDuplicateOptions options) {
+        return fuzzyDuplicate(false, tokens1, tokens2, options);
+    }
+
+    public static FuzzyDuplicateResult isStreetDuplicateFuzzy(FuzzyTokens tokens1, FuzzyTokens tokens2, FuzzyDuplicateOptions options) {
+        return fuzzyDuplicate(true, tokens1, tokens2, options);
+    }
+
+    // Batch Fuzzy Duplicate Checks - one query against many candidates in one native call, scored on the native workers.
+    // The candidates' tokens are packed together, candidateOffsets[i] is the first token of candidate i (plus the token count).
+    public static FuzzyDuplicateBatch isNameDuplicateFuzzy(FuzzyTokens query, FuzzyTokens candidates, int[] candidateOffsets,
+        FuzzyDuplicateOptions options) {
+        return fuzzyDuplicates(false, query, candidates, candidateOffsets, options);
+    }
+
+    public static FuzzyDuplicateBatch isStreetDuplicateFuzzy(FuzzyTokens query, FuzzyTokens candidates, int[] candidateOffsets,
+        FuzzyDuplicateOptions options) {
+        return fuzzyDuplicates(true, query, candidates, candidateOffsets, options);
+    }
+
+    private static FuzzyDuplicateResult fuzzyDuplicate(boolean street, FuzzyTokens tokens1, FuzzyTokens tokens2, FuzzyDuplicateOptions options) {
+        FuzzyDuplicateBatch batch = fuzzyDuplicates(street, tokens1, tokens2, new int[]{0, tokens2.size()}, options);
+
+        return new FuzzyDuplicateResult(batch.status(0), batch.similarity(0));
+    }
+
+    private static FuzzyDuplicateBatch fuzzyDuplicates(boolean street, FuzzyTokens query, FuzzyTokens candidates, int[] candidateOffsets,
+        FuzzyDuplicateOptions options) {
+        int numCandidates = candidateOffsets.length - 1;
+        byte[] statuses = new byte[Math.max(numCandidates, 0)];
+        double[] similarities = new double[statuses.length];
+
+        fuzzyDuplicateBatch(street, query.tokens(), query.offsets(), query.scores(), candidates.tokens(), candidates.offsets(), candidates.scores(),
+            candidateOffsets, options.languages(), options.getNeedsReviewThreshold(), options.getLikelyDupeThreshold(), statuses, similarities);
+
+        return new FuzzyDuplicateBatch(statuses, similarities);
+    }
+
+    private static native void fuzzyDuplicateBatch(boolean street, byte[] queryTokens, int[] queryOffsets, double[] queryScores,
+        byte[] candidateTokens, int[] candidateTokenOffsets, double[] candidateScores, int[] candidateOffsets, String[] languages,
+        double needsReviewThreshold, double likelyDupeThreshold, byte[] statuses, double[] similarities);
+
+    // FuzzyDuplicateOptions support, returns {needsReviewThreshold, likelyDupeThreshold}
+    static native double[] defaultFuzzyDuplicateThresholds();
+
+    private static String[] emptyToNull(String[] languages) {
+        return languages == null || languages.length == 0 ? null : languages;
+    }
+
+    private static native int isDuplicateNative(int component, String value1, String value2, String[] languages);
+    private static native int isToponymDuplicateNative(String[] labels1, String[] values1, String[] labels2, String[] values2, String[] languages);
+    private static native byte[] isDuplicateBatch(int component, String[] left, String[] right, String[] languages);
+    private static native byte[] isDuplicateBatchUtf8(int component, byte[] leftValues, int[] leftOffsets, byte[] rightValues, int[] rightOffsets,
+        String[] languages);
+
+    // String Normalization - one canonical form per input (no expansion variants), options are Normalization bitmasks.
+    // Languages are optional and select the transliterators, no language detection is done. Returns null when
+    // libpostal can't normalize the input (e.g. an empty string).
+    public static String normalizeString(String input, long options, String... languages) {
+        Objects.requireNonNull(input, "input");
+        return normalizeStringNative(input, options, emptyToNull(languages));
+    }
+
+    public static NormalizedTokens normalizedTokens(String input, long stringOptions, long tokenOptions, boolean whitespace, String... languages) {
+        Objects.requireNonNull(input, "input");
+        return normalizedTokensNative(input, stringOptions, tokenOptions, whitespace, emptyToNull(languages));
+    }
+
+    // Batch normalization on the native workers, null inputs give null results
+    public static String[] normalizeStrings(String[] inputs, long options, String... languages) {
+        return normalizeStringBatch(inputs, options, emptyToNull(languages));
+    }
+
+    private static native String normalizeStringNative(String input, long options, String[] languages);
+    private static native NormalizedTokens normalizedTokensNative(String input, long stringOptions, long tokenOptions, boolean whitespace,
+        String[] languages);
+    private static native String[] normalizeStringBatch(String[] inputs, long options, String[] languages);
+
+    // Bulk File Processing - parses/expands every line of a newline delimited file on the native workers and writes
+    // one record per line, in input order, to the output file. No Strings or Maps are created per line; the listener
+    // (may be null) is called after every chunk. Expand runs use the options (null for the defaults), parse runs ignore them.
+    public static BulkProgress processFile(String inputPath, String outputPath, BulkMode mode, BulkFormat format) {
+        return processFile(inputPath, outputPath, mode, format, null, null);
+    }
+
+    public static BulkProgress processFile(String inputPath, String outputPath, BulkMode mode, BulkFormat format,
+        NormalizeOptions options, BulkProgressListener listener) {
+
+        Objects.requireNonNull(mode, "mode");
+        Objects.requireNonNull(format, "format");
+
+        try {
+            long handle = (options != null && mode != BulkMode.PARSE ? options.handle() : 0);
+            return bulkProcessFile(inputPath, outputPath, mode.ordinal(), format.ordinal(), 0, handle, listener);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    private static native BulkProgress bulkProcessFile(String inputPath, String outputPath, int mode, int format, int chunkLines,
+        long optionsHandle, BulkProgressListener listener);
+
+    // Metrics - optional latency histograms of the native parse/expand calls, per entry point and per stage (input marshaling,
+    // libpostal, result building), plus the slowest inputs. Off by default; while on, every call costs a few clock reads and
+    // the single-address calls stay on JNI even with the FFM backend. LibPostalMetricsJmx.register() publishes them over JMX.
+    private static final int DEFAULT_METRICS_SLOW_INPUTS = 32;
+
+    private static volatile int metricsSlowInputs = DEFAULT_METRICS_SLOW_INPUTS;
+
+    public static void enableMetrics() {
+        enableMetrics(DEFAULT_METRICS_SLOW_INPUTS);
+    }
+
+    // Keeps the slowInputs (0 to 1024) slowest calls, changing the number drops the ones kept so far
+    public static synchronized void enableMetrics(int slowInputs) {
+        setMetricsEnabledNative(true, slowInputs);
+        metricsSlowInputs = slowInputs;
+    }
+
+    // Stops recording, the counters are kept until resetMetrics()
+    public static void disableMetrics() {
+        setMetricsEnabledNative(false, 0);
+    }
+
+    public static native boolean isMetricsEnabled();
+    public static native void resetMetrics();
+
+    static int getMetricsSlowInputs() {
+        return metricsSlowInputs;
+    }
+
+    public static LibPostalMetrics getMetrics() {
+        long[] counters = new long[LibPostalMetrics.SNAPSHOT_LONGS];
+        metricsSnapshot(counters);
+
+        long[] fields = new long[metricsSlowInputs * SlowInput.FIELDS];
+        String[] inputs = slowInputs(fields);
+        List<SlowInput> slow = new ArrayList<>(inputs.length);
+
+        for (int i = 0; i < inputs.length; i++) {
+            slow.add(new SlowInput(fields, i * SlowInput.FIELDS, inputs[i]));
+        }
+
+        return new LibPostalMetrics(counters, slow);
+    }
+
+    private static native void setMetricsEnabledNative(boolean enabled, int slowInputs);
+    private static native void metricsSnapshot(long[] counters);
+    private static native String[] slowInputs(long[] fields);
+
+    // Async - the native call runs on a bounded pool of platform threads, so a virtual thread waiting on the future
+    // never pins its carrier inside libpostal. Without setupAsync, the first async call creates a pool with one thread
+    // per core, a queue depth of 1024 and BLOCK backpressure.
+    private static final int DEFAULT_ASYNC_QUEUE_DEPTH = 1024;
+
+    private static volatile AsyncExecutor asyncExecutor;
+
+    // Replaces the async pool, waiting for the calls pending on the previous one
+    public static void setupAsync(int threads, int queueDepth, AsyncBackpressure backpressure) {
+        AsyncExecutor previous;
+
+        synchronized (LibPostal.class) {
+            previous = asyncExecutor;
+            asyncExecutor = new AsyncExecutor(threads, queueDepth, backpressure);
+        }
+
+        if (previous != null) {
+            previous.close();
+        }
+    }
+
+    // Shuts the async pool down, waiting for the pending calls, the next async call starts a default pool
+    public static void shutdownAsync() {
+        AsyncExecutor previous;
+
+        synchronized (LibPostal.class) {
+            previous = asyncExecutor;
+            asyncExecutor = null;
+        }
+
+        if (previous != null) {
+            previous.close();
+        }
+    }
+
+    // Every async call comes through here, so only the first one takes the class lock
+    public static AsyncExecutor getAsyncExecutor() {
+        AsyncExecutor executor = asyncExecutor;
+
+        if (executor != null) {
+            return executor;
+        }
+
+        synchronized (LibPostal.class) {
+            if (asyncExecutor == null) {
+                asyncExecutor = new AsyncExecutor(Runtime.getRuntime().availableProcessors(), DEFAULT_ASYNC_QUEUE_DEPTH, AsyncBackpressure.BLOCK);
+            }
+
+            return asyncExecutor;
+        }
+    }
+
+    public static CompletableFuture<Map<String, String>> parseAddressAsync(String address) {
+        return getAsyncExecutor().submit(() -> parseAddress(address));
+    }
+
+    public static CompletableFuture<Map<String, String>> parseAddressAsync(String address, String language, String country) {
+        return getAsyncExecutor().submit(() -> parseAddress(address, language, country));
+    }
+
+    public static CompletableFuture<String[]> expandAddressAsync(String address) {
+        return getAsyncExecutor().submit(() -> expandAddress(address));
+    }
+
+    public static CompletableFuture<String[]> expandAddressAsync(String address, NormalizeOptions options) {
+        return getAsyncExecutor().submit(() -> expandAddress(address, options));
+    }
+
+    // UTF-8 Input - the bytes are handed to libpostal as-is, with no String decode/encode round trip.
+    // Direct buffers are read in place when the input is followed by a NUL byte, otherwise copied once.
+    public static Map<String, String> parseAddress(byte[] utf8) {
+        return parseAddressUtf8(utf8, null, 0, utf8.length);
+    }
+
+    public static Map<String, String> parseAddress(ByteBuffer buffer, int offset, int length) {
+        return withUtf8Input(buffer, offset, length, LibPostal::parseAddressUtf8);
+    }
+
+    public static ParsedAddress parseAddressCompact(byte[] utf8) {
+        return parseAddressCompactUtf8(utf8, null, 0, utf8.length);
+    }
+
+    public static ParsedAddress parseAddressCompact(ByteBuffer buffer, int offset, int length) {
+        return withUtf8Input(buffer, offset, length, LibPostal::parseAddressCompactUtf8);
+    }
+
+    public static String[] expandAddress(byte[] utf8) {
+        return expandAddressUtf8(utf8, null, 0, utf8.length);
+    }
+
+    public static String[] expandAddress(ByteBuffer buffer, int offset, int length) {
+        return withUtf8Input(buffer, offset, length, LibPostal::expandAddressUtf8);
+    }
+
+    public static String[] expandRootAddress(byte[] utf8) {
+        return expandRootAddressUtf8(utf8, null, 0, utf8.length);
+    }
+
+    public static String[] expandRootAddress(ByteBuffer buffer, int offset, int length) {
+        return withUtf8Input(buffer, offset, length, LibPostal::expandRootAddressUtf8);
+    }
+
+    // Exactly one of array/buffer is non-null, the buffer is always a direct buffer
+    private static native Map<String, String> parseAddressUtf8(byte[] array, ByteBuffer buffer, int offset, int length);
+    private static native ParsedAddress parseAddressCompactUtf8(byte[] array, ByteBuffer buffer, int offset, int length);
+    private static native String[] expandAddressUtf8(byte[] array, ByteBuffer buffer, int offset, int length);
+    private static native String[] expandRootAddressUtf8(byte[] array, ByteBuffer buffer, int offset, int length);
+
+    // Tokenization - tokens come back packed as (offset, length, TokenType code) triples into the input, no setup needed.
+    // String input gives UTF-16 offsets for substring(); whitespace adds the whitespace/newline tokens.
+    public static int[] tokenize(String input) {
+        return tokenize(input, false);
+    }
+
+    public static native int[] tokenize(String input, boolean whitespace);
+
+    // UTF-8 input gives byte offsets relative to offset, written into the caller's reusable tokens array.
+    // Returns the token count; when it exceeds tokens.length / 3 only the first tokens were written.
+    public static int tokenize(byte[] utf8, int offset, int length, boolean whitespace, int[] tokens) {
+        Objects.checkFromIndexSize(offset, length, utf8.length);
+        return tokenizeUtf8(utf8, null, offset, length, whitespace, tokens);
+    }
+
+    public static int tokenize(ByteBuffer buffer, int offset, int length, boolean whitespace, int[] tokens) {
+        Objects.requireNonNull(tokens, "tokens");
+        return withUtf8Input(buffer, offset, length, (array, direct, start, size) -> tokenizeUtf8(array, direct, start, size, whitespace, tokens));
+    }
+
+    private static native int tokenizeUtf8(byte[] array, ByteBuffer buffer, int offset, int length, boolean whitespace, int[] tokens);
+
+    // Serialized Output - the result is written natively as a JSON/CSV/binary record (see RecordFormat) into the caller's
+    // buffer starting at offset, so no Java object is created per address. Returns the record length; when it is more
+    // than the space left nothing was written and the call can be retried with a larger buffer. Null options select the
+    // libpostal defaults. ByteBuffer offsets are absolute, the position and limit are not changed.
+    public static int parseAddressTo(String address, RecordFormat format, byte[] out, int offset) {
+        Objects.checkFromToIndex(offset, out.length, out.length);
+        return parseAddressToNative(Objects.requireNonNull(address, "address"), format.ordinal(), out, null, offset, out.length);
+    }
+
+    public static int parseAddressTo(String address, RecordFormat format, ByteBuffer out, int offset) {
+        Objects.requireNonNull(address, "address");
+        return withRecordOutput(out, offset, (array, direct, start, limit) -> parseAddressToNative(address, format.ordinal(), array, direct, start, limit));
+    }
+
+    public static int expandAddressTo(String address, NormalizeOptions options, RecordFormat format, byte[] out, int offset) {
+        Objects.checkFromToIndex(offset, out.length, out.length);
+        Objects.requireNonNull(address, "address");
+
+        try {
+            return expandAddressToNative(address, options == null ? 0 : options.handle(), format.ordinal(), out, null, offset, out.length);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    public static int expandAddressTo(String address, NormalizeOptions options, RecordFormat format, ByteBuffer out, int offset) {
+        Objects.requireNonNull(address, "address");
+
+        try {
+            return withRecordOutput(out, offset, (array, direct, start, limit) -> expandAddressToNative(address,
+                options == null ? 0 : options.handle(), format.ordinal(), array, direct, start, limit));
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    // Batch forms, computed on the native workers: records are written back to back in input order until the next one
+    // does not fit. Returns the number of records written, ends[i] receiving the absolute end offset of record i
+    // (ends must be at least as long as addresses). Resubmit the remaining addresses to continue.
+    public static int parseAddressesTo(String[] addresses, RecordFormat format, byte[] out, int offset, int[] ends) {
+        Objects.checkFromToIndex(offset, out.length, out.length);
+        return parseAddressesToNative(addresses, format.ordinal(), out, null, offset, out.length, ends);
+    }
+
+    public static int parseAddressesTo(String[] addresses, RecordFormat format, ByteBuffer out, int offset, int[] ends) {
+        return withRecordBatchOutput(out, offset, ends, (array, direct, start, limit) -> parseAddressesToNative(addresses, format.ordinal(),
+            array, direct, start, limit, ends));
+    }
+
+    public static int expandAddressesTo(String[] addresses, NormalizeOptions options, RecordFormat format, byte[] out, int offset, int[] ends) {
+        Objects.checkFromToIndex(offset, out.length, out.length);
+
+        try {
+            return expandAddressesToNative(addresses, options == null ? 0 : options.handle(), format.ordinal(), out, null, offset, out.length, ends);
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    public static int expandAddressesTo(String[] addresses, NormalizeOptions options, RecordFormat format, ByteBuffer out, int offset, int[] ends) {
+        try {
+            return withRecordBatchOutput(out, offset, ends, (array, direct, start, limit) -> expandAddressesToNative(addresses,
+                options == null ? 0 : options.handle(), format.ordinal(), array, direct, start, limit, ends));
+        } finally {
+            Reference.reachabilityFence(options);
+        }
+    }
+
+    private static native int parseAddressToNative(String address, int format, byte[] array, ByteBuffer buffer, int offset, int limit);
+    private static native int expandAddressToNative(String address, long optionsHandle, int format, byte[] array, ByteBuffer buffer, int offset,
+        int limit);
+    private static native int parseAddressesToNative(String[] addresses, int format, byte[] array, ByteBuffer buffer, int offset, int limit,
+        int[] ends);
+    private static native int expandAddressesToNative(String[] addresses, long optionsHandle, int format, byte[] array, ByteBuffer buffer,
+        int offset, int limit, int[] ends);
+
+    @FunctionalInterface
+    private interface RecordOutputCall {
+        int call(byte[] array, ByteBuffer buffer, int offset, int limit);
+    }
+
+    /**
+     * Routes a ByteBuffer output to the native record writers: direct buffers are passed through and heap buffers
+     * pass their backing array. Records are written from the absolute offset up to the buffer limit.
+     */
+    private static int withRecordOutput(ByteBuffer buffer, int offset, RecordOutputCall call) {
+        Objects.checkFromToIndex(offset, buffer.limit(), buffer.limit());
+
+        if (buffer.isReadOnly()) {
+            throw new ReadOnlyBufferException();
+        }
+
+        if (buffer.isDirect()) {
+            return call.call(null, buffer, offset, buffer.limit());
+        }
+
+        return call.call(buffer.array(), null, buffer.arrayOffset() + offset, buffer.arrayOffset() + buffer.limit());
+    }
+
+    /**
+     * Batch form of withRecordOutput: the natives report ends within the array they wrote to, so for heap buffers
+     * (slices and wrapped subranges included) they are moved back to offsets within the buffer.
+     */
+    private static int withRecordBatchOutput(ByteBuffer buffer, int offset, int[] ends, RecordOutputCall call) {
+        int written = withRecordOutput(buffer, offset, call);
+        int shift = (buffer.isDirect() ? 0 : buffer.arrayOffset());
+
+        for (int i = 0; shift != 0 && i < written; i++) {
+            ends[i] -= shift;
+        }
+
+        return written;
+    }
+
+    @FunctionalInterface
+    private interface Utf8Call<T> {
+        T call(byte[] array, ByteBuffer buffer, int offset, int length);
+    }
+
+    /**
+     * Routes a ByteBuffer input to the native UTF-8 entry points: direct buffers are passed through,
+     * heap buffers pass their backing array, and read-only heap buffers are copied.
+     * The offset is absolute, the buffer position and limit are left untouched.
+     */
+    private static <T> T withUtf8Input(ByteBuffer buffer, int offset, int length, Utf8Call<T> call) {
+        Objects.checkFromIndexSize(offset, length, buffer.limit());
+
+        if (buffer.isDirect()) {
+            return call.call(null, buffer, offset, length);
+        }
+
+        if (buffer.hasArray()) {
+            return call.call(buffer.array(), null, buffer.arrayOffset() + offset, length);
+        }
+
+        byte[] copy = new byte[length];
+        buffer.get(offset, copy);
+
+        return call.call(copy, null, 0, length);
+    }
 }
@@ -0,0 +1,59 @@
+package com.dnebinger.postal4j;
+
+import java.util.List;
+
+/**
+ * Snapshot of the native call metrics, see {@link LibPostal#enableMetrics(int)}.
+ * Counters are summed over the per-thread native counters when the snapshot is taken, so a snapshot taken while calls
+ * are running may be off by a few calls between entries and stages.
+ */
+public final class LibPostalMetrics {
+
+    // calls, errors and one histogram per stage
+    static final int ENTRY_LONGS = 2 + MetricsStage.values().length * LatencyHistogram.LONGS;
+    static final int SNAPSHOT_LONGS = MetricsEntryPoint.values().length * ENTRY_LONGS;
+
+    private final long[] counters;
+    private final List<SlowInput> slowInputs;
+
+    LibPostalMetrics(long[] counters, List<SlowInput> slowInputs) {
+        this.counters = counters;
+        this.slowInputs = List.copyOf(slowInputs);
+    }
+
+    public long getCalls(MetricsEntryPoint entryPoint) {
+        return counters[entryPoint.ordinal() * ENTRY_LONGS];
+    }
+
+    /**
+     * @param entryPoint the entry point
+     * @return the number of calls that threw
+     */
+    public long getErrors(MetricsEntryPoint entryPoint) {
+        return counters[entryPoint.ordinal() * ENTRY_LONGS + 1];
+    }
+
+    public LatencyHistogram getLatency(MetricsEntryPoint entryPoint, MetricsStage stage) {
+        return new LatencyHistogram(counters, entryPoint.ordinal() * ENTRY_LONGS + 2 + stage.ordinal() * LatencyHistogram.LONGS);
+    }
+
+    /**
+     * @return the slowest calls, slowest first
+     */
+    public List<SlowInput> getSlowInputs() {
+        return slowInputs;
+    }
+
+    @Override
+    public String toString() {
+        StringBuilder builder = new StringBuilder("LibPostalMetrics{");
+
+        for (MetricsEntryPoint entryPoint : MetricsEntryPoint.values()) {
+            if (getCalls(entryPoint) > 0) {
+                builder.append(entryPoint.key()).append("=").append(getLatency(entryPoint, MetricsStage.TOTAL)).append(", ");
+            }
+        }
+
+        return builder.append("slowInputs=").append(slowInputs.size()).append("}").toString();
+    }
+}
@@ -0,0 +1,148 @@
+package com.dnebinger.postal4j;
+
+import java.lang.management.ManagementFactory;
+import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.function.ToDoubleFunction;
+import javax.management.JMException;
+import javax.management.MBeanServer;
+import javax.management.ObjectName;
+
+/**
+ * Publishes {@link LibPostal#getMetrics()} as the platform MBean {@value #OBJECT_NAME}.
+ * Every attribute read takes a fresh snapshot, entry points without calls are left out of the maps.
+ */
+public final class LibPostalMetricsJmx implements LibPostalMetricsMXBean {
+
+    public static final String OBJECT_NAME = "com.dnebinger.postal4j:type=LibPostalMetrics";
+
+    private LibPostalMetricsJmx() {
+    }
+
+    /**
+     * Registers the MBean with the platform MBean server, doing nothing if it already is.
+     * Metrics still have to be enabled, through {@link LibPostal#enableMetrics(int)} or the Enabled attribute.
+     * @return the MBean name
+     */
+    public static synchronized ObjectName register() {
+        try {
+            ObjectName name = new ObjectName(OBJECT_NAME);
+            MBeanServer server = ManagementFactory.getPlatformMBeanServer();
+
+            if (!server.isRegistered(name)) {
+                server.registerMBean(new LibPostalMetricsJmx(), name);
+            }
+
+            return name;
+        } catch (JMException e) {
+            throw new IllegalStateException("Error registering " + OBJECT_NAME, e);
+        }
+    }
+
+    public static synchronized void unregister() {
+        try {
+            ObjectName name = new ObjectName(OBJECT_NAME);
+            MBeanServer server = ManagementFactory.getPlatformMBeanServer();
+
+            if (server.isRegistered(name)) {
+                server.unregisterMBean(name);
+            }
+        } catch (JMException e) {
+            throw new IllegalStateException("Error unregistering " + OBJECT_NAME, e);
+        }
+    }
+
+    @Override
+    public boolean isEnabled() {
+        return LibPostal.isMetricsEnabled();
+    }
+
+    @Override
+    public void setEnabled(boolean enabled) {
+        if (enabled) {
+            LibPostal.enableMetrics(LibPostal.getMetricsSlowInputs());
+        } else {
+            LibPostal.disableMetrics();
+        }
+    }
+
+    @Override
+    public Map<String, Long> getCalls() {
+        LibPostalMetrics metrics = LibPostal.getMetrics();
+        Map<String, Long> calls = new LinkedHashMap<>();
+
+        for (MetricsEntryPoint entryPoint : MetricsEntryPoint.values()) {
+            if (metrics.getCalls(entryPoint) > 0) {
+                calls.put(entryPoint.key(), metrics.getCalls(entryPoint));
+            }
+        }
+
+        return calls;
+    }
+
+    @Override
+    public Map<String, Long> getErrors() {
+        LibPostalMetrics metrics = LibPostal.getMetrics();
+        Map<String, Long> errors = new LinkedHashMap<>();
+
+        for (MetricsEntryPoint entryPoint : MetricsEntryPoint.values()) {
+            if (metrics.getCalls(entryPoint) > 0) {
+                errors.put(entryPoint.key(), metrics.getErrors(entryPoint));
+            }
+        }
+
+        return errors;
+    }
+
+    @Override
+    public Map<String, Double> getMeanMicros() {
+        return latencies(LatencyHistogram::getMeanNanos);
+    }
+
+    @Override
+    public Map<String, Double> getP50Micros() {
+        return latencies(histogram -> histogram.getPercentileNanos(50.0));
+    }
+
+    @Override
+    public Map<String, Double> getP99Micros() {
+        return latencies(histogram -> histogram.getPercentileNanos(99.0));
+    }
+
+    @Override
+    public Map<String, Double> getP999Micros() {
+        return latencies(histogram -> histogram.getPercentileNanos(99.9));
+    }
+
+    @Override
+    public Map<String, Double> getMaxMicros() {
+        return latencies(LatencyHistogram::getMaxNanos);
+    }
+
+    @Override
+    public String[] getSlowInputs() {
+        return LibPostal.getMetrics().getSlowInputs().stream().map(SlowInput::toString).toArray(String[]::new);
+    }
+
+    @Override
+    public void reset() {
+        LibPostal.resetMetrics();
+    }
+
+    private static Map<String, Double> latencies(ToDoubleFunction<LatencyHistogram> nanos) {
+        LibPostalMetrics metrics = LibPostal.getMetrics();
+        Map<String, Double> latencies = new LinkedHashMap<>();
+
+        for (MetricsEntryPoint entryPoint : MetricsEntryPoint.values()) {
+            if (metrics.getCalls(entryPoint) == 0) {
+                continue;
+            }
+
+            for (MetricsStage stage : MetricsStage.values()) {
+                latencies.put(entryPoint.key() + "." + stage.key(), nanos.applyAsDouble(metrics.getLatency(entryPoint, stage)) / 1000.0);
+            }
+        }
+
+        return latencies;
+    }
+}
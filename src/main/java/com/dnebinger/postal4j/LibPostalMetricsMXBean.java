@@ -0,0 +1,34 @@
+package com.dnebinger.postal4j;
+
+import java.util.Map;
+
+/**
+ * JMX view of the native call metrics, registered by {@link LibPostalMetricsJmx#register()}.
+ * Map attributes are keyed by entry point and stage, e.g. "parse.total" or "expandBatch.libpostal"; latencies are in microseconds.
+ */
+public interface LibPostalMetricsMXBean {
+
+    boolean isEnabled();
+
+    // Enabling keeps the slow inputs capacity of the last enableMetrics call
+    void setEnabled(boolean enabled);
+
+    Map<String, Long> getCalls();
+
+    Map<String, Long> getErrors();
+
+    Map<String, Double> getMeanMicros();
+
+    Map<String, Double> getP50Micros();
+
+    Map<String, Double> getP99Micros();
+
+    Map<String, Double> getP999Micros();
+
+    Map<String, Double> getMaxMicros();
+
+    // One line per slow input, slowest first
+    String[] getSlowInputs();
+
+    void reset();
+}
@@ -0,0 +1,50 @@
+package com.dnebinger.postal4j;
+
+import java.util.EnumSet;
+import java.util.Set;
+
+/**
+ * The separately loaded parts of libpostal.
+ * EXPANSION is the core module (dictionaries, transliteration, numex) that every call and every other module needs,
+ * PARSER backs the parse calls and CLASSIFIER detects the languages when expand/dedupe calls are not given any.
+ */
+public enum LibPostalModule {
+    EXPANSION(1),
+    PARSER(1 << 1),
+    CLASSIFIER(1 << 2);
+
+    private final int mask;
+
+    LibPostalModule(int mask) {
+        this.mask = mask;
+    }
+
+    /**
+     * @return the native bit of the module
+     */
+    int mask() {
+        return mask;
+    }
+
+    static int toMask(Set<LibPostalModule> modules) {
+        int mask = 0;
+
+        for (LibPostalModule module : modules) {
+            mask |= module.mask;
+        }
+
+        return mask;
+    }
+
+    static Set<LibPostalModule> fromMask(int mask) {
+        Set<LibPostalModule> modules = EnumSet.noneOf(LibPostalModule.class);
+
+        for (LibPostalModule module : values()) {
+            if ((mask & module.mask) != 0) {
+                modules.add(module);
+            }
+        }
+
+        return modules;
+    }
+}
@@ -0,0 +1,28 @@
+package com.dnebinger.postal4j;
+
+/**
+ * The calls {@link LibPostal#getMetrics()} keeps latency histograms for. String, UTF-8 and {@link NormalizeOptions}
+ * variants of a call share its entry point.
+ * The declaration order is shared with the native metrics entries, do not reorder.
+ */
+public enum MetricsEntryPoint {
+    PARSE("parse"),
+    PARSE_COMPACT("parseCompact"),
+    EXPAND("expand"),
+    EXPAND_ROOT("expandRoot"),
+    PARSE_BATCH("parseBatch"),
+    EXPAND_BATCH("expandBatch");
+
+    private final String key;
+
+    MetricsEntryPoint(String key) {
+        this.key = key;
+    }
+
+    /**
+     * @return the name used in JMX attribute keys, e.g. "parse"
+     */
+    public String key() {
+        return key;
+    }
+}
@@ -0,0 +1,40 @@
+package com.dnebinger.postal4j;
+
+/**
+ * The parts of a call timed by {@link LibPostal#getMetrics()}.
+ * The declaration order is shared with the native metrics stages, do not reorder.
+ */
+public enum MetricsStage {
+    /**
+     * Getting the input into native memory: String transcoding, batch copies, normalize options.
+     */
+    INPUT("input"),
+
+    /**
+     * The libpostal call, or the result cache lookup in front of it. For batches, the whole run on the worker pool.
+     */
+    LIBPOSTAL("libpostal"),
+
+    /**
+     * Building the Java result: HashMap, String[] or columnar arrays.
+     */
+    RESULT("result"),
+
+    /**
+     * The whole native call.
+     */
+    TOTAL("total");
+
+    private final String key;
+
+    MetricsStage(String key) {
+        this.key = key;
+    }
+
+    /**
+     * @return the name used in JMX attribute keys, e.g. "libpostal"
+     */
+    public String key() {
+        return key;
+    }
+}
@@ -0,0 +1,80 @@
+package com.dnebinger.postal4j;
+
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Near-duplicate hashes of a batch of records, see {@link LibPostal#nearDupeHashes(ParsedAddressBatch, double[], double[], NearDupeHashOptions)}.
+ * All hashes share one packed UTF-8 array and one offsets table; {@code recordOffsets[i]} is the index
+ * of the first hash of record {@code i}. Strings are only created when a hash is asked for.
+ */
+public final class NearDupeHashBatch {
+
+    private final int[] recordOffsets;
+    private final byte[] hashes;
+    private final int[] offsets;
+
+    // Called from native code
+    NearDupeHashBatch(int[] recordOffsets, byte[] hashes, int[] offsets) {
+        this.recordOffsets = recordOffsets;
+        this.hashes = hashes;
+        this.offsets = offsets;
+    }
+
+    /**
+     * @return the number of records in the batch
+     */
+    public int size() {
+        return recordOffsets.length - 1;
+    }
+
+    /**
+     * @param record the record index
+     * @return the number of hashes of the record
+     */
+    public int hashCount(int record) {
+        checkRecord(record);
+
+        return recordOffsets[record + 1] - recordOffsets[record];
+    }
+
+    /**
+     * @param record the record index
+     * @param index the hash index within the record
+     * @return the hash, decoded from UTF-8
+     */
+    public String hash(int record, int index) {
+        int position = position(record, index);
+
+        return new String(hashes, offsets[position], offsets[position + 1] - offsets[position], StandardCharsets.UTF_8);
+    }
+
+    /**
+     * @param record the record index
+     * @return all hashes of the record
+     */
+    public String[] hashes(int record) {
+        String[] result = new String[hashCount(record)];
+
+        for (int i = 0; i < result.length; i++) {
+            result[i] = hash(record, i);
+        }
+
+        return result;
+    }
+
+    private int position(int record, int index) {
+        int count = hashCount(record);
+
+        if (index < 0 || index >= count) {
+            throw new IndexOutOfBoundsException("Hash index " + index + " out of bounds for size " + count);
+        }
+
+        return recordOffsets[record] + index;
+    }
+
+    private void checkRecord(int record) {
+        if (record < 0 || record >= size()) {
+            throw new IndexOutOfBoundsException("Record index " + record + " out of bounds for size " + size());
+        }
+    }
+}
@@ -0,0 +1,139 @@
+package com.dnebinger.postal4j;
+
+import java.util.Arrays;
+import java.util.Objects;
+
+/**
+ * Immutable options for libpostal near-duplicate hashing, see {@link LibPostal#nearDupeHashes}.
+ * The hashes are blocking keys: records sharing at least one hash are candidate duplicates.
+ * Build with {@link #builder()}, which starts from the libpostal defaults.
+ */
+public final class NearDupeHashOptions {
+
+    // Flag bits, in libpostal_near_dupe_hash_options_t field order
+    public static final int WITH_NAME = 1;
+    public static final int WITH_ADDRESS = 1 << 1;
+    public static final int WITH_UNIT = 1 << 2;
+    public static final int WITH_CITY_OR_EQUIVALENT = 1 << 3;
+    public static final int WITH_SMALL_CONTAINING_BOUNDARIES = 1 << 4;
+    public static final int WITH_POSTAL_CODE = 1 << 5;
+    public static final int WITH_LATLON = 1 << 6;
+    public static final int NAME_AND_ADDRESS_KEYS = 1 << 7;
+    public static final int NAME_ONLY_KEYS = 1 << 8;
+    public static final int ADDRESS_ONLY_KEYS = 1 << 9;
+
+    private final String[] languages;
+    private final int flags;
+    private final int geohashPrecision;
+
+    private NearDupeHashOptions(Builder builder) {
+        this.languages = builder.languages;
+        this.flags = builder.flags;
+        this.geohashPrecision = builder.geohashPrecision;
+    }
+
+    /**
+     * @return a builder starting from the libpostal default options
+     */
+    public static Builder builder() {
+        return new Builder();
+    }
+
+    /**
+     * @return the languages of the records, null to let libpostal classify each record
+     */
+    public String[] getLanguages() {
+        return languages == null ? null : languages.clone();
+    }
+
+    public int getFlags() {
+        return flags;
+    }
+
+    public boolean isSet(int flag) {
+        return (flags & flag) == flag;
+    }
+
+    /**
+     * @return the geohash precision used for {@link #WITH_LATLON} keys
+     */
+    public int getGeohashPrecision() {
+        return geohashPrecision;
+    }
+
+    // Passed to native code as-is
+    String[] languages() {
+        return languages;
+    }
+
+    @Override
+    public String toString() {
+        return "NearDupeHashOptions{languages=" + Arrays.toString(languages) + ", flags=0x" + Integer.toHexString(flags) +
+            ", geohashPrecision=" + geohashPrecision + "}";
+    }
+
+    public static final class Builder {
+        private String[] languages;
+        private int flags;
+        private int geohashPrecision;
+
+        private Builder() {
+            this.flags = LibPostal.defaultNearDupeHashFlags();
+            this.geohashPrecision = LibPostal.defaultGeohashPrecision();
+        }
+
+        /**
+         * @param languages the languages of the records, null or empty to let libpostal classify each record
+         */
+        public Builder languages(String... languages) {
+            if (languages == null || languages.length == 0) {
+                this.languages = null;
+            } else {
+                for (String language : languages) {
+                    Objects.requireNonNull(language, "language");
+                }
+
+                this.languages = languages.clone();
+            }
+
+            return this;
+        }
+
+        public Builder flags(int flags) {
+            this.flags = flags;
+            return this;
+        }
+
+        public Builder set(int flag, boolean enabled) {
+            this.flags = enabled ? (flags | flag) : (flags & ~flag);
+            return this;
+        }
+
+        public Builder withName(boolean enabled) { return set(WITH_NAME, enabled); }
+        public Builder withAddress(boolean enabled) { return set(WITH_ADDRESS, enabled); }
+        public Builder withUnit(boolean enabled) { return set(WITH_UNIT, enabled); }
+        public Builder withCityOrEquivalent(boolean enabled) { return set(WITH_CITY_OR_EQUIVALENT, enabled); }
+        public Builder withSmallContainingBoundaries(boolean enabled) { return set(WITH_SMALL_CONTAINING_BOUNDARIES, enabled); }
+        public Builder withPostalCode(boolean enabled) { return set(WITH_POSTAL_CODE, enabled); }
+        public Builder withLatLon(boolean enabled) { return set(WITH_LATLON, enabled); }
+        public Builder nameAndAddressKeys(boolean enabled) { return set(NAME_AND_ADDRESS_KEYS, enabled); }
+        public Builder nameOnlyKeys(boolean enabled) { return set(NAME_ONLY_KEYS, enabled); }
+        public Builder addressOnlyKeys(boolean enabled) { return set(ADDRESS_ONLY_KEYS, enabled); }
+
+        /**
+         * @param geohashPrecision the number of geohash characters for latitude/longitude keys, 1 to 12
+         */
+        public Builder geohashPrecision(int geohashPrecision) {
+            if (geohashPrecision < 1 || geohashPrecision > 12) {
+                throw new IllegalArgumentException("Geohash precision must be between 1 and 12: " + geohashPrecision);
+            }
+
+            this.geohashPrecision = geohashPrecision;
+            return this;
+        }
+
+        public NearDupeHashOptions build() {
+            return new NearDupeHashOptions(this);
+        }
+    }
+}
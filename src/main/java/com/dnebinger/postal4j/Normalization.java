@@ -0,0 +1,44 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Option bitmasks for {@link LibPostal#normalizeString(String, long, String...)} and
+ * {@link LibPostal#normalizedTokens(String, long, long, boolean, String...)}.
+ * The values are libpostal's {@code LIBPOSTAL_NORMALIZE_STRING_*} and {@code LIBPOSTAL_NORMALIZE_TOKEN_*} bits.
+ */
+public final class Normalization {
+
+    // String options
+    public static final long STRING_LATIN_ASCII = 1L;
+    public static final long STRING_TRANSLITERATE = 1L << 1;
+    public static final long STRING_STRIP_ACCENTS = 1L << 2;
+    public static final long STRING_DECOMPOSE = 1L << 3;
+    public static final long STRING_LOWERCASE = 1L << 4;
+    public static final long STRING_TRIM = 1L << 5;
+    public static final long STRING_REPLACE_HYPHENS = 1L << 6;
+    public static final long STRING_COMPOSE = 1L << 7;
+    public static final long STRING_SIMPLE_LATIN_ASCII = 1L << 8;
+    public static final long STRING_REPLACE_NUMEX = 1L << 9;
+
+    // Token options
+    public static final long TOKEN_REPLACE_HYPHENS = 1L;
+    public static final long TOKEN_DELETE_HYPHENS = 1L << 1;
+    public static final long TOKEN_DELETE_FINAL_PERIOD = 1L << 2;
+    public static final long TOKEN_DELETE_ACRONYM_PERIODS = 1L << 3;
+    public static final long TOKEN_DROP_ENGLISH_POSSESSIVES = 1L << 4;
+    public static final long TOKEN_DELETE_OTHER_APOSTROPHE = 1L << 5;
+    public static final long TOKEN_SPLIT_ALPHA_FROM_NUMERIC = 1L << 6;
+    public static final long TOKEN_REPLACE_DIGITS = 1L << 7;
+    public static final long TOKEN_REPLACE_NUMERIC_TOKEN_LETTERS = 1L << 8;
+    public static final long TOKEN_REPLACE_NUMERIC_HYPHENS = 1L << 9;
+
+    // libpostal's defaults
+    public static final long DEFAULT_STRING_OPTIONS = STRING_LATIN_ASCII | STRING_COMPOSE | STRING_TRIM | STRING_REPLACE_HYPHENS |
+        STRING_STRIP_ACCENTS | STRING_LOWERCASE;
+    public static final long DEFAULT_TOKEN_OPTIONS = TOKEN_REPLACE_HYPHENS | TOKEN_DELETE_FINAL_PERIOD | TOKEN_DELETE_ACRONYM_PERIODS |
+        TOKEN_DROP_ENGLISH_POSSESSIVES | TOKEN_DELETE_OTHER_APOSTROPHE;
+    public static final long TOKEN_OPTIONS_DROP_PERIODS = TOKEN_DELETE_FINAL_PERIOD | TOKEN_DELETE_ACRONYM_PERIODS;
+    public static final long DEFAULT_TOKEN_OPTIONS_NUMERIC = DEFAULT_TOKEN_OPTIONS | TOKEN_SPLIT_ALPHA_FROM_NUMERIC;
+
+    private Normalization() {
+    }
+}
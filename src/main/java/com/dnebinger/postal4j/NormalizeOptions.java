@@ -0,0 +1,206 @@
+package com.dnebinger.postal4j;
+
+import java.lang.ref.Cleaner;
+import java.util.Arrays;
+import java.util.Objects;
+
+/**
+ * Immutable, precompiled libpostal normalize options for address expansion.
+ * The native options struct (including the converted languages) is built once, so expand calls
+ * using a NormalizeOptions do no option marshaling or allocation. Safe to share across threads.
+ * Close it when done, otherwise the native struct is released once it becomes unreachable.
+ */
+public final class NormalizeOptions implements AutoCloseable {
+
+    // Flag bits, in libpostal_normalize_options_t field order
+    public static final int LATIN_ASCII = 1;
+    public static final int TRANSLITERATE = 1 << 1;
+    public static final int STRIP_ACCENTS = 1 << 2;
+    public static final int DECOMPOSE = 1 << 3;
+    public static final int LOWERCASE = 1 << 4;
+    public static final int TRIM_STRING = 1 << 5;
+    public static final int DROP_PARENTHETICALS = 1 << 6;
+    public static final int REPLACE_NUMERIC_HYPHENS = 1 << 7;
+    public static final int DELETE_NUMERIC_HYPHENS = 1 << 8;
+    public static final int SPLIT_ALPHA_FROM_NUMERIC = 1 << 9;
+    public static final int REPLACE_WORD_HYPHENS = 1 << 10;
+    public static final int DELETE_WORD_HYPHENS = 1 << 11;
+    public static final int DELETE_FINAL_PERIODS = 1 << 12;
+    public static final int DELETE_ACRONYM_PERIODS = 1 << 13;
+    public static final int DROP_ENGLISH_POSSESSIVES = 1 << 14;
+    public static final int DELETE_APOSTROPHES = 1 << 15;
+    public static final int EXPAND_NUMEX = 1 << 16;
+    public static final int ROMAN_NUMERALS = 1 << 17;
+
+    // Address component bits, matching libpostal's LIBPOSTAL_ADDRESS_* values
+    public static final int ADDRESS_NONE = 0;
+    public static final int ADDRESS_ANY = 1;
+    public static final int ADDRESS_NAME = 1 << 1;
+    public static final int ADDRESS_HOUSE_NUMBER = 1 << 2;
+    public static final int ADDRESS_STREET = 1 << 3;
+    public static final int ADDRESS_UNIT = 1 << 4;
+    public static final int ADDRESS_LEVEL = 1 << 5;
+    public static final int ADDRESS_STAIRCASE = 1 << 6;
+    public static final int ADDRESS_ENTRANCE = 1 << 7;
+    public static final int ADDRESS_CATEGORY = 1 << 8;
+    public static final int ADDRESS_NEAR = 1 << 9;
+    public static final int ADDRESS_TOPONYM = 1 << 13;
+    public static final int ADDRESS_POSTAL_CODE = 1 << 14;
+    public static final int ADDRESS_PO_BOX = 1 << 15;
+    public static final int ADDRESS_ALL = (1 << 16) - 1;
+
+    private static final Cleaner CLEANER = Cleaner.create();
+
+    private final String[] languages;
+    private final int flags;
+    private final int addressComponents;
+    private final Handle handle;
+    private final Cleaner.Cleanable cleanable;
+
+    private NormalizeOptions(Builder builder) {
+        this.languages = builder.languages;
+        this.flags = builder.flags;
+        this.addressComponents = builder.addressComponents;
+        this.handle = new Handle(LibPostal.createNormalizeOptions(languages, flags, addressComponents));
+        this.cleanable = CLEANER.register(this, handle);
+    }
+
+    /**
+     * @return a builder starting from the libpostal default options
+     */
+    public static Builder builder() {
+        return new Builder();
+    }
+
+    public String[] getLanguages() {
+        return languages == null ? null : languages.clone();
+    }
+
+    public int getFlags() {
+        return flags;
+    }
+
+    public boolean isSet(int flag) {
+        return (flags & flag) == flag;
+    }
+
+    public int getAddressComponents() {
+        return addressComponents;
+    }
+
+    public boolean isClosed() {
+        return handle.address == 0;
+    }
+
+    /**
+     * Releases the native options. Expand calls using closed options throw an IllegalStateException.
+     */
+    @Override
+    public void close() {
+        cleanable.clean();
+    }
+
+    /**
+     * @return the native handle, callers must keep this object reachable for the duration of the native call
+     */
+    long handle() {
+        long address = handle.address;
+
+        if (address == 0) {
+            throw new IllegalStateException("NormalizeOptions has been closed");
+        }
+
+        return address;
+    }
+
+    @Override
+    public String toString() {
+        return "NormalizeOptions{languages=" + Arrays.toString(languages) + ", flags=0x" + Integer.toHexString(flags) +
+            ", addressComponents=0x" + Integer.toHexString(addressComponents) + "}";
+    }
+
+    // Cleaning action, must not reference the NormalizeOptions itself
+    private static final class Handle implements Runnable {
+        private volatile long address;
+
+        private Handle(long address) {
+            this.address = address;
+        }
+
+        @Override
+        public void run() {
+            long current = address;
+            address = 0;
+            LibPostal.destroyNormalizeOptions(current);
+        }
+    }
+
+    public static final class Builder {
+        private String[] languages;
+        private int flags;
+        private int addressComponents;
+
+        private Builder() {
+            this.flags = LibPostal.defaultNormalizeFlags();
+            this.addressComponents = LibPostal.defaultAddressComponents();
+        }
+
+        /**
+         * @param languages the language codes to expand with, null or empty to let libpostal detect them
+         */
+        public Builder languages(String... languages) {
+            if (languages == null || languages.length == 0) {
+                this.languages = null;
+            } else {
+                for (String language : languages) {
+                    Objects.requireNonNull(language, "language");
+                }
+
+                this.languages = languages.clone();
+            }
+
+            return this;
+        }
+
+        public Builder flags(int flags) {
+            this.flags = flags;
+            return this;
+        }
+
+        public Builder set(int flag, boolean enabled) {
+            this.flags = enabled ? (flags | flag) : (flags & ~flag);
+            return this;
+        }
+
+        public Builder latinAscii(boolean enabled) { return set(LATIN_ASCII, enabled); }
+        public Builder transliterate(boolean enabled) { return set(TRANSLITERATE, enabled); }
+        public Builder stripAccents(boolean enabled) { return set(STRIP_ACCENTS, enabled); }
+        public Builder decompose(boolean enabled) { return set(DECOMPOSE, enabled); }
+        public Builder lowercase(boolean enabled) { return set(LOWERCASE, enabled); }
+        public Builder trimString(boolean enabled) { return set(TRIM_STRING, enabled); }
+        public Builder dropParentheticals(boolean enabled) { return set(DROP_PARENTHETICALS, enabled); }
+        public Builder replaceNumericHyphens(boolean enabled) { return set(REPLACE_NUMERIC_HYPHENS, enabled); }
+        public Builder deleteNumericHyphens(boolean enabled) { return set(DELETE_NUMERIC_HYPHENS, enabled); }
+        public Builder splitAlphaFromNumeric(boolean enabled) { return set(SPLIT_ALPHA_FROM_NUMERIC, enabled); }
+        public Builder replaceWordHyphens(boolean enabled) { return set(REPLACE_WORD_HYPHENS, enabled); }
+        public Builder deleteWordHyphens(boolean enabled) { return set(DELETE_WORD_HYPHENS, enabled); }
+        public Builder deleteFinalPeriods(boolean enabled) { return set(DELETE_FINAL_PERIODS, enabled); }
+        public Builder deleteAcronymPeriods(boolean enabled) { return set(DELETE_ACRONYM_PERIODS, enabled); }
+        public Builder dropEnglishPossessives(boolean enabled) { return set(DROP_ENGLISH_POSSESSIVES, enabled); }
+        public Builder deleteApostrophes(boolean enabled) { return set(DELETE_APOSTROPHES, enabled); }
+        public Builder expandNumex(boolean enabled) { return set(EXPAND_NUMEX, enabled); }
+        public Builder romanNumerals(boolean enabled) { return set(ROMAN_NUMERALS, enabled); }
+
+        public Builder addressComponents(int addressComponents) {
+            this.addressComponents = addressComponents;
+            return this;
+        }
+
+        /**
+         * @return the precompiled options, owning a native struct until closed
+         */
+        public NormalizeOptions build() {
+            return new NormalizeOptions(this);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+package com.dnebinger.postal4j;
+
+import java.util.Objects;
+
+/**
+ * Tokens of a normalized string, see {@link LibPostal#normalizedTokens(String, long, long, boolean, String...)}.
+ */
+public final class NormalizedTokens {
+
+    private final String[] tokens;
+    private final int[] types;
+
+    // Called from native code
+    NormalizedTokens(String[] tokens, int[] types) {
+        this.tokens = tokens;
+        this.types = types;
+    }
+
+    /**
+     * @return the number of tokens
+     */
+    public int size() {
+        return tokens.length;
+    }
+
+    /**
+     * @param index the token index
+     * @return the normalized token
+     */
+    public String token(int index) {
+        return tokens[Objects.checkIndex(index, tokens.length)];
+    }
+
+    /**
+     * @param index the token index
+     * @return the libpostal token type code, see {@link TokenType#fromCode(int)}
+     */
+    public int typeCode(int index) {
+        return types[Objects.checkIndex(index, types.length)];
+    }
+
+    /**
+     * @param index the token index
+     * @return the token type
+     */
+    public TokenType type(int index) {
+        return TokenType.fromCode(typeCode(index));
+    }
+
+    /**
+     * @return all normalized tokens
+     */
+    public String[] tokens() {
+        return tokens.clone();
+    }
+
+    @Override
+    public String toString() {
+        return String.join(" ", tokens);
+    }
+}
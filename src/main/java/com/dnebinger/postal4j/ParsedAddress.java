@@ -0,0 +1,154 @@
+package com.dnebinger.postal4j;
+
+import java.nio.charset.StandardCharsets;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+/**
+ * Compact result of parsing a single address.
+ * Labels are stored as {@link AddressLabel} ordinals and the component values as one packed UTF-8
+ * array with an offsets table, so no Strings are created until a value is asked for.
+ * Instances returned from a {@link ParsedAddressBatch} are views over the batch arrays.
+ */
+public final class ParsedAddress {
+
+    private final byte[] labels;
+    private final byte[] values;
+    private final int[] offsets;
+    private final int first;
+    private final int count;
+
+    // Called from native code for single address results
+    ParsedAddress(byte[] labels, byte[] values, int[] offsets) {
+        this(labels, values, offsets, 0, labels.length);
+    }
+
+    ParsedAddress(byte[] labels, byte[] values, int[] offsets, int first, int count) {
+        this.labels = labels;
+        this.values = values;
+        this.offsets = offsets;
+        this.first = first;
+        this.count = count;
+    }
+
+    /**
+     * @return the number of components in the address
+     */
+    public int size() {
+        return count;
+    }
+
+    /**
+     * @return true if the parser returned no components
+     */
+    public boolean isEmpty() {
+        return count == 0;
+    }
+
+    /**
+     * @param index the component index
+     * @return the label of the component
+     */
+    public AddressLabel label(int index) {
+        return AddressLabel.fromOrdinal(labels[position(index)]);
+    }
+
+    /**
+     * @param index the component index
+     * @return the value of the component, decoded from UTF-8
+     */
+    public String value(int index) {
+        int position = position(index);
+
+        return new String(values, offsets[position], offsets[position + 1] - offsets[position], StandardCharsets.UTF_8);
+    }
+
+    /**
+     * @param index the component index
+     * @return the length of the component value in UTF-8 bytes
+     */
+    public int valueLength(int index) {
+        int position = position(index);
+
+        return offsets[position + 1] - offsets[position];
+    }
+
+    /**
+     * Copies the UTF-8 bytes of a component value without decoding them.
+     *
+     * @param index the component index
+     * @param destination the array to copy into
+     * @param destinationOffset the offset in the destination array
+     * @return the number of bytes copied
+     */
+    public int copyValue(int index, byte[] destination, int destinationOffset) {
+        int position = position(index);
+        int length = offsets[position + 1] - offsets[position];
+
+        System.arraycopy(values, offsets[position], destination, destinationOffset, length);
+
+        return length;
+    }
+
+    /**
+     * Finds the index of the first component with the given label.
+     *
+     * @param label the label
+     * @return the component index, or -1 if the label is not present
+     */
+    public int indexOf(AddressLabel label) {
+        for (int i = 0; i < count; i++) {
+            if (labels[first + i] == label.ordinal()) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    /**
+     * @param label the label
+     * @return true if the address has a component with the label
+     */
+    public boolean contains(AddressLabel label) {
+        return indexOf(label) >= 0;
+    }
+
+    /**
+     * @param label the label
+     * @return the value of the first component with the label, or null if it is not present
+     */
+    public String get(AddressLabel label) {
+        int index = indexOf(label);
+
+        return index >= 0 ? value(index) : null;
+    }
+
+    /**
+     * Converts the result to the same label:value map returned by {@link LibPostal#parseAddress(String)}.
+     *
+     * @return the components keyed by libpostal label, in parser order
+     */
+    public Map<String, String> toMap() {
+        Map<String, String> map = new LinkedHashMap<>();
+
+        for (int i = 0; i < count; i++) {
+            map.put(label(i).label(), value(i));
+        }
+
+        return map;
+    }
+
+    @Override
+    public String toString() {
+        return toMap().toString();
+    }
+
+    private int position(int index) {
+        if (index < 0 || index >= count) {
+            throw new IndexOutOfBoundsException("Component index " + index + " out of bounds for size " + count);
+        }
+
+        return first + index;
+    }
+}
@@ -0,0 +1,74 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Compact result of parsing a batch of addresses.
+ * All components of the batch share one label array, one packed UTF-8 value array and one offsets
+ * table; {@code recordOffsets[i]} is the index of the first component of address {@code i}.
+ */
+public final class ParsedAddressBatch {
+
+    private final int[] recordOffsets;
+    private final byte[] labels;
+    private final byte[] values;
+    private final int[] offsets;
+
+    // Called from native code
+    ParsedAddressBatch(int[] recordOffsets, byte[] labels, byte[] values, int[] offsets) {
+        this.recordOffsets = recordOffsets;
+        this.labels = labels;
+        this.values = values;
+        this.offsets = offsets;
+    }
+
+    /**
+     * @return the number of addresses in the batch
+     */
+    public int size() {
+        return recordOffsets.length - 1;
+    }
+
+    /**
+     * @param index the address index
+     * @return the number of components parsed for the address
+     */
+    public int componentCount(int index) {
+        checkIndex(index);
+
+        return recordOffsets[index + 1] - recordOffsets[index];
+    }
+
+    /**
+     * Returns a view over the components of one address, no data is copied.
+     *
+     * @param index the address index, in input order
+     * @return the parsed address
+     */
+    public ParsedAddress get(int index) {
+        checkIndex(index);
+
+        return new ParsedAddress(labels, values, offsets, recordOffsets[index], recordOffsets[index + 1] - recordOffsets[index]);
+    }
+
+    // Flat arrays, passed back to native code as near dupe hash input
+    int[] recordOffsets() {
+        return recordOffsets;
+    }
+
+    byte[] labels() {
+        return labels;
+    }
+
+    byte[] values() {
+        return values;
+    }
+
+    int[] offsets() {
+        return offsets;
+    }
+
+    private void checkIndex(int index) {
+        if (index < 0 || index >= size()) {
+            throw new IndexOutOfBoundsException("Address index " + index + " out of bounds for size " + size());
+        }
+    }
+}
@@ -0,0 +1,26 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Format of the records written into a caller buffer by {@link LibPostal#parseAddressTo} and friends.
+ * The declaration order is shared with the native record formats, do not reorder.
+ */
+public enum RecordFormat {
+    /**
+     * One JSON value per line: a parse is an object of label to value in libpostal order, an expansion list an
+     * array of strings. Values of a repeated label are joined by a space. Ends with a newline.
+     */
+    JSON,
+
+    /**
+     * One CSV row per record: a parse has one column per {@link AddressLabel}, in enum order, with repeated labels
+     * joined by a space, an expansion list one column per expansion. Fields with a comma, quote or line break are
+     * quoted with quotes doubled. Ends with a newline.
+     */
+    CSV,
+
+    /**
+     * The {@link BulkFormat#BINARY} record layout, without the file header: little-endian uint32 counts and lengths,
+     * parse components prefixed with their {@link AddressLabel} ordinal byte.
+     */
+    BINARY
+}
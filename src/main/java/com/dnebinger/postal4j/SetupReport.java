@@ -0,0 +1,44 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Timings of a background setup, see {@link LibPostal#setupInBackground(String, int, int, java.util.Collection)}.
+ */
+public final class SetupReport {
+
+    private final long loadNanos;
+    private final long warmupNanos;
+    private final int warmupAddresses;
+
+    SetupReport(long loadNanos, long warmupNanos, int warmupAddresses) {
+        this.loadNanos = loadNanos;
+        this.warmupNanos = warmupNanos;
+        this.warmupAddresses = warmupAddresses;
+    }
+
+    /**
+     * @return the time spent loading the libpostal data files and starting the workers and cache
+     */
+    public long getLoadNanos() {
+        return loadNanos;
+    }
+
+    /**
+     * @return the time spent running the warmup corpus through parse and expand, 0 without warmup
+     */
+    public long getWarmupNanos() {
+        return warmupNanos;
+    }
+
+    /**
+     * @return the number of warmup addresses that were parsed and expanded
+     */
+    public int getWarmupAddresses() {
+        return warmupAddresses;
+    }
+
+    @Override
+    public String toString() {
+        return "SetupReport{loadMillis=" + loadNanos / 1_000_000 + ", warmupMillis=" + warmupNanos / 1_000_000 +
+            ", warmupAddresses=" + warmupAddresses + "}";
+    }
+}
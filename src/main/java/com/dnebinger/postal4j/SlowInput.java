@@ -0,0 +1,53 @@
+package com.dnebinger.postal4j;
+
+/**
+ * One of the slowest calls since metrics were enabled or reset, see {@link LibPostalMetrics#getSlowInputs()}.
+ */
+public final class SlowInput {
+
+    // entry point, timestamp, then the nanoseconds of every stage
+    static final int FIELDS = 2 + MetricsStage.values().length;
+
+    private final MetricsEntryPoint entryPoint;
+    private final long timestampMillis;
+    private final long[] stageNanos;
+    private final String input;
+
+    SlowInput(long[] fields, int offset, String input) {
+        this.entryPoint = MetricsEntryPoint.values()[(int) fields[offset]];
+        this.timestampMillis = fields[offset + 1];
+        this.stageNanos = new long[MetricsStage.values().length];
+        this.input = input;
+
+        System.arraycopy(fields, offset + 2, stageNanos, 0, stageNanos.length);
+    }
+
+    public MetricsEntryPoint getEntryPoint() {
+        return entryPoint;
+    }
+
+    /**
+     * @return when the call ended, in epoch milliseconds
+     */
+    public long getTimestampMillis() {
+        return timestampMillis;
+    }
+
+    public long getNanos(MetricsStage stage) {
+        return stageNanos[stage.ordinal()];
+    }
+
+    /**
+     * @return the input, truncated to 255 UTF-8 bytes; batches give their size, e.g. "[1000 addresses]"
+     */
+    public String getInput() {
+        return input;
+    }
+
+    @Override
+    public String toString() {
+        return entryPoint.key() + " " + stageNanos[MetricsStage.TOTAL.ordinal()] / 1000 + "us (input " +
+            stageNanos[MetricsStage.INPUT.ordinal()] / 1000 + "us, libpostal " + stageNanos[MetricsStage.LIBPOSTAL.ordinal()] / 1000 +
+            "us, result " + stageNanos[MetricsStage.RESULT.ordinal()] / 1000 + "us): " + input;
+    }
+}
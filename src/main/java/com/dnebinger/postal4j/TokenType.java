@@ -0,0 +1,109 @@
+package com.dnebinger.postal4j;
+
+/**
+ * Token types assigned by the libpostal tokenizer.
+ * The codes are libpostal's {@code libpostal_token_type_t} values, as returned in the packed token triples.
+ */
+public enum TokenType {
+    END(0),
+    WORD(1),
+    ABBREVIATION(2),
+    IDEOGRAPHIC_CHAR(3),
+    HANGUL_SYLLABLE(4),
+    ACRONYM(5),
+    PHRASE(10),
+    EMAIL(20),
+    URL(21),
+    US_PHONE(22),
+    INTL_PHONE(23),
+    NUMERIC(50),
+    ORDINAL(51),
+    ROMAN_NUMERAL(52),
+    IDEOGRAPHIC_NUMBER(53),
+    PERIOD(100),
+    EXCLAMATION(101),
+    QUESTION_MARK(102),
+    COMMA(103),
+    COLON(104),
+    SEMICOLON(105),
+    PLUS(106),
+    AMPERSAND(107),
+    AT_SIGN(108),
+    POUND(109),
+    ELLIPSIS(110),
+    DASH(111),
+    BREAKING_DASH(112),
+    HYPHEN(113),
+    PUNCT_OPEN(114),
+    PUNCT_CLOSE(115),
+    DOUBLE_QUOTE(119),
+    SINGLE_QUOTE(120),
+    OPEN_QUOTE(121),
+    CLOSE_QUOTE(122),
+    SLASH(124),
+    BACKSLASH(125),
+    GREATER_THAN(126),
+    LESS_THAN(127),
+    OTHER(200),
+    WHITESPACE(300),
+    NEWLINE(301),
+    INVALID_CHAR(500);
+
+    private final int code;
+
+    TokenType(int code) {
+        this.code = code;
+    }
+
+    /**
+     * @return the libpostal token type code
+     */
+    public int code() {
+        return code;
+    }
+
+    /**
+     * @return true for word-like tokens (words, abbreviations, ideographs, acronyms)
+     */
+    public boolean isWord() {
+        return code >= WORD.code && code <= ACRONYM.code;
+    }
+
+    /**
+     * @return true for numeric tokens (numbers, ordinals, roman numerals, ideographic numbers)
+     */
+    public boolean isNumeric() {
+        return code >= NUMERIC.code && code <= IDEOGRAPHIC_NUMBER.code;
+    }
+
+    /**
+     * @return true for punctuation tokens
+     */
+    public boolean isPunctuation() {
+        return code >= PERIOD.code && code < OTHER.code;
+    }
+
+    /**
+     * @return true for whitespace and newline tokens
+     */
+    public boolean isWhitespace() {
+        return code == WHITESPACE.code || code == NEWLINE.code;
+    }
+
+    /**
+     * Looks up a token type by its libpostal code.
+     *
+     * @param code the libpostal token type code
+     * @return the matching token type
+     * @throws IllegalArgumentException if the code is unknown
+     */
+    public static TokenType fromCode(int code) {
+        for (TokenType type : values()) {
+            if (type.code == code) {
+                return type;
+            }
+        }
+
+        throw new IllegalArgumentException("Unknown token type code: " + code);
+    }
+}
@@ -0,0 +1,208 @@
+package com.dnebinger.postal4j;
+
+import java.lang.foreign.AddressLayout;
+import java.lang.foreign.Arena;
+import java.lang.foreign.FunctionDescriptor;
+import java.lang.foreign.Linker;
+import java.lang.foreign.MemoryLayout;
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.SegmentAllocator;
+import java.lang.foreign.StructLayout;
+import java.lang.foreign.SymbolLookup;
+import java.lang.invoke.MethodHandle;
+import java.util.HashMap;
+import java.util.Map;
+
+import static java.lang.foreign.MemoryLayout.PathElement.groupElement;
+import static java.lang.foreign.ValueLayout.ADDRESS;
+import static java.lang.foreign.ValueLayout.JAVA_BOOLEAN;
+import static java.lang.foreign.ValueLayout.JAVA_BYTE;
+import static java.lang.foreign.ValueLayout.JAVA_LONG;
+import static java.lang.foreign.ValueLayout.JAVA_SHORT;
+
+/**
+ * Calls libpostal.h functions through FFM downcall handles (JDK 22+), see {@link DirectBackend}.
+ * Inputs are copied into a confined arena per call and the libpostal results are read in place before being destroyed,
+ * so there is no JNI transition, no GetStringUTFChars copy and no local reference bookkeeping.
+ * The libpostal symbols are found through the already loaded postal4j library, which links against libpostal.
+ */
+final class FfmBackend implements DirectBackend {
+
+    private static final Linker LINKER = Linker.nativeLinker();
+    private static final SymbolLookup LIBPOSTAL = SymbolLookup.loaderLookup().or(LINKER.defaultLookup());
+
+    // the layouts below read size_t as a Java long
+    static {
+        if (LINKER.canonicalLayouts().get("size_t").byteSize() != Long.BYTES) {
+            throw new UnsupportedOperationException("FFM backend needs a 64-bit size_t");
+        }
+    }
+
+    // char* pointing at a NUL terminated string of unknown length
+    private static final AddressLayout C_STRING = ADDRESS.withTargetLayout(MemoryLayout.sequenceLayout(Long.MAX_VALUE, JAVA_BYTE));
+
+    // libpostal_address_parser_options_t
+    private static final StructLayout PARSER_OPTIONS = MemoryLayout.structLayout(
+        ADDRESS.withName("language"),
+        ADDRESS.withName("country"));
+
+    // libpostal_address_parser_response_t
+    private static final StructLayout PARSER_RESPONSE = MemoryLayout.structLayout(
+        JAVA_LONG.withName("num_components"),
+        ADDRESS.withName("components"),
+        ADDRESS.withName("labels"));
+
+    // libpostal_normalize_options_t
+    private static final StructLayout NORMALIZE_OPTIONS = MemoryLayout.structLayout(
+        ADDRESS.withName("languages"),
+        JAVA_LONG.withName("num_languages"),
+        JAVA_SHORT.withName("address_components"),
+        JAVA_BOOLEAN.withName("latin_ascii"),
+        JAVA_BOOLEAN.withName("transliterate"),
+        JAVA_BOOLEAN.withName("strip_accents"),
+        JAVA_BOOLEAN.withName("decompose"),
+        JAVA_BOOLEAN.withName("lowercase"),
+        JAVA_BOOLEAN.withName("trim_string"),
+        JAVA_BOOLEAN.withName("drop_parentheticals"),
+        JAVA_BOOLEAN.withName("replace_numeric_hyphens"),
+        JAVA_BOOLEAN.withName("delete_numeric_hyphens"),
+        JAVA_BOOLEAN.withName("split_alpha_from_numeric"),
+        JAVA_BOOLEAN.withName("replace_word_hyphens"),
+        JAVA_BOOLEAN.withName("delete_word_hyphens"),
+        JAVA_BOOLEAN.withName("delete_final_periods"),
+        JAVA_BOOLEAN.withName("delete_acronym_periods"),
+        JAVA_BOOLEAN.withName("drop_english_possessives"),
+        JAVA_BOOLEAN.withName("delete_apostrophes"),
+        JAVA_BOOLEAN.withName("expand_numex"),
+        JAVA_BOOLEAN.withName("roman_numerals"),
+        MemoryLayout.paddingLayout(4));
+
+    private static final long LANGUAGE_OFFSET = PARSER_OPTIONS.byteOffset(groupElement("language"));
+    private static final long COUNTRY_OFFSET = PARSER_OPTIONS.byteOffset(groupElement("country"));
+    private static final long NUM_COMPONENTS_OFFSET = PARSER_RESPONSE.byteOffset(groupElement("num_components"));
+    private static final long COMPONENTS_OFFSET = PARSER_RESPONSE.byteOffset(groupElement("components"));
+    private static final long LABELS_OFFSET = PARSER_RESPONSE.byteOffset(groupElement("labels"));
+
+    private static final MethodHandle GET_PARSER_DEFAULT_OPTIONS = downcall("libpostal_get_address_parser_default_options",
+        FunctionDescriptor.of(PARSER_OPTIONS));
+    private static final MethodHandle PARSE_ADDRESS = downcall("libpostal_parse_address",
+        FunctionDescriptor.of(ADDRESS.withTargetLayout(PARSER_RESPONSE), ADDRESS, PARSER_OPTIONS));
+    private static final MethodHandle PARSER_RESPONSE_DESTROY = downcall("libpostal_address_parser_response_destroy",
+        FunctionDescriptor.ofVoid(ADDRESS));
+    private static final MethodHandle GET_DEFAULT_OPTIONS = downcall("libpostal_get_default_options",
+        FunctionDescriptor.of(NORMALIZE_OPTIONS));
+    private static final MethodHandle EXPAND_ADDRESS = downcall("libpostal_expand_address",
+        FunctionDescriptor.of(ADDRESS, ADDRESS, NORMALIZE_OPTIONS, ADDRESS));
+    private static final MethodHandle EXPAND_ADDRESS_ROOT = downcall("libpostal_expand_address_root",
+        FunctionDescriptor.of(ADDRESS, ADDRESS, NORMALIZE_OPTIONS, ADDRESS));
+    private static final MethodHandle EXPANSION_ARRAY_DESTROY = downcall("libpostal_expansion_array_destroy",
+        FunctionDescriptor.ofVoid(ADDRESS, JAVA_LONG));
+
+    // libpostal hands out the same defaults every time, so they are fetched once and passed by value on every call
+    private static final MemorySegment DEFAULT_PARSER_OPTIONS;
+    private static final MemorySegment DEFAULT_NORMALIZE_OPTIONS;
+
+    static {
+        try {
+            DEFAULT_PARSER_OPTIONS = (MemorySegment) GET_PARSER_DEFAULT_OPTIONS.invokeExact((SegmentAllocator) Arena.global());
+            DEFAULT_NORMALIZE_OPTIONS = (MemorySegment) GET_DEFAULT_OPTIONS.invokeExact((SegmentAllocator) Arena.global());
+        } catch (Throwable t) {
+            throw new ExceptionInInitializerError(t);
+        }
+    }
+
+    // Created reflectively by DirectBackend.load()
+    FfmBackend() {
+    }
+
+    private static MethodHandle downcall(String name, FunctionDescriptor descriptor) {
+        MemorySegment symbol = LIBPOSTAL.find(name)
+            .orElseThrow(() -> new UnsupportedOperationException("libpostal symbol not found: " + name));
+
+        return LINKER.downcallHandle(symbol, descriptor);
+    }
+
+    @Override
+    public String name() {
+        return "ffm";
+    }
+
+    @Override
+    public Map<String, String> parseAddress(String address, String language, String country) {
+        try (Arena arena = Arena.ofConfined()) {
+            MemorySegment options = DEFAULT_PARSER_OPTIONS;
+
+            if (language != null || country != null) {
+                options = arena.allocate(PARSER_OPTIONS).copyFrom(DEFAULT_PARSER_OPTIONS);
+
+                if (language != null) {
+                    options.set(ADDRESS, LANGUAGE_OFFSET, arena.allocateFrom(language));
+                }
+                if (country != null) {
+                    options.set(ADDRESS, COUNTRY_OFFSET, arena.allocateFrom(country));
+                }
+            }
+
+            MemorySegment response = (MemorySegment) PARSE_ADDRESS.invokeExact(arena.allocateFrom(address), options);
+
+            if (response.address() == 0) {
+                throw new RuntimeException("Error parsing address");
+            }
+
+            try {
+                int numComponents = Math.toIntExact(response.get(JAVA_LONG, NUM_COMPONENTS_OFFSET));
+                MemorySegment components = response.get(ADDRESS, COMPONENTS_OFFSET).reinterpret(numComponents * ADDRESS.byteSize());
+                MemorySegment labels = response.get(ADDRESS, LABELS_OFFSET).reinterpret(numComponents * ADDRESS.byteSize());
+
+                Map<String, String> result = new HashMap<>();
+
+                for (int i = 0; i < numComponents; i++) {
+                    result.put(labels.getAtIndex(C_STRING, i).getString(0), components.getAtIndex(C_STRING, i).getString(0));
+                }
+
+                return result;
+            } finally {
+                PARSER_RESPONSE_DESTROY.invokeExact(response);
+            }
+        } catch (RuntimeException | Error e) {
+            throw e;
+        } catch (Throwable t) {
+            throw new RuntimeException("Error parsing address", t);
+        }
+    }
+
+    @Override
+    public String[] expandAddress(String address, boolean root) {
+        try (Arena arena = Arena.ofConfined()) {
+            MemorySegment input = arena.allocateFrom(address);
+            MemorySegment count = arena.allocate(JAVA_LONG);
+
+            MemorySegment expansions = root
+                ? (MemorySegment) EXPAND_ADDRESS_ROOT.invokeExact(input, DEFAULT_NORMALIZE_OPTIONS, count)
+                : (MemorySegment) EXPAND_ADDRESS.invokeExact(input, DEFAULT_NORMALIZE_OPTIONS, count);
+
+            if (expansions.address() == 0) {
+                throw new RuntimeException("Error expanding address");
+            }
+
+            long numExpansions = count.get(JAVA_LONG, 0);
+
+            try {
+                MemorySegment array = expansions.reinterpret(numExpansions * ADDRESS.byteSize());
+                String[] result = new String[Math.toIntExact(numExpansions)];
+
+                for (int i = 0; i < result.length; i++) {
+                    result[i] = array.getAtIndex(C_STRING, i).getString(0);
+                }
+
+                return result;
+            } finally {
+                EXPANSION_ARRAY_DESTROY.invokeExact(expansions, numExpansions);
+            }
+        } catch (RuntimeException | Error e) {
+            throw e;
+        } catch (Throwable t) {
+            throw new RuntimeException("Error expanding address", t);
+        }
+    }
+}
@@ -0,0 +1,184 @@
+/*
+ * postal4j_sidecar_daemon.c
+ * Loads the libpostal models once and serves parse/expand calls to every postal4j JVM on the host
+ *
+ * usage: postal4jSidecar [options] SOCKET
+ */
+
+#include "postal4j_cache.h"
+#include "postal4j_diskcache.h"
+#include "postal4j_sidecar.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t stopRequested = 0;
+
+/*
+ * Print the usage message
+ * @param program the program name
+ */
+static void usage(const char *program) {
+    fprintf(stderr,
+        "usage: %s [options] SOCKET\n"
+        "\n"
+        "Loads the libpostal models once and serves the parse/expand calls of JVMs started with\n"
+        "POSTAL4J_SIDECAR=SOCKET (or LibPostal.setupSidecar) on the Unix domain socket SOCKET.\n"
+        "\n"
+        "  --data-dir DIR     libpostal data directory\n"
+        "  --no-parser        do not load the address parser, parse calls fail\n"
+        "  --no-classifier    do not load the language classifier, expand calls need languages\n"
+        "  --cache N          result cache entries shared by all clients (default: 0, disabled)\n"
+        "  --disk-cache FILE  persistent result cache file, shared with other daemons (needs --data-dir)\n"
+        "  --disk-cache-mb N  size of a new disk cache file in MB (default: 1024)\n",
+        program);
+}
+
+static void requestStop(int signal) {
+    stopRequested = 1;
+}
+
+/*
+ * Load the core module plus the requested ones
+ * @param dataDir the data directory, or NULL for the default one
+ * @param modules the SIDECAR_MODULE_* bits to load
+ * @return true on success
+ */
+static bool setupLibpostal(char *dataDir, int modules) {
+    if (!(dataDir != NULL ? libpostal_setup_datadir(dataDir) : libpostal_setup())) {
+        fprintf(stderr, "Error initializing libpostal\n");
+        return false;
+    }
+
+    if ((modules & SIDECAR_MODULE_PARSER) != 0
+            && !(dataDir != NULL ? libpostal_setup_parser_datadir(dataDir) : libpostal_setup_parser())) {
+        fprintf(stderr, "Error initializing libpostal parser\n");
+        libpostal_teardown();
+        return false;
+    }
+
+    if ((modules & SIDECAR_MODULE_CLASSIFIER) != 0
+            && !(dataDir != NULL ? libpostal_setup_language_classifier_datadir(dataDir) : libpostal_setup_language_classifier())) {
+        fprintf(stderr, "Error initializing libpostal language classifier\n");
+        if ((modules & SIDECAR_MODULE_PARSER) != 0) {
+            libpostal_teardown_parser();
+        }
+        libpostal_teardown();
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Tear down the modules loaded by setupLibpostal, in reverse order
+ * @param modules the SIDECAR_MODULE_* bits that were loaded
+ */
+static void teardownLibpostal(int modules) {
+    if ((modules & SIDECAR_MODULE_CLASSIFIER) != 0) {
+        libpostal_teardown_language_classifier();
+    }
+    if ((modules & SIDECAR_MODULE_PARSER) != 0) {
+        libpostal_teardown_parser();
+    }
+
+    libpostal_teardown();
+}
+
+int main(int argc, char **argv) {
+    char *dataDir = NULL;
+    const char *socketPath = NULL;
+    int modules = SIDECAR_MODULE_EXPANSION | SIDECAR_MODULE_PARSER | SIDECAR_MODULE_CLASSIFIER;
+    long cacheEntries = 0;
+    const char *diskCachePath = NULL;
+    long diskCacheMegabytes = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--no-parser") == 0) {
+            modules &= ~SIDECAR_MODULE_PARSER;
+        } else if (strcmp(arg, "--no-classifier") == 0) {
+            modules &= ~SIDECAR_MODULE_CLASSIFIER;
+        } else if (strcmp(arg, "--data-dir") == 0 && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (strcmp(arg, "--cache") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            cacheEntries = strtol(argv[++i], &end, 10);
+
+            if (*end != '\0' || cacheEntries < 0 || cacheEntries > MAX_CACHE_ENTRIES) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--disk-cache") == 0 && i + 1 < argc) {
+            diskCachePath = argv[++i];
+        } else if (strcmp(arg, "--disk-cache-mb") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            diskCacheMegabytes = strtol(argv[++i], &end, 10);
+
+            if (*end != '\0' || diskCacheMegabytes < 1 || diskCacheMegabytes > (MAX_DISK_CACHE_BYTES >> 20)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg[0] == '-' || socketPath != NULL) {
+            usage(argv[0]);
+            return 2;
+        } else {
+            socketPath = arg;
+        }
+    }
+
+    if (socketPath == NULL || (diskCachePath != NULL && dataDir == NULL)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // a client that goes away mid-response must not take the daemon with it
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!setupLibpostal(dataDir, modules)) {
+        return 1;
+    }
+
+    if (!cacheStart((size_t)cacheEntries)) {
+        fprintf(stderr, "Error allocating the result cache\n");
+        teardownLibpostal(modules);
+        return 1;
+    }
+
+    if (diskCachePath != NULL) {
+        // entries are tagged with the data version, so a daemon on updated data ignores the old ones
+        uint64_t tag = diskCacheDataTag(dataDir);
+        const char *error = (tag == 0 ? "No libpostal data found in the data directory"
+            : diskCacheOpen(diskCachePath, (size_t)diskCacheMegabytes << 20, tag));
+
+        if (error != NULL) {
+            fprintf(stderr, "%s\n", error);
+            cacheStop();
+            teardownLibpostal(modules);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "Serving libpostal on %s\n", socketPath);
+
+    const char *error = sidecarServe(socketPath, modules, &stopRequested);
+
+    cacheStop();
+    diskCacheClose();
+    teardownLibpostal(modules);
+
+    if (error != NULL) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,7 +1,29 @@
 package com.dnebinger.postal4j;
 
 import org.junit.jupiter.api.*;
+
+import java.lang.management.ManagementFactory;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.ReadOnlyBufferException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.EnumSet;
+import java.util.List;
 import java.util.Map;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicReference;
+import javax.management.MBeanServer;
+import javax.management.ObjectName;
 
 import static org.junit.jupiter.api.Assertions.*;
 import static org.junit.jupiter.api.Assumptions.assumeTrue;
@@ -240,6 +262,1134 @@ class LibPostalTest {
         System.out.println("Expansions for empty string: " + expansions.length + " results");
     }
 
+    @Test
+    @Order(14)
+    void testParseAddressesBatch() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = {
+            "123 Main Street, Springfield, IL 62701",
+            "Unter den Linden 77, 10117 Berlin, Germany",
+            ""
+        };
+
+        Map<String, String>[] results = LibPostal.parseAddresses(addresses);
+
+        assertNotNull(results);
+        assertEquals(addresses.length, results.length);
+
+        // batch results should match the single-address path, in input order
+        for (int i = 0; i < addresses.length; i++) {
+            assertEquals(LibPostal.parseAddress(addresses[i]), results[i]);
+        }
+    }
+
+    @Test
+    @Order(15)
+    void testParseAddressesBatchWithLanguagesAndCountries() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = {
+            "123 Main Street, Springfield, IL 62701",
+            "Unter den Linden 77, 10117 Berlin, Germany"
+        };
+
+        Map<String, String>[] results = LibPostal.parseAddresses(addresses, new String[]{"en", "de"}, new String[]{"us", null});
+
+        assertEquals(addresses.length, results.length);
+        assertEquals(LibPostal.parseAddress(addresses[0], "en", "us"), results[0]);
+        assertEquals(LibPostal.parseAddress(addresses[1], "de", null), results[1]);
+
+        // hint arrays must line up with the addresses
+        assertThrows(RuntimeException.class, () -> LibPostal.parseAddresses(addresses, new String[]{"en"}, null));
+        assertThrows(RuntimeException.class, () -> LibPostal.parseAddresses(new String[]{"123 Main St", null}));
+    }
+
+    @Test
+    @Order(16)
+    void testParseAddressCompact() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "Unter den Linden 77, 10117 Berlin, Germany";
+        ParsedAddress result = LibPostal.parseAddressCompact(address, "de", "de");
+
+        assertNotNull(result);
+        assertFalse(result.isEmpty());
+        assertEquals(LibPostal.parseAddress(address, "de", "de"), result.toMap());
+        assertEquals("10117", result.get(AddressLabel.POSTCODE));
+    }
+
+    @Test
+    @Order(17)
+    void testParseAddressesCompact() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = {
+            "123 Main Street, Springfield, IL 62701",
+            "",
+            "Unter den Linden 77, 10117 Berlin, Germany"
+        };
+
+        ParsedAddressBatch batch = LibPostal.parseAddressesCompact(addresses);
+
+        assertEquals(addresses.length, batch.size());
+
+        for (int i = 0; i < addresses.length; i++) {
+            assertEquals(LibPostal.parseAddress(addresses[i]), batch.get(i).toMap());
+            assertEquals(batch.get(i).size(), batch.componentCount(i));
+        }
+    }
+
+    @Test
+    @Order(18)
+    void testParseAddressUtf8() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "Unter den Linden 77, 10117 Berlin, Germany";
+        byte[] utf8 = address.getBytes(StandardCharsets.UTF_8);
+        Map<String, String> expected = LibPostal.parseAddress(address);
+
+        assertEquals(expected, LibPostal.parseAddress(utf8));
+        assertEquals(expected, LibPostal.parseAddressCompact(utf8).toMap());
+
+        // direct buffer with surrounding bytes, read by absolute offset
+        ByteBuffer direct = ByteBuffer.allocateDirect(utf8.length + 8);
+        direct.put(4, utf8);
+        assertEquals(expected, LibPostal.parseAddress(direct, 4, utf8.length));
+
+        // heap and read-only heap buffers
+        ByteBuffer heap = ByteBuffer.wrap(utf8);
+        assertEquals(expected, LibPostal.parseAddress(heap, 0, utf8.length));
+        assertEquals(expected, LibPostal.parseAddress(heap.asReadOnlyBuffer(), 0, utf8.length));
+
+        assertThrows(IndexOutOfBoundsException.class, () -> LibPostal.parseAddress(direct, 10, utf8.length));
+    }
+
+    @Test
+    @Order(19)
+    void testExpandAddressUtf8() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "123 E 45th St Apt 6B";
+        byte[] utf8 = address.getBytes(StandardCharsets.UTF_8);
+
+        ByteBuffer direct = ByteBuffer.allocateDirect(utf8.length);
+        direct.put(0, utf8);
+
+        assertArrayEquals(sorted(LibPostal.expandAddress(address)), sorted(LibPostal.expandAddress(utf8)));
+        assertArrayEquals(sorted(LibPostal.expandAddress(address)), sorted(LibPostal.expandAddress(direct, 0, utf8.length)));
+        assertArrayEquals(sorted(LibPostal.expandRootAddress(address)), sorted(LibPostal.expandRootAddress(utf8)));
+        assertArrayEquals(sorted(LibPostal.expandRootAddress(address)), sorted(LibPostal.expandRootAddress(direct, 0, utf8.length)));
+    }
+
+    @Test
+    @Order(20)
+    void testParseAddressUtf8SupplementaryCharacters() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        // standard UTF-8 for a non-BMP character survives untouched through the byte path
+        byte[] utf8 = "𠮷野家 東京都渋谷区 1-2-3".getBytes(StandardCharsets.UTF_8);
+        ParsedAddress result = LibPostal.parseAddressCompact(utf8);
+
+        assertNotNull(result);
+        assertTrue(String.join(" ", result.toMap().values()).contains("𠮷"));
+    }
+
+    @Test
+    @Order(21)
+    void testExpandAddressesBatch() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = {"123 Main St", "123 E 45th St Apt 6B", ""};
+
+        String[][] expansions = LibPostal.expandAddresses(addresses);
+        String[][] rootExpansions = LibPostal.expandRootAddresses(addresses);
+
+        assertEquals(addresses.length, expansions.length);
+        assertEquals(addresses.length, rootExpansions.length);
+
+        for (int i = 0; i < addresses.length; i++) {
+            assertArrayEquals(sorted(LibPostal.expandAddress(addresses[i])), sorted(expansions[i]));
+            assertArrayEquals(sorted(LibPostal.expandRootAddress(addresses[i])), sorted(rootExpansions[i]));
+        }
+    }
+
+    @Test
+    @Order(22)
+    void testBatchesWithWorkerThreads() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = new String[257];
+        for (int i = 0; i < addresses.length; i++) {
+            addresses[i] = (i % 2 == 0)
+                ? (i + 100) + " Main Street, Springfield, IL 62701"
+                : "Unter den Linden " + i + ", 10117 Berlin, Germany";
+        }
+
+        Map<String, String>[] sequential = LibPostal.parseAddresses(addresses);
+        String[][] sequentialExpansions = LibPostal.expandAddresses(addresses);
+
+        // restart with workers, results must be identical and in input order
+        LibPostal.teardown();
+        setupSucceeded = false;
+
+        try {
+            LibPostal.setup(DATA_DIR, 4);
+            setupSucceeded = true;
+
+            assertEquals(4, LibPostal.getWorkerThreads());
+            assertArrayEquals(sequential, LibPostal.parseAddresses(addresses));
+
+            String[][] parallelExpansions = LibPostal.expandAddresses(addresses);
+            for (int i = 0; i < addresses.length; i++) {
+                assertArrayEquals(sorted(sequentialExpansions[i]), sorted(parallelExpansions[i]));
+            }
+
+            ParsedAddressBatch compact = LibPostal.parseAddressesCompact(addresses);
+            for (int i = 0; i < addresses.length; i++) {
+                assertEquals(sequential[i], compact.get(i).toMap());
+            }
+        } finally {
+            // go back to the plain setup used by the remaining tests
+            if (setupSucceeded) {
+                LibPostal.teardown();
+            }
+            LibPostal.setup(DATA_DIR);
+            setupSucceeded = true;
+        }
+
+        assertEquals(0, LibPostal.getWorkerThreads());
+        assertThrows(RuntimeException.class, () -> LibPostal.setup(DATA_DIR, -1));
+    }
+
+    @Test
+    @Order(23)
+    void testExpandAddressWithNormalizeOptions() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "123 Main St";
+
+        // the same options as testExpandAddressWithOptions
+        NormalizeOptions options = NormalizeOptions.builder()
+            .languages("en")
+            .flags(NormalizeOptions.LATIN_ASCII | NormalizeOptions.TRANSLITERATE | NormalizeOptions.STRIP_ACCENTS |
+                NormalizeOptions.DECOMPOSE | NormalizeOptions.LOWERCASE | NormalizeOptions.TRIM_STRING | NormalizeOptions.EXPAND_NUMEX)
+            .addressComponents(NormalizeOptions.ADDRESS_ALL)
+            .build();
+
+        try (options) {
+            String[] expected = LibPostal.expandAddress(address, new String[]{"en"}, true, true, true, true, true, true,
+                false, false, false, false, false, false, false, false, false, false, true, false, 0xFFFF);
+
+            assertArrayEquals(sorted(expected), sorted(LibPostal.expandAddress(address, options)));
+            assertArrayEquals(sorted(expected), sorted(LibPostal.expandAddresses(new String[]{address}, options)[0]));
+            assertNotNull(LibPostal.expandRootAddress(address, options));
+        }
+
+        assertTrue(options.isClosed());
+        assertThrows(IllegalStateException.class, () -> LibPostal.expandAddress(address, options));
+
+        // the builder starts from the libpostal defaults
+        try (NormalizeOptions defaults = NormalizeOptions.builder().build()) {
+            assertArrayEquals(sorted(LibPostal.expandAddress(address)), sorted(LibPostal.expandAddress(address, defaults)));
+            assertArrayEquals(sorted(LibPostal.expandRootAddress(address)), sorted(LibPostal.expandRootAddress(address, defaults)));
+        }
+    }
+
+    @Test
+    @Order(24)
+    void testResultCache() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "781 Franklin Ave Crown Heights Brooklyn NY 11216";
+        Map<String, String> uncached = LibPostal.parseAddress(address);
+        String[] uncachedExpansions = LibPostal.expandAddress(address);
+        // line breaks separate fields for the parser, the cache must not turn them into spaces
+        String multiline = "Barboncino\n781 Franklin Ave\nCrown Heights, Brooklyn NY 11216";
+        Map<String, String> uncachedMultiline = LibPostal.parseAddress(multiline);
+
+        assertEquals(0, LibPostal.getCacheStats().getCapacity());
+
+        LibPostal.teardown();
+        setupSucceeded = false;
+
+        try {
+            LibPostal.setup(DATA_DIR, 0, 1000);
+            setupSucceeded = true;
+
+            assertEquals(uncached, LibPostal.parseAddress(address));
+            // same address with different whitespace and case is a hit
+            assertEquals(uncached, LibPostal.parseAddress("  781 franklin AVE   Crown Heights Brooklyn NY 11216 "));
+            assertEquals(uncached, LibPostal.parseAddresses(new String[]{address})[0]);
+
+            // different hints are a different key
+            LibPostal.parseAddress(address, "en", "us");
+
+            assertEquals(uncachedMultiline, LibPostal.parseAddress(multiline));
+            assertEquals(uncachedMultiline, LibPostal.parseAddress(multiline));
+
+            CacheStats stats = LibPostal.getCacheStats();
+            assertEquals(1000, stats.getCapacity());
+            assertEquals(3, stats.getHits());
+            assertEquals(3, stats.getMisses());
+            assertEquals(3, stats.getEntries());
+
+            assertArrayEquals(sorted(uncachedExpansions), sorted(LibPostal.expandAddress(address)));
+            assertArrayEquals(sorted(uncachedExpansions), sorted(LibPostal.expandAddress(address)));
+            assertEquals(4, LibPostal.getCacheStats().getHits());
+
+            LibPostal.clearCache();
+            assertEquals(0, LibPostal.getCacheStats().getEntries());
+            assertEquals(uncached, LibPostal.parseAddress(address));
+        } finally {
+            if (setupSucceeded) {
+                LibPostal.teardown();
+            }
+            LibPostal.setup(DATA_DIR);
+            setupSucceeded = true;
+        }
+
+        assertEquals(0, LibPostal.getCacheStats().getCapacity());
+        assertThrows(RuntimeException.class, () -> LibPostal.setup(DATA_DIR, 0, -1));
+    }
+
+    @Test
+    @Order(25)
+    void testNearDupeHashes() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        NearDupeHashOptions options = NearDupeHashOptions.builder().build();
+
+        String[] labels = {"house_number", "road", "city", "state", "postcode"};
+        String[] hashes = LibPostal.nearDupeHashes(labels, new String[]{"123", "main street", "springfield", "il", "62701"}, options);
+        String[] abbreviated = LibPostal.nearDupeHashes(labels, new String[]{"123", "main st", "springfield", "il", "62701"}, options);
+
+        assertTrue(hashes.length > 0);
+        // the abbreviation expands to the same street, so the records share a blocking key
+        assertTrue(Arrays.stream(hashes).anyMatch(hash -> Arrays.asList(abbreviated).contains(hash)));
+
+        String[] geoHashes = LibPostal.nearDupeHashes(labels, new String[]{"123", "main street", "springfield", "il", "62701"},
+            39.7817, -89.6501, options);
+        assertTrue(geoHashes.length >= hashes.length);
+
+        // the batch form gives the same hashes as one call per record
+        String[] addresses = {"123 Main Street, Springfield, IL 62701", "Unter den Linden 77, 10117 Berlin, Germany"};
+        ParsedAddressBatch parsed = LibPostal.parseAddressesCompact(addresses);
+        NearDupeHashBatch batch = LibPostal.nearDupeHashes(parsed, null, null, options);
+
+        assertEquals(addresses.length, batch.size());
+        for (int i = 0; i < addresses.length; i++) {
+            assertArrayEquals(sorted(LibPostal.nearDupeHashes(parsed.get(i), options)), sorted(batch.hashes(i)));
+        }
+
+        NearDupeHashBatch geoBatch = LibPostal.nearDupeHashes(parsed, new double[]{39.7817, Double.NaN},
+            new double[]{-89.6501, Double.NaN}, NearDupeHashOptions.builder().withLatLon(true).build());
+        assertArrayEquals(sorted(batch.hashes(1)), sorted(geoBatch.hashes(1)));
+
+        assertTrue(LibPostal.nearDupeNameHashes("Book Club").length > 0);
+
+        // malformed flat input is rejected before any hashing
+        assertThrows(RuntimeException.class, () -> LibPostal.nearDupeHashes(new int[]{0, 2}, new byte[]{0}, new byte[0],
+            new int[]{0, 0}, null, null, options));
+    }
+
+    @Test
+    @Order(26)
+    void testDuplicateChecks() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        assertTrue(LibPostal.isStreetDuplicate("Main St", "Main Street").isDuplicate());
+        assertEquals(DuplicateStatus.NON_DUPLICATE, LibPostal.isHouseNumberDuplicate("123", "456"));
+        assertEquals(DuplicateStatus.NULL_DUPLICATE, LibPostal.isNameDuplicate("Book Club", null));
+        assertNotNull(LibPostal.isToponymDuplicate(
+            new String[]{"city", "state"}, new String[]{"brooklyn", "ny"},
+            new String[]{"city", "state"}, new String[]{"brooklyn", "new york"}, "en"));
+
+        // the batch codes match one call per pair
+        String[] left = {"Main St", "123", "Apt 4B", null};
+        String[] right = {"Main Street", "456", "Apartment 4B", "Main St"};
+        byte[] streets = LibPostal.isDuplicate(DuplicateComponent.STREET, left, right);
+
+        assertEquals(left.length, streets.length);
+        for (int i = 0; i < left.length; i++) {
+            assertEquals(LibPostal.isDuplicate(DuplicateComponent.STREET, left[i], right[i]), DuplicateStatus.fromCode(streets[i]));
+        }
+
+        // packed UTF-8 pairs, the -1 offset is a missing value
+        byte[] leftValues = "Main St123".getBytes(StandardCharsets.UTF_8);
+        byte[] rightValues = "Main Street456".getBytes(StandardCharsets.UTF_8);
+        byte[] packed = LibPostal.isDuplicate(DuplicateComponent.STREET, leftValues, new int[]{0, 7, -1, 10}, rightValues, new int[]{0, 11, 11, 14});
+
+        assertArrayEquals(new byte[]{streets[0], streets[1], (byte) DuplicateStatus.NULL_DUPLICATE.code()}, packed);
+    }
+
+    @Test
+    @Order(27)
+    void testFuzzyDuplicateChecks() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        FuzzyDuplicateOptions options = FuzzyDuplicateOptions.builder().build();
+        FuzzyTokens query = FuzzyTokens.of(new String[]{"the", "book", "club"}, new double[]{0.1, 0.6, 0.5});
+
+        FuzzyDuplicateResult same = LibPostal.isNameDuplicateFuzzy(query, query, options);
+        assertTrue(same.getStatus().isDuplicate());
+        assertEquals(1.0, same.getSimilarity(), 1e-9);
+
+        // candidates packed back to back, the offsets mark where each one starts
+        FuzzyTokens.Builder candidates = FuzzyTokens.builder();
+        int[] candidateOffsets = new int[4];
+
+        candidateOffsets[0] = candidates.size();
+        candidates.add("book", 0.6).add("club", 0.5);
+        candidateOffsets[1] = candidates.size();
+        candidates.add("pizza", 0.7).add("palace", 0.6);
+        candidateOffsets[2] = candidates.size();
+        candidates.add("the", 0.1).add("book", 0.6).add("club", 0.5);
+        candidateOffsets[3] = candidates.size();
+
+        FuzzyTokens packed = candidates.build();
+        FuzzyDuplicateBatch batch = LibPostal.isNameDuplicateFuzzy(query, packed, candidateOffsets, options);
+
+        assertEquals(3, batch.size());
+        assertEquals(DuplicateStatus.NON_DUPLICATE, batch.status(1));
+        assertTrue(batch.similarity(0) > batch.similarity(1));
+        assertEquals(same.getSimilarity(), batch.similarity(2), 1e-9);
+
+        FuzzyDuplicateResult street = LibPostal.isStreetDuplicateFuzzy(
+            FuzzyTokens.of(new String[]{"main", "street"}, new double[]{0.8, 0.2}),
+            FuzzyTokens.of(new String[]{"main", "st"}, new double[]{0.8, 0.2}), options);
+        assertNotNull(street.getStatus());
+    }
+
+    @Test
+    @Order(28)
+    void testSelectiveModules() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        assertEquals(EnumSet.allOf(LibPostalModule.class), LibPostal.getLoadedModules());
+        String address = "781 Franklin Ave Crown Heights Brooklyn NY 11216";
+        NormalizeOptions english = NormalizeOptions.builder().languages("en").build();
+        String[] expected = LibPostal.expandAddress(address, english);
+
+        LibPostal.teardown();
+        setupSucceeded = false;
+        assertTrue(LibPostal.getLoadedModules().isEmpty());
+
+        try {
+            // expansion only, the parser and classifier are never loaded
+            LibPostal.setup(DATA_DIR, EnumSet.of(LibPostalModule.EXPANSION));
+            setupSucceeded = true;
+
+            assertEquals(EnumSet.of(LibPostalModule.EXPANSION), LibPostal.getLoadedModules());
+            assertArrayEquals(sorted(expected), sorted(LibPostal.expandAddress(address, english)));
+            assertThrows(RuntimeException.class, () -> LibPostal.parseAddress(address));
+            assertThrows(RuntimeException.class, () -> LibPostal.expandAddress(address));
+
+            LibPostal.teardown();
+            setupSucceeded = false;
+
+            // lazy, each module is loaded by the first call needing it
+            LibPostal.setup(DATA_DIR, EnumSet.allOf(LibPostalModule.class), true);
+            setupSucceeded = true;
+
+            assertEquals(EnumSet.of(LibPostalModule.EXPANSION), LibPostal.getLoadedModules());
+            assertFalse(LibPostal.parseAddress(address).isEmpty());
+            assertEquals(EnumSet.of(LibPostalModule.EXPANSION, LibPostalModule.PARSER), LibPostal.getLoadedModules());
+
+            LibPostal.loadModules(EnumSet.of(LibPostalModule.CLASSIFIER));
+            assertEquals(EnumSet.allOf(LibPostalModule.class), LibPostal.getLoadedModules());
+        } finally {
+            english.close();
+            if (setupSucceeded) {
+                LibPostal.teardown();
+            }
+            LibPostal.setup(DATA_DIR);
+            setupSucceeded = true;
+        }
+    }
+
+    @Test
+    @Order(29)
+    void testTokenize() {
+        String input = "Crème Brûlée Café, 123 Main St.";
+        int[] tokens = LibPostal.tokenize(input);
+
+        assertEquals(0, tokens.length % 3);
+        assertEquals("Crème", input.substring(tokens[0], tokens[0] + tokens[1]));
+        assertEquals(TokenType.WORD, TokenType.fromCode(tokens[2]));
+
+        boolean sawComma = false;
+        boolean sawNumber = false;
+        for (int i = 0; i < tokens.length; i += 3) {
+            TokenType type = TokenType.fromCode(tokens[i + 2]);
+            sawComma |= type == TokenType.COMMA;
+            sawNumber |= type.isNumeric() && input.substring(tokens[i], tokens[i] + tokens[i + 1]).equals("123");
+            assertFalse(type.isWhitespace());
+        }
+        assertTrue(sawComma);
+        assertTrue(sawNumber);
+
+        // UTF-8 offsets are byte offsets relative to the input offset
+        byte[] utf8 = ("xx" + input).getBytes(StandardCharsets.UTF_8);
+        int[] buffer = new int[tokens.length];
+        assertEquals(tokens.length / 3, LibPostal.tokenize(utf8, 2, utf8.length - 2, false, buffer));
+        assertEquals("Crème", new String(utf8, 2 + buffer[0], buffer[1], StandardCharsets.UTF_8));
+        assertEquals(6, buffer[1]);
+
+        // a short buffer gets the leading tokens and the full count
+        int[] small = new int[3];
+        assertEquals(tokens.length / 3, LibPostal.tokenize(ByteBuffer.wrap(utf8), 2, utf8.length - 2, false, small));
+        assertEquals(buffer[0], small[0]);
+
+        assertTrue(LibPostal.tokenize(input, true).length > tokens.length);
+    }
+
+    @Test
+    @Order(30)
+    void testNormalizeString() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String normalized = LibPostal.normalizeString("  Crème Brûlée  ", Normalization.DEFAULT_STRING_OPTIONS);
+        assertEquals("creme brulee", normalized);
+        assertEquals(normalized, LibPostal.normalizeString("  Crème Brûlée  ", Normalization.DEFAULT_STRING_OPTIONS, "fr"));
+
+        NormalizedTokens tokens = LibPostal.normalizedTokens("St. Mary's Rd.", Normalization.DEFAULT_STRING_OPTIONS,
+            Normalization.DEFAULT_TOKEN_OPTIONS, false);
+        assertTrue(tokens.size() >= 3);
+        assertEquals("st", tokens.token(0));
+        assertEquals(TokenType.ABBREVIATION, tokens.type(0));
+
+        String[] batch = LibPostal.normalizeStrings(new String[]{"Crème Brûlée", null, "MAIN ST"}, Normalization.DEFAULT_STRING_OPTIONS);
+        assertEquals(3, batch.length);
+        assertEquals(normalized, batch[0]);
+        assertNull(batch[1]);
+        assertEquals("main st", batch[2]);
+    }
+
+    @Test
+    @Order(31)
+    void testBulkProcessFile() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = {
+            "781 Franklin Ave Crown Heights Brooklyn NY 11216",
+            "",
+            "30 W 26th St, New York, NY 10010",
+            "Quatre-vingt-douze Ave des Champs-Élysées"
+        };
+        Path input = Files.createTempFile("postal4j-bulk", ".txt");
+        Path tsv = Files.createTempFile("postal4j-bulk", ".tsv");
+        Path binary = Files.createTempFile("postal4j-bulk", ".bin");
+
+        try {
+            Files.write(input, Arrays.asList(addresses), StandardCharsets.UTF_8);
+
+            List<BulkProgress> reports = new ArrayList<>();
+            BulkProgress result = LibPostal.processFile(input.toString(), tsv.toString(), BulkMode.PARSE, BulkFormat.TSV, null, reports::add);
+
+            assertEquals(addresses.length, result.getLines());
+            assertEquals(Files.size(input), result.getTotalBytes());
+            assertEquals(Files.size(tsv), result.getBytesWritten());
+            assertFalse(reports.isEmpty());
+
+            // one line per address in input order, one column per label
+            List<String> lines = Files.readAllLines(tsv, StandardCharsets.UTF_8);
+            assertEquals(addresses.length, lines.size());
+            for (int i = 0; i < addresses.length; i++) {
+                String[] columns = lines.get(i).split("\t", -1);
+                assertEquals(AddressLabel.values().length, columns.length);
+
+                Map<String, String> parsed = addresses[i].isEmpty() ? Map.of() : LibPostal.parseAddress(addresses[i]);
+                for (AddressLabel label : AddressLabel.values()) {
+                    assertEquals(parsed.getOrDefault(label.label(), ""), columns[label.ordinal()]);
+                }
+            }
+
+            LibPostal.processFile(input.toString(), binary.toString(), BulkMode.EXPAND, BulkFormat.BINARY);
+
+            ByteBuffer records = ByteBuffer.wrap(Files.readAllBytes(binary)).order(ByteOrder.LITTLE_ENDIAN);
+            assertEquals(0x424a3450, records.getInt());
+            assertEquals(1, records.get());
+            assertEquals(BulkMode.EXPAND.ordinal(), records.get());
+            records.getShort();
+
+            for (String address : addresses) {
+                String[] expected = address.isEmpty() ? new String[0] : LibPostal.expandAddress(address);
+                String[] actual = new String[records.getInt()];
+                for (int i = 0; i < actual.length; i++) {
+                    byte[] value = new byte[records.getInt()];
+                    records.get(value);
+                    actual[i] = new String(value, StandardCharsets.UTF_8);
+                }
+                assertArrayEquals(sorted(expected), sorted(actual));
+            }
+            assertFalse(records.hasRemaining());
+
+            // a throwing listener stops the run
+            assertThrows(IllegalStateException.class, () -> LibPostal.processFile(input.toString(), tsv.toString(), BulkMode.PARSE,
+                BulkFormat.TSV, null, progress -> { throw new IllegalStateException("stop"); }));
+        } finally {
+            Files.deleteIfExists(input);
+            Files.deleteIfExists(tsv);
+            Files.deleteIfExists(binary);
+        }
+    }
+
+    @Test
+    @Order(32)
+    void testAsync() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "781 Franklin Ave Crown Heights Brooklyn NY 11216";
+
+        try {
+            LibPostal.setupAsync(2, 4, AsyncBackpressure.BLOCK);
+
+            List<CompletableFuture<Map<String, String>>> parses = new ArrayList<>();
+            for (int i = 0; i < 20; i++) {
+                parses.add(LibPostal.parseAddressAsync(address));
+            }
+
+            Map<String, String> expected = LibPostal.parseAddress(address);
+            for (CompletableFuture<Map<String, String>> parse : parses) {
+                assertEquals(expected, parse.get(30, TimeUnit.SECONDS));
+            }
+            assertArrayEquals(sorted(LibPostal.expandAddress(address)), sorted(LibPostal.expandAddressAsync(address).get(30, TimeUnit.SECONDS)));
+
+            // errors complete the future exceptionally
+            NormalizeOptions closed = NormalizeOptions.builder().build();
+            closed.close();
+            ExecutionException error = assertThrows(ExecutionException.class,
+                () -> LibPostal.expandAddressAsync(address, closed).get(30, TimeUnit.SECONDS));
+            assertInstanceOf(IllegalStateException.class, error.getCause());
+        } finally {
+            LibPostal.shutdownAsync();
+        }
+
+        // with every thread busy and the queue full, REJECT fails the next call right away
+        CountDownLatch release = new CountDownLatch(1);
+        try (AsyncExecutor executor = new AsyncExecutor(1, 1, AsyncBackpressure.REJECT)) {
+            CompletableFuture<Boolean> running = executor.submit(() -> awaitQuietly(release));
+            CompletableFuture<Boolean> queued = executor.submit(() -> awaitQuietly(release));
+
+            CompletableFuture<Boolean> rejected = executor.submit(() -> true);
+            ExecutionException error = assertThrows(ExecutionException.class, rejected::get);
+            assertInstanceOf(RejectedExecutionException.class, error.getCause());
+            assertEquals(2, executor.getPending());
+
+            release.countDown();
+            assertTrue(running.get(30, TimeUnit.SECONDS));
+            assertTrue(queued.get(30, TimeUnit.SECONDS));
+            assertTrue(executor.submit(() -> true).get(30, TimeUnit.SECONDS));
+        }
+    }
+
+    @Test
+    @Order(33)
+    void testBackend() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String backend = LibPostal.getBackend();
+        assertTrue(backend.equals("jni") || backend.equals("ffm"), backend);
+
+        // the batch calls always go through JNI, so they cross-check whichever backend the single-address calls use
+        String[] addresses = {
+            "781 Franklin Ave Crown Heights Brooklyn NY 11216",
+            "Unter den Linden 77, 10117 Berlin, Germany",
+            "Calle de Alcalá 45, 28014 Madrid, España"
+        };
+        Map<String, String>[] parsed = LibPostal.parseAddresses(addresses);
+        String[][] expanded = LibPostal.expandAddresses(addresses);
+        String[][] roots = LibPostal.expandRootAddresses(addresses);
+
+        for (int i = 0; i < addresses.length; i++) {
+            assertEquals(parsed[i], LibPostal.parseAddress(addresses[i]));
+            assertArrayEquals(sorted(expanded[i]), sorted(LibPostal.expandAddress(addresses[i])));
+            assertArrayEquals(sorted(roots[i]), sorted(LibPostal.expandRootAddress(addresses[i])));
+        }
+        assertEquals(LibPostal.parseAddresses(addresses, new String[]{"de", "de", "es"}, new String[]{"de", "de", "es"})[1],
+            LibPostal.parseAddress(addresses[1], "de", "de"));
+    }
+
+    @Test
+    @Order(34)
+    void testStringTranscoding() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        // String inputs reach libpostal as standard UTF-8, exactly like the same text passed as UTF-8 bytes,
+        // including characters outside the BMP (here U+20BB7) that modified UTF-8 would split into surrogates
+        String[] inputs = {
+            "30 W 26th St, New York, NY 10010",
+            "Calle de Alcalá 45, 28014 Madrid, España",
+            "東京都千代田区丸の内1丁目9番1号",
+            "\uD842\uDFB7野家 新宿区西新宿2-8-1 東京都"
+        };
+
+        for (String input : inputs) {
+            byte[] utf8 = input.getBytes(StandardCharsets.UTF_8);
+
+            assertEquals(LibPostal.parseAddress(utf8), LibPostal.parseAddress(input));
+            assertArrayEquals(sorted(LibPostal.expandAddress(utf8)), sorted(LibPostal.expandAddress(input)));
+            assertEquals(LibPostal.parseAddresses(new String[]{input})[0], LibPostal.parseAddress(input));
+        }
+
+        // token offsets count the supplementary character as two UTF-16 units
+        String input = inputs[3];
+        int[] tokens = LibPostal.tokenize(input);
+        assertTrue(input.substring(tokens[0], tokens[0] + tokens[1]).startsWith("\uD842\uDFB7"));
+        assertEquals(input.length(), tokens[tokens.length - 3] + tokens[tokens.length - 2]);
+
+        // and results come back as the same supplementary character, not as six mangled chars
+        assertTrue(LibPostal.parseAddress(input).values().stream().anyMatch(value -> value.contains("\uD842\uDFB7")));
+        assertTrue(LibPostal.parseAddresses(new String[]{input})[0].values().stream()
+            .anyMatch(value -> value.contains("\uD842\uDFB7")));
+    }
+
+    @Test
+    @Order(35)
+    void testMetrics() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        LibPostal.enableMetrics(4);
+
+        try {
+            LibPostal.resetMetrics();
+            assertTrue(LibPostal.isMetricsEnabled());
+
+            String address = "781 Franklin Ave Crown Heights Brooklyn NY 11216";
+
+            for (int i = 0; i < 10; i++) {
+                LibPostal.parseAddress(address);
+            }
+            LibPostal.expandAddress(address);
+            LibPostal.parseAddresses(new String[]{address, address, address});
+
+            LibPostalMetrics metrics = LibPostal.getMetrics();
+            assertEquals(10, metrics.getCalls(MetricsEntryPoint.PARSE));
+            assertEquals(0, metrics.getErrors(MetricsEntryPoint.PARSE));
+            assertEquals(1, metrics.getCalls(MetricsEntryPoint.EXPAND));
+            assertEquals(1, metrics.getCalls(MetricsEntryPoint.PARSE_BATCH));
+            assertEquals(0, metrics.getCalls(MetricsEntryPoint.EXPAND_ROOT));
+
+            // the stages add up to the whole call
+            LatencyHistogram total = metrics.getLatency(MetricsEntryPoint.PARSE, MetricsStage.TOTAL);
+            long stages = 0;
+            for (MetricsStage stage : new MetricsStage[]{MetricsStage.INPUT, MetricsStage.LIBPOSTAL, MetricsStage.RESULT}) {
+                LatencyHistogram histogram = metrics.getLatency(MetricsEntryPoint.PARSE, stage);
+                assertEquals(10, histogram.getCount());
+                stages += histogram.getTotalNanos();
+            }
+            assertEquals(10, total.getCount());
+            assertEquals(total.getTotalNanos(), stages);
+            assertEquals(10, Arrays.stream(total.getBuckets()).sum());
+            assertTrue(total.getPercentileNanos(50) <= total.getPercentileNanos(99));
+            assertTrue(total.getPercentileNanos(100) <= total.getMaxNanos());
+
+            // slowest first, at most the 4 asked for
+            List<SlowInput> slow = metrics.getSlowInputs();
+            assertEquals(4, slow.size());
+            for (int i = 1; i < slow.size(); i++) {
+                assertTrue(slow.get(i - 1).getNanos(MetricsStage.TOTAL) >= slow.get(i).getNanos(MetricsStage.TOTAL));
+            }
+            assertTrue(slow.stream().allMatch(input -> input.getInput().equals(address) || input.getInput().equals("[3 addresses]")));
+
+            // bucket bounds line up with the native layout
+            assertEquals(7, LatencyHistogram.bucketHighestValue(7));
+            assertEquals(8, LatencyHistogram.bucketLowestValue(8));
+            assertEquals(1024, LatencyHistogram.bucketLowestValue(64));
+            assertEquals(1151, LatencyHistogram.bucketHighestValue(64));
+
+            ObjectName name = LibPostalMetricsJmx.register();
+            MBeanServer server = ManagementFactory.getPlatformMBeanServer();
+            assertEquals(Boolean.TRUE, server.getAttribute(name, "Enabled"));
+            assertNotNull(server.getAttribute(name, "P99Micros"));
+            assertEquals(4, ((String[]) server.getAttribute(name, "SlowInputs")).length);
+            server.invoke(name, "reset", null, null);
+            assertEquals(0, LibPostal.getMetrics().getCalls(MetricsEntryPoint.PARSE));
+            LibPostalMetricsJmx.unregister();
+
+            assertThrows(RuntimeException.class, () -> LibPostal.enableMetrics(-1));
+        } finally {
+            LibPostal.disableMetrics();
+        }
+
+        // nothing is recorded while disabled
+        LibPostal.parseAddress("Unter den Linden 77, 10117 Berlin, Germany");
+        assertFalse(LibPostal.isMetricsEnabled());
+        assertEquals(0, LibPostal.getMetrics().getCalls(MetricsEntryPoint.PARSE));
+    }
+
+    @Test
+    @Order(36)
+    void testSidecar() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        assertNotEquals("sidecar", LibPostal.getBackend());
+
+        String[] addresses = {
+            "781 Franklin Ave Crown Heights Brooklyn NY 11216",
+            "Unter den Linden 77, 10117 Berlin, Germany"
+        };
+        Map<String, String>[] parsed = LibPostal.parseAddresses(addresses);
+        String[][] expanded = LibPostal.expandAddresses(addresses);
+
+        LibPostal.teardown();
+        setupSucceeded = false;
+
+        try {
+            // torn down, so the only thing that can fail is the connection
+            RuntimeException e = assertThrows(RuntimeException.class, () -> LibPostal.setupSidecar("/nonexistent/postal4j.sock"));
+            assertTrue(e.getMessage().contains("Error connecting to the sidecar daemon"), e.getMessage());
+
+            // the round trip needs a daemon, e.g. postal4jSidecar /tmp/postal4j.sock with -Dpostal4j.sidecar.socket=/tmp/postal4j.sock
+            String socket = System.getProperty("postal4j.sidecar.socket");
+            assumeTrue(socket != null, "No sidecar daemon to test against");
+
+            LibPostal.setupSidecar(socket, 2, 0);
+            setupSucceeded = true;
+
+            assertEquals("sidecar", LibPostal.getBackend());
+            assertEquals(parsed[0], LibPostal.parseAddress(addresses[0]));
+            assertArrayEquals(parsed, LibPostal.parseAddresses(addresses));
+            assertArrayEquals(sorted(expanded[1]), sorted(LibPostal.expandAddress(addresses[1])));
+            assertArrayEquals(sorted(expanded[1]), sorted(LibPostal.expandAddresses(addresses)[1]));
+
+            // only parse/expand calls go to the daemon
+            assertThrows(RuntimeException.class, () -> LibPostal.normalizeString("Main St", Normalization.DEFAULT_STRING_OPTIONS));
+        } finally {
+            if (setupSucceeded) {
+                LibPostal.teardown();
+            }
+            LibPostal.setup(DATA_DIR);
+            setupSucceeded = true;
+        }
+
+        assertNotEquals("sidecar", LibPostal.getBackend());
+    }
+
+    @Test
+    @Order(37)
+    void testSetupInBackground() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        LibPostal.teardown();
+        setupSucceeded = false;
+        assertFalse(LibPostal.isReady());
+
+        try {
+            CompletableFuture<SetupReport> setup = LibPostal.setupInBackground(DATA_DIR, 2, 100, null);
+            assertThrows(IllegalStateException.class, () -> LibPostal.setupInBackground(DATA_DIR));
+
+            SetupReport report = setup.get(5, TimeUnit.MINUTES);
+            setupSucceeded = true;
+
+            assertTrue(LibPostal.isReady());
+            assertTrue(report.getLoadNanos() > 0);
+            assertTrue(report.getWarmupNanos() > 0);
+            assertTrue(report.getWarmupAddresses() >= 40, report.toString());
+            // the warmup leaves the cache empty
+            assertEquals(0, LibPostal.getCacheStats().getEntries());
+            assertFalse(LibPostal.parseAddress("781 Franklin Ave Crown Heights Brooklyn NY 11216").isEmpty());
+
+            LibPostal.teardown();
+            setupSucceeded = false;
+            assertFalse(LibPostal.isReady());
+
+            report = LibPostal.setupInBackground(DATA_DIR, 0, 0, List.of()).get(5, TimeUnit.MINUTES);
+            setupSucceeded = true;
+            assertEquals(0, report.getWarmupAddresses());
+            assertEquals(0, report.getWarmupNanos());
+        } finally {
+            if (setupSucceeded) {
+                LibPostal.teardown();
+            }
+            LibPostal.setup(DATA_DIR);
+            setupSucceeded = true;
+        }
+
+        // setting up twice fails the future rather than the caller
+        ExecutionException failed = assertThrows(ExecutionException.class,
+            () -> LibPostal.setupInBackground(DATA_DIR, 0, 0, List.of()).get(5, TimeUnit.MINUTES));
+        assertInstanceOf(RuntimeException.class, failed.getCause());
+        assertFalse(LibPostal.isReady());
+    }
+
+    @Test
+    @Order(38)
+    void testTeardownDuringCalls() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String[] addresses = {
+            "781 Franklin Ave Crown Heights Brooklyn NY 11216",
+            "Unter den Linden 77, 10117 Berlin, Germany",
+            "Calle de Alcalá 45, 28014 Madrid, España"
+        };
+        AtomicBoolean stop = new AtomicBoolean();
+        AtomicLong completed = new AtomicLong();
+        AtomicReference<Throwable> unexpected = new AtomicReference<>();
+        Thread[] callers = new Thread[8];
+
+        // calls racing teardown either complete or throw "not initialized", they never touch unloaded models
+        for (int t = 0; t < callers.length; t++) {
+            int id = t;
+            callers[t] = new Thread(() -> {
+                for (int i = id; !stop.get(); i++) {
+                    try {
+                        switch (i % 4) {
+                            case 0 -> assertFalse(LibPostal.parseAddress(addresses[i % 3]).isEmpty());
+                            case 1 -> assertTrue(LibPostal.expandAddress(addresses[i % 3]).length > 0);
+                            case 2 -> assertEquals(3, LibPostal.parseAddresses(addresses).length);
+                            default -> assertEquals(3, LibPostal.expandRootAddresses(addresses).length);
+                        }
+                        completed.incrementAndGet();
+                    } catch (RuntimeException e) {
+                        if (e.getMessage() == null || !e.getMessage().contains("not initialized")) {
+                            unexpected.compareAndSet(null, e);
+                        }
+                    } catch (Throwable e) {
+                        unexpected.compareAndSet(null, e);
+                    }
+                }
+            });
+            callers[t].start();
+        }
+
+        try {
+            for (int cycle = 0; cycle < 3; cycle++) {
+                Thread.sleep(200);
+                LibPostal.teardown();
+                setupSucceeded = false;
+
+                Thread.sleep(20);
+                // workers and a cache in some cycles, so batch workers and cache teardown race the calls too
+                LibPostal.setup(DATA_DIR, cycle, cycle == 1 ? 1000 : 0);
+                setupSucceeded = true;
+            }
+            Thread.sleep(200);
+        } finally {
+            stop.set(true);
+            for (Thread caller : callers) {
+                caller.join(60_000);
+            }
+        }
+
+        assertNull(unexpected.get(), () -> String.valueOf(unexpected.get()));
+        assertTrue(completed.get() > 0);
+
+        LibPostal.teardown();
+        LibPostal.setup(DATA_DIR);
+        setupSucceeded = true;
+    }
+
+    @Test
+    @Order(39)
+    void testMatchScores() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "30 W 26th St New York NY";
+
+        assertEquals(1.0f, LibPostal.matchScore(address, address));
+        assertTrue(LibPostal.matchScore(address, "30 West 26th Street New York NY") > 0.0f);
+        assertEquals(0.0f, LibPostal.matchScore(address, "1600 Amphitheatre Pkwy Mountain View CA"));
+        assertEquals(0.0f, LibPostal.matchScore(address, null));
+
+        // the batch scores match one call per pair
+        String[] left = {address, address, address, null};
+        String[] right = {"30 West 26th Street New York NY", "1600 Amphitheatre Pkwy Mountain View CA", address, address};
+        float[] scores = LibPostal.matchScores(left, right);
+
+        assertEquals(left.length, scores.length);
+        for (int i = 0; i < left.length; i++) {
+            assertEquals(LibPostal.matchScore(left[i], right[i]), scores[i]);
+            assertTrue(scores[i] >= 0.0f && scores[i] <= 1.0f);
+        }
+
+        try (NormalizeOptions english = NormalizeOptions.builder().languages("en").build()) {
+            float[] englishScores = LibPostal.matchScores(left, right, english);
+
+            assertEquals(1.0f, englishScores[2]);
+            assertEquals(0.0f, englishScores[3]);
+            assertEquals(LibPostal.matchScore(left[0], right[0], english), englishScores[0]);
+        }
+
+        assertThrows(RuntimeException.class, () -> LibPostal.matchScores(left, new String[1]));
+    }
+
+    @Test
+    @Order(40)
+    void testBlockingIndex() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        NearDupeHashOptions options = NearDupeHashOptions.builder().build();
+        Path file = Files.createTempFile("postal4j-index", ".idx");
+        String[] labels = {"house_number", "road", "city", "state", "postcode"};
+
+        try {
+            try (BlockingIndex index = BlockingIndex.open(file, options)) {
+                index.add(1, labels, new String[]{"123", "main street", "springfield", "il", "62701"});
+
+                // a batch of parsed records, hashed on the native workers
+                String[] addresses = {"Unter den Linden 77, 10117 Berlin, Germany", "781 Franklin Ave Crown Heights Brooklyn NY 11216"};
+                index.add(new long[]{2, 3}, LibPostal.parseAddressesCompact(addresses), null, null);
+
+                assertEquals(3, index.size());
+                assertTrue(index.keyCount() > 0);
+                assertArrayEquals(new long[]{1}, index.candidates(labels, new String[]{"123", "main st", "springfield", "il", "62701"}));
+                long[] brooklyn = index.candidates(LibPostal.parseAddressCompact("781 Franklin Avenue, Brooklyn, NY 11216"));
+                assertTrue(Arrays.stream(brooklyn).anyMatch(id -> id == 3));
+
+                // an index file is only open once
+                assertThrows(RuntimeException.class, () -> BlockingIndex.open(file, options));
+            }
+
+            // reopened with its records, appends go on from there
+            try (BlockingIndex index = BlockingIndex.open(file, options)) {
+                assertEquals(3, index.size());
+
+                index.add(4, labels, new String[]{"123", "main st", "springfield", "il", "62701"});
+
+                assertArrayEquals(new long[]{1, 4}, index.candidates(labels, new String[]{"123", "main street", "springfield", "il", "62701"}));
+                assertArrayEquals(new long[0], index.candidates(labels, new String[]{"1", "nowhere lane", "nowhere", "zz", "00000"}));
+            }
+
+            assertThrows(RuntimeException.class, () -> BlockingIndex.open(file, NearDupeHashOptions.builder().languages("en").build()));
+
+            BlockingIndex closed = BlockingIndex.open(file, options);
+            closed.close();
+            assertThrows(IllegalStateException.class, () -> closed.candidates(labels, labels));
+        } finally {
+            Files.deleteIfExists(file);
+        }
+    }
+
+    @Test
+    @Order(41)
+    void testDiskCache() throws Exception {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "781 Franklin Ave Crown Heights Brooklyn NY 11216";
+        Map<String, String> uncached = LibPostal.parseAddress(address);
+        String[] uncachedExpansions = LibPostal.expandAddress(address);
+        Path file = Files.createTempFile("postal4j-cache", ".bin");
+        Files.delete(file);
+
+        assertEquals(0, LibPostal.getDiskCacheStats().getSlots());
+        assertThrows(RuntimeException.class, () -> LibPostal.setDiskCache(file, 1024));
+
+        LibPostal.teardown();
+        setupSucceeded = false;
+
+        try {
+            LibPostal.setDiskCache(file, 8 << 20);
+            LibPostal.setup(DATA_DIR, 0, 0);
+            setupSucceeded = true;
+
+            assertEquals(uncached, LibPostal.parseAddress(address));
+            assertArrayEquals(sorted(uncachedExpansions), sorted(LibPostal.expandAddress(address)));
+
+            DiskCacheStats stats = LibPostal.getDiskCacheStats();
+            assertEquals(2, stats.getStores());
+            assertEquals(0, stats.getHits());
+            assertTrue(stats.getSlots() > 0);
+
+            // the file survives a restart, so a new setup is served from disk
+            LibPostal.teardown();
+            setupSucceeded = false;
+            LibPostal.setup(DATA_DIR, 0, 100);
+            setupSucceeded = true;
+
+            assertEquals(uncached, LibPostal.parseAddress("  781 franklin AVE   Crown Heights Brooklyn NY 11216 "));
+            assertArrayEquals(sorted(uncachedExpansions), sorted(LibPostal.expandAddress(address)));
+            assertEquals(2, LibPostal.getDiskCacheStats().getHits());
+
+            // promoted to the memory cache on the way
+            assertEquals(uncached, LibPostal.parseAddress(address));
+            assertEquals(2, LibPostal.getDiskCacheStats().getHits());
+            assertEquals(1, LibPostal.getCacheStats().getHits());
+        } finally {
+            LibPostal.setDiskCache(null, 0);
+
+            if (setupSucceeded) {
+                LibPostal.teardown();
+            }
+            LibPostal.setup(DATA_DIR);
+            setupSucceeded = true;
+            Files.deleteIfExists(file);
+        }
+
+        assertEquals(0, LibPostal.getDiskCacheStats().getSlots());
+    }
+
+    @Test
+    @Order(42)
+    void testSerializedOutput() {
+        assumeTrue(setupSucceeded, "Setup must succeed before running this test");
+
+        String address = "781 Franklin Ave Crown Heights Brooklyn NY 11216";
+        Map<String, String> components = LibPostal.parseAddress(address);
+        byte[] out = new byte[4096];
+
+        int length = LibPostal.parseAddressTo(address, RecordFormat.JSON, out, 10);
+        String json = new String(out, 10, length, StandardCharsets.UTF_8);
+        assertTrue(json.startsWith("{") && json.endsWith("}\n"));
+        components.forEach((label, value) -> assertTrue(json.contains("\"" + label + "\":\"" + value + "\"")));
+
+        String csv = new String(out, 0, LibPostal.parseAddressTo(address, RecordFormat.CSV, out, 0), StandardCharsets.UTF_8);
+        assertEquals(AddressLabel.values().length, csv.split(",", -1).length);
+        assertTrue(csv.contains(components.get("road")));
+
+        // direct buffers are written in place, position and limit untouched
+        ByteBuffer direct = ByteBuffer.allocateDirect(4096);
+        int binaryLength = LibPostal.parseAddressTo(address, RecordFormat.BINARY, direct, 0);
+        assertEquals(components.size(), direct.order(ByteOrder.LITTLE_ENDIAN).getInt(0));
+        assertEquals(0, direct.position());
+
+        String[] expansions = LibPostal.expandAddress(address);
+        length = LibPostal.expandAddressTo(address, null, RecordFormat.JSON, out, 0);
+        assertTrue(new String(out, 0, length, StandardCharsets.UTF_8).contains("\"" + expansions[0] + "\""));
+
+        // a record that does not fit is not written, the length tells how much room it needs
+        byte[] small = new byte[8];
+        assertEquals(binaryLength, LibPostal.parseAddressTo(address, RecordFormat.BINARY, small, 0));
+        assertArrayEquals(new byte[8], small);
+
+        // batches stop at the first record that does not fit
+        String[] addresses = {address, "Unter den Linden 77, 10117 Berlin, Germany", address};
+        int[] ends = new int[addresses.length];
+        assertEquals(3, LibPostal.parseAddressesTo(addresses, RecordFormat.JSON, out, 0, ends));
+        assertEquals(json, new String(out, 0, ends[0], StandardCharsets.UTF_8));
+        assertEquals(json, new String(out, ends[1], ends[2] - ends[1], StandardCharsets.UTF_8));
+        assertEquals(1, LibPostal.parseAddressesTo(addresses, RecordFormat.JSON, new byte[ends[1] - 1], 0, ends));
+        assertEquals(3, LibPostal.expandAddressesTo(addresses, null, RecordFormat.CSV, direct, 0, ends));
+
+        // heap buffers over part of an array report ends within the buffer, not the array
+        ByteBuffer slice = ByteBuffer.wrap(new byte[4096], 7, 4000).slice();
+        assertEquals(3, LibPostal.parseAddressesTo(addresses, RecordFormat.JSON, slice, 0, ends));
+        byte[] first = new byte[ends[0]];
+        slice.get(0, first);
+        assertEquals(json, new String(first, StandardCharsets.UTF_8));
+        assertEquals(ends[2] - ends[1], ends[0]);
+
+        assertThrows(IndexOutOfBoundsException.class, () -> LibPostal.parseAddressTo(address, RecordFormat.JSON, out, 4097));
+        assertThrows(ReadOnlyBufferException.class, () -> LibPostal.parseAddressTo(address, RecordFormat.JSON, direct.asReadOnlyBuffer(), 0));
+        assertThrows(RuntimeException.class, () -> LibPostal.parseAddressesTo(addresses, RecordFormat.JSON, out, 0, new int[1]));
+    }
+
+    private static boolean awaitQuietly(CountDownLatch latch) {
+        try {
+            return latch.await(30, TimeUnit.SECONDS);
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            return false;
+        }
+    }
+
+    private static String[] sorted(String[] values) {
+        String[] copy = values.clone();
+        Arrays.sort(copy);
+        return copy;
+    }
+
     @Test
     @Order(100)
     void testTeardown() {
@@ -0,0 +1,84 @@
+package com.dnebinger.postal4j;
+
+import org.junit.jupiter.api.Test;
+
+import java.nio.charset.StandardCharsets;
+import java.util.Map;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+/**
+ * Tests for the compact parse result classes, built the same way the native code builds them.
+ */
+class ParsedAddressTest {
+
+    private static ParsedAddressBatch sampleBatch() {
+        // two addresses: "123" / "main street", then "10117" / "berlin" / "straße"
+        byte[] values = "123main street10117berlinstraße".getBytes(StandardCharsets.UTF_8);
+        byte[] labels = {
+            (byte) AddressLabel.HOUSE_NUMBER.ordinal(),
+            (byte) AddressLabel.ROAD.ordinal(),
+            (byte) AddressLabel.POSTCODE.ordinal(),
+            (byte) AddressLabel.CITY.ordinal(),
+            (byte) AddressLabel.ROAD.ordinal()
+        };
+        int[] offsets = {0, 3, 14, 19, 25, values.length};
+
+        return new ParsedAddressBatch(new int[]{0, 2, 5}, labels, values, offsets);
+    }
+
+    @Test
+    void testBatchViews() {
+        ParsedAddressBatch batch = sampleBatch();
+
+        assertEquals(2, batch.size());
+        assertEquals(2, batch.componentCount(0));
+        assertEquals(3, batch.componentCount(1));
+
+        ParsedAddress second = batch.get(1);
+
+        assertEquals(AddressLabel.POSTCODE, second.label(0));
+        assertEquals("10117", second.value(0));
+        assertEquals("straße", second.get(AddressLabel.ROAD));
+        assertEquals(7, second.valueLength(2));
+        assertNull(second.get(AddressLabel.HOUSE_NUMBER));
+    }
+
+    @Test
+    void testToMap() {
+        Map<String, String> map = sampleBatch().get(0).toMap();
+
+        assertEquals(Map.of("house_number", "123", "road", "main street"), map);
+    }
+
+    @Test
+    void testCopyValue() {
+        byte[] destination = new byte[16];
+        int length = sampleBatch().get(0).copyValue(1, destination, 2);
+
+        assertEquals("main street", new String(destination, 2, length, StandardCharsets.UTF_8));
+    }
+
+    @Test
+    void testIndexBounds() {
+        ParsedAddressBatch batch = sampleBatch();
+
+        assertThrows(IndexOutOfBoundsException.class, () -> batch.get(2));
+        assertThrows(IndexOutOfBoundsException.class, () -> batch.get(0).value(2));
+    }
+
+    @Test
+    void testEmptyResult() {
+        ParsedAddress empty = new ParsedAddress(new byte[0], new byte[0], new int[]{0});
+
+        assertTrue(empty.isEmpty());
+        assertTrue(empty.toMap().isEmpty());
+    }
+
+    @Test
+    void testLabelLookup() {
+        assertEquals(AddressLabel.HOUSE_NUMBER, AddressLabel.fromLabel("house_number"));
+        assertEquals("world_region", AddressLabel.WORLD_REGION.label());
+        assertThrows(IllegalArgumentException.class, () -> AddressLabel.fromLabel("galaxy"));
+    }
+}